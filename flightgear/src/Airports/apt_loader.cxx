@@ -93,6 +93,11 @@ public:
         exit(-1);
     }
 
+    parseAPT(in);
+  }
+
+  void parseAPT(std::istream& in)
+  {
     string line;
     char tmp[2049];
     tmp[2048] = 0;
@@ -547,6 +552,13 @@ bool airportDBLoad( const SGPath &aptdb_file )
   ld.parseAPT(aptdb_file);
   return true;
 }
+
+bool airportDBLoad(std::istream& in)
+{
+  APTLoader ld;
+  ld.parseAPT(in);
+  return true;
+}
   
 bool metarDataLoad(const SGPath& metar_file)
 {
@@ -556,6 +568,11 @@ bool metarDataLoad(const SGPath& metar_file)
     return false;
   }
   
+  return metarDataLoad(metar_in);
+}
+
+bool metarDataLoad(std::istream& metar_in)
+{
   NavDataCache* cache = NavDataCache::instance();
   string ident;
   while ( metar_in ) {
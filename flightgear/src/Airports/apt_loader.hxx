@@ -27,6 +27,8 @@
 
 #include <simgear/compiler.h>
 
+#include <iosfwd>
+
 class SGPath;
 
 namespace flightgear
@@ -40,6 +42,11 @@ bool airportDBLoad(const SGPath& path);
 
 bool metarDataLoad(const SGPath& path);
 
+// the same, from the file contents already read into memory
+bool airportDBLoad(std::istream& in);
+
+bool metarDataLoad(std::istream& in);
+
 } // of namespace flighgear
 
 #endif // _FG_APT_LOADER_HXX
@@ -51,6 +51,7 @@
 #include <AIModel/performancedata.hxx>
 #include <AIModel/AIFlightPlan.hxx>
 #include <Navaids/NavDataCache.hxx>
+#include <Navaids/IndexedHeap.hxx>
 
 #include <ATC/atc_mgr.hxx>
 
@@ -177,7 +178,7 @@ FGGroundNetwork::FGGroundNetwork() :
     group = 0;
     version = 0;
     networkInitialized = false;
-
+    routeGraphs[0] = routeGraphs[1] = NULL;
 }
 
 FGGroundNetwork::~FGGroundNetwork()
@@ -194,6 +195,9 @@ FGGroundNetwork::~FGGroundNetwork()
   BOOST_FOREACH(FGTaxiSegment* seg, segments) {
     delete seg;
   }
+  
+  delete routeGraphs[0];
+  delete routeGraphs[1];
 }
 
 void FGGroundNetwork::saveElevationCache()
@@ -385,30 +389,123 @@ static int edgePenalty(FGTaxiNode* tn)
     (tn->getIsOnRunway() ? 1000 : 0);
 }
 
-class ShortestPathData
+/**
+ * The nodes are numbered in order of their ID; the segments leaving node i
+ * are edgeTarget[firstEdge[i]] up to (excluding) firstEdge[i+1]. The cost of
+ * a segment is its length plus the penalty of the node it leads to.
+ */
+class FGGroundNetwork::RouteGraph
 {
 public:
-  ShortestPathData() :
-    score(HUGE_VAL)
-  {}
+  typedef std::pair<PositionedID, PositionedID> Edge;
   
-  double score;
-  FGTaxiNodeRef previousNode;
+  RouteGraph(const PositionedIDVec& aNodes, const std::vector<Edge>& aEdges) :
+    ids(aNodes)
+  {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    
+    carts.reserve(ids.size());
+    std::vector<int> penalty;
+    BOOST_FOREACH(PositionedID id, ids) {
+      FGTaxiNodeRef node = FGPositioned::loadById<FGTaxiNode>(id);
+      carts.push_back(node->cart());
+      penalty.push_back(edgePenalty(node));
+    }
+    
+  // only the segments between nodes of this graph; count them per start
+  // node and turn the counts into offsets
+    firstEdge.assign(ids.size() + 1, 0);
+    std::vector<Edge> inGraph;
+    BOOST_FOREACH(const Edge& e, aEdges) {
+      unsigned int from = indexOf(e.first);
+      if ((from == NO_NODE) || (indexOf(e.second) == NO_NODE)) {
+        continue;
+      }
+      
+      inGraph.push_back(e);
+      ++firstEdge[from + 1];
+    }
+    
+    for (unsigned int i=0; i<ids.size(); ++i) {
+      firstEdge[i + 1] += firstEdge[i];
+    }
+    
+    edgeTarget.resize(inGraph.size());
+    edgeCost.resize(inGraph.size());
+    std::vector<unsigned int> next(firstEdge.begin(), firstEdge.end() - 1);
+    BOOST_FOREACH(const Edge& e, inGraph) {
+      unsigned int from = indexOf(e.first), to = indexOf(e.second);
+      unsigned int k = next[from]++;
+      edgeTarget[k] = to;
+      edgeCost[k] = dist(carts[from], carts[to]) + penalty[to];
+    }
+  }
+  
+  enum { NO_NODE = ~0u };
+  
+  unsigned int size() const
+  { return ids.size(); }
+  
+  unsigned int indexOf(PositionedID aID) const
+  {
+    PositionedIDVec::const_iterator it = std::lower_bound(ids.begin(), ids.end(), aID);
+    if ((it == ids.end()) || (*it != aID)) {
+      return NO_NODE;
+    }
+    
+    return it - ids.begin();
+  }
+  
+  PositionedIDVec ids;
+  std::vector<SGVec3d> carts;
+  std::vector<unsigned int> firstEdge;
+  std::vector<unsigned int> edgeTarget;
+  std::vector<double> edgeCost;
 };
 
+FGGroundNetwork::RouteGraph* FGGroundNetwork::routeGraph(bool fullSearch)
+{
+  RouteGraph*& graph = routeGraphs[fullSearch ? 1 : 0];
+  if (!graph) {
+    std::vector<RouteGraph::Edge> edges;
+    BOOST_FOREACH(FGTaxiSegment* seg, segments) {
+      edges.push_back(RouteGraph::Edge(seg->startNode, seg->endNode));
+    }
+    
+    flightgear::NavDataCache* cache = flightgear::NavDataCache::instance();
+    graph = new RouteGraph(cache->groundNetNodes(parent->guid(), !fullSearch), edges);
+  }
+  
+  return graph;
+}
+
 FGTaxiRoute FGGroundNetwork::findShortestRoute(PositionedID start, PositionedID end,
         bool fullSearch)
 {
-//implements Dijkstra's algorithm to find shortest distance route from start to end
-//taken from http://en.wikipedia.org/wiki/Dijkstra's_algorithm
-    FGTaxiNodeVector unvisited;
-    flightgear::NavDataCache* cache = flightgear::NavDataCache::instance();
-    std::map<FGTaxiNode*, ShortestPathData> searchData;
+  // AI traffic asks for the same gate <-> runway routes again and again
+    const unsigned int MAX_CACHED_ROUTES = 4096;
+    TaxiRouteCache& cache = routeCache[fullSearch ? 1 : 0];
+    std::pair<PositionedID, PositionedID> key(start, end);
+    TaxiRouteCache::iterator it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
   
-    BOOST_FOREACH(PositionedID n, cache->groundNetNodes(parent->guid(), !fullSearch)) {
-      unvisited.push_back(findNode(n));
+    if (cache.size() >= MAX_CACHED_ROUTES) {
+        cache.clear();
     }
   
+    FGTaxiRoute route = searchRoute(start, end, fullSearch);
+    cache[key] = route;
+    return route;
+}
+
+FGTaxiRoute FGGroundNetwork::searchRoute(PositionedID start, PositionedID end,
+        bool fullSearch)
+{
+//implements A* over the taxi graph, with the straight distance to the end
+//node as the estimate, which never exceeds the cost of the remaining route
     FGTaxiNode *firstNode = findNode(start);
     if (!firstNode)
     {
@@ -417,7 +514,6 @@ FGTaxiRoute FGGroundNetwork::findShortestRoute(PositionedID start, PositionedID
                << " at " << ((parent) ? parent->getId() : "<unknown>"));
         return FGTaxiRoute();
     }
-    searchData[firstNode].score = 0.0;
 
     FGTaxiNode *lastNode = findNode(end);
     if (!lastNode)
@@ -427,36 +523,56 @@ FGTaxiRoute FGGroundNetwork::findShortestRoute(PositionedID start, PositionedID
                << " at " << ((parent) ? parent->getId() : "<unknown>"));
         return FGTaxiRoute();
     }
-
-    while (!unvisited.empty()) {
-        FGTaxiNode *best = unvisited.front();
-        BOOST_FOREACH(FGTaxiNode* i, unvisited) {
-            if (searchData[i].score < searchData[best].score) {
-                best = i;
-            }
-        }
-      
-      // remove 'best' from the unvisited set
-        FGTaxiNodeVectorIterator newend =
-            remove(unvisited.begin(), unvisited.end(), best);
-        unvisited.erase(newend, unvisited.end());
-
-        if (best == lastNode) { // found route or best not connected
+  
+    if (start == end) {
+        return FGTaxiRoute(PositionedIDVec(1, start), 0.0, 0);
+    }
+  
+    const RouteGraph* graph = routeGraph(fullSearch);
+    unsigned int first = graph->indexOf(start), last = graph->indexOf(end);
+    std::vector<double> score(graph->size(), HUGE_VAL);
+    std::vector<double> estimate(graph->size(), HUGE_VAL);
+    std::vector<double> totalCost(graph->size(), HUGE_VAL);
+    std::vector<unsigned int> previous(graph->size(), RouteGraph::NO_NODE);
+    flightgear::IndexedHeap open(totalCost);
+  
+    if ((first != RouteGraph::NO_NODE) && (last != RouteGraph::NO_NODE)) {
+        score[first] = 0.0;
+        totalCost[first] = 0.0;
+        open.push(first);
+    }
+  
+    while (!open.empty()) {
+        unsigned int best = open.pop();
+        if (best == last) {
             break;
         }
       
-        BOOST_FOREACH(PositionedID targetId, cache->groundNetEdgesFrom(best->guid(), !fullSearch)) {
-            FGTaxiNodeRef tgt = FGPositioned::loadById<FGTaxiNode>(targetId);
-            double edgeLength = dist(best->cart(), tgt->cart());          
-            double alt = searchData[best].score + edgeLength + edgePenalty(tgt);
-            if (alt < searchData[tgt].score) {    // Relax (u,v)
-                searchData[tgt].score = alt;
-                searchData[tgt].previousNode = best;
+      // closed nodes are opened again if a shorter path to them turns up,
+      // in case rounding makes the estimate overshoot by a hair
+        for (unsigned int k = graph->firstEdge[best]; k < graph->firstEdge[best + 1]; ++k) {
+            unsigned int tgt = graph->edgeTarget[k];
+            double alt = score[best] + graph->edgeCost[k];
+            if (alt >= score[tgt]) {
+                continue;
+            }
+          
+            if (estimate[tgt] == HUGE_VAL) {
+                estimate[tgt] = dist(graph->carts[tgt], graph->carts[last]);
+            }
+          
+            score[tgt] = alt;
+            totalCost[tgt] = alt + estimate[tgt];
+            previous[tgt] = best;
+            if (open.contains(tgt)) {
+                open.decrease(tgt);
+            } else {
+                open.push(tgt);
             }
         } // of outgoing arcs/segments from current best node iteration
-    } // of unvisited nodes remaining
+    } // of open nodes remaining
 
-    if (searchData[lastNode].score == HUGE_VAL) {
+    if ((last == RouteGraph::NO_NODE) || (score[last] == HUGE_VAL)) {
         // no valid route found
         if (fullSearch) {
             SG_LOG(SG_GENERAL, SG_ALERT,
@@ -469,14 +585,11 @@ FGTaxiRoute FGGroundNetwork::findShortestRoute(PositionedID start, PositionedID
   
     // assemble route from backtrace information
     PositionedIDVec nodes;
-    FGTaxiNode *bt = lastNode;
-    while (searchData[bt].previousNode != 0) {
-        nodes.push_back(bt->guid());
-        bt = searchData[bt].previousNode;
+    for (unsigned int n = last; n != RouteGraph::NO_NODE; n = previous[n]) {
+        nodes.push_back(graph->ids[n]);
     }
-    nodes.push_back(start);
     reverse(nodes.begin(), nodes.end());
-    return FGTaxiRoute(nodes, searchData[lastNode].score, 0);
+    return FGTaxiRoute(nodes, score[last], 0);
 }
 
 /* ATC Related Functions */
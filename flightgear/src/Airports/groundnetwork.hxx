@@ -27,6 +27,7 @@
 #include <simgear/compiler.h>
 
 #include <string>
+#include <map>
 
 #include "gnnode.hxx"
 #include "parking.hxx"
@@ -189,6 +190,23 @@ private:
     void parseCache();
   
     void loadSegments();
+    
+    /**
+     * The taxi graph in memory, for findShortestRoute: one for the full
+     * network, one for the pushback network, built on first use
+     */
+    class RouteGraph;
+    RouteGraph* routeGraphs[2];
+    RouteGraph* routeGraph(bool fullSearch);
+    
+    /**
+     * Routes found before, by start and end node. The network does not
+     * change once loaded, so they stay valid.
+     */
+    typedef std::map<std::pair<PositionedID, PositionedID>, FGTaxiRoute> TaxiRouteCache;
+    TaxiRouteCache routeCache[2];
+    
+    FGTaxiRoute searchRoute(PositionedID start, PositionedID end, bool fullSearch);
 public:
     FGGroundNetwork();
     ~FGGroundNetwork();
@@ -51,6 +51,7 @@
 #include "Navaids/positioned.hxx"
 #include <Navaids/waypoint.hxx>
 #include <Navaids/procedure.hxx>
+#include <Navaids/airways.hxx>
 #include "Airports/airport.hxx"
 #include "Airports/runways.hxx"
 #include <GUI/new_gui.hxx>
@@ -204,6 +205,51 @@ static bool commandDeleteWaypt(const SGPropertyNode* arg)
   return true;
 }
 
+// city pairs routed by airway-benchmark when none are given
+static const char* benchmarkPairs[][2] = {
+  {"EGLL", "LIRF"}, {"EHAM", "LEMD"}, {"EDDF", "ESSA"}, {"LFPG", "LGAV"},
+  {"KJFK", "KLAX"}, {"KSEA", "KMIA"}, {"KORD", "KDFW"}, {"CYYZ", "KATL"},
+  {"EGLL", "KJFK"}, {"RJTT", "WSSS"}, {"YSSY", "YPPH"}, {"OMDB", "VIDP"}
+};
+
+/**
+ * Time the airway router against the database search it replaced, over
+ * the airport pairs given as pair/from and pair/to, or a built-in set.
+ * network is 'high' (the default) or 'low'.
+ */
+static bool commandAirwayBenchmark(const SGPropertyNode* arg)
+{
+  std::vector<std::pair<std::string, std::string> > idents;
+  BOOST_FOREACH(SGPropertyNode* pair, arg->getChildren("pair")) {
+    idents.push_back(std::make_pair(pair->getStringValue("from"),
+                                    pair->getStringValue("to")));
+  }
+  
+  if (idents.empty()) {
+    for (unsigned int i=0; i<sizeof(benchmarkPairs) / sizeof(benchmarkPairs[0]); ++i) {
+      idents.push_back(std::make_pair(benchmarkPairs[i][0], benchmarkPairs[i][1]));
+    }
+  }
+  
+  std::vector<std::pair<WayptRef, WayptRef> > pairs;
+  for (unsigned int i=0; i<idents.size(); ++i) {
+    FGAirportRef from = FGAirport::findByIdent(idents[i].first);
+    FGAirportRef to = FGAirport::findByIdent(idents[i].second);
+    if (!from || !to) {
+      SG_LOG(SG_AUTOPILOT, SG_INFO, "airway-benchmark: unknown airport in "
+             << idents[i].first << "-" << idents[i].second);
+      continue;
+    }
+    
+    pairs.push_back(std::make_pair(WayptRef(new NavaidWaypoint(from, NULL)),
+                                   WayptRef(new NavaidWaypoint(to, NULL))));
+  }
+  
+  bool low = !strcmp(arg->getStringValue("network", "high"), "low");
+  Airway::Network* net = low ? Airway::lowLevel() : Airway::highLevel();
+  return net->benchmark(pairs);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 FGRouteMgr::FGRouteMgr() :
@@ -226,6 +272,7 @@ FGRouteMgr::FGRouteMgr() :
   cmdMgr->addCommand("set-active-waypt", commandSetActiveWaypt);
   cmdMgr->addCommand("insert-waypt", commandInsertWaypt);
   cmdMgr->addCommand("delete-waypt", commandDeleteWaypt);
+  cmdMgr->addCommand("airway-benchmark", commandAirwayBenchmark);
 }
 
 
@@ -224,15 +224,23 @@ void AreaSampler::update( double dt )
 
     SGTimeStamp start = SGTimeStamp::now();
     while( (SGTimeStamp::now() - start).toSecs() < dt * _max_computation_time_norm ) {
-        // sample until we used up all our configured time
-        double distance = sg_random();
-        distance = _radius * (1-distance*distance);
-        double course = sg_random() * 2.0 * SG_PI;
-        SGGeod probe = SGGeod::fromGeoc(center.advanceRadM( course, distance ));
-        double elevation_m = 0.0;
-
-        if (scenery->get_elevation_m( probe, elevation_m, NULL )) 
-            _elevations.push_front(elevation_m *= SG_METER_TO_FEET);
+        // sample until we used up all our configured time, some probes
+        // at a time so the scenery can answer them together
+        FGScenery::ElevationQueryList probes;
+        for( int i = 0; i < 16; i++ ) {
+            double distance = sg_random();
+            distance = _radius * (1-distance*distance);
+            double course = sg_random() * 2.0 * SG_PI;
+            SGGeod probe = SGGeod::fromGeoc(center.advanceRadM( course, distance ));
+            probes.push_back( FGScenery::ElevationQuery( probe ) );
+        }
+        scenery->get_elevations_m( probes );
+
+        for( FGScenery::ElevationQueryList::size_type i = 0; i < probes.size()
+             && _elevations.size() < (deque<unsigned>::size_type)_max_samples; i++ ) {
+            if( probes[i].valid )
+                _elevations.push_front(probes[i].elevation * SG_METER_TO_FEET);
+        }
         
         if( _elevations.size() >= (deque<unsigned>::size_type)_max_samples ) {
             // sampling complete? 
@@ -45,6 +45,7 @@
 #include <simgear/scene/util/SGNodeMasks.hxx>
 #include <simgear/scene/util/SGSceneUserData.hxx>
 #include <simgear/scene/util/OsgMath.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <simgear/bvh/BVHNode.hxx>
 #include <simgear/bvh/BVHGroup.hxx>
@@ -62,9 +63,9 @@
 
 #ifdef GROUNDCACHE_DEBUG
 #include <simgear/scene/model/BVHDebugCollectVisitor.hxx>
-#include <Main/fg_props.hxx>
 #endif
 
+#include <Main/fg_props.hxx>
 #include <Main/globals.hxx>
 #include <Scenery/scenery.hxx>
 #include <Scenery/tilemgr.hxx>
@@ -302,8 +303,22 @@ FGGroundCache::FGGroundCache() :
     reference_wgs84_point(SGVec3d(0, 0, 0)),
     reference_vehicle_radius(0),
     down(0.0, 0.0, 0.0),
-    found_ground(false)
+    found_ground(false),
+    _prefetchStartTime(0),
+    _prefetchEndTime(0),
+    _lastPoint(SGVec3d(0, 0, 0)),
+    _lastTime(0)
 {
+    // Seconds of flight the prefetched cache should cover, zero walks
+    // the scene graph on every call as before
+    _lookaheadNode = fgGetNode("/fdm/ground-cache/lookahead-sec", true);
+    if (!_lookaheadNode->hasValue())
+        _lookaheadNode->setDoubleValue(1);
+    _updateTimeNode = fgGetNode("/fdm/ground-cache/update-usec", true);
+    _refillTimeNode = fgGetNode("/fdm/ground-cache/refill-usec", true);
+    _refillCountNode = fgGetNode("/fdm/ground-cache/refills", true);
+    _refillCountNode->setIntValue(0);
+
 #ifdef GROUNDCACHE_DEBUG
     _lookupTime = SGTimeStamp::fromSec(0.0);
     _lookupCount = 0;
@@ -320,9 +335,8 @@ bool
 FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
                                     const SGVec3d& pt, double rad)
 {
-#ifdef GROUNDCACHE_DEBUG
     SGTimeStamp t0 = SGTimeStamp::now();
-#endif
+    double refillUSec = 0;
 
     // Empty cache.
     found_ground = false;
@@ -354,31 +368,75 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     // Get the ground cache, that is a local collision tree of the environment
     startSimTime += cache_time_offset;
     endSimTime += cache_time_offset;
-    CacheFill subtreeCollector(pt, down, rad, startSimTime, endSimTime);
-    globals->get_scenery()->get_scene_graph()->accept(subtreeCollector);
-    _localBvhTree = subtreeCollector.getBVHNode();
-
-    if (subtreeCollector.getHaveElevationBelowCache()) {
-        // Use the altitude value below the cache that we gathered during
-        // cache collection
-        _altitude = subtreeCollector.getElevationBelowCache();
-        _material = subtreeCollector.getMaterialBelowCache();
-        found_ground = true;
-    } else if (_localBvhTree) {
-        // We have nothing below us, so try starting with the lowest point
-        // upwards for a croase altitude value
-        SGLineSegmentd line(pt + reference_vehicle_radius*down, pt - 1e3*down);
-        simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, startSimTime);
-        _localBvhTree->accept(lineSegmentVisitor);
 
-        if (!lineSegmentVisitor.empty()) {
-            SGGeod geodPt = SGGeod::fromCart(lineSegmentVisitor.getPoint());
-            _altitude = geodPt.getElevationM();
-            _material = lineSegmentVisitor.getMaterial();
+    // Estimate where the vehicle is heading from the last call
+    SGVec3d velocity(0, 0, 0);
+    double dt = startSimTime - _lastTime;
+    if (0 < dt && dt < 1)
+        velocity = (pt - _lastPoint)/dt;
+    _lastPoint = pt;
+    _lastTime = startSimTime;
+
+    bool haveCache = collect_from_prefetch(startSimTime, endSimTime, pt, rad);
+    double lookahead = _lookaheadNode->getDoubleValue();
+    if (!haveCache && 0 < lookahead) {
+        // Walk the scenery for a sphere reaching half the lookahead time
+        // ahead and back from the middle of the expected path, with some
+        // margin for turns. Only worth it if the ground is within that
+        // sphere, as the cache is only collected from the prefetched
+        // tree if the ground below is found there.
+        double radius = 2*rad + 0.5*lookahead*norm(velocity);
+        if (geodPt.getElevationM() - _altitude < radius - rad) {
+            SGTimeStamp t1 = SGTimeStamp::now();
+            SGVec3d center = pt + 0.5*lookahead*velocity;
+            double endTime = endSimTime + lookahead;
+            CacheFill prefetch(center, down, radius, startSimTime, endTime);
+            globals->get_scenery()->get_scene_graph()->accept(prefetch);
+            _prefetchBvhTree = prefetch.getBVHNode();
+            _prefetchSphere = SGSphered(center, radius);
+            _prefetchStartTime = startSimTime;
+            _prefetchEndTime = endTime;
+            refillUSec += (SGTimeStamp::now() - t1).toUSecs();
+            _refillCountNode->setIntValue(_refillCountNode->getIntValue() + 1);
+
+            haveCache = collect_from_prefetch(startSimTime, endSimTime, pt, rad);
+        }
+    }
+
+    if (!haveCache) {
+        _prefetchBvhTree = 0;
+
+        SGTimeStamp t1 = SGTimeStamp::now();
+        CacheFill subtreeCollector(pt, down, rad, startSimTime, endSimTime);
+        globals->get_scenery()->get_scene_graph()->accept(subtreeCollector);
+        _localBvhTree = subtreeCollector.getBVHNode();
+        refillUSec += (SGTimeStamp::now() - t1).toUSecs();
+        _refillCountNode->setIntValue(_refillCountNode->getIntValue() + 1);
+
+        if (subtreeCollector.getHaveElevationBelowCache()) {
+            // Use the altitude value below the cache that we gathered during
+            // cache collection
+            _altitude = subtreeCollector.getElevationBelowCache();
+            _material = subtreeCollector.getMaterialBelowCache();
             found_ground = true;
+        } else if (_localBvhTree) {
+            // We have nothing below us, so try starting with the lowest point
+            // upwards for a croase altitude value
+            SGLineSegmentd line(pt + reference_vehicle_radius*down,
+                                pt - 1e3*down);
+            simgear::BVHLineSegmentVisitor lineSegmentVisitor(line,
+                                                              startSimTime);
+            _localBvhTree->accept(lineSegmentVisitor);
+
+            if (!lineSegmentVisitor.empty()) {
+                SGGeod geodPt = SGGeod::fromCart(lineSegmentVisitor.getPoint());
+                _altitude = geodPt.getElevationM();
+                _material = lineSegmentVisitor.getMaterial();
+                found_ground = true;
+            }
         }
     }
-    
+
     if (!found_ground) {
         // Ok, still nothing here?? Last resort ...
         double alt = 0;
@@ -394,8 +452,11 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         SG_LOG(SG_FLIGHT, SG_WARN, "prepare_ground_cache(): trying to build "
                "cache without any scenery below the aircraft");
 
-#ifdef GROUNDCACHE_DEBUG
     t0 = SGTimeStamp::now() - t0;
+    _updateTimeNode->setDoubleValue(t0.toUSecs());
+    _refillTimeNode->setDoubleValue(refillUSec);
+
+#ifdef GROUNDCACHE_DEBUG
     _buildTime += t0;
     _buildCount++;
 
@@ -433,6 +494,41 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     return found_ground;
 }
 
+bool
+FGGroundCache::collect_from_prefetch(double startSimTime, double endSimTime,
+                                     const SGVec3d& pt, double rad)
+{
+    if (!_prefetchBvhTree)
+        return false;
+    // The motion of moving objects is only known within the times the
+    // prefetched tree was collected for
+    if (startSimTime < _prefetchStartTime || _prefetchEndTime < endSimTime)
+        return false;
+    if (_prefetchSphere.getRadius() < dist(_prefetchSphere.getCenter(), pt) + rad)
+        return false;
+
+    // The same croase ground intersection the scenery walk does. Only
+    // if the hit is within the prefetched sphere, all of the line above
+    // it is, and nothing closer could have been missed.
+    double maxDown = SGGeod::fromCart(pt).getElevationM() + 9999;
+    SGLineSegmentd line(pt + rad*down, pt + maxDown*down);
+    simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, startSimTime);
+    _prefetchBvhTree->accept(lineSegmentVisitor);
+    if (lineSegmentVisitor.empty())
+        return false;
+    if (!intersects(_prefetchSphere, lineSegmentVisitor.getPoint()))
+        return false;
+
+    simgear::BVHSubTreeCollector subTreeCollector(SGSphered(pt, rad));
+    _prefetchBvhTree->accept(subTreeCollector);
+    _localBvhTree = subTreeCollector.getNode();
+
+    _altitude = SGGeod::fromCart(lineSegmentVisitor.getPoint()).getElevationM();
+    _material = lineSegmentVisitor.getMaterial();
+    found_ground = true;
+    return true;
+}
+
 bool
 FGGroundCache::is_valid(double& ref_time, SGVec3d& pt, double& rad)
 {
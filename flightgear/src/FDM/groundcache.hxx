@@ -28,6 +28,7 @@
 #include <simgear/math/SGMath.hxx>
 #include <simgear/math/SGGeometry.hxx>
 #include <simgear/bvh/BVHNode.hxx>
+#include <simgear/props/props.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
 
 // #define GROUNDCACHE_DEBUG
@@ -118,6 +119,11 @@ private:
     class WireIntersector;
     class WireFinder;
 
+    // Collects the cache for pt and rad from the prefetched tree, if that
+    // still covers it. Returns false if the scenery needs to be walked.
+    bool collect_from_prefetch(double startSimTime, double endSimTime,
+                               const SGVec3d& pt, double rad);
+
     // Approximate ground radius.
     // In case the aircraft is too high above ground.
     double _altitude;
@@ -140,6 +146,23 @@ private:
 
     SGSharedPtr<simgear::BVHNode> _localBvhTree;
 
+    // A larger cache around the path the vehicle is expected to take
+    // within the next lookahead seconds. As long as it covers the
+    // requested sphere the cache is collected from that tree instead of
+    // the whole scene graph.
+    SGSharedPtr<simgear::BVHNode> _prefetchBvhTree;
+    SGSphered _prefetchSphere;
+    double _prefetchStartTime;
+    double _prefetchEndTime;
+    // Where the last cache was requested, to estimate the velocity.
+    SGVec3d _lastPoint;
+    double _lastTime;
+
+    SGPropertyNode_ptr _lookaheadNode;
+    SGPropertyNode_ptr _updateTimeNode;
+    SGPropertyNode_ptr _refillTimeNode;
+    SGPropertyNode_ptr _refillCountNode;
+
 #ifdef GROUNDCACHE_DEBUG
     SGTimeStamp _lookupTime;
     unsigned _lookupCount;
@@ -223,6 +223,10 @@ bool FGInstrumentMgr::build (SGPropertyNode* config_props)
             return false;
         }
       
+        // instruments may declare the properties they use, so they can be
+        // updated concurrently (see SGSubsystem::declare_reads)
+        get_subsystem(id)->declare_access(node);
+
       // only push to our array if we actually built an insturment
         _instruments.push_back(id);
     } // of instruments iteration
@@ -551,6 +551,12 @@ void fgCreateSubsystems() {
     SG_LOG( SG_GENERAL, SG_INFO, "Creating Subsystems");
     SG_LOG( SG_GENERAL, SG_INFO, "========== ==========");
 
+    // Subsystems declaring the properties they use can be updated by
+    // worker threads. Off by default: 0 keeps the deterministic serial
+    // order, and few subsystems declare their accesses yet.
+    SGSubsystemGroup::set_worker_threads(
+        fgGetInt("/sim/subsystems/worker-threads", 0));
+
     ////////////////////////////////////////////////////////////////////
     // Initialize the sound subsystem.
     ////////////////////////////////////////////////////////////////////
@@ -587,7 +593,8 @@ void fgCreateSubsystems() {
     ////////////////////////////////////////////////////////////////////
     globals->add_subsystem("performance-mon",
             new SGPerformanceMonitor(globals->get_subsystem_mgr(),
-                                     fgGetNode("/sim/performance-monitor", true)));
+                                     fgGetNode("/sim/performance-monitor", true),
+                                     fgGetNode("/sim/performance/subsystems", true)));
 
     ////////////////////////////////////////////////////////////////////
     // Initialize the material property subsystem.
@@ -25,6 +25,10 @@
 #endif
 
 #include <simgear/compiler.h>
+
+#include <list>
+#include <map>
+
 #include <simgear/structure/exception.hxx>
 #include <simgear/props/props_io.hxx>
 
@@ -739,6 +743,122 @@ fgSetString (const char * name, const char * val)
   return globals->get_props()->setStringValue(name, val);
 }
 
+namespace
+{
+  // Least recently used paths are at the back
+  typedef std::list<string> PathUse;
+
+  struct CachedPath
+  {
+    CachedPath (const SGPropertyPath& p, PathUse::iterator u)
+      : path(p), use(u) {}
+
+    SGPropertyPath path;
+    PathUse::iterator use;
+  };
+}
+
+const SGPropertyPath &
+fgCompiledPath (const string & path)
+{
+  typedef std::map<string, CachedPath> PathCache;
+  static PathCache cache;
+  static PathUse use;
+
+  PathCache::iterator it = cache.find(path);
+  if (it != cache.end()) {
+    use.splice(use.begin(), use, it->second.use);
+    return it->second.path;
+  }
+
+  SGPropertyPath compiled(path);
+  if (cache.size() >= 4096) {
+    cache.erase(use.back());
+    use.pop_back();
+  }
+  use.push_front(path);
+  it = cache.insert(PathCache::value_type(path, CachedPath(compiled, use.begin()))).first;
+  return it->second.path;
+}
+
+SGPropertyNode *
+fgGetNode (const SGPropertyPath & path, bool create)
+{
+  return globals->get_props()->getNode(path, create);
+}
+
+bool
+fgGetBool (const SGPropertyPath & path, bool defaultValue)
+{
+  return globals->get_props()->getBoolValue(path, defaultValue);
+}
+
+int
+fgGetInt (const SGPropertyPath & path, int defaultValue)
+{
+  return globals->get_props()->getIntValue(path, defaultValue);
+}
+
+long
+fgGetLong (const SGPropertyPath & path, long defaultValue)
+{
+  return globals->get_props()->getLongValue(path, defaultValue);
+}
+
+float
+fgGetFloat (const SGPropertyPath & path, float defaultValue)
+{
+  return globals->get_props()->getFloatValue(path, defaultValue);
+}
+
+double
+fgGetDouble (const SGPropertyPath & path, double defaultValue)
+{
+  return globals->get_props()->getDoubleValue(path, defaultValue);
+}
+
+const char *
+fgGetString (const SGPropertyPath & path, const char * defaultValue)
+{
+  return globals->get_props()->getStringValue(path, defaultValue);
+}
+
+bool
+fgSetBool (const SGPropertyPath & path, bool val)
+{
+  return globals->get_props()->setBoolValue(path, val);
+}
+
+bool
+fgSetInt (const SGPropertyPath & path, int val)
+{
+  return globals->get_props()->setIntValue(path, val);
+}
+
+bool
+fgSetLong (const SGPropertyPath & path, long val)
+{
+  return globals->get_props()->setLongValue(path, val);
+}
+
+bool
+fgSetFloat (const SGPropertyPath & path, float val)
+{
+  return globals->get_props()->setFloatValue(path, val);
+}
+
+bool
+fgSetDouble (const SGPropertyPath & path, double val)
+{
+  return globals->get_props()->setDoubleValue(path, val);
+}
+
+bool
+fgSetString (const SGPropertyPath & path, const char * val)
+{
+  return globals->get_props()->setStringValue(path, val);
+}
+
 void
 fgSetArchivable (const char * name, bool state)
 {
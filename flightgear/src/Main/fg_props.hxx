@@ -644,6 +644,55 @@ inline bool fgSetString (const std::string & name, const std::string & val)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Convenience functions using pre-compiled paths.
+//
+// An SGPropertyPath is parsed only once and caches the node it resolves
+// to, so unlike the string variants these are cheap enough to be used
+// in the main loop, eg. with a static or member SGPropertyPath.
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * Get a property node by pre-compiled path.
+ *
+ * @param path The path of the node, relative to root.
+ * @param create true to create the node if it doesn't exist.
+ * @return The node, or 0 if none exists and none was created.
+ */
+extern SGPropertyNode * fgGetNode (const SGPropertyPath & path,
+                                   bool create = false);
+
+extern bool fgGetBool (const SGPropertyPath & path, bool defaultValue = false);
+extern int fgGetInt (const SGPropertyPath & path, int defaultValue = 0);
+extern long fgGetLong (const SGPropertyPath & path, long defaultValue = 0L);
+extern float fgGetFloat (const SGPropertyPath & path,
+                         float defaultValue = 0.0);
+extern double fgGetDouble (const SGPropertyPath & path,
+                           double defaultValue = 0.0);
+extern const char * fgGetString (const SGPropertyPath & path,
+                                 const char * defaultValue = "");
+
+extern bool fgSetBool (const SGPropertyPath & path, bool val);
+extern bool fgSetInt (const SGPropertyPath & path, int val);
+extern bool fgSetLong (const SGPropertyPath & path, long val);
+extern bool fgSetFloat (const SGPropertyPath & path, float val);
+extern bool fgSetDouble (const SGPropertyPath & path, double val);
+extern bool fgSetString (const SGPropertyPath & path, const char * val);
+
+/**
+ * Get a pre-compiled version of a path built at run time.
+ *
+ * For code which receives paths as strings, like Nasal getprop() or the
+ * telnet and HTTP servers. Paths are compiled once and kept in a cache
+ * of the 4096 most recently used ones, so the reference stays valid until
+ * as many other paths have been asked for. Main thread only.
+ *
+ * @param path The path to compile.
+ * @return The compiled path. Throws a string on bad syntax.
+ */
+extern const SGPropertyPath & fgCompiledPath (const std::string & path);
+
+
 ////////////////////////////////////////////////////////////////////////
 // Convenience functions for setting property attributes.
 ////////////////////////////////////////////////////////////////////////
@@ -39,6 +39,7 @@
 #include <simgear/misc/ResourceManager.hxx>
 #include <simgear/props/propertyObject.hxx>
 #include <simgear/props/props_io.hxx>
+#include <simgear/props/PropertySnapshot.hxx>
 
 #include <Aircraft/controls.hxx>
 #include <Airports/runways.hxx>
@@ -156,6 +157,7 @@ FGGlobals::FGGlobals() :
     tile_mgr( NULL ),
     fontcache ( new FGFontCache ),
     channellist( NULL ),
+    state_snapshot( new simgear::PropertySnapshot(props) ),
     haveUserSettings(false)
 {
   simgear::ResourceManager::instance()->addProvider(new AircraftResourceProvider);
@@ -173,6 +175,11 @@ FGGlobals::FGGlobals() :
   orientPitch = props->getNode("orientation/pitch-deg", true);
   orientHeading = props->getNode("orientation/heading-deg", true);
   orientRoll = props->getNode("orientation/roll-deg", true);
+
+  state_snapshot->addSubtree("position");
+  state_snapshot->addSubtree("orientation");
+  state_snapshot->addSubtree("velocities");
+  state_snapshot->addSubtree("sim/time/elapsed-sec");
 }
 
 // Destructor
@@ -214,6 +221,7 @@ FGGlobals::~FGGlobals()
 
     delete channellist;
     delete sound;
+    delete state_snapshot;
 
     delete locale;
     locale = NULL;
@@ -66,6 +66,8 @@ class FGViewer;
 class FGRenderer;
 class FGFontCache;
 
+namespace simgear { class PropertySnapshot; }
+
 
 /**
  * Bucket for subsystem pointers representing the sim's state.
@@ -142,6 +144,9 @@ private:
     // Navigational Aids
     FGTACANList *channellist;
 
+    // Per frame copy of the aircraft state for readers off the main loop
+    simgear::PropertySnapshot *state_snapshot;
+
     /// roots of Aircraft trees
     string_list fg_aircraft_dirs;
 
@@ -283,6 +288,14 @@ public:
   
     inline FGTACANList *get_channellist() const { return channellist; }
     inline void set_channellist( FGTACANList *c ) { channellist = c; }
+
+    /**
+     * Copies of /position, /orientation, /velocities and
+     * /sim/time/elapsed-sec, published at the end of every frame. Safe to
+     * read from any thread.
+     */
+    inline simgear::PropertySnapshot *get_state_snapshot() const
+    { return state_snapshot; }
   
    /**
      * Save the current state as the initial state.
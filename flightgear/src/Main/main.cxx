@@ -28,6 +28,8 @@
 #include <simgear/compiler.h>
 
 #include <iostream>
+#include <csignal>
+#include <cstring>
 
 #include <osg/Camera>
 #include <osg/GraphicsContext>
@@ -39,6 +41,7 @@
 #include <simgear/scene/material/matlib.hxx>
 #include <simgear/props/AtomicChangeListener.hxx>
 #include <simgear/props/props.hxx>
+#include <simgear/props/PropertySnapshot.hxx>
 #include <simgear/timing/sg_time.hxx>
 #include <simgear/io/raw_socket.hxx>
 #include <simgear/scene/tsync/terrasync.hxx>
@@ -76,6 +79,7 @@ using std::vector;
 extern int _bootstrap_OSInit;
 
 static SGPropertyNode_ptr frame_signal;
+static SGPropertyNode_ptr listener_calls;
 static TimeManager* timeMgr;
 
 // What should we do when we have nothing else to do?  Let's get ready
@@ -97,6 +101,13 @@ static void fgMainLoop( void )
 
     simgear::AtomicChangeListener::fireChangeListeners();
 
+    // make this frame's state available to readers off the main loop
+    globals->get_state_snapshot()->publish();
+
+    // publish how many property listeners have been called this frame
+    listener_calls->setIntValue(SGPropertyNode::getListenerCallCount());
+    SGPropertyNode::resetListenerCallCount();
+
     SG_LOG( SG_GENERAL, SG_DEBUG, "" );
 }
 
@@ -105,6 +116,7 @@ static void registerMainLoop()
 {
     // stash current frame signal property
     frame_signal = fgGetNode("/sim/signals/frame", true);
+    listener_calls = fgGetNode("/sim/performance/property-listener-calls", true);
     timeMgr = (TimeManager*) globals->get_subsystem("time");
     fgRegisterIdleHandler( fgMainLoop );
 }
@@ -295,6 +307,35 @@ static void logToFile()
     sglog().logToFile(logPath, SG_ALL, SG_INFO);
 }
 
+#if !defined(SG_WINDOWS)
+// Formatted up front, the signal handler mustn't allocate
+static char crashLogPath[1024];
+
+static void dumpLogOnCrash(int sig)
+{
+    sglog().dumpRingBuffer(crashLogPath);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+#endif
+
+// Keep the latest messages in memory, and write them to fgfs-crash.log if
+// we crash, even when the log file itself is behind.
+static void logToCrashBuffer()
+{
+    sglog().logToRingBuffer(256 * 1024, SG_ALL, SG_INFO);
+#if !defined(SG_WINDOWS)
+    SGPath crashPath = globals->get_fg_home();
+    crashPath.append("fgfs-crash.log");
+    strncpy(crashLogPath, crashPath.c_str(), sizeof(crashLogPath) - 1);
+
+    signal(SIGSEGV, dumpLogOnCrash);
+    signal(SIGBUS, dumpLogOnCrash);
+    signal(SIGILL, dumpLogOnCrash);
+    signal(SIGABRT, dumpLogOnCrash);
+#endif
+}
+
 // Main top level initialization
 int fgMainInit( int argc, char **argv ) {
 
@@ -306,6 +347,7 @@ int fgMainInit( int argc, char **argv ) {
     
     // now home is initialised, we can log to a file inside it
     logToFile();
+    logToCrashBuffer();
     
     std::string version;
 #ifdef FLIGHTGEAR_VERSION
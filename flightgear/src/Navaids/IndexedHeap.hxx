@@ -0,0 +1,126 @@
+// IndexedHeap.hxx -- priority queue of graph nodes for shortest path searches
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef FG_INDEXED_HEAP_HXX
+#define FG_INDEXED_HEAP_HXX
+
+#include <vector>
+
+namespace flightgear
+{
+
+/**
+ * Binary heap of node indices ordered by their cost, which is looked up
+ * in a vector owned by the search. The heap knows where each node sits in
+ * it, so the cost of an open node can be lowered in O(log n) instead of
+ * searching for it and rebuilding the heap.
+ */
+class IndexedHeap
+{
+public:
+  IndexedHeap(const std::vector<double>& aCost) :
+    _cost(aCost),
+    _position(aCost.size(), NOT_IN_HEAP)
+  { }
+  
+  bool empty() const
+  { return _heap.empty(); }
+  
+  bool contains(unsigned int aNode) const
+  { return _position[aNode] != NOT_IN_HEAP; }
+  
+  void push(unsigned int aNode)
+  {
+    _position[aNode] = _heap.size();
+    _heap.push_back(aNode);
+    up(_heap.size() - 1);
+  }
+  
+  /// restore the order after the cost of aNode was lowered
+  void decrease(unsigned int aNode)
+  { up(_position[aNode]); }
+  
+  unsigned int pop()
+  {
+    unsigned int top = _heap.front();
+    _position[top] = NOT_IN_HEAP;
+    _heap.front() = _heap.back();
+    _heap.pop_back();
+    if (!_heap.empty()) {
+      _position[_heap.front()] = 0;
+      down(0);
+    }
+    
+    return top;
+  }
+  
+private:
+  enum { NOT_IN_HEAP = ~0u };
+  
+  void up(unsigned int i)
+  {
+    unsigned int n = _heap[i];
+    while (i > 0) {
+      unsigned int parent = (i - 1) / 2;
+      if (_cost[_heap[parent]] <= _cost[n]) {
+        break;
+      }
+      
+      place(i, _heap[parent]);
+      i = parent;
+    }
+    
+    place(i, n);
+  }
+  
+  void down(unsigned int i)
+  {
+    unsigned int n = _heap[i];
+    for (;;) {
+      unsigned int child = 2 * i + 1;
+      if (child >= _heap.size()) {
+        break;
+      }
+      
+      if ((child + 1 < _heap.size()) && (_cost[_heap[child + 1]] < _cost[_heap[child]])) {
+        ++child;
+      }
+      
+      if (_cost[n] <= _cost[_heap[child]]) {
+        break;
+      }
+      
+      place(i, _heap[child]);
+      i = child;
+    }
+    
+    place(i, n);
+  }
+  
+  void place(unsigned int i, unsigned int aNode)
+  {
+    _heap[i] = aNode;
+    _position[aNode] = i;
+  }
+  
+  const std::vector<double>& _cost;
+  std::vector<unsigned int> _heap;
+  std::vector<unsigned int> _position;
+};
+
+} // of namespace flightgear
+
+#endif // of FG_INDEXED_HEAP_HXX
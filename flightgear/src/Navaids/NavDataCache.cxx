@@ -34,6 +34,11 @@
 #include <map>
 #include <cassert>
 #include <stdint.h> // for int64_t
+#include <ctime>
+#include <istream>
+#include <streambuf>
+// zlib
+#include <zlib.h>
 // boost
 #include <boost/foreach.hpp>
 
@@ -50,6 +55,7 @@
 #include <simgear/threads/SGGuard.hxx>
 
 #include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
 #include "markerbeacon.hxx"
 #include "navrecord.hxx"
 #include <Airports/airport.hxx>
@@ -59,6 +65,7 @@
 #include <Navaids/fixlist.hxx>
 #include <Navaids/navdb.hxx>
 #include "PositionedOctree.hxx"
+#include "NavDataSnapshot.hxx"
 #include <Airports/apt_loader.hxx>
 #include <Navaids/airways.hxx>
 #include "poidb.hxx"
@@ -73,7 +80,7 @@ using std::string;
 namespace {
 
 const int MAX_RETRIES = 10;
-const int SCHEMA_VERSION = 8;
+const int SCHEMA_VERSION = 9;
 const int CACHE_SIZE_KBYTES= 16000;
     
 // bind a std::string to a sqlite statement. The std::string must live the
@@ -140,11 +147,12 @@ namespace flightgear
 {
 
 /**
- * Thread encapsulating a cache rebuild. This is not used to parallelise
- * the rebuild - we must still wait until completion before doing other
- * startup, since many things rely on a complete cache. The thread is used
- * so we don't block the main event loop for an unacceptable duration,
- * which causes 'not responding' / spinning beachballs on Windows & Mac
+ * Thread encapsulating a cache rebuild. We must still wait until completion
+ * before doing other startup, since many things rely on a complete cache.
+ * The thread is used so we don't block the main event loop for an
+ * unacceptable duration, which causes 'not responding' / spinning
+ * beachballs on Windows & Mac. The work within the rebuild is spread over
+ * DatFileThreads.
  */
 class RebuildThread : public SGThread
 {
@@ -178,6 +186,229 @@ private:
   bool _isFinished;
 };
 
+/**
+ * Read only stream over a buffer in memory, without copying it
+ */
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+  MemoryStreamBuf(const std::string& data)
+  {
+    char* p = const_cast<char*>(data.data());
+    setg(p, p, p + data.size());
+  }
+};
+
+/**
+ * Limits how many DatFileThreads hold an inflated file at once. Files are
+ * let through in the order the rebuild loads them, so the reader it waits
+ * for next can always proceed.
+ */
+class DatFileBudget
+{
+public:
+  DatFileBudget(unsigned int maxBuffered) :
+    _max(maxBuffered),
+    _released(0),
+    _cancelled(false)
+  {
+  }
+  
+  /// wait until the file loaded at position order may be read; false
+  /// if the rebuild gave up in the meantime
+  bool acquire(unsigned int order)
+  {
+    SGGuard<SGMutex> g(_lock);
+    while (!_cancelled && order >= _released + _max) {
+      _cond.wait(_lock);
+    }
+    return !_cancelled;
+  }
+  
+  void release()
+  {
+    SGGuard<SGMutex> g(_lock);
+    ++_released;
+    _cond.broadcast();
+  }
+  
+  void cancel()
+  {
+    SGGuard<SGMutex> g(_lock);
+    _cancelled = true;
+    _cond.broadcast();
+  }
+private:
+  SGMutex _lock;
+  SGWaitCondition _cond;
+  unsigned int _max, _released;
+  bool _cancelled;
+};
+
+/**
+ * Reads one of the global data files into memory, and parses it in the
+ * same thread where the parsing does not depend on the cache. Reading
+ * starts when a rebuild does, within the DatFileBudget, so inflating and
+ * parsing overlaps with the rebuild thread inserting the files before it;
+ * SQLite itself is only ever used from the rebuild thread, in one
+ * transaction.
+ */
+class DatFileThread : public SGThread
+{
+public:
+  DatFileThread(const SGPath& path, DatFileBudget& budget) :
+    _path(path),
+    _budget(budget),
+    _order(0),
+    _holdsBudget(false),
+    _ok(false),
+    _readMSec(0),
+    _parseMSec(0)
+  {
+  }
+  
+  virtual ~DatFileThread()
+  {
+    stop();
+  }
+  
+  /// start reading, as the file loaded at position order
+  void start(unsigned int order)
+  {
+    _order = order;
+    SGThread::start();
+  }
+  
+  virtual void run()
+  {
+    if (!_budget.acquire(_order)) {
+      return;
+    }
+    
+    _holdsBudget = true;
+    try {
+      SGTimeStamp st;
+      st.stamp();
+      _ok = readFile();
+      _readMSec = st.elapsedMSec();
+      
+      if (_ok) {
+        st.stamp();
+        MemoryStreamBuf buf(_data);
+        std::istream in(&buf);
+        parse(in);
+        _parseMSec = st.elapsedMSec();
+      }
+    } catch (std::exception& e) { // sg_exception, or std::bad_alloc
+      SG_LOG(SG_NAVCACHE, SG_WARN, "reading " << _path << " failed:" << e.what());
+      _ok = false;
+    }
+    
+    if (!_ok) {
+      releaseData();
+    }
+  }
+  
+  /// the file could be read and parsed; if not, the loaders report the
+  /// problem when trying to open it themselves
+  bool ok() const
+  { return _ok; }
+  
+  const std::string& data() const
+  { return _data; }
+  
+  /// drop the buffered file, letting the next reader start
+  void releaseData()
+  {
+    std::string().swap(_data);
+    if (_holdsBudget) {
+      _holdsBudget = false;
+      _budget.release();
+    }
+  }
+  
+  int readMSec() const
+  { return _readMSec; }
+  
+  int parseMSec() const
+  { return _parseMSec; }
+  
+protected:
+  virtual void parse(std::istream&)
+  {
+  }
+  
+  /// wait for the thread, waking it up if it still waits for the budget
+  void stop()
+  {
+    _budget.cancel();
+    join();
+  }
+  
+private:
+  bool readFile()
+  {
+    gzFile f = gzopen(_path.c_str(), "rb");
+    if (!f) {
+      return false;
+    }
+    
+    const int CHUNK = 1 << 20;
+    std::vector<char> chunk(CHUNK);
+    int n;
+    while ((n = gzread(f, &chunk.front(), CHUNK)) > 0) {
+      _data.append(&chunk.front(), n);
+    }
+    
+    gzclose(f);
+    return n == 0;
+  }
+  
+  SGPath _path;
+  DatFileBudget& _budget;
+  unsigned int _order;
+  bool _holdsBudget;
+  std::string _data;
+  bool _ok;
+  int _readMSec, _parseMSec;
+};
+
+class FixFileThread : public DatFileThread
+{
+public:
+  FixFileThread(const SGPath& path, DatFileBudget& budget) :
+    DatFileThread(path, budget) { }
+  
+  virtual ~FixFileThread()
+  { stop(); } // parse() must not outlive the members it fills
+  
+  FixRecordVec fixes;
+protected:
+  virtual void parse(std::istream& in)
+  {
+    parseFixes(in, fixes);
+    releaseData();
+  }
+};
+
+class AirwayFileThread : public DatFileThread
+{
+public:
+  AirwayFileThread(const SGPath& path, DatFileBudget& budget) :
+    DatFileThread(path, budget) { }
+  
+  virtual ~AirwayFileThread()
+  { stop(); } // parse() must not outlive the members it fills
+  
+  Airway::SegmentVec segments;
+protected:
+  virtual void parse(std::istream& in)
+  {
+    Airway::parse(in, segments);
+    releaseData();
+  }
+};
+
 ////////////////////////////////////////////////////////////////////////////
   
 typedef std::map<PositionedID, FGPositionedRef> PositionedCache;
@@ -202,7 +433,10 @@ public:
     cacheHits(0),
     cacheMisses(0),
     transactionLevel(0),
-    transactionAborted(false)
+    transactionAborted(false),
+    snapshotEnabled(false),
+    snapshotChecked(false),
+    snapshotStale(false)
   {
   }
   
@@ -415,6 +649,19 @@ public:
     reset(stmt);
   }
   
+  /**
+   * Indexes for lookups at runtime which the rebuild does not use. They
+   * are created once the data is in, which is cheaper than keeping them
+   * up to date with every insert.
+   */
+  void createLookupIndexes()
+  {
+    runSQL("CREATE INDEX IF NOT EXISTS pos_name ON positioned(name collate nocase)");
+    runSQL("CREATE INDEX IF NOT EXISTS comm_freq ON comm(freq_khz)");
+    runSQL("CREATE INDEX IF NOT EXISTS navaid_freq ON navaid(freq)");
+    runSQL("CREATE INDEX IF NOT EXISTS airway_edge_from ON airway_edge(a)");
+  }
+  
   void initTables()
   {
     runSQL("CREATE TABLE properties ("
@@ -443,7 +690,6 @@ public:
     
     runSQL("CREATE INDEX pos_octree ON positioned(octree_node)");
     runSQL("CREATE INDEX pos_ident ON positioned(ident collate nocase)");
-    runSQL("CREATE INDEX pos_name ON positioned(name collate nocase)");
     // allow efficient querying of 'all ATIS at this airport' or
     // 'all towers at this airport'
     runSQL("CREATE INDEX pos_apt_type ON positioned(airport, type)");
@@ -459,8 +705,6 @@ public:
            ")"
            );
     
-    runSQL("CREATE INDEX comm_freq ON comm(freq_khz)");
-    
     runSQL("CREATE TABLE runway ("
            "heading FLOAT,"
            "length_ft FLOAT,"
@@ -482,8 +726,6 @@ public:
            ")"
            );
     
-    runSQL("CREATE INDEX navaid_freq ON navaid(freq)");
-    
     runSQL("CREATE TABLE octree (children INT)");
     
     runSQL("CREATE TABLE airway ("
@@ -500,8 +742,6 @@ public:
            "b INT64"
            ")");
     
-    runSQL("CREATE INDEX airway_edge_from ON airway_edge(a)");
-    
     runSQL("CREATE TABLE taxi_node ("
            "hold_type INT,"
            "on_runway BOOL,"
@@ -652,6 +892,12 @@ public:
     
     airwayEdgesFrom = prepare("SELECT airway, b FROM airway_edge WHERE network=?1 AND a=?2");
     
+    airwayNetworkEdges = prepare("SELECT airway_edge.airway, airway_edge.a, airway_edge.b, "
+                                 "pa.lon, pa.lat, pb.lon, pb.lat "
+                                 "FROM airway_edge, positioned AS pa, positioned AS pb WHERE "
+                                 "airway_edge.network=?1 AND pa.rowid=airway_edge.a "
+                                 "AND pb.rowid=airway_edge.b");
+    
   // parking / taxi-node graph
     insertTaxiNode = prepare("INSERT INTO taxi_node (rowid, hold_type, on_runway, pushback) VALUES(?1, ?2, ?3, 0)");
     insertParkingPos = prepare("INSERT INTO parking (rowid, heading, radius, gate_type, airlines) "
@@ -838,6 +1084,7 @@ public:
                                 const string& name, const SGGeod& pos, PositionedID apt,
                                 bool spatialIndex)
   {
+    invalidateSnapshot();
     SGVec3d cartPos(SGVec3d::fromGeod(pos));
     
     sqlite3_bind_int(insertPositionedQuery, 1, ty);
@@ -867,6 +1114,32 @@ public:
   FGPositionedList findAllByString(const string& s, const string& column,
                                      FGPositioned::Filter* filter, bool exact)
   {
+    const NavDataSnapshot* snap = readSnapshot();
+  // LIKE patterns with wildcards of their own are left to SQLite
+    if (snap && !s.empty() && (exact || (s.find_first_of("%_") == string::npos))) {
+      NavDataSnapshot::RecordPtrVec recs;
+      snap->findAllByString(s, column == "name", exact,
+                            filter ? filter->minType() : FGPositioned::INVALID,
+                            filter ? filter->maxType() : FGPositioned::LAST_TYPE, recs);
+    // loading items may modify the cache and so drop the snapshot
+      PositionedIDVec ids;
+      BOOST_FOREACH(const NavDataSnapshot::Record* r, recs) {
+        ids.push_back(r->id);
+      }
+      
+      FGPositionedList result;
+      BOOST_FOREACH(PositionedID id, ids) {
+        FGPositioned* pos = outer->loadById(id);
+        if (filter && !filter->pass(pos)) {
+          continue;
+        }
+        
+        result.push_back(pos);
+      }
+      
+      return result;
+    }
+    
     string query = s;
     if (!exact) query += "%";
     
@@ -936,8 +1209,107 @@ public:
     deferredOctreeUpdates.clear();
   }
     
+  SGPath snapshotPath() const
+  {
+    return SGPath(path.base() + ".snapshot");
+  }
+  
+  /**
+   * the snapshot to answer read-only queries from, or NULL to use SQLite.
+   * The snapshot is opened on first use. If it is missing or out of date,
+   * or the cache was modified since, SQLite is used until it is written
+   * again at shutdown. Never used while rebuilding.
+   */
+  const NavDataSnapshot* readSnapshot()
+  {
+    if (!snapshotEnabled || snapshotStale || rebuilder.get()) {
+      return NULL;
+    }
+    
+    if (!snapshotChecked) {
+      snapshotChecked = true;
+      int generation = outer->readIntProperty("snapshot-generation");
+      snapshot.reset(NavDataSnapshot::open(snapshotPath(), generation));
+      if (!snapshot.get()) {
+        SG_LOG(SG_NAVCACHE, SG_INFO, "no current nav data snapshot, writing it at shutdown");
+        snapshotStale = true;
+      }
+    }
+    
+    return snapshot.get();
+  }
+  
+  /**
+   * write the snapshot again if it did not match the cache, so the next
+   * start can use it. Done at shutdown rather than in the query which
+   * finds it out of date, as it takes a while.
+   */
+  void writeStaleSnapshot()
+  {
+    if (!snapshotEnabled || !snapshotStale || rebuilder.get()) {
+      return;
+    }
+    
+    if (writeSnapshot(outer->readIntProperty("snapshot-generation"))) {
+      snapshotStale = false;
+    }
+  }
+  
+  bool writeSnapshot(int generation)
+  {
+    SGTimeStamp st;
+    st.stamp();
+    NavDataSnapshot::Builder builder;
+    
+    sqlite3_stmt_ptr q = prepare("SELECT rowid, type, ident, name, airport, lon, lat, elev_m, "
+                                 "octree_node, cart_x, cart_y, cart_z FROM positioned ORDER BY rowid");
+    while (stepSelect(q)) {
+      SGVec3d cart(sqlite3_column_double(q, 9), sqlite3_column_double(q, 10),
+                   sqlite3_column_double(q, 11));
+      builder.addPositioned(sqlite3_column_int64(q, 0), sqlite3_column_int(q, 1),
+                            (const char*) sqlite3_column_text(q, 2),
+                            (const char*) sqlite3_column_text(q, 3),
+                            sqlite3_column_int64(q, 4), sqlite3_column_double(q, 5),
+                            sqlite3_column_double(q, 6), sqlite3_column_double(q, 7),
+                            sqlite3_column_int64(q, 8), cart);
+    }
+    finalize(q);
+    
+    q = prepare("SELECT rowid, children FROM octree ORDER BY rowid");
+    while (stepSelect(q)) {
+      builder.addOctreeBranch(sqlite3_column_int64(q, 0), sqlite3_column_int(q, 1));
+    }
+    finalize(q);
+    
+    bool ok = builder.write(snapshotPath(), generation);
+    SG_LOG(SG_NAVCACHE, SG_INFO, "writing nav data snapshot took:" << st.elapsedMSec());
+    return ok;
+  }
+  
+  /**
+   * called before modifying the positioned or octree tables: the snapshot
+   * no longer matches the cache, so stop using it, and make sure it is
+   * written again at shutdown
+   */
+  void invalidateSnapshot()
+  {
+    if (snapshotStale || rebuilder.get()) {
+      return; // rebuilding writes a new generation anyway
+    }
+    
+    snapshotStale = true;
+    if (snapshot.get()) {
+      SG_LOG(SG_NAVCACHE, SG_INFO, "nav data modified, not using the snapshot any more");
+      snapshot.reset();
+    }
+    
+    int generation = outer->readIntProperty("snapshot-generation");
+    outer->writeIntProperty("snapshot-generation", generation + 1);
+  }
+  
   void removePositionedWithIdent(FGPositioned::Type ty, const std::string& aIdent)
   {
+    invalidateSnapshot();
     sqlite3_bind_int(removePOIQuery, 1, ty);
     sqlite_bind_stdstring(removePOIQuery, 2, aIdent);
     execUpdate(removePOIQuery);
@@ -992,7 +1364,7 @@ public:
   
 // airways
   sqlite3_stmt_ptr findAirway, insertAirwayEdge, isPosInAirway, airwayEdgesFrom,
-  insertAirway;
+  insertAirway, airwayNetworkEdges;
   
 // groundnet (parking, taxi node graph)
   sqlite3_stmt_ptr loadTaxiNodeStmt, loadParkingPos, insertTaxiNode, insertParkingPos;
@@ -1013,6 +1385,10 @@ public:
   // if we're performing a rebuild, the thread that is doing the work.
   // otherwise, NULL
   std::auto_ptr<RebuildThread> rebuilder;
+  
+  /// memory mapped copy of the positioned and octree tables, if enabled
+  std::auto_ptr<NavDataSnapshot> snapshot;
+  bool snapshotEnabled, snapshotChecked, snapshotStale;
 };
 
   //////////////////////////////////////////////////////////////////////
@@ -1020,21 +1396,36 @@ public:
 FGPositioned* NavDataCache::NavDataCachePrivate::loadById(sqlite3_int64 rowid)
 {
   
-  sqlite3_bind_int64(loadPositioned, 1, rowid);
-  execSelect1(loadPositioned);
+  FGPositioned::Type ty;
+  string ident, name;
+  sqlite3_int64 aptId;
+  SGGeod pos;
   
-  assert(rowid == sqlite3_column_int64(loadPositioned, 0));
-  FGPositioned::Type ty = (FGPositioned::Type) sqlite3_column_int(loadPositioned, 1);
-  
-  string ident = (char*) sqlite3_column_text(loadPositioned, 2);
-  string name = (char*) sqlite3_column_text(loadPositioned, 3);
-  sqlite3_int64 aptId = sqlite3_column_int64(loadPositioned, 4);
-  double lon = sqlite3_column_double(loadPositioned, 5);
-  double lat = sqlite3_column_double(loadPositioned, 6);
-  double elev = sqlite3_column_double(loadPositioned, 7);
-  SGGeod pos = SGGeod::fromDegM(lon, lat, elev);
-      
-  reset(loadPositioned);
+  const NavDataSnapshot* snap = readSnapshot();
+  const NavDataSnapshot::Record* rec = snap ? snap->findById(rowid) : NULL;
+  if (rec) {
+    ty = (FGPositioned::Type) rec->type;
+    ident = snap->ident(*rec);
+    name = snap->name(*rec);
+    aptId = rec->airport;
+    pos = SGGeod::fromDegM(rec->lon, rec->lat, rec->elev);
+  } else {
+    sqlite3_bind_int64(loadPositioned, 1, rowid);
+    execSelect1(loadPositioned);
+    
+    assert(rowid == sqlite3_column_int64(loadPositioned, 0));
+    ty = (FGPositioned::Type) sqlite3_column_int(loadPositioned, 1);
+    
+    ident = (char*) sqlite3_column_text(loadPositioned, 2);
+    name = (char*) sqlite3_column_text(loadPositioned, 3);
+    aptId = sqlite3_column_int64(loadPositioned, 4);
+    double lon = sqlite3_column_double(loadPositioned, 5);
+    double lat = sqlite3_column_double(loadPositioned, 6);
+    double elev = sqlite3_column_double(loadPositioned, 7);
+    pos = SGGeod::fromDegM(lon, lat, elev);
+    
+    reset(loadPositioned);
+  }
   
   switch (ty) {
     case FGPositioned::AIRPORT:
@@ -1167,12 +1558,15 @@ NavDataCache::NavDataCache()
   
   d->airwayDatPath = SGPath(globals->get_fg_root());
   d->airwayDatPath.append("Navaids/awy.dat.gz");
+  
+  d->snapshotEnabled = fgGetBool("/sim/navdb/snapshot/enabled", false);
 }
     
 NavDataCache::~NavDataCache()
 {
   assert(static_instance == this);
   static_instance = NULL;
+  d->writeStaleSnapshot();
   d.reset();
 }
     
@@ -1227,8 +1621,43 @@ bool NavDataCache::rebuild()
   return fin;
 }
   
+/**
+ * Report how long reading and parsing a data file took in its reader
+ * thread, and loading it into the cache since st
+ */
+static void logFileLoad(const char* name, DatFileThread& reader, const SGTimeStamp& st)
+{
+  SG_LOG(SG_NAVCACHE, SG_INFO, name << ": read " << reader.readMSec() << " msec, parse "
+         << reader.parseMSec() << " msec (in parallel), load " << st.elapsedMSec() << " msec");
+}
+
 void NavDataCache::doRebuild()
 {
+// apt.dat is loaded first and is much the largest file, so it is streamed
+// by the rebuild thread itself; at most three of the others are buffered
+  DatFileBudget budget(3);
+  DatFileThread metarReader(d->metarDatPath, budget),
+    navReader(d->navDatPath, budget), poiReader(d->poiDatPath, budget),
+    carrierReader(d->carrierDatPath, budget);
+  FixFileThread fixReader(d->fixDatPath, budget);
+  AirwayFileThread airwayReader(d->airwayDatPath, budget);
+  
+  DatFileThread* readers[] = {
+    &metarReader, &fixReader, &navReader,
+#ifndef SG_WINDOWS
+    &poiReader,
+#endif
+    &carrierReader, &airwayReader
+  };
+  const unsigned int numReaders = sizeof(readers) / sizeof(readers[0]);
+  for (unsigned int i=0; i<numReaders; ++i) {
+    readers[i]->start(i);
+  }
+  
+  d->snapshot.reset();
+  d->snapshotChecked = false;
+  d->snapshotStale = false;
+  
   try {
     d->close(); // completely close the sqlite object
     d->path.remove(); // remove the file on disk
@@ -1239,48 +1668,112 @@ void NavDataCache::doRebuild()
     d->runSQL("INSERT INTO octree (rowid, children) VALUES (1, 0)");
     
     SGTimeStamp st;
-    st.stamp();
     
+  // the files are loaded in the order they depend on each other: navaids
+  // look up the runways of the airports, airways the navaids and fixes
+    st.stamp();
     airportDBLoad(d->aptDatPath);
-    SG_LOG(SG_NAVCACHE, SG_INFO, "apt.dat load took:" << st.elapsedMSec());
+    SG_LOG(SG_NAVCACHE, SG_INFO, "apt.dat load took:" << st.elapsedMSec() << " msec");
     
-    metarDataLoad(d->metarDatPath);
+    metarReader.join();
+    st.stamp();
+    if (metarReader.ok()) {
+      MemoryStreamBuf buf(metarReader.data());
+      std::istream in(&buf);
+      metarDataLoad(in);
+    } else {
+      metarDataLoad(d->metarDatPath);
+    }
+    metarReader.releaseData();
+    logFileLoad("metar.dat", metarReader, st);
     stampCacheFile(d->aptDatPath);
     stampCacheFile(d->metarDatPath);
     
+    fixReader.join();
     st.stamp();
-    loadFixes(d->fixDatPath);
+    if (fixReader.ok()) {
+      loadFixes(fixReader.fixes);
+    } else {
+      loadFixes(d->fixDatPath);
+    }
+    logFileLoad("fix.dat", fixReader, st);
     stampCacheFile(d->fixDatPath);
-    SG_LOG(SG_NAVCACHE, SG_INFO, "fix.dat load took:" << st.elapsedMSec());
     
+    navReader.join();
     st.stamp();
-    navDBInit(d->navDatPath);
+    if (navReader.ok()) {
+      MemoryStreamBuf buf(navReader.data());
+      std::istream in(&buf);
+      navDBInit(in);
+    } else {
+      navDBInit(d->navDatPath);
+    }
+    navReader.releaseData();
+    logFileLoad("nav.dat", navReader, st);
     stampCacheFile(d->navDatPath);
-    SG_LOG(SG_NAVCACHE, SG_INFO, "nav.dat load took:" << st.elapsedMSec());
 
 #ifdef SG_WINDOWS
     SG_LOG(SG_NAVCACHE, SG_ALERT, "SKIPPING POI load on Windows");
 #else
+    poiReader.join();
     st.stamp();
-    poiDBInit(d->poiDatPath);
+    if (poiReader.ok()) {
+      MemoryStreamBuf buf(poiReader.data());
+      std::istream in(&buf);
+      poiDBInit(in);
+    } else {
+      poiDBInit(d->poiDatPath);
+    }
+    poiReader.releaseData();
+    logFileLoad("poi.dat", poiReader, st);
     stampCacheFile(d->poiDatPath);
-    SG_LOG(SG_NAVCACHE, SG_INFO, "poi.dat load took:" << st.elapsedMSec());
 #endif
-      
-    loadCarrierNav(d->carrierDatPath);
+    
+    carrierReader.join();
+    st.stamp();
+    if (carrierReader.ok()) {
+      MemoryStreamBuf buf(carrierReader.data());
+      std::istream in(&buf);
+      loadCarrierNav(in);
+    } else {
+      loadCarrierNav(d->carrierDatPath);
+    }
+    carrierReader.releaseData();
+    logFileLoad("carrier_nav.dat", carrierReader, st);
     stampCacheFile(d->carrierDatPath);
     
+    airwayReader.join();
     st.stamp();
-    Airway::load(d->airwayDatPath);
+    if (airwayReader.ok()) {
+      Airway::load(airwayReader.segments);
+    } else {
+      Airway::load(d->airwayDatPath);
+    }
+    logFileLoad("awy.dat", airwayReader, st);
     stampCacheFile(d->airwayDatPath);
-    SG_LOG(SG_NAVCACHE, SG_INFO, "awy.dat load took:" << st.elapsedMSec());
     
     d->flushDeferredOctreeUpdates();
     
+    st.stamp();
+    d->createLookupIndexes();
+    SG_LOG(SG_NAVCACHE, SG_INFO, "creating indexes took:" << st.elapsedMSec());
+    
     string sceneryPaths = simgear::strutils::join(globals->get_fg_scenery(), ";");
     writeStringProperty("scenery_paths", sceneryPaths);
     
+  // any snapshot of the previous contents is out of date now
+    int generation = static_cast<int>(time(NULL));
+    writeIntProperty("snapshot-generation", generation);
+    
     txn.commit();
+    
+    st.stamp();
+    Airway::computeLandmarks();
+    SG_LOG(SG_NAVCACHE, SG_INFO, "airway landmarks took:" << st.elapsedMSec());
+    
+    if (d->snapshotEnabled) {
+      d->writeSnapshot(generation);
+    }
   } catch (sg_exception& e) {
     SG_LOG(SG_NAVCACHE, SG_ALERT, "caught exception rebuilding navCache:" << e.what());
   }
@@ -1378,6 +1871,11 @@ void NavDataCache::writeStringListProperty(const string& key, const string_list&
   }
 }
   
+SGPath NavDataCache::path() const
+{
+  return d->path;
+}
+
 bool NavDataCache::isCachedFileModified(const SGPath& path) const
 {
   if (!path.exists()) {
@@ -1525,6 +2023,7 @@ void NavDataCache::updatePosition(PositionedID item, const SGGeod &pos)
     d->cache[item]->modifyPosition(pos);
   }
   
+  d->invalidateSnapshot();
   SGVec3d cartPos(SGVec3d::fromGeod(pos));
   
   sqlite3_bind_int(d->setAirportPos, 1, item);
@@ -1722,6 +2221,31 @@ FGPositionedRef NavDataCache::findClosestWithIdent( const string& aIdent,
                                                     const SGGeod& aPos,
                                                     FGPositioned::Filter* aFilter )
 {
+  const NavDataSnapshot* snap = d->readSnapshot();
+  if (snap && !aIdent.empty()) {
+    NavDataSnapshot::RecordPtrVec recs;
+    snap->findAllByString(aIdent, false, true,
+                          aFilter ? aFilter->minType() : FGPositioned::INVALID,
+                          aFilter ? aFilter->maxType() : FGPositioned::LAST_TYPE, recs);
+    
+    SGVec3d cartPos(SGVec3d::fromGeod(aPos));
+    std::vector<std::pair<double, PositionedID> > candidates;
+    BOOST_FOREACH(const NavDataSnapshot::Record* r, recs) {
+      SGVec3d cart(r->cart[0], r->cart[1], r->cart[2]);
+      candidates.push_back(std::make_pair(distSqr(cart, cartPos), r->id));
+    }
+    
+    std::sort(candidates.begin(), candidates.end());
+    for (unsigned int i=0; i<candidates.size(); ++i) {
+      FGPositioned* pos = loadById(candidates[i].second);
+      if (!aFilter || aFilter->pass(pos)) {
+        return pos;
+      }
+    }
+    
+    return NULL;
+  }
+  
   sqlite_bind_stdstring(d->findClosestWithIdent, 1, aIdent);
   if (aFilter) {
     sqlite3_bind_int(d->findClosestWithIdent, 2, aFilter->minType());
@@ -1755,6 +2279,12 @@ FGPositionedRef NavDataCache::findClosestWithIdent( const string& aIdent,
   
 int NavDataCache::getOctreeBranchChildren(int64_t octreeNodeId)
 {
+  const NavDataSnapshot* snap = d->readSnapshot();
+  int snapChildren;
+  if (snap && snap->octreeBranchChildren(octreeNodeId, snapChildren)) {
+    return snapChildren;
+  }
+  
   sqlite3_bind_int64(d->getOctreeChildren, 1, octreeNodeId);
   d->execSelect1(d->getOctreeChildren);
   int children = sqlite3_column_int(d->getOctreeChildren, 0);
@@ -1764,6 +2294,7 @@ int NavDataCache::getOctreeBranchChildren(int64_t octreeNodeId)
 
 void NavDataCache::defineOctreeNode(Octree::Branch* pr, Octree::Node* nd)
 {
+  d->invalidateSnapshot();
   sqlite3_bind_int64(d->insertOctree, 1, nd->guid());
   d->execInsert(d->insertOctree);
   
@@ -1784,6 +2315,11 @@ void NavDataCache::defineOctreeNode(Octree::Branch* pr, Octree::Node* nd)
 TypedPositionedVec
 NavDataCache::getOctreeLeafChildren(int64_t octreeNodeId)
 {
+  const NavDataSnapshot* snap = d->readSnapshot();
+  if (snap) {
+    return snap->octreeLeafChildren(octreeNodeId);
+  }
+  
   sqlite3_bind_int64(d->getOctreeLeafChildren, 1, octreeNodeId);
   
   TypedPositionedVec r;
@@ -2057,6 +2593,27 @@ AirwayEdgeVec NavDataCache::airwayEdgesFrom(int network, PositionedID pos)
   return result;
 }
 
+AirwayNetworkEdgeVec NavDataCache::airwayNetworkEdges(int network)
+{
+  sqlite3_bind_int(d->airwayNetworkEdges, 1, network);
+  
+  AirwayNetworkEdgeVec result;
+  while (d->stepSelect(d->airwayNetworkEdges)) {
+    AirwayNetworkEdge e;
+    e.airway = sqlite3_column_int(d->airwayNetworkEdges, 0);
+    e.from = sqlite3_column_int64(d->airwayNetworkEdges, 1);
+    e.to = sqlite3_column_int64(d->airwayNetworkEdges, 2);
+    e.fromPos = SGGeod::fromDeg(sqlite3_column_double(d->airwayNetworkEdges, 3),
+                                sqlite3_column_double(d->airwayNetworkEdges, 4));
+    e.toPos = SGGeod::fromDeg(sqlite3_column_double(d->airwayNetworkEdges, 5),
+                              sqlite3_column_double(d->airwayNetworkEdges, 6));
+    result.push_back(e);
+  }
+  
+  d->reset(d->airwayNetworkEdges);
+  return result;
+}
+
 PositionedID NavDataCache::findNavaidForRunway(PositionedID runway, FGPositioned::Type ty)
 {
   sqlite3_bind_int64(d->findNavaidForRunway, 1, runway);
@@ -2190,6 +2747,7 @@ PositionedIDVec NavDataCache::findAirportParking(PositionedID airport, const std
 
 void NavDataCache::dropGroundnetFor(PositionedID aAirport)
 {
+  d->invalidateSnapshot();
   sqlite3_stmt_ptr q = d->prepare("DELETE FROM parking WHERE rowid IN (SELECT rowid FROM positioned WHERE type=?1 AND airport=?2)");
   sqlite3_bind_int(q, 1, FGPositioned::PARKING);
   sqlite3_bind_int64(q, 2, aAirport);
@@ -44,6 +44,15 @@ typedef std::vector<TypedPositioned> TypedPositionedVec;
 // pair of airway ID, destination node ID
 typedef std::pair<int, PositionedID> AirwayEdge;
 typedef std::vector<AirwayEdge> AirwayEdgeVec;
+
+// an airway edge together with the positions of its ends
+struct AirwayNetworkEdge
+{
+  int airway;
+  PositionedID from, to;
+  SGGeod fromPos, toPos;
+};
+typedef std::vector<AirwayNetworkEdge> AirwayNetworkEdgeVec;
   
 namespace Octree {
   class Node;
@@ -71,6 +80,12 @@ public:
    */
   bool rebuild();
   
+  /**
+   * location of the cache file; data derived from the cache, such as the
+   * airway routing landmarks, is stored next to it
+   */
+  SGPath path() const;
+  
   bool isCachedFileModified(const SGPath& path) const;
   void stampCacheFile(const SGPath& path);
   
@@ -244,6 +259,12 @@ public:
    */
   AirwayEdgeVec airwayEdgesFrom(int network, PositionedID pos);
   
+  /**
+   * retrieve all edges of an airway network in one go, with the positions
+   * of their end points, for building the in-memory routing graph
+   */
+  AirwayNetworkEdgeVec airwayNetworkEdges(int network);
+  
 // ground-network
   PositionedIDVec groundNetNodes(PositionedID aAirport, bool onlyPushback);
   void markGroundnetAsPushback(PositionedID nodeId);
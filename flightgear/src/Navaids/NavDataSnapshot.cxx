@@ -0,0 +1,587 @@
+// NavDataSnapshot.cxx -- memory mapped, read-only copy of the nav data cache
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "NavDataSnapshot.hxx"
+
+#include <algorithm>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+#ifdef SG_WINDOWS
+# include <windows.h>
+#else
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include <simgear/debug/logstream.hxx>
+
+namespace flightgear
+{
+
+static const char SNAPSHOT_MAGIC[8] = {'F', 'G', 'N', 'A', 'V', 'S', 'N', 'P'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * The file starts with the header, followed by the records sorted by id,
+ * the ident, name and octree leaf indexes into them, the octree branches
+ * and the strings. Every part starts at a multiple of eight bytes.
+ */
+struct NavDataSnapshot::Header
+{
+  char magic[8];
+  uint32_t version;
+  int32_t generation;
+  uint32_t records, names, leafEntries, branches;
+  uint32_t stringBytes;
+  uint32_t padding;
+  uint64_t fileSize;
+
+  uint64_t recordsOffset() const
+  { return sizeof(Header); }
+
+  uint64_t identIndexOffset() const
+  { return recordsOffset() + uint64_t(records) * sizeof(Record); }
+
+  uint64_t nameIndexOffset() const
+  { return identIndexOffset() + uint64_t(records) * sizeof(uint32_t); }
+
+  uint64_t leafIndexOffset() const
+  { return nameIndexOffset() + uint64_t(names) * sizeof(uint32_t); }
+
+  uint64_t branchesOffset() const
+  {
+    uint64_t end = leafIndexOffset() + uint64_t(leafEntries) * sizeof(uint32_t);
+    return (end + 7) & ~uint64_t(7);
+  }
+
+  uint64_t stringsOffset() const
+  { return branchesOffset() + uint64_t(branches) * 2 * sizeof(int64_t); }
+
+  uint64_t endOffset() const
+  { return stringsOffset() + stringBytes; }
+};
+
+/**
+ * A whole file mapped into memory read-only
+ */
+class NavDataSnapshot::Mapping
+{
+public:
+  Mapping() :
+#ifdef SG_WINDOWS
+    _file(INVALID_HANDLE_VALUE),
+    _mapping(NULL),
+#endif
+    _data(NULL),
+    _size(0)
+  { }
+
+  ~Mapping()
+  {
+#ifdef SG_WINDOWS
+    if (_data) {
+      UnmapViewOfFile(_data);
+    }
+
+    if (_mapping) {
+      CloseHandle(_mapping);
+    }
+
+    if (_file != INVALID_HANDLE_VALUE) {
+      CloseHandle(_file);
+    }
+#else
+    if (_data) {
+      munmap(_data, _size);
+    }
+#endif
+  }
+
+  bool map(const SGPath& aPath)
+  {
+#ifdef SG_WINDOWS
+    _file = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (_file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size) || (size.QuadPart == 0)) {
+      return false;
+    }
+
+    _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!_mapping) {
+      return false;
+    }
+
+    _data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    _size = size.QuadPart;
+#else
+    int fd = ::open(aPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+      ::close(fd);
+      return false;
+    }
+
+    _size = st.st_size;
+    void* data = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping keeps its own reference to the file
+    ::close(fd);
+    _data = (data == MAP_FAILED) ? NULL : data;
+#endif
+    return (_data != NULL);
+  }
+
+  const char* data() const
+  { return static_cast<const char*>(_data); }
+
+  size_t size() const
+  { return _size; }
+private:
+#ifdef SG_WINDOWS
+  HANDLE _file, _mapping;
+#endif
+  void* _data;
+  size_t _size;
+};
+
+/**
+ * compare like SQLite's NOCASE collation does: only ASCII letters are
+ * folded. If aPrefix, b only needs to be a prefix of a to compare equal.
+ */
+static int compareNoCase(const char* a, const char* b, bool aPrefix)
+{
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(a);
+  const unsigned char* q = reinterpret_cast<const unsigned char*>(b);
+  for (; *q; ++p, ++q) {
+    int ca = (*p >= 'A' && *p <= 'Z') ? *p + ('a' - 'A') : *p,
+      cb = (*q >= 'A' && *q <= 'Z') ? *q + ('a' - 'A') : *q;
+    if (ca != cb) {
+      return ca - cb;
+    }
+  }
+  
+  return (aPrefix || (*p == 0)) ? 0 : 1;
+}
+
+/**
+ * orders record indices by a string field, then by id
+ */
+class RecordStringOrder
+{
+public:
+  RecordStringOrder(const std::vector<NavDataSnapshot::Record>& aRecords,
+                    const std::vector<char>& aStrings,
+                    uint32_t NavDataSnapshot::Record::* aField) :
+    _records(aRecords),
+    _strings(aStrings),
+    _field(aField)
+  { }
+
+  bool operator()(uint32_t a, uint32_t b) const
+  {
+    const NavDataSnapshot::Record& ra = _records[a], & rb = _records[b];
+    int c = compareNoCase(&_strings[ra.*_field], &_strings[rb.*_field], false);
+    return (c < 0) || ((c == 0) && (ra.id < rb.id));
+  }
+private:
+  const std::vector<NavDataSnapshot::Record>& _records;
+  const std::vector<char>& _strings;
+  uint32_t NavDataSnapshot::Record::* _field;
+};
+
+/**
+ * orders record indices by octree leaf, then by id
+ */
+class RecordLeafOrder
+{
+public:
+  RecordLeafOrder(const std::vector<NavDataSnapshot::Record>& aRecords) :
+    _records(aRecords)
+  { }
+
+  bool operator()(uint32_t a, uint32_t b) const
+  {
+    const NavDataSnapshot::Record& ra = _records[a], & rb = _records[b];
+    return (ra.octreeNode < rb.octreeNode) ||
+      ((ra.octreeNode == rb.octreeNode) && (ra.id < rb.id));
+  }
+private:
+  const std::vector<NavDataSnapshot::Record>& _records;
+};
+
+template <class T>
+static void writeVector(std::ofstream& aOut, const std::vector<T>& aData)
+{
+  if (!aData.empty()) {
+    aOut.write(reinterpret_cast<const char*>(&aData.front()), aData.size() * sizeof(T));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+NavDataSnapshot::Builder::Builder()
+{
+// offset zero is the empty string
+  _strings.push_back(0);
+}
+
+uint32_t NavDataSnapshot::Builder::addString(const char* aString)
+{
+  if (!aString || (*aString == 0)) {
+    return 0;
+  }
+
+  uint32_t offset = _strings.size();
+  _strings.insert(_strings.end(), aString, aString + strlen(aString) + 1);
+  return offset;
+}
+
+void NavDataSnapshot::Builder::addPositioned(int64_t aId, int aType, const char* aIdent,
+                                             const char* aName, int64_t aAirport,
+                                             double aLon, double aLat, double aElev,
+                                             int64_t aOctreeNode, const SGVec3d& aCart)
+{
+  Record r;
+  memset(&r, 0, sizeof(r));
+  r.id = aId;
+  r.airport = aAirport;
+  r.octreeNode = aOctreeNode;
+  r.lon = aLon;
+  r.lat = aLat;
+  r.elev = aElev;
+  for (int i=0; i<3; ++i) {
+    r.cart[i] = aCart[i];
+  }
+
+  r.type = aType;
+  r.ident = addString(aIdent);
+  r.name = addString(aName);
+  _records.push_back(r);
+}
+
+void NavDataSnapshot::Builder::addOctreeBranch(int64_t aId, int aChildren)
+{
+  _branches.push_back(aId);
+  _branches.push_back(aChildren);
+}
+
+#ifdef SG_WINDOWS
+static unsigned long processId()
+{
+  return GetCurrentProcessId();
+}
+
+static bool replaceFile(const SGPath& aFrom, const SGPath& aTo)
+{
+// fails while another process has the old file mapped
+  return MoveFileExA(aFrom.c_str(), aTo.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#else
+static unsigned long processId()
+{
+  return getpid();
+}
+
+static bool replaceFile(const SGPath& aFrom, const SGPath& aTo)
+{
+// processes which have the old file mapped keep it
+  return ::rename(aFrom.c_str(), aTo.c_str()) == 0;
+}
+#endif
+
+bool NavDataSnapshot::Builder::write(const SGPath& aPath, int aGeneration)
+{
+  std::vector<uint32_t> identIndex, nameIndex, leafIndex;
+  for (uint32_t i=0; i<_records.size(); ++i) {
+    identIndex.push_back(i);
+    if (_records[i].name) {
+      nameIndex.push_back(i);
+    }
+
+    if (_records[i].octreeNode) {
+      leafIndex.push_back(i);
+    }
+  }
+
+  std::sort(identIndex.begin(), identIndex.end(),
+            RecordStringOrder(_records, _strings, &Record::ident));
+  std::sort(nameIndex.begin(), nameIndex.end(),
+            RecordStringOrder(_records, _strings, &Record::name));
+  std::sort(leafIndex.begin(), leafIndex.end(), RecordLeafOrder(_records));
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.version = SNAPSHOT_VERSION;
+  header.generation = aGeneration;
+  header.records = _records.size();
+  header.names = nameIndex.size();
+  header.leafEntries = leafIndex.size();
+  header.branches = _branches.size() / 2;
+  header.stringBytes = _strings.size();
+  header.fileSize = header.endOffset();
+
+// written to a file of its own which then replaces the old one, as other
+// instances sharing FG_HOME may have that mapped
+  std::ostringstream os;
+  os << aPath.str() << "." << processId() << ".tmp";
+  SGPath tmpPath(os.str());
+  
+  std::ofstream out(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+// the magic is only written once everything else is, so an interrupted
+// write leaves a file which is rejected
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  writeVector(out, _records);
+  writeVector(out, identIndex);
+  writeVector(out, nameIndex);
+  writeVector(out, leafIndex);
+  uint64_t padding = header.branchesOffset() - (header.leafIndexOffset() +
+                                                leafIndex.size() * sizeof(uint32_t));
+  out.write("\0\0\0\0\0\0\0", padding);
+  writeVector(out, _branches);
+  writeVector(out, _strings);
+
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+  if (!out) {
+    SG_LOG(SG_NAVAID, SG_WARN, "failed to write nav data snapshot to " << tmpPath);
+    tmpPath.remove();
+    return false;
+  }
+
+  if (!replaceFile(tmpPath, aPath)) {
+    SG_LOG(SG_NAVAID, SG_WARN, "failed to replace nav data snapshot at " << aPath);
+    tmpPath.remove();
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+NavDataSnapshot::NavDataSnapshot() :
+  _mapping(new Mapping),
+  _header(NULL)
+{
+}
+
+NavDataSnapshot::~NavDataSnapshot()
+{
+  delete _mapping;
+}
+
+NavDataSnapshot* NavDataSnapshot::open(const SGPath& aPath, int aGeneration)
+{
+  std::auto_ptr<NavDataSnapshot> snapshot(new NavDataSnapshot);
+  if (!snapshot->_mapping->map(aPath)) {
+    SG_LOG(SG_NAVAID, SG_INFO, "no nav data snapshot at " << aPath);
+    return NULL;
+  }
+
+  const char* base = snapshot->_mapping->data();
+  const Header* h = reinterpret_cast<const Header*>(base);
+  if ((snapshot->_mapping->size() < sizeof(Header)) ||
+      memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) ||
+      (h->version != SNAPSHOT_VERSION) ||
+      (h->fileSize != snapshot->_mapping->size()) ||
+      (h->endOffset() != h->fileSize) ||
+      (h->names > h->records) || (h->leafEntries > h->records))
+  {
+    SG_LOG(SG_NAVAID, SG_WARN, "nav data snapshot at " << aPath << " is damaged");
+    return NULL;
+  }
+
+  if (h->generation != aGeneration) {
+    SG_LOG(SG_NAVAID, SG_INFO, "nav data snapshot at " << aPath << " is out of date");
+    return NULL;
+  }
+
+  snapshot->_header = h;
+  snapshot->_records = reinterpret_cast<const Record*>(base + h->recordsOffset());
+  snapshot->_identIndex = reinterpret_cast<const uint32_t*>(base + h->identIndexOffset());
+  snapshot->_nameIndex = reinterpret_cast<const uint32_t*>(base + h->nameIndexOffset());
+  snapshot->_leafIndex = reinterpret_cast<const uint32_t*>(base + h->leafIndexOffset());
+  snapshot->_branches = reinterpret_cast<const int64_t*>(base + h->branchesOffset());
+  snapshot->_strings = base + h->stringsOffset();
+  if (!snapshot->isConsistent()) {
+    SG_LOG(SG_NAVAID, SG_WARN, "nav data snapshot at " << aPath << " is damaged");
+    return NULL;
+  }
+
+  return snapshot.release();
+}
+
+static bool validIndex(const uint32_t* aIndex, uint32_t aCount, uint32_t aRecords)
+{
+  for (uint32_t i=0; i<aCount; ++i) {
+    if (aIndex[i] >= aRecords) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool NavDataSnapshot::isConsistent() const
+{
+  uint32_t stringBytes = _header->stringBytes;
+  if ((stringBytes > 0) && (_strings[stringBytes - 1] != 0)) {
+    return false; // the last string is not terminated
+  }
+
+  for (uint32_t i=0; i<_header->records; ++i) {
+    if ((_records[i].ident >= stringBytes) || (_records[i].name >= stringBytes)) {
+      return false;
+    }
+  }
+
+  return validIndex(_identIndex, _header->records, _header->records) &&
+    validIndex(_nameIndex, _header->names, _header->records) &&
+    validIndex(_leafIndex, _header->leafEntries, _header->records);
+}
+
+unsigned int NavDataSnapshot::size() const
+{
+  return _header->records;
+}
+
+const NavDataSnapshot::Record* NavDataSnapshot::findById(int64_t aId) const
+{
+  unsigned int lo = 0, hi = _header->records;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (_records[mid].id < aId) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if ((lo < _header->records) && (_records[lo].id == aId)) {
+    return _records + lo;
+  }
+
+  return NULL;
+}
+
+const uint32_t* NavDataSnapshot::findRange(const uint32_t* aIndex, unsigned int aCount,
+                                           uint32_t Record::* aField, const std::string& aKey,
+                                           bool aExact, const uint32_t*& aEnd) const
+{
+// first entry not ordered before the key
+  unsigned int lo = 0, hi = aCount;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (compareNoCase(_strings + (_records[aIndex[mid]].*aField), aKey.c_str(), false) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+// first entry after all the matches
+  unsigned int end = lo;
+  hi = aCount;
+  while (end < hi) {
+    unsigned int mid = end + (hi - end) / 2;
+    if (compareNoCase(_strings + (_records[aIndex[mid]].*aField), aKey.c_str(), !aExact) <= 0) {
+      end = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  aEnd = aIndex + end;
+  return aIndex + lo;
+}
+
+void NavDataSnapshot::findAllByString(const std::string& aString, bool aName, bool aExact,
+                                      int aMinType, int aMaxType, RecordPtrVec& aResult) const
+{
+  const uint32_t* end;
+  const uint32_t* it = aName ?
+    findRange(_nameIndex, _header->names, &Record::name, aString, aExact, end) :
+    findRange(_identIndex, _header->records, &Record::ident, aString, aExact, end);
+  for (; it != end; ++it) {
+    const Record& r = _records[*it];
+    if ((r.type >= aMinType) && (r.type <= aMaxType)) {
+      aResult.push_back(&r);
+    }
+  }
+}
+
+bool NavDataSnapshot::octreeBranchChildren(int64_t aNode, int& aChildren) const
+{
+  unsigned int lo = 0, hi = _header->branches;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (_branches[mid * 2] < aNode) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if ((lo == _header->branches) || (_branches[lo * 2] != aNode)) {
+    return false;
+  }
+
+  aChildren = static_cast<int>(_branches[lo * 2 + 1]);
+  return true;
+}
+
+TypedPositionedVec NavDataSnapshot::octreeLeafChildren(int64_t aNode) const
+{
+  unsigned int lo = 0, hi = _header->leafEntries;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (_records[_leafIndex[mid]].octreeNode < aNode) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  TypedPositionedVec r;
+  for (; (lo < _header->leafEntries) && (_records[_leafIndex[lo]].octreeNode == aNode); ++lo) {
+    const Record& rec = _records[_leafIndex[lo]];
+    r.push_back(std::make_pair(static_cast<FGPositioned::Type>(rec.type), rec.id));
+  }
+
+  return r;
+}
+
+} // of namespace flightgear
@@ -0,0 +1,151 @@
+// NavDataSnapshot.hxx -- memory mapped, read-only copy of the nav data cache
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef FG_NAVDATA_SNAPSHOT_HXX
+#define FG_NAVDATA_SNAPSHOT_HXX
+
+#include <string>
+#include <vector>
+#include <stdint.h> // for int64_t
+
+#include <simgear/misc/sg_path.hxx>
+#include <Navaids/NavDataCache.hxx>
+
+namespace flightgear
+{
+
+/**
+ * Binary copy of the positioned table, its ident and name indexes and the
+ * octree, written from the SQLite cache and mapped into memory read-only.
+ * Lookups binary search the mapped arrays and hand out pointers into the
+ * mapping, so they need neither SQLite nor any copying. Records are only
+ * valid as long as the snapshot is; the cache drops the snapshot as soon
+ * as it modifies any positioned row, so callers must not hold on to them
+ * across calls which may load or modify data.
+ */
+class NavDataSnapshot
+{
+public:
+  /**
+   * One row of the positioned table
+   */
+  struct Record
+  {
+    int64_t id;
+    int64_t airport;
+    int64_t octreeNode; ///< zero when not spatially indexed
+    double lon, lat, elev;
+    double cart[3];
+    int32_t type;
+    uint32_t ident, name; ///< offsets into the string table
+    uint32_t padding;
+  };
+
+  typedef std::vector<const Record*> RecordPtrVec;
+
+  /**
+   * Collects the rows of a snapshot and writes it out
+   */
+  class Builder
+  {
+  public:
+    Builder();
+
+    /// rows must be added in increasing order of their ids
+    void addPositioned(int64_t aId, int aType, const char* aIdent,
+                       const char* aName, int64_t aAirport,
+                       double aLon, double aLat, double aElev,
+                       int64_t aOctreeNode, const SGVec3d& aCart);
+
+    /// branches must be added in increasing order of their ids
+    void addOctreeBranch(int64_t aId, int aChildren);
+
+    /**
+     * write the snapshot to aPath, tagged with the generation of the
+     * cache contents it was made from
+     */
+    bool write(const SGPath& aPath, int aGeneration);
+  private:
+    uint32_t addString(const char* aString);
+
+    std::vector<Record> _records;
+    std::vector<int64_t> _branches;
+    std::vector<char> _strings;
+  };
+
+  ~NavDataSnapshot();
+
+  /**
+   * map the snapshot at aPath. Returns NULL if it is missing, damaged,
+   * or was made from another generation of the cache contents. The file
+   * is never modified in place, a new snapshot replaces it instead.
+   */
+  static NavDataSnapshot* open(const SGPath& aPath, int aGeneration);
+
+  /// the record of a positioned, or NULL if there is no such row
+  const Record* findById(int64_t aId) const;
+
+  const char* ident(const Record& aRecord) const
+  { return _strings + aRecord.ident; }
+
+  const char* name(const Record& aRecord) const
+  { return _strings + aRecord.name; }
+
+  /**
+   * all records of types aMinType to aMaxType whose ident (or name)
+   * matches aString, ignoring the case of ASCII letters like the cache
+   * does. Unless exact, aString only needs to be a prefix.
+   */
+  void findAllByString(const std::string& aString, bool aName, bool aExact,
+                       int aMinType, int aMaxType, RecordPtrVec& aResult) const;
+
+  /**
+   * the bit-mask of the existing children of an octree branch. Returns
+   * false if the branch is not defined.
+   */
+  bool octreeBranchChildren(int64_t aNode, int& aChildren) const;
+
+  /// all positioned items in an octree leaf, and their types
+  TypedPositionedVec octreeLeafChildren(int64_t aNode) const;
+
+  /// number of positioned records
+  unsigned int size() const;
+private:
+  NavDataSnapshot();
+
+  struct Header;
+  class Mapping;
+
+  /// whether all indexes and string offsets are within the mapping
+  bool isConsistent() const;
+
+  const uint32_t* findRange(const uint32_t* aIndex, unsigned int aCount,
+                            uint32_t Record::* aField, const std::string& aKey,
+                            bool aExact, const uint32_t*& aEnd) const;
+
+  Mapping* _mapping;
+  const Header* _header;
+  const Record* _records;
+  const uint32_t* _identIndex;
+  const uint32_t* _nameIndex;
+  const uint32_t* _leafIndex;
+  const int64_t* _branches; ///< pairs of branch id and children mask
+  const char* _strings;
+};
+
+} // of namespace flightgear
+
+#endif // of FG_NAVDATA_SNAPSHOT_HXX
@@ -25,11 +25,16 @@
 
 #include <algorithm>
 #include <set>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <cstring>
 
 #include <simgear/sg_inlines.h>
 #include <simgear/structure/exception.hxx>
 #include <simgear/misc/sgstream.hxx>
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -38,6 +43,7 @@
 #include <Navaids/positioned.hxx>
 #include <Navaids/waypoint.hxx>
 #include <Navaids/NavDataCache.hxx>
+#include <Navaids/IndexedHeap.hxx>
 
 using std::make_pair;
 using std::string;
@@ -91,13 +97,396 @@ typedef SGSharedPtr<AStarOpenNode> AStarOpenNodeRef;
 
 ////////////////////////////////////////////////////////////////////////////
 
+static const double UNSEEN = std::numeric_limits<double>::max();
+
+/**
+ * Dijkstra from aSource over a graph in compressed sparse row form, giving
+ * the length of the shortest path to every node, or UNSEEN
+ */
+static void shortestDistances(const vector<unsigned int>& aFirst,
+                              const vector<unsigned int>& aTarget,
+                              const vector<double>& aLength,
+                              unsigned int aSource, vector<double>& aDist)
+{
+  aDist.assign(aFirst.size() - 1, UNSEEN);
+  IndexedHeap open(aDist);
+  aDist[aSource] = 0.0;
+  open.push(aSource);
+  
+  while (!open.empty()) {
+    unsigned int x = open.pop();
+    for (unsigned int k = aFirst[x]; k < aFirst[x + 1]; ++k) {
+      unsigned int y = aTarget[k];
+      double d = aDist[x] + aLength[k];
+      if (d >= aDist[y]) {
+        continue;
+      }
+      
+      aDist[y] = d;
+      if (open.contains(y)) {
+        open.decrease(y);
+      } else {
+        open.push(y);
+      }
+    }
+  }
+}
+
+/**
+ * The whole network in memory, in compressed sparse row form: the nodes
+ * are numbered in order of their PositionedID, and the edges leaving node
+ * i are edgeTarget[firstEdge[i]] up to (excluding) firstEdge[i+1], with
+ * their lengths computed once when loading.
+ */
+class Airway::Network::Graph
+{
+public:
+  Graph(int aNetworkID) :
+    landmarksChecked(false)
+  {
+    AirwayNetworkEdgeVec edges = NavDataCache::instance()->airwayNetworkEdges(aNetworkID);
+    
+    std::map<PositionedID, SGGeod> positions;
+    BOOST_FOREACH(const AirwayNetworkEdge& e, edges) {
+      positions.insert(make_pair(e.from, e.fromPos));
+      positions.insert(make_pair(e.to, e.toPos));
+    }
+    
+    ids.reserve(positions.size());
+    carts.reserve(positions.size());
+    std::map<PositionedID, SGGeod>::const_iterator it;
+    for (it = positions.begin(); it != positions.end(); ++it) {
+      ids.push_back(it->first);
+    // on the ellipsoid, since the edge lengths ignore the elevation
+      carts.push_back(SGVec3d::fromGeod(SGGeod::fromGeodM(it->second, 0.0)));
+    }
+    
+  // count the edges per node, and turn the counts into offsets
+    firstEdge.assign(ids.size() + 1, 0);
+    BOOST_FOREACH(const AirwayNetworkEdge& e, edges) {
+      ++firstEdge[indexOf(e.from) + 1];
+    }
+    
+    for (unsigned int i=0; i<ids.size(); ++i) {
+      firstEdge[i + 1] += firstEdge[i];
+    }
+    
+    edgeTarget.resize(edges.size());
+    edgeAirway.resize(edges.size());
+    edgeLengthM.resize(edges.size());
+    vector<unsigned int> next(firstEdge.begin(), firstEdge.end() - 1);
+    BOOST_FOREACH(const AirwayNetworkEdge& e, edges) {
+      unsigned int k = next[indexOf(e.from)]++;
+      edgeTarget[k] = indexOf(e.to);
+      edgeAirway[k] = e.airway;
+      edgeLengthM[k] = SGGeodesy::distanceM(e.fromPos, e.toPos);
+    }
+    
+    SG_LOG(SG_NAVAID, SG_INFO, "loaded airway network " << aNetworkID << ": "
+           << ids.size() << " nodes, " << edges.size() << " edges");
+  }
+  
+  static const unsigned int NO_NODE = ~0u;
+  
+  unsigned int size() const
+  { return ids.size(); }
+  
+  /// index of a positioned in the graph, or NO_NODE
+  unsigned int indexOf(PositionedID aID) const
+  {
+    vector<PositionedID>::const_iterator it;
+    it = std::lower_bound(ids.begin(), ids.end(), aID);
+    if ((it == ids.end()) || (*it != aID)) {
+      return NO_NODE;
+    }
+    
+    return it - ids.begin();
+  }
+  
+  /// nodes with edges leaving them, which is what inNetwork() asks for
+  bool hasEdges(unsigned int aNode) const
+  { return firstEdge[aNode] < firstEdge[aNode + 1]; }
+  
+  /**
+   * Lower bound of the distance between two nodes: the chord is never
+   * longer than the geodesic along the ellipsoid. Shortened a little more
+   * so rounding in the edge lengths cannot make it overestimate.
+   */
+  double estimateM(unsigned int a, unsigned int b) const
+  { return dist(carts[a], carts[b]) * (1.0 - 1e-6); }
+  
+  /**
+   * ALT preprocessing (A*, landmarks and the triangle inequality): with the
+   * shortest distances from and to a few landmarks L spread over the
+   * network, d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L). Along
+   * the airways this is a far better lower bound than the chord, so the
+   * search expands much fewer nodes, and still finds the shortest route.
+   *
+   * The distances are computed when the navdata cache is rebuilt and
+   * stored next to it; routing only reads them, and goes without them if
+   * they are missing or were computed for another network.
+   */
+  enum { LANDMARKS = 16 };
+  
+  bool hasLandmarks() const
+  { return !fromLandmark.empty(); }
+  
+  void loadLandmarks(int aNetworkID);
+  void computeLandmarks(int aNetworkID);
+  
+  /**
+   * The ALT lower bound from a to b. Distances are kept as float, so the
+   * bound is shortened by more than their rounding error.
+   */
+  double landmarkEstimateM(unsigned int a, unsigned int b) const
+  {
+    const float* fromA = &fromLandmark[a * LANDMARKS];
+    const float* fromB = &fromLandmark[b * LANDMARKS];
+    const float* toA = &toLandmark[a * LANDMARKS];
+    const float* toB = &toLandmark[b * LANDMARKS];
+    double best = 0.0;
+    for (unsigned int l=0; l<LANDMARKS; ++l) {
+      if ((fromA[l] >= 0.0f) && (fromB[l] >= 0.0f)) {
+        double fa = fromA[l], fb = fromB[l];
+        best = std::max(best, fb - fa - 1e-6 * (fb + fa));
+      }
+      
+      if ((toA[l] >= 0.0f) && (toB[l] >= 0.0f)) {
+        double ta = toA[l], tb = toB[l];
+        best = std::max(best, ta - tb - 1e-6 * (ta + tb));
+      }
+    }
+    
+    return best;
+  }
+  
+  vector<PositionedID> ids;
+  vector<SGVec3d> carts;
+  vector<unsigned int> firstEdge;
+  vector<unsigned int> edgeTarget;
+  vector<int> edgeAirway;
+  vector<double> edgeLengthM;
+  
+// per node, the distance from / to each landmark, or -1 if there is no path
+  vector<float> fromLandmark;
+  vector<float> toLandmark;
+  
+private:
+  bool landmarksChecked;
+  
+  uint64_t signature() const;
+  SGPath landmarkPath(int aNetworkID) const;
+  bool readLandmarks(const SGPath& aPath);
+  void writeLandmarks(const SGPath& aPath) const;
+  void buildLandmarks();
+};
+
+const unsigned int Airway::Network::Graph::NO_NODE;
+
+static const char LANDMARK_MAGIC[8] = {'F', 'G', 'A', 'W', 'Y', 'A', 'L', 'T'};
+static const uint32_t LANDMARK_VERSION = 1;
+
+// FNV-1a, over the raw bytes of a vector
+template<typename T>
+static void hashVector(uint64_t& aHash, const vector<T>& aData)
+{
+  if (aData.empty()) {
+    return;
+  }
+  
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(&aData.front());
+  for (size_t i=0; i<aData.size() * sizeof(T); ++i) {
+    aHash = (aHash ^ p[i]) * 1099511628211ULL;
+  }
+}
+
+/**
+ * identifies the network the landmarks were computed for: any change of
+ * the nodes, the edges or their lengths changes it
+ */
+uint64_t Airway::Network::Graph::signature() const
+{
+  uint64_t hash = 14695981039346656037ULL;
+  hashVector(hash, ids);
+  hashVector(hash, firstEdge);
+  hashVector(hash, edgeTarget);
+  hashVector(hash, edgeLengthM);
+  return hash;
+}
+
+SGPath Airway::Network::Graph::landmarkPath(int aNetworkID) const
+{
+  std::ostringstream os;
+  os << NavDataCache::instance()->path().base() << "_airways" << aNetworkID << ".alt";
+  return SGPath(os.str());
+}
+
+bool Airway::Network::Graph::readLandmarks(const SGPath& aPath)
+{
+  std::ifstream in(aPath.c_str(), std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  
+  char magic[8];
+  uint32_t version, landmarks, nodes;
+  uint64_t sig;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&landmarks), sizeof(landmarks));
+  in.read(reinterpret_cast<char*>(&nodes), sizeof(nodes));
+  in.read(reinterpret_cast<char*>(&sig), sizeof(sig));
+  if (!in || memcmp(magic, LANDMARK_MAGIC, sizeof(magic)) ||
+      (version != LANDMARK_VERSION) || (landmarks != LANDMARKS) ||
+      (nodes != size()) || (sig != signature()))
+  {
+    SG_LOG(SG_NAVAID, SG_INFO, "airway landmarks at " << aPath << " are out of date");
+    return false;
+  }
+  
+  fromLandmark.resize(size() * LANDMARKS);
+  toLandmark.resize(size() * LANDMARKS);
+  in.read(reinterpret_cast<char*>(&fromLandmark.front()), fromLandmark.size() * sizeof(float));
+  in.read(reinterpret_cast<char*>(&toLandmark.front()), toLandmark.size() * sizeof(float));
+  if (!in) {
+    SG_LOG(SG_NAVAID, SG_WARN, "airway landmarks at " << aPath << " are truncated");
+    fromLandmark.clear();
+    toLandmark.clear();
+    return false;
+  }
+  
+  return true;
+}
+
+void Airway::Network::Graph::writeLandmarks(const SGPath& aPath) const
+{
+  std::ofstream out(aPath.c_str(), std::ios::binary | std::ios::trunc);
+  uint32_t version = LANDMARK_VERSION, landmarks = LANDMARKS, nodes = size();
+  uint64_t sig = signature();
+  out.write(LANDMARK_MAGIC, sizeof(LANDMARK_MAGIC));
+  out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  out.write(reinterpret_cast<const char*>(&landmarks), sizeof(landmarks));
+  out.write(reinterpret_cast<const char*>(&nodes), sizeof(nodes));
+  out.write(reinterpret_cast<const char*>(&sig), sizeof(sig));
+  out.write(reinterpret_cast<const char*>(&fromLandmark.front()), fromLandmark.size() * sizeof(float));
+  out.write(reinterpret_cast<const char*>(&toLandmark.front()), toLandmark.size() * sizeof(float));
+  if (!out) {
+    SG_LOG(SG_NAVAID, SG_WARN, "failed to write airway landmarks to " << aPath);
+  }
+}
+
+void Airway::Network::Graph::loadLandmarks(int aNetworkID)
+{
+  if (landmarksChecked || ids.empty()) {
+    return;
+  }
+  
+  landmarksChecked = true;
+  if (!readLandmarks(landmarkPath(aNetworkID))) {
+    SG_LOG(SG_NAVAID, SG_INFO, "routing airway network " << aNetworkID
+           << " without landmarks until the navdata cache is rebuilt");
+  }
+}
+
+void Airway::Network::Graph::computeLandmarks(int aNetworkID)
+{
+  if (ids.empty()) {
+    return;
+  }
+  
+  SGPath path(landmarkPath(aNetworkID));
+  if (readLandmarks(path)) {
+    return; // rebuilt from the same data
+  }
+  
+  SGTimeStamp st = SGTimeStamp::now();
+  buildLandmarks();
+  SG_LOG(SG_NAVAID, SG_INFO, "computed " << LANDMARKS << " landmarks for airway network "
+         << aNetworkID << " in " << st.elapsedMSec() << " msec");
+  writeLandmarks(path);
+}
+
+/**
+ * Picks the landmarks one by one, each as far as possible from those
+ * before it, all in the part of the network reachable from its best
+ * connected node.
+ */
+void Airway::Network::Graph::buildLandmarks()
+{
+  unsigned int n = size();
+  
+// the edges reversed, for the distances to each landmark
+  vector<unsigned int> reverseFirst(n + 1, 0), reverseTarget(edgeTarget.size());
+  vector<double> reverseLength(edgeTarget.size());
+  for (unsigned int k=0; k<edgeTarget.size(); ++k) {
+    ++reverseFirst[edgeTarget[k] + 1];
+  }
+  
+  for (unsigned int i=0; i<n; ++i) {
+    reverseFirst[i + 1] += reverseFirst[i];
+  }
+  
+  vector<unsigned int> next(reverseFirst.begin(), reverseFirst.end() - 1);
+  for (unsigned int x=0; x<n; ++x) {
+    for (unsigned int k = firstEdge[x]; k < firstEdge[x + 1]; ++k) {
+      unsigned int r = next[edgeTarget[k]]++;
+      reverseTarget[r] = x;
+      reverseLength[r] = edgeLengthM[k];
+    }
+  }
+  
+  unsigned int seed = 0;
+  for (unsigned int i=1; i<n; ++i) {
+    if (firstEdge[i + 1] - firstEdge[i] > firstEdge[seed + 1] - firstEdge[seed]) {
+      seed = i;
+    }
+  }
+  
+// how far each candidate is from the closest landmark so far
+  vector<double> dist, closest;
+  shortestDistances(firstEdge, edgeTarget, edgeLengthM, seed, closest);
+  
+  fromLandmark.assign(n * LANDMARKS, -1.0f);
+  toLandmark.assign(n * LANDMARKS, -1.0f);
+  for (unsigned int l=0; l<LANDMARKS; ++l) {
+    unsigned int landmark = seed;
+    double farthest = -1.0;
+    for (unsigned int i=0; i<n; ++i) {
+      if ((closest[i] != UNSEEN) && (closest[i] > farthest)) {
+        landmark = i;
+        farthest = closest[i];
+      }
+    }
+    
+    shortestDistances(firstEdge, edgeTarget, edgeLengthM, landmark, dist);
+    for (unsigned int i=0; i<n; ++i) {
+      if (dist[i] != UNSEEN) {
+        fromLandmark[i * LANDMARKS + l] = dist[i];
+        if (l == 0) {
+          closest[i] = dist[i];
+        } else if (closest[i] != UNSEEN) {
+          closest[i] = std::min(closest[i], dist[i]);
+        }
+      }
+    }
+    
+    shortestDistances(reverseFirst, reverseTarget, reverseLength, landmark, dist);
+    for (unsigned int i=0; i<n; ++i) {
+      if (dist[i] != UNSEEN) {
+        toLandmark[i * LANDMARKS + l] = dist[i];
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
 Airway::Network* Airway::lowLevel()
 {
   static Network* static_lowLevel = NULL;
   
   if (!static_lowLevel) {
-    static_lowLevel = new Network;
-    static_lowLevel->_networkID = 1;
+    static_lowLevel = new Network(1);
   }
   
   return static_lowLevel;
@@ -107,13 +496,18 @@ Airway::Network* Airway::highLevel()
 {
   static Network* static_highLevel = NULL;
   if (!static_highLevel) {
-    static_highLevel = new Network;
-    static_highLevel->_networkID = 2;
+    static_highLevel = new Network(2);
   }
   
   return static_highLevel;
 }
 
+Airway::Network::Network(int aNetworkID) :
+  _networkID(aNetworkID),
+  _graph(NULL)
+{
+}
+
 Airway::Airway(const std::string& aIdent, double aTop, double aBottom) :
   _ident(aIdent),
   _topAltitudeFt(aTop),
@@ -123,42 +517,54 @@ Airway::Airway(const std::string& aIdent, double aTop, double aBottom) :
 
 void Airway::load(const SGPath& path)
 {
-  std::string identStart, identEnd, name;
-  double latStart, lonStart, latEnd, lonEnd;
-  int type, base, top;
-  //int airwayIndex = 0;
-  //FGNode *n;
-
   sg_gzifstream in( path.str() );
   if ( !in.is_open() ) {
     SG_LOG( SG_NAVAID, SG_ALERT, "Cannot open file: " << path.str() );
     throw sg_io_exception("Could not open airways data", sg_location(path.str()));
   }
+  
+  SegmentVec segments;
+  parse(in, segments);
+  load(segments);
+}
+
+void Airway::parse(std::istream& in, SegmentVec& segments)
+{
+  double latStart, lonStart, latEnd, lonEnd;
+
 // toss the first two lines of the file
   in >> skipeol;
   in >> skipeol;
 
 // read in each remaining line of the file
   while (!in.eof()) {
-    in >> identStart;
+    Segment seg;
+    in >> seg.startIdent;
 
-    if (identStart == "99") {
+    if (seg.startIdent == "99") {
       break;
     }
     
-    in >> latStart >> lonStart >> identEnd >> latEnd >> lonEnd >> type >> base >> top >> name;
+    in >> latStart >> lonStart >> seg.endIdent >> latEnd >> lonEnd
+       >> seg.type >> seg.base >> seg.top >> seg.name;
     in >> skipeol;
+    
+    seg.startPos = SGGeod::fromDeg(lonStart, latStart);
+    seg.endPos = SGGeod::fromDeg(lonEnd, latEnd);
+    segments.push_back(seg);
+  } // of file line iteration
+}
 
+void Airway::load(const SegmentVec& segments)
+{
+  BOOST_FOREACH(const Segment& seg, segments) {
     // type = 1; low-altitude
     // type = 2; high-altitude
-    Network* net = (type == 1) ? lowLevel() : highLevel();
-  
-    SGGeod startPos(SGGeod::fromDeg(lonStart, latStart)),
-      endPos(SGGeod::fromDeg(lonEnd, latEnd));
+    Network* net = (seg.type == 1) ? lowLevel() : highLevel();
     
-    int awy = net->findAirway(name, top, base);
-    net->addEdge(awy, startPos, identStart, endPos, identEnd);
-  } // of file line iteration
+    int awy = net->findAirway(seg.name, seg.top, seg.base);
+    net->addEdge(awy, seg.startPos, seg.startIdent, seg.endPos, seg.endIdent);
+  }
 }
 
 int Airway::Network::findAirway(const std::string& aName, double aTop, double aBase)
@@ -186,6 +592,32 @@ void Airway::Network::addEdge(int aWay, const SGGeod& aStartPos,
   }
   
   NavDataCache::instance()->insertEdge(_networkID, aWay, start->guid(), end->guid());
+  
+// the network is being rebuilt, load it again when next routing
+  delete _graph;
+  _graph = NULL;
+}
+
+void Airway::computeLandmarks()
+{
+  lowLevel()->computeLandmarks();
+  highLevel()->computeLandmarks();
+}
+
+// in a graph of its own, this runs in the cache rebuild thread
+void Airway::Network::computeLandmarks()
+{
+  Graph g(_networkID);
+  g.computeLandmarks(_networkID);
+}
+
+Airway::Network::Graph* Airway::Network::graph() const
+{
+  if (!_graph) {
+    _graph = new Graph(_networkID);
+  }
+  
+  return _graph;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -199,14 +631,9 @@ static double headingDiffDeg(double a, double b)
     
 bool Airway::Network::inNetwork(PositionedID posID) const
 {
-  NetworkMembershipDict::iterator it = _inNetworkCache.find(posID);
-  if (it != _inNetworkCache.end()) {
-    return it->second; // cached, easy
-  }
-  
-  bool r =  NavDataCache::instance()->isInAirwayNetwork(_networkID, posID);
-  _inNetworkCache.insert(it, std::make_pair(posID, r));
-  return r;
+  Graph* g = graph();
+  unsigned int index = g->indexOf(posID);
+  return (index != Graph::NO_NODE) && g->hasEdges(index);
 }
 
 bool Airway::Network::route(WayptRef aFrom, WayptRef aTo, 
@@ -230,7 +657,7 @@ bool Airway::Network::route(WayptRef aFrom, WayptRef aTo,
   SG_LOG(SG_NAVAID, SG_INFO, "to:" << to->ident() << "/" << to->name());
 #endif
 
-  bool ok = search2(from, to, aPath);
+  bool ok = searchGraph(from, to, aPath);
   if (!ok) {
     return false;
   }
@@ -322,6 +749,167 @@ Airway::Network::findClosestNode(const SGGeod& aGeod)
 
 /////////////////////////////////////////////////////////////////////////////
 
+bool Airway::Network::searchGraph(FGPositionedRef aStart, FGPositionedRef aDest,
+  WayptVec& aRoute, bool aLandmarks)
+{
+  if (!aStart || !aDest) {
+    return false;
+  }
+  
+  Graph* g = graph();
+  unsigned int start = g->indexOf(aStart->guid()),
+    dest = g->indexOf(aDest->guid());
+  if ((start == Graph::NO_NODE) || (dest == Graph::NO_NODE)) {
+    SG_LOG(SG_NAVAID, SG_INFO, "A* failed to find route, end point not in network");
+    return false;
+  }
+  
+  if (aLandmarks) {
+    g->loadLandmarks(_networkID);
+    aLandmarks = g->hasLandmarks();
+  }
+  
+// per search state, indexed by node. g(x) is infinite for nodes not seen
+// yet, h(x) is computed when a node is first reached.
+  vector<double> distanceFromStart(g->size(), UNSEEN);
+  vector<double> estimate(g->size(), UNSEEN);
+  vector<double> totalCost(g->size(), UNSEEN);
+  vector<unsigned int> previous(g->size(), Graph::NO_NODE);
+  IndexedHeap openNodes(totalCost);
+  
+  distanceFromStart[start] = 0.0;
+  totalCost[start] = 0.0;
+  openNodes.push(start);
+  
+// A* open node iteration
+  while (!openNodes.empty()) {
+    unsigned int x = openNodes.pop();
+    
+  // check if x is the goal; if so we're done, since there cannot be an open
+  // node with lower f(x) value.
+    if (x == dest) {
+      vector<unsigned int> path;
+      for (unsigned int n = x; n != Graph::NO_NODE; n = previous[n]) {
+        path.push_back(n);
+      }
+      
+      NavDataCache* cache = NavDataCache::instance();
+      aRoute.resize(path.size());
+      for (unsigned int i=0; i<path.size(); ++i) {
+        FGPositionedRef pos = cache->loadById(g->ids[path[path.size() - 1 - i]]);
+        aRoute[i] = new NavaidWaypoint(pos, NULL);
+      }
+      
+      return true;
+    }
+    
+  // adjacent (neighbour) iteration. Closed nodes are opened again if a
+  // shorter path to them turns up, which the landmark bounds allow by a
+  // rounding error, so the result stays exactly the shortest route.
+    for (unsigned int k = g->firstEdge[x]; k < g->firstEdge[x + 1]; ++k) {
+      unsigned int y = g->edgeTarget[k];
+      double d = distanceFromStart[x] + g->edgeLengthM[k];
+      if (d >= distanceFromStart[y]) {
+        continue; // worse path, ignore
+      }
+      
+      if (estimate[y] == UNSEEN) {
+        estimate[y] = g->estimateM(y, dest);
+        if (aLandmarks) {
+          estimate[y] = std::max(estimate[y], g->landmarkEstimateM(y, dest));
+        }
+      }
+      
+      distanceFromStart[y] = d;
+      totalCost[y] = d + estimate[y];
+      previous[y] = x;
+      if (openNodes.contains(y)) {
+        openNodes.decrease(y);
+      } else {
+        openNodes.push(y);
+      }
+    } // of neighbour iteration
+  } // of open node iteration
+  
+  SG_LOG(SG_NAVAID, SG_INFO, "A* failed to find route");
+  return false;
+}
+
+static double routeLengthM(const WayptVec& aRoute)
+{
+  double d = 0.0;
+  for (unsigned int i=1; i<aRoute.size(); ++i) {
+    d += SGGeodesy::distanceM(aRoute[i - 1]->position(), aRoute[i]->position());
+  }
+  
+  return d;
+}
+
+bool Airway::Network::benchmark(const std::vector<std::pair<WayptRef, WayptRef> >& aPairs)
+{
+  SGTimeStamp st = SGTimeStamp::now();
+  graph();
+  SG_LOG(SG_NAVAID, SG_INFO, "airway benchmark: loading network " << _networkID
+         << " took " << st.elapsedMSec() << " msec");
+  st.stamp();
+  graph()->loadLandmarks(_networkID);
+  SG_LOG(SG_NAVAID, SG_INFO, "airway benchmark: loading landmarks took "
+         << st.elapsedMSec() << " msec");
+  
+  bool ok = true;
+  double landmarkUSec = 0.0, graphUSec = 0.0, databaseUSec = 0.0;
+  for (unsigned int i=0; i<aPairs.size(); ++i) {
+    FGPositionedRef from = findClosestNode(aPairs[i].first).first,
+      to = findClosestNode(aPairs[i].second).first;
+    if (!from || !to) {
+      SG_LOG(SG_NAVAID, SG_INFO, "airway benchmark: no network node near "
+             << aPairs[i].first->ident() << " or " << aPairs[i].second->ident());
+      continue;
+    }
+    
+    WayptVec landmarkRoute, graphRoute, databaseRoute;
+    st.stamp();
+    bool landmarkOk = searchGraph(from, to, landmarkRoute, true);
+    double landmarkPairUSec = (SGTimeStamp::now() - st).toUSecs();
+    st.stamp();
+    bool graphOk = searchGraph(from, to, graphRoute, false);
+    double graphPairUSec = (SGTimeStamp::now() - st).toUSecs();
+    st.stamp();
+    bool databaseOk = search2(from, to, databaseRoute);
+    double databasePairUSec = (SGTimeStamp::now() - st).toUSecs();
+    landmarkUSec += landmarkPairUSec;
+    graphUSec += graphPairUSec;
+    databaseUSec += databasePairUSec;
+    
+    double landmarkM = routeLengthM(landmarkRoute),
+      graphM = routeLengthM(graphRoute),
+      databaseM = routeLengthM(databaseRoute);
+    SG_LOG(SG_NAVAID, SG_INFO, "airway benchmark: " << aPairs[i].first->ident()
+           << "-" << aPairs[i].second->ident() << ": " << graphRoute.size()
+           << " waypoints, " << graphM * SG_METER_TO_NM << "nm, landmarks "
+           << landmarkPairUSec << " usec, graph " << graphPairUSec
+           << " usec, database " << databasePairUSec << " usec");
+    
+  // routes of equal length may take different nodes, compare the lengths
+    if ((landmarkOk != graphOk) || (fabs(landmarkM - graphM) > 1.0)) {
+      SG_LOG(SG_NAVAID, SG_WARN, "airway benchmark: landmark route differs, "
+             << landmarkM << "m against " << graphM << "m");
+      ok = false;
+    }
+    
+    if ((graphOk != databaseOk) || (fabs(graphM - databaseM) > 1.0)) {
+      SG_LOG(SG_NAVAID, SG_WARN, "airway benchmark: routes differ, graph "
+             << graphM << "m, database " << databaseM << "m");
+      ok = false;
+    }
+  }
+  
+  SG_LOG(SG_NAVAID, SG_INFO, "airway benchmark: " << aPairs.size() << " pairs, landmarks "
+         << landmarkUSec / 1000 << " msec, graph " << graphUSec / 1000
+         << " msec, database " << databaseUSec / 1000 << " msec");
+  return ok;
+}
+
 typedef vector<AStarOpenNodeRef> OpenNodeHeap;
 
 static void buildWaypoints(AStarOpenNodeRef aNode, WayptVec& aRoute)
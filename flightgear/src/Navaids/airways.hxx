@@ -44,6 +44,28 @@ public:
   
   static void load(const SGPath& path);
   
+  /**
+   * one line of awy.dat, parsed into memory so the parsing can run in a
+   * thread of its own while the cache is busy with other files
+   */
+  struct Segment
+  {
+    std::string startIdent, endIdent, name;
+    SGGeod startPos, endPos;
+    int type, base, top;
+  };
+  typedef std::vector<Segment> SegmentVec;
+  
+  static void parse(std::istream& in, SegmentVec& segments);
+  static void load(const SegmentVec& segments);
+  
+  /**
+   * Compute the routing landmarks of both networks, and store them next
+   * to the navdata cache. Done when the cache is rebuilt, routing only
+   * reads them.
+   */
+  static void computeLandmarks();
+  
   /**
    * Track a network of airways
    *
@@ -64,17 +86,47 @@ public:
      * Returns true if a route could be found, or false otherwise.
      */
     bool route(WayptRef aFrom, WayptRef aTo, WayptVec& aPath);
-  private:    
+    
+    /**
+     * Route between each pair of waypoints with the in-memory graph, with
+     * and without landmarks, and with the search over the database, logging
+     * the time taken by each. Returns false if the searches disagree.
+     */
+    bool benchmark(const std::vector<std::pair<WayptRef, WayptRef> >& aPairs);
+  private:
+    class Graph;
+    
+    Network(int aNetworkID);
+    
     void addEdge(int aWay, const SGGeod& aStartPos,
                 const std::string& aStartIdent, 
                 const SGGeod& aEndPos, const std::string& aEndIdent);
   
     int findAirway(const std::string& aName, double aTop, double aBase);
+    
+    void computeLandmarks();
 
     bool cleanGeneratedPath(WayptRef aFrom, WayptRef aTo, WayptVec& aPath,
                             bool exactTo, bool exactFrom);
       
+    /**
+     * A* over the in-memory graph, see Graph. With aLandmarks the search is
+     * guided by the ALT bounds, which gives the same route much faster
+     * once they have been computed.
+     */
+    bool searchGraph(FGPositionedRef aStart, FGPositionedRef aDest,
+                     WayptVec& aRoute, bool aLandmarks = true);
+    
+    /**
+     * A* querying the database for every expanded node. Much slower, kept
+     * as the reference for benchmark()
+     */
     bool search2(FGPositionedRef aStart, FGPositionedRef aDest, WayptVec& aRoute);
+    
+    /**
+     * the in-memory graph, loaded from the database on first use
+     */
+    Graph* graph() const;
   
     /**
      * Test if a positioned item is part of this airway network or not.
@@ -101,13 +153,8 @@ public:
   
     std::pair<FGPositionedRef, bool> findClosestNode(const SGGeod& aGeod);
     
-    /**
-     * cache which positioned items are in this network
-     */
-    typedef std::map<PositionedID, bool> NetworkMembershipDict;
-    mutable NetworkMembershipDict _inNetworkCache;
-    
     int _networkID;
+    mutable Graph* _graph;
   };
 
 
@@ -53,23 +53,36 @@ void loadFixes(const SGPath& path)
     exit(-1);
   }
   
+  FixRecordVec fixes;
+  parseFixes(in, fixes);
+  loadFixes(fixes);
+}
+
+void parseFixes(std::istream& in, FixRecordVec& fixes)
+{
   // toss the first two lines of the file
   in >> skipeol;
   in >> skipeol;
   
-  NavDataCache* cache = NavDataCache::instance();
-  
   // read in each remaining line of the file
   while ( ! in.eof() ) {
     double lat, lon;
-    std::string ident;
-    in >> lat >> lon >> ident;
+    FixRecord fix;
+    in >> lat >> lon >> fix.ident;
     if (lat > 95) break;
     
-    cache->insertFix(ident, SGGeod::fromDeg(lon, lat));
+    fix.pos = SGGeod::fromDeg(lon, lat);
+    fixes.push_back(fix);
     in >> skipcomment;
   }
+}
 
+void loadFixes(const FixRecordVec& fixes)
+{
+  NavDataCache* cache = NavDataCache::instance();
+  for (unsigned int i=0; i<fixes.size(); ++i) {
+    cache->insertFix(fixes[i].ident, fixes[i].pos);
+  }
 }
   
 } // of namespace flightgear;
@@ -27,6 +27,12 @@
 
 #include <simgear/compiler.h>
 
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+
 class SGPath;
 
 namespace flightgear
@@ -34,6 +40,20 @@ namespace flightgear
   
   void loadFixes(const SGPath& path);
   
+  /**
+   * fix.dat parsed into memory, so the parsing can run in a thread of its
+   * own while the cache is busy with other files
+   */
+  struct FixRecord
+  {
+    std::string ident;
+    SGGeod pos;
+  };
+  typedef std::vector<FixRecord> FixRecordVec;
+  
+  void parseFixes(std::istream& in, FixRecordVec& fixes);
+  void loadFixes(const FixRecordVec& fixes);
+  
 }
 
 #endif // _FG_FIXLIST_HXX
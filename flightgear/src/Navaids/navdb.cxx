@@ -255,6 +255,11 @@ bool navDBInit(const SGPath& path)
       return false;
     }
   
+    return navDBInit(in);
+}
+  
+bool navDBInit(std::istream& in)
+{
   autoAlignLocalizers = fgGetBool("/sim/navdb/localizers/auto-align", true);
   autoAlignThreshold = fgGetDouble( "/sim/navdb/localizers/auto-align-threshold-deg", 5.0 );
 
@@ -281,6 +286,11 @@ bool loadCarrierNav(const SGPath& path)
       return false;
     }
     
+    return loadCarrierNav(incarrier);
+}
+  
+bool loadCarrierNav(std::istream& incarrier)
+{
     while ( ! incarrier.eof() ) {
       // force the type to be MOBILE_TACAN
       readNavFromStream(incarrier, FGPositioned::MOBILE_TACAN);
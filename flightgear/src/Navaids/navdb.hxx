@@ -27,6 +27,7 @@
 
 #include <simgear/compiler.h>
 #include <string>
+#include <iosfwd>
 
 // forward decls
 class FGTACANList;
@@ -40,7 +41,11 @@ namespace flightgear
 // load and initialize the navigational databases
 bool navDBInit(const SGPath& path);
   
+// the same, from the file contents already read into memory
+bool navDBInit(std::istream& in);
+  
 bool loadCarrierNav(const SGPath& path);
+bool loadCarrierNav(std::istream& in);
   
 bool loadTacan(const SGPath& path, FGTACANList *channellist);
 
@@ -93,6 +93,11 @@ bool poiDBInit(const SGPath& path)
       return false;
     }
 
+    return poiDBInit(in);
+}
+
+bool poiDBInit(std::istream& in)
+{
     in >> skipcomment;
 
     while (!in.eof()) {
@@ -25,6 +25,8 @@
 
 #include <simgear/compiler.h>
 
+#include <iosfwd>
+
 
 // forward decls
 class SGPath;
@@ -35,6 +37,9 @@ namespace flightgear
 // load and initialize the POI database
 bool poiDBInit(const SGPath& path);
 
+// the same, from the file contents already read into memory
+bool poiDBInit(std::istream& in);
+
 } // of namespace flightgear
 
 #endif // _FG_NAVDB_HXX
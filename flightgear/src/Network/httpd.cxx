@@ -254,7 +254,7 @@ void HttpdChannel::foundTerminator (void) {
                     } else {
                         if ( a == "value" ) {
                             // update a property value
-                            fgSetString( request.c_str(),
+                            fgSetString( fgCompiledPath(request),
                                          urlDecode(b).c_str() );
                         }
                     }
@@ -264,7 +264,7 @@ void HttpdChannel::foundTerminator (void) {
             request = urlDecode(request);
 	}
 
-        node = globals->get_props()->getNode(request.c_str());
+        node = fgGetNode(fgCompiledPath(request));
 
         string response = "";
         response += "<HTML LANG=\"en\">";
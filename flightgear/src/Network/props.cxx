@@ -40,6 +40,7 @@
 #include <errno.h>
 
 #include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
 #include <Viewer/viewmgr.hxx>
 
 #include <simgear/io/sg_netChat.hxx>
@@ -335,15 +336,15 @@ PropsChannel::foundTerminator()
                 push( getTerminator() );
             } else if ( command == "get" || command == "show" ) {
                 if ( tokens.size() == 2 ) {
+                    const SGPropertyPath& child = fgCompiledPath( tokens[1] );
                     string tmp;
-                    string value = node->getStringValue ( tokens[1].c_str(), "" );
+                    string value = node->getStringValue ( child, "" );
                     if ( mode == PROMPT ) {
                         tmp = tokens[1];
                         tmp += " = '";
                         tmp += value;
                         tmp += "' (";
-                        tmp += getValueTypeString(
-                                         node->getNode( tokens[1].c_str() ) );
+                        tmp += getValueTypeString( node->getNode( child ) );
                         tmp += ")";
                     } else {
                         tmp = value;
@@ -359,15 +360,15 @@ PropsChannel::foundTerminator()
                             value += " ";
                         value += tokens[i];
                     }
-                    node->getNode( tokens[1].c_str(), true )
-                        ->setStringValue(value.c_str());
+                    const SGPropertyPath& child = fgCompiledPath( tokens[1] );
+                    node->getNode( child, true )->setStringValue(value.c_str());
 
                     if ( mode == PROMPT ) {
                         // now fetch and write out the new value as confirmation
                         // of the change
-                        value = node->getStringValue ( tokens[1].c_str(), "" );
+                        value = node->getStringValue ( child, "" );
                         tmp = tokens[1] + " = '" + value + "' (";
-                        tmp += getValueTypeString( node->getNode( tokens[1].c_str() ) );
+                        tmp += getValueTypeString( node->getNode( child ) );
                         tmp += ")";
                         push( tmp.c_str() );
                         push( getTerminator() );
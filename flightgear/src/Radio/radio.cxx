@@ -320,13 +320,20 @@ double FGRadioTransmission::ITM_calculate_attenuation(SGGeod pos, double freq, i
 	
 	unsigned int e_size = (deque<unsigned>::size_type)max_points;
 	
-	while (elevations.size() <= e_size) {
+	// sample the whole terrain profile in one go
+	FGScenery::ElevationQueryList probes;
+	for (unsigned int i = 0; i <= e_size; i++) {
 		probe_distance += point_distance;
 		SGGeod probe = SGGeod::fromGeoc(center.advanceRadM( course, probe_distance ));
-		const simgear::BVHMaterial *material = 0;
-		double elevation_m = 0.0;
+		probes.push_back(FGScenery::ElevationQuery(probe));
+	}
+	scenery->get_elevations_m(probes);
+
+	for (unsigned int i = 0; i < probes.size(); i++) {
+		const simgear::BVHMaterial *material = probes[i].material;
+		double elevation_m = probes[i].elevation;
 	
-		if (scenery->get_elevation_m( probe, elevation_m, &material )) {
+		if (probes[i].valid) {
                         const SGMaterial *mat;
                         mat = dynamic_cast<const SGMaterial*>(material);
 			if((transmission_type == 3) || (transmission_type == 4)) {
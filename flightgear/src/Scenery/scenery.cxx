@@ -28,6 +28,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include <osg/Camera>
 #include <osg/Transform>
 #include <osg/MatrixTransform>
@@ -36,6 +38,7 @@
 #include <osgViewer/Viewer>
 
 #include <simgear/constants.h>
+#include <simgear/bucket/newbucket.hxx>
 #include <simgear/sg_inlines.h>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/scene/tgdb/userdata.hxx>
@@ -48,6 +51,7 @@
 #include <simgear/bvh/BVHNode.hxx>
 #include <simgear/bvh/BVHLineSegmentVisitor.hxx>
 #include <simgear/structure/commands.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <Viewer/renderer.hxx>
 #include <Main/fg_props.hxx>
@@ -218,6 +222,226 @@ private:
     bool _haveHit;
 };
 
+// Collects the terrain bounding volumes within a sphere, together with
+// the transforms to reach them, so that many line segments in there can
+// be tested without walking the scene graph for each of them.
+class FGSceneryCollect : public osg::NodeVisitor {
+public:
+    struct Volume {
+        SGSharedPtr<simgear::BVHNode> node;
+        SGMatrixd toLocal;
+        SGMatrixd toWorld;
+        bool transformed;
+    };
+    typedef std::vector<Volume> VolumeList;
+
+    FGSceneryCollect(const SGSphered& sphere, const osg::Node* skipNode) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _sphere(sphere),
+        _skipNode(skipNode),
+        _transformed(false)
+    { }
+
+    VolumeList& getVolumes()
+    { return _volumes; }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (&node == _skipNode)
+            return;
+        if (!testBoundingSphere(node.getBound()))
+            return;
+
+        addBoundingVolume(node);
+    }
+
+    virtual void apply(osg::Group& group)
+    {
+        if (&group == _skipNode)
+            return;
+        if (!testBoundingSphere(group.getBound()))
+            return;
+
+        traverse(group);
+        addBoundingVolume(group);
+    }
+
+    virtual void apply(osg::Transform& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::Camera& camera)
+    {
+        if (camera.getRenderOrder() != osg::Camera::NESTED_RENDER)
+            return;
+        handleTransform(camera);
+    }
+    virtual void apply(osg::CameraView& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::MatrixTransform& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::PositionAttitudeTransform& transform)
+    { handleTransform(transform); }
+
+private:
+    // Same as FGSceneryIntersect, but accumulating the transforms
+    void handleTransform(osg::Transform& transform)
+    {
+        if (&transform == _skipNode)
+            return;
+        if (transform.getReferenceFrame() != osg::Transform::RELATIVE_RF)
+            return;
+
+        if (!testBoundingSphere(transform.getBound()))
+            return;
+
+        osg::Matrix inverseMatrix;
+        if (!transform.computeWorldToLocalMatrix(inverseMatrix, this))
+            return;
+        osg::Matrix matrix;
+        if (!transform.computeLocalToWorldMatrix(matrix, this))
+            return;
+
+        SGSphered sphere = _sphere;
+        osg::Matrix toLocal = _toLocal;
+        osg::Matrix toWorld = _toWorld;
+        bool transformed = _transformed;
+
+        osg::Vec3d center = toOsg(sphere.getCenter())*inverseMatrix;
+        osg::Vec3d scales = inverseMatrix.getScale();
+        double scale = std::max(scales[0], std::max(scales[1], scales[2]));
+        _sphere = SGSphered(toSG(center), scale*sphere.getRadius());
+        _toLocal = toLocal*inverseMatrix;
+        _toWorld = matrix*toWorld;
+        _transformed = true;
+
+        addBoundingVolume(transform);
+        traverse(transform);
+
+        _sphere = sphere;
+        _toLocal = toLocal;
+        _toWorld = toWorld;
+        _transformed = transformed;
+    }
+
+    void addBoundingVolume(osg::Node& node)
+    {
+        SGSceneUserData* userData = SGSceneUserData::getSceneUserData(&node);
+        if (!userData)
+            return;
+        simgear::BVHNode* bvNode = userData->getBVHNode();
+        if (!bvNode)
+            return;
+        // This also computes all the bounds below, which the queries
+        // only read then, from whatever thread they run in
+        if (!intersects(_sphere, bvNode->getBoundingSphere()))
+            return;
+
+        Volume volume;
+        volume.node = bvNode;
+        volume.toLocal = SGMatrixd(_toLocal.ptr());
+        volume.toWorld = SGMatrixd(_toWorld.ptr());
+        volume.transformed = _transformed;
+        _volumes.push_back(volume);
+    }
+
+    bool testBoundingSphere(const osg::BoundingSphere& bound) const
+    {
+        if (!bound.valid())
+            return false;
+
+        SGSphered sphere(toVec3d(toSG(bound._center)), bound._radius);
+        return intersects(_sphere, sphere);
+    }
+
+    SGSphered _sphere;
+    const osg::Node* _skipNode;
+
+    osg::Matrix _toLocal;
+    osg::Matrix _toWorld;
+    bool _transformed;
+    VolumeList _volumes;
+};
+
+namespace
+{
+
+// The line segment get_elevation_m() searches for the terrain
+SGLineSegmentd elevationLineSegment(const SGGeod& geod)
+{
+  SGVec3d start = SGVec3d::fromGeod(geod);
+
+  SGGeod geodEnd = geod;
+  geodEnd.setElevationM(SGMiscd::min(geod.getElevationM() - 10, -10000));
+  SGVec3d end = SGVec3d::fromGeod(geodEnd);
+  return SGLineSegmentd(start, end);
+}
+
+typedef FGSceneryCollect::VolumeList VolumeList;
+
+// One query of get_elevations_m(), with the volumes of its tile
+struct ElevationTask {
+  FGScenery::ElevationQuery* query;
+  const VolumeList* volumes;
+  long bucket;
+};
+
+bool operator<(const ElevationTask& task1, const ElevationTask& task2)
+{
+  if (task1.bucket != task2.bucket)
+    return task1.bucket < task2.bucket;
+  // keep neighbours next to each other within the tile as well
+  const SGGeod& pos1 = task1.query->position;
+  const SGGeod& pos2 = task2.query->position;
+  if (pos1.getLatitudeRad() != pos2.getLatitudeRad())
+    return pos1.getLatitudeRad() < pos2.getLatitudeRad();
+  return pos1.getLongitudeRad() < pos2.getLongitudeRad();
+}
+
+void answerElevationTask(const ElevationTask& task)
+{
+  FGScenery::ElevationQuery& query = *task.query;
+  SGLineSegmentd lineSegment = elevationLineSegment(query.position);
+  query.valid = false;
+
+  VolumeList::const_iterator i;
+  for (i = task.volumes->begin(); i != task.volumes->end(); ++i) {
+    SGLineSegmentd local = lineSegment;
+    if (i->transformed)
+      local = lineSegment.transform(i->toLocal);
+    simgear::BVHLineSegmentVisitor lineSegmentVisitor(local, 0/*startTime*/);
+    i->node->accept(lineSegmentVisitor);
+    if (lineSegmentVisitor.empty())
+      continue;
+    lineSegment = lineSegmentVisitor.getLineSegment();
+    if (i->transformed)
+      lineSegment = lineSegment.transform(i->toWorld);
+    query.material = lineSegmentVisitor.getMaterial();
+    query.valid = true;
+  }
+
+  if (query.valid)
+    query.elevation = SGGeod::fromCart(lineSegment.getEnd()).getElevationM();
+}
+
+void answerElevationTasks(const ElevationTask* begin, const ElevationTask* end)
+{
+  for (const ElevationTask* task = begin; task != end; ++task)
+    answerElevationTask(*task);
+}
+
+class ElevationThread : public SGThread {
+public:
+  ElevationThread(const ElevationTask* begin, const ElevationTask* end) :
+    _begin(begin), _end(end)
+  { }
+  virtual void run()
+  { answerElevationTasks(_begin, _end); }
+private:
+  const ElevationTask* _begin;
+  const ElevationTask* _end;
+};
+
+} // of anonymous namespace
+
 // Scenery Management system
 FGScenery::FGScenery()
 {
@@ -288,20 +512,14 @@ FGScenery::get_elevation_m(const SGGeod& geod, double& alt,
                            const simgear::BVHMaterial** material,
                            const osg::Node* butNotFrom)
 {
-  SGVec3d start = SGVec3d::fromGeod(geod);
-
-  SGGeod geodEnd = geod;
-  geodEnd.setElevationM(SGMiscd::min(geod.getElevationM() - 10, -10000));
-  SGVec3d end = SGVec3d::fromGeod(geodEnd);
-
-  FGSceneryIntersect intersectVisitor(SGLineSegmentd(start, end), butNotFrom);
+  FGSceneryIntersect intersectVisitor(elevationLineSegment(geod), butNotFrom);
   intersectVisitor.setTraversalMask(SG_NODEMASK_TERRAIN_BIT);
   get_scene_graph()->accept(intersectVisitor);
 
   if (!intersectVisitor.getHaveHit())
       return false;
 
-  geodEnd = SGGeod::fromCart(intersectVisitor.getLineSegment().getEnd());
+  SGGeod geodEnd = SGGeod::fromCart(intersectVisitor.getLineSegment().getEnd());
   alt = geodEnd.getElevationM();
   if (material)
       *material = intersectVisitor.getMaterial();
@@ -309,6 +527,64 @@ FGScenery::get_elevation_m(const SGGeod& geod, double& alt,
   return true;
 }
 
+void
+FGScenery::get_elevations_m(ElevationQueryList& queries,
+                            const osg::Node* butNotFrom,
+                            unsigned threads)
+{
+  if (queries.empty())
+      return;
+
+  std::vector<ElevationTask> tasks(queries.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+      tasks[i].query = &queries[i];
+      tasks[i].volumes = 0;
+      tasks[i].bucket = SGBucket(queries[i].position).gen_index();
+  }
+  std::sort(tasks.begin(), tasks.end());
+
+  // One walk of the scene graph per tile, for a sphere around all the
+  // line segments of the queries in there
+  std::vector<VolumeList> volumes;
+  volumes.reserve(tasks.size());
+  for (size_t begin = 0, end; begin < tasks.size(); begin = end) {
+      SGSphered sphere;
+      for (end = begin; end < tasks.size()
+               && tasks[end].bucket == tasks[begin].bucket; ++end) {
+          SGLineSegmentd lineSegment
+              = elevationLineSegment(tasks[end].query->position);
+          sphere.expandBy(lineSegment.getStart());
+          sphere.expandBy(lineSegment.getEnd());
+      }
+
+      FGSceneryCollect collectVisitor(sphere, butNotFrom);
+      collectVisitor.setTraversalMask(SG_NODEMASK_TERRAIN_BIT);
+      get_scene_graph()->accept(collectVisitor);
+      volumes.push_back(VolumeList());
+      volumes.back().swap(collectVisitor.getVolumes());
+      for (size_t i = begin; i < end; ++i)
+          tasks[i].volumes = &volumes.back();
+  }
+
+  // Give every thread a range of neighbouring queries, the calling
+  // thread takes the first one
+  size_t count = threads + 1;
+  if (tasks.size() < count)
+      count = tasks.size();
+  std::vector<ElevationThread*> workers;
+  for (size_t i = 1; i < count; ++i) {
+      const ElevationTask* begin = &tasks.front() + i*tasks.size()/count;
+      const ElevationTask* end = &tasks.front() + (i + 1)*tasks.size()/count;
+      workers.push_back(new ElevationThread(begin, end));
+      workers.back()->start();
+  }
+  answerElevationTasks(&tasks.front(), &tasks.front() + tasks.size()/count);
+  for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i]->join();
+      delete workers[i];
+  }
+}
+
 bool
 FGScenery::get_cart_ground_intersection(const SGVec3d& pos, const SGVec3d& dir,
                                         SGVec3d& nearestHit,
@@ -29,6 +29,8 @@
 # error This library requires C++
 #endif                                   
 
+#include <vector>
+
 #include <osg/ref_ptr>
 #include <osg/Group>
 
@@ -77,6 +79,34 @@ public:
                          const simgear::BVHMaterial** material,
                          const osg::Node* butNotFrom = 0);
 
+    /// One point for get_elevations_m(), with the position meaning the
+    /// same as the geod argument of get_elevation_m().  The results are
+    /// filled in by the query, valid telling if there was scenery below.
+    struct ElevationQuery {
+        ElevationQuery() :
+            elevation(0), material(0), valid(false)
+        { }
+        explicit ElevationQuery(const SGGeod& geod) :
+            position(geod), elevation(0), material(0), valid(false)
+        { }
+        SGGeod position;
+        double elevation;
+        const simgear::BVHMaterial* material;
+        bool valid;
+    };
+    typedef std::vector<ElevationQuery> ElevationQueryList;
+
+    /// Answer many get_elevation_m() queries at once.
+    /// The queries are sorted by scenery tile, and the scene graph is
+    /// walked once per tile, collecting the terrain bounding volumes
+    /// all queries in that tile need to test.  With threads > 0 the
+    /// queries are then answered by that many worker threads, which is
+    /// only worth it for some thousands of points.
+    /// The results are the same get_elevation_m() would have given.
+    void get_elevations_m(ElevationQueryList& queries,
+                          const osg::Node* butNotFrom = 0,
+                          unsigned threads = 0);
+
     /// Compute the elevation of the scenery below the cartesian point pos.
     /// you the returned scenery altitude is not higher than the position
     /// pos plus an offset given with max_altoff.
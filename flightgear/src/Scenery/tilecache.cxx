@@ -32,7 +32,8 @@
 #include "tilecache.hxx"
 
 TileCache::TileCache( void ) :
-    max_cache_size(100), current_time(0.0)
+    max_cache_size(100), memory_bytes(0), max_memory_bytes(0),
+    current_time(0.0)
 {
     tile_cache.clear();
 }
@@ -48,7 +49,7 @@ void TileCache::entry_free( long tile_index ) {
     SG_LOG( SG_TERRAIN, SG_DEBUG, "FREEING CACHE ENTRY = " << tile_index );
     TileEntry *tile = tile_cache[tile_index];
     tile->removeFromSceneGraph();
-    tile_cache.erase( tile_index );
+    clear_entry( tile_index );
     delete tile;
 }
 
@@ -78,8 +79,20 @@ bool TileCache::exists( const SGBucket& b ) const {
 
 
 // Return the index of a tile to be dropped from the cache, return -1 if
-// nothing available to be removed.
+// nothing available to be removed.  Tiles of the current view are never
+// dropped.  Otherwise expired tiles go first, oldest and lowest priority
+// ones before the others, unless the cache is over its memory budget.
+// Then the loaded tile which was requested longest ago goes first, whether
+// it expired or not, so tiles prefetched ahead of the view also count.
+// Tiles which are not loaded would not free any memory, so they stay.
 long TileCache::get_drop_tile() {
+    bool over_budget = is_over_budget();
+    if ( over_budget ) {
+        long index = get_drop_loaded_tile();
+        if ( index > -1 )
+            return index;
+    }
+
     long min_index = -1;
     double min_time = DBL_MAX;
     float priority = FLT_MAX;
@@ -91,7 +104,8 @@ long TileCache::get_drop_tile() {
         long index = current->first;
         TileEntry *e = current->second;
         if (( !e->is_current_view() )&&
-            ( e->is_expired(current_time) ))
+            ( e->is_expired(current_time) )&&
+            ( !over_budget || e->is_loaded() ))
         {
             if (e->is_expired(current_time - 1.0)&&
                 !e->is_loaded())
@@ -122,6 +136,34 @@ long TileCache::get_drop_tile() {
 }
 
 
+// Return the index of the loaded tile outside the current view which was
+// requested longest ago, return -1 if there is none.  Only tiles whose
+// memory was measured are considered, dropping others would not bring the
+// cache back into its budget.
+long TileCache::get_drop_loaded_tile() {
+    long min_index = -1;
+    double min_time = DBL_MAX;
+
+    tile_map_iterator current = tile_cache.begin();
+    tile_map_iterator end = tile_cache.end();
+
+    for ( ; current != end; ++current ) {
+        TileEntry *e = current->second;
+        if ( e->is_current_view() || !e->is_loaded() ||
+             e->get_memory_bytes() == 0 )
+            continue;
+        if ( e->get_time_accessed() < min_time ) {
+            min_time = e->get_time_accessed();
+            min_index = current->first;
+        }
+    }
+
+    SG_LOG( SG_TERRAIN, SG_DEBUG, "    over budget, index = " << min_index );
+
+    return min_index;
+}
+
+
 // Clear all flags indicating tiles belonging to the current view
 void TileCache::clear_current_view()
 {
@@ -142,7 +184,18 @@ void TileCache::clear_current_view()
 // Clear a cache entry, note that the cache only holds pointers
 // and this does not free the object which is pointed to.
 void TileCache::clear_entry( long tile_index ) {
-    tile_cache.erase( tile_index );
+    tile_map_iterator it = tile_cache.find( tile_index );
+    if ( it == tile_cache.end() )
+        return;
+    if ( it->second )
+        memory_bytes -= it->second->get_memory_bytes();
+    tile_cache.erase( it );
+}
+
+// (Re)measure the memory of a loaded tile and account for it
+void TileCache::measure_tile( TileEntry* e ) {
+    memory_bytes -= e->measure_memory( current_time );
+    memory_bytes += e->get_memory_bytes();
 }
 
 
@@ -175,6 +228,7 @@ bool TileCache::insert_tile( TileEntry *e ) {
     long tile_index = e->get_tile_bucket().gen_index();
     tile_cache[tile_index] = e;
     e->update_time_expired(current_time);
+    e->set_time_accessed(current_time);
 
     return true;
 }
@@ -190,8 +244,10 @@ void TileCache::refresh_tile(long tile_index)
 
     SG_LOG( SG_TERRAIN, SG_DEBUG, "REFRESHING CACHE ENTRY = " << tile_index );
 
-    if (it->second)
+    if (it->second) {
+        memory_bytes -= it->second->get_memory_bytes();
         it->second->refresh();
+    }
 }
 
 // update tile's priority and expiry time according to current request
@@ -200,6 +256,8 @@ void TileCache::request_tile(TileEntry* t,float priority,bool current_view,doubl
     if ((!current_view)&&(request_time<=0.0))
         return;
 
+    t->set_time_accessed( current_time );
+
     // update priority when higher - or old request has expired
     if ((t->is_expired(current_time))||
          (priority > t->get_priority()))
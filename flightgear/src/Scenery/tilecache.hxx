@@ -44,6 +44,10 @@ private:
     // maximum cache size
     int max_cache_size;
 
+    // memory used by the loaded tiles, and the ceiling for it (0 for none)
+    size_t memory_bytes;
+    size_t max_memory_bytes;
+
     // pointers to allow an external linear traversal of cache entries
     tile_map_iterator current;
 
@@ -52,6 +56,10 @@ private:
     // Free a tile cache entry
     void entry_free( long cache_index );
 
+    // Return the index of the least recently requested loaded tile, which
+    // is not part of the current view, or -1 if there is none
+    long get_drop_loaded_tile();
+
 public:
     tile_map_iterator begin() { return tile_cache.begin(); }
     tile_map_iterator end() { return tile_cache.end(); }
@@ -71,7 +79,8 @@ public:
     bool exists( const SGBucket& b ) const;
 
     // Return the index of a tile to be dropped from the cache, return -1 if
-    // nothing available to be removed.
+    // nothing available to be removed.  When the cache is over its memory
+    // budget, only loaded tiles are dropped, least recently requested first.
     long get_drop_tile();
     
     // Clear all flags indicating tiles belonging to the current view
@@ -117,6 +126,16 @@ public:
     inline int get_max_cache_size() const { return max_cache_size; }
     inline void set_max_cache_size( int m ) { max_cache_size = m; }
 
+    inline size_t get_memory_bytes() const { return memory_bytes; }
+    inline size_t get_max_memory_bytes() const { return max_memory_bytes; }
+    inline void set_max_memory_bytes( size_t m ) { max_memory_bytes = m; }
+    inline bool is_over_budget() const {
+        return max_memory_bytes > 0 && memory_bytes > max_memory_bytes;
+    }
+
+    // (Re)measure the memory of a loaded tile and account for it
+    void measure_tile( TileEntry* e );
+
     /**
      * Create a new tile and enqueue it for loading.
      * @param b
@@ -27,16 +27,189 @@
 #include <string>
 #include <sstream>
 #include <istream>
+#include <algorithm>
 
+#include <osg/Geode>
+#include <osg/Geometry>
 #include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/Texture>
 
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/debug/logstream.hxx>
+#include <simgear/bvh/BVHGroup.hxx>
+#include <simgear/bvh/BVHLineGeometry.hxx>
+#include <simgear/bvh/BVHMotionTransform.hxx>
+#include <simgear/bvh/BVHPageNode.hxx>
+#include <simgear/bvh/BVHStaticBinary.hxx>
+#include <simgear/bvh/BVHStaticData.hxx>
+#include <simgear/bvh/BVHStaticFlatTree.hxx>
+#include <simgear/bvh/BVHStaticGeometry.hxx>
+#include <simgear/bvh/BVHStaticTriangle.hxx>
+#include <simgear/bvh/BVHTransform.hxx>
+#include <simgear/bvh/BVHVisitor.hxx>
+#include <simgear/scene/util/SGSceneUserData.hxx>
 
 #include "tileentry.hxx"
 
 using std::string;
 
+namespace
+{
+
+// Adds up the memory of a collision tree. Paged nodes are owned by the
+// BVH pager and not counted.
+class BVHMemoryVisitor : public simgear::BVHVisitor {
+public:
+    BVHMemoryVisitor() : _bytes(0) { }
+
+    virtual void apply(simgear::BVHGroup& node)
+    { _bytes += sizeof(node); node.traverse(*this); }
+    virtual void apply(simgear::BVHPageNode& node)
+    { }
+    virtual void apply(simgear::BVHTransform& node)
+    { _bytes += sizeof(node); node.traverse(*this); }
+    virtual void apply(simgear::BVHMotionTransform& node)
+    { _bytes += sizeof(node); node.traverse(*this); }
+    virtual void apply(simgear::BVHLineGeometry& node)
+    { _bytes += sizeof(node); }
+    virtual void apply(simgear::BVHStaticGeometry& node)
+    {
+        // Estimated from the static data, visiting every triangle would
+        // take too long. The tree has a leaf and about one inner node per
+        // triangle, and terrain meshes about two triangles per vertex.
+        _bytes += sizeof(node);
+        const simgear::BVHStaticData* data = node.getStaticData();
+        unsigned vertices = data ? data->getNumVertices() : 0;
+        const simgear::BVHStaticFlatTree* flatTree = node.getFlatTree();
+        unsigned triangles = flatTree ? flatTree->getNumTriangles() : 2*vertices;
+        _bytes += vertices*sizeof(SGVec3f);
+        _bytes += triangles*(sizeof(simgear::BVHStaticTriangle) +
+                             sizeof(simgear::BVHStaticBinary));
+        if (flatTree) {
+            // A four wide node holds about three triangles, which are
+            // referenced from the node tree
+            _bytes += triangles*sizeof(const simgear::BVHStaticTriangle*);
+            _bytes += triangles/3*(7*4*sizeof(float));
+        }
+    }
+    virtual void apply(const simgear::BVHStaticBinary& node,
+                       const simgear::BVHStaticData& data)
+    { }
+    virtual void apply(const simgear::BVHStaticTriangle& node,
+                       const simgear::BVHStaticData& data)
+    { }
+
+    size_t getBytes() const { return _bytes; }
+
+private:
+    size_t _bytes;
+};
+
+// Adds up the memory of the arrays, primitive sets, texture images and
+// collision trees below a node. Nodes with several parents and textures
+// used by several state sets are counted in equal parts for each of them.
+class MemoryVisitor : public osg::NodeVisitor {
+public:
+    MemoryVisitor() :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _share(1.0),
+        _bytes(0.0)
+    { }
+
+    virtual void apply(osg::Node& node)
+    {
+        double share = _share;
+        if (1 < node.getNumParents())
+            _share /= node.getNumParents();
+        applyNode(node);
+        traverse(node);
+        _share = share;
+    }
+
+    virtual void apply(osg::Geode& geode)
+    {
+        double share = _share;
+        if (1 < geode.getNumParents())
+            _share /= geode.getNumParents();
+        applyNode(geode);
+        for (unsigned i = 0; i < geode.getNumDrawables(); ++i) {
+            osg::Drawable* drawable = geode.getDrawable(i);
+            double drawableShare = _share;
+            if (1 < drawable->getNumParents())
+                _share /= drawable->getNumParents();
+            applyStateSet(drawable->getStateSet());
+            osg::Geometry* geometry = drawable->asGeometry();
+            if (geometry)
+                applyGeometry(*geometry);
+            _share = drawableShare;
+        }
+        _share = share;
+    }
+
+    size_t getBytes() const { return (size_t)_bytes; }
+
+private:
+    void applyNode(osg::Node& node)
+    {
+        applyStateSet(node.getStateSet());
+        SGSceneUserData* userData = SGSceneUserData::getSceneUserData(&node);
+        if (userData && userData->getBVHNode()) {
+            BVHMemoryVisitor bvhVisitor;
+            userData->getBVHNode()->accept(bvhVisitor);
+            _bytes += _share*bvhVisitor.getBytes();
+        }
+    }
+
+    void applyStateSet(osg::StateSet* stateSet)
+    {
+        if (!stateSet)
+            return;
+        unsigned units = stateSet->getTextureAttributeList().size();
+        for (unsigned unit = 0; unit < units; ++unit) {
+            osg::StateAttribute* attribute;
+            attribute = stateSet->getTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+            osg::Texture* texture = dynamic_cast<osg::Texture*>(attribute);
+            if (!texture)
+                continue;
+            // Parents are the state sets using the texture
+            unsigned users = std::max(1u, texture->getNumParents());
+            double share = _share/users;
+            for (unsigned i = 0; i < texture->getNumImages(); ++i) {
+                const osg::Image* image = texture->getImage(i);
+                if (image)
+                    _bytes += share*image->getTotalSizeInBytesIncludingMipmaps();
+            }
+        }
+    }
+
+    void applyArray(const osg::Array* array)
+    {
+        if (array)
+            _bytes += _share*array->getTotalDataSize();
+    }
+
+    void applyGeometry(osg::Geometry& geometry)
+    {
+        applyArray(geometry.getVertexArray());
+        applyArray(geometry.getNormalArray());
+        applyArray(geometry.getColorArray());
+        applyArray(geometry.getSecondaryColorArray());
+        applyArray(geometry.getFogCoordArray());
+        for (unsigned i = 0; i < geometry.getNumTexCoordArrays(); ++i)
+            applyArray(geometry.getTexCoordArray(i));
+        for (unsigned i = 0; i < geometry.getNumVertexAttribArrays(); ++i)
+            applyArray(geometry.getVertexAttribArray(i));
+        for (unsigned i = 0; i < geometry.getNumPrimitiveSets(); ++i)
+            _bytes += _share*geometry.getPrimitiveSet(i)->getTotalDataSize();
+    }
+
+    double _share;
+    double _bytes;
+};
+
+}
+
 // Constructor
 TileEntry::TileEntry ( const SGBucket& b )
     : tile_bucket( b ),
@@ -44,7 +217,10 @@ TileEntry::TileEntry ( const SGBucket& b )
       _node( new osg::LOD ),
       _priority(-FLT_MAX),
       _current_view(false),
-      _time_expired(-1.0)
+      _time_expired(-1.0),
+      _time_accessed(-1.0),
+      _memory_bytes(0),
+      _memory_time(-1.0)
 {
     tileFileName += ".stg";
     _node->setName(tileFileName);
@@ -60,7 +236,10 @@ TileEntry::TileEntry( const TileEntry& t )
   _node( new osg::LOD ),
   _priority(t._priority),
   _current_view(t._current_view),
-  _time_expired(t._time_expired)
+  _time_expired(t._time_expired),
+  _time_accessed(t._time_accessed),
+  _memory_bytes(0),
+  _memory_time(-1.0)
 {
     _node->setName(tileFileName);
     // Give a default LOD range so that traversals that traverse
@@ -119,6 +298,17 @@ TileEntry::removeFromSceneGraph()
     }
 }
 
+size_t
+TileEntry::measure_memory(double current_time)
+{
+    size_t bytes = _memory_bytes;
+    MemoryVisitor visitor;
+    _node->accept(visitor);
+    _memory_bytes = visitor.getBytes();
+    _memory_time = current_time;
+    return bytes;
+}
+
 void
 TileEntry::refresh()
 {
@@ -132,6 +322,8 @@ TileEntry::refresh()
         }
     }
     _node = new osg::LOD;
+    _memory_bytes = 0;
+    _memory_time = -1.0;
     if (parent)
         parent->addChild(_node.get());
 }
@@ -71,6 +71,11 @@ private:
     bool _current_view;
     /** Time when tile expires. */ 
     double _time_expired;
+    /** Time when the tile was last requested. */
+    double _time_accessed;
+    /** Memory used by the loaded tile, and when that was measured. */
+    size_t _memory_bytes;
+    double _memory_time;
 
 public:
 
@@ -128,6 +133,9 @@ public:
     inline double get_time_expired() const { return _time_expired; }
     inline void update_time_expired( double time_expired ) { if (_time_expired<time_expired) _time_expired = time_expired; }
 
+    inline double get_time_accessed() const { return _time_accessed; }
+    inline void set_time_accessed( double time_accessed ) { _time_accessed = time_accessed; }
+
     inline void set_priority(float priority) { _priority=priority; }
     inline float get_priority() const { return _priority; }
     inline void set_current_view(bool current_view) { _current_view = current_view; }
@@ -139,6 +147,16 @@ public:
      */
     inline bool is_expired(double current_time) const { return (_current_view) ? false : (current_time > _time_expired); }
 
+    /**
+     * Measure the memory used by the geometry, textures and collision
+     * tree of the loaded tile. Data shared with other tiles, like the
+     * textures of the materials, is counted in equal parts for each user.
+     * Returns the previous value.
+     */
+    size_t measure_memory(double current_time);
+    inline size_t get_memory_bytes() const { return _memory_bytes; }
+    inline double get_memory_time() const { return _memory_time; }
+
     // Get the ref_ptr to the DatabaseRequest object, in order to pass
     // this to the pager.
     osg::ref_ptr<osg::Referenced>& getDatabaseRequest()
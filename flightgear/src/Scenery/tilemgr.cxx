@@ -27,12 +27,16 @@
 
 #include <algorithm>
 #include <functional>
+#include <set>
+#include <vector>
 
 #include <osgViewer/Viewer>
 #include <osgDB/Registry>
 
 #include <simgear/constants.h>
 #include <simgear/debug/logstream.hxx>
+#include <simgear/io/sg_binobj.hxx>
+#include <simgear/math/SGGeodesy.hxx>
 #include <simgear/structure/exception.hxx>
 #include <simgear/scene/model/modellib.hxx>
 #include <simgear/scene/util/SGReaderWriterOptions.hxx>
@@ -58,14 +62,39 @@ FGTileMgr::FGTileMgr():
     longitude(-1000.0),
     latitude(-1000.0),
     scheduled_visibility(100.0),
+    ahead_elapsed(0.0),
+    view_cache_size(100),
     _terra_sync(NULL),
     _visibilityMeters(fgGetNode("/environment/visibility-m", true)),
     _maxTileRangeM(fgGetNode("/sim/rendering/static-lod/bare", true)),
     _disableNasalHooks(fgGetNode("/sim/temp/disable-scenery-nasal", true)),
     _scenery_loaded(fgGetNode("/sim/sceneryloaded", true)),
     _scenery_override(fgGetNode("/sim/sceneryloaded-override", true)),
+    _speedNorthFps(fgGetNode("/velocities/speed-north-fps", true)),
+    _speedEastFps(fgGetNode("/velocities/speed-east-fps", true)),
+    _speedUp(fgGetNode("/sim/speed-up", true)),
+    _lookaheadSec(fgGetNode("/sim/tile-cache/lookahead-sec", true)),
+    _maxRequests(fgGetNode("/sim/tile-cache/max-requests", true)),
+    _maxPrefetchTiles(fgGetNode("/sim/tile-cache/max-prefetch-tiles", true)),
+    _cacheHits(fgGetNode("/sim/tile-cache/hits", true)),
+    _cacheMisses(fgGetNode("/sim/tile-cache/misses", true)),
+    _cacheSize(fgGetNode("/sim/tile-cache/size", true)),
+    _maxMemoryMB(fgGetNode("/sim/tile-cache/max-memory-mb", true)),
+    _memoryMB(fgGetNode("/sim/tile-cache/memory-mb", true)),
+    _btgStats(fgGetNode("/sim/tile-cache/btg", true)),
+    _pendingTiles(fgGetNode("/sim/tile-cache/pending-tiles", true)),
+    _requestedTiles(fgGetNode("/sim/tile-cache/requested-tiles", true)),
+    _prefetchTiles(fgGetNode("/sim/tile-cache/prefetch-tiles", true)),
     _pager(FGScenery::getPagerSingleton())
 {
+    if (!_lookaheadSec->hasValue())
+        _lookaheadSec->setDoubleValue(120.0);
+    if (!_maxRequests->hasValue())
+        _maxRequests->setIntValue(16);
+    if (!_maxPrefetchTiles->hasValue())
+        _maxPrefetchTiles->setIntValue(64);
+    if (!_maxMemoryMB->hasValue())
+        _maxMemoryMB->setIntValue(1024);
 }
 
 
@@ -141,6 +170,9 @@ void FGTileMgr::reinit()
     current_bucket.make_bad();
     longitude = latitude = -1000.0;
     scheduled_visibility = 100.0;
+    ahead_elapsed = 0.0;
+    _cacheHits->setIntValue(0);
+    _cacheMisses->setIntValue(0);
 
     // force an update now
     update(0.0);
@@ -209,7 +241,10 @@ void FGTileMgr::schedule_needed(const SGBucket& curr_bucket, double vis)
 
     // make the cache twice as large to avoid losing terrain when switching
     // between aircraft and tower views
-    tile_cache.set_max_cache_size( (2*xrange + 2) * (2*yrange + 2) * 2 );
+    view_cache_size = (2*xrange + 2) * (2*yrange + 2) * 2;
+    int prefetch = std::min(_prefetchTiles->getIntValue(),
+                            _maxPrefetchTiles->getIntValue());
+    tile_cache.set_max_cache_size( view_cache_size + std::max(0, prefetch) );
     // cout << "xrange = " << xrange << "  yrange = " << yrange << endl;
     // cout << "max cache size = " << tile_cache.get_max_cache_size()
     //      << " current cache size = " << tile_cache.get_size() << endl;
@@ -227,16 +262,97 @@ void FGTileMgr::schedule_needed(const SGBucket& curr_bucket, double vis)
     int x, y;
 
     /* schedule all tiles, use distance-based loading priority,
-     * so tiles are loaded in innermost-to-outermost sequence. */
+     * so tiles are loaded in innermost-to-outermost sequence.
+     * Count the tiles which are already there as cache hits. */
+    int hits = 0, misses = 0;
     for ( x = -xrange; x <= xrange; ++x )
     {
         for ( y = -yrange; y <= yrange; ++y )
         {
             SGBucket b = sgBucketOffset( longitude, latitude, x, y );
             float priority = (-1.0) * (x*x+y*y);
-            sched_tile( b, priority, true, 0.0 );
+            if (sched_tile( b, priority, true, 0.0 ))
+                ++hits;
+            else
+                ++misses;
         }
     }
+    _cacheHits->setIntValue(_cacheHits->getIntValue() + hits);
+    _cacheMisses->setIntValue(_cacheMisses->getIntValue() + misses);
+}
+
+/* schedule the tiles the view will reach within the lookahead time,
+ * following the current ground track of the aircraft. Time acceleration
+ * is taken into account, as the tiles need to be loaded in real time. */
+void FGTileMgr::schedule_ahead(double dt)
+{
+    // once a second is plenty, the tiles are requested well ahead
+    ahead_elapsed += dt;
+    if (ahead_elapsed < 1.0)
+        return;
+    ahead_elapsed = 0.0;
+
+    double vn = _speedNorthFps->getDoubleValue() * SG_FEET_TO_METER;
+    double ve = _speedEastFps->getDoubleValue() * SG_FEET_TO_METER;
+    double speed = sqrt(vn*vn + ve*ve) * std::max(1.0, _speedUp->getDoubleValue());
+    double lookahead = _lookaheadSec->getDoubleValue();
+    size_t maxTiles = std::max(0, _maxPrefetchTiles->getIntValue());
+    if (lookahead <= 0.0 || speed < 1.0 || maxTiles == 0)
+    {
+        _prefetchTiles->setIntValue(0);
+        return;
+    }
+
+    SGGeod position = globals->get_aircraft_position();
+    if (position.getLatitudeDeg() < -89.0 || position.getLatitudeDeg() > 89.0)
+        return;
+    SGBucket bucket(position);
+    double tileSize = std::min(bucket.get_width_m(), bucket.get_height_m());
+    double tileRangeM = std::min(_visibilityMeters->getDoubleValue(),
+                                 _maxTileRangeM->getDoubleValue());
+    double course = SGMiscd::rad2deg(atan2(ve, vn));
+
+    /* Walk the track from the edge of the current view on, with a tile
+     * to each side. A tile is requested until the view reaches it, with
+     * the priority a view tile at that distance gets, so tiles arriving
+     * sooner are loaded first and the current view always goes ahead.
+     * At most max-prefetch-tiles are held this way, the cache only grows
+     * by as many tiles. */
+    std::set<long> scheduled;
+    double end = tileRangeM + speed*lookahead;
+    for (double s = tileRangeM; s <= end && scheduled.size() < maxTiles &&
+         !tile_cache.is_over_budget(); s += 0.5*tileSize)
+    {
+        SGGeod center;
+        double az2;
+        if (!SGGeodesy::direct(position, course, s, center, az2))
+            break;
+        double timeToArrival = (s - tileRangeM) / speed;
+        float priority = (-1.0) * (s/tileSize) * (s/tileSize);
+        for (int side = -1; side <= 1 && scheduled.size() < maxTiles; ++side)
+        {
+            SGGeod p = center;
+            if (side != 0 &&
+                !SGGeodesy::direct(center, course + 90.0*side, tileSize, p, az2))
+                continue;
+            SGBucket b(p);
+            if (!scheduled.insert(b.gen_index()).second)
+                continue;
+            sched_tile( b, priority, false, timeToArrival + 10.0 );
+        }
+    }
+
+    _prefetchTiles->setIntValue((int)scheduled.size());
+    tile_cache.set_max_cache_size( view_cache_size + (int)scheduled.size() );
+}
+
+namespace
+{
+    struct ComparePriority
+    {
+        bool operator()(const TileEntry* a, const TileEntry* b) const
+        { return a->get_priority() > b->get_priority(); }
+    };
 }
 
 /**
@@ -252,8 +368,12 @@ void FGTileMgr::update_queues()
     TileEntry *e;
     int loading=0;
     int sz=0;
+    std::vector<TileEntry*> requests;
+    // the loaded tile measured longest ago, one is measured per frame
+    TileEntry *measure = 0;
 
     tile_cache.set_current_time( current_time );
+    tile_cache.set_max_memory_bytes( (size_t)std::max(0, _maxMemoryMB->getIntValue()) << 20 );
     tile_cache.reset_traversal();
 
     while ( ! tile_cache.at_end() )
@@ -267,17 +387,18 @@ void FGTileMgr::update_queues()
             // based on current visibilty
             e->prep_ssg_node(vis);
 
+            // Objects and trees keep loading after the tile itself, so
+            // measure the memory of loaded tiles again now and then
+            if (e->is_loaded() &&
+                e->get_memory_time() < current_time - 30.0 &&
+                (!measure || e->get_memory_time() < measure->get_memory_time()))
+                measure = e;
+
             if (( !e->is_loaded() )&&
                 ((!e->is_expired(current_time))||
                   e->is_current_view() ))
             {
-                // schedule tile for loading with osg pager
-                _pager->queueRequest(e->tileFileName,
-                                     e->getNode(),
-                                     e->get_priority(),
-                                     framestamp,
-                                     e->getDatabaseRequest(),
-                                     _options.get());
+                requests.push_back(e);
                 loading++;
             }
         } else
@@ -288,9 +409,39 @@ void FGTileMgr::update_queues()
         sz++;
     }
 
+    // Only keep the most urgent requests with the osg pager, which drops
+    // the requests that are not renewed. That way tiles far down the
+    // track do not hold up the ones needed next.
+    int max_requests = _maxRequests->getIntValue();
+    if (max_requests > 0 && (int)requests.size() > max_requests)
+    {
+        std::partial_sort(requests.begin(), requests.begin() + max_requests,
+                          requests.end(), ComparePriority());
+        requests.resize(max_requests);
+    }
+    for (unsigned i = 0; i < requests.size(); ++i)
+    {
+        // schedule tile for loading with osg pager
+        e = requests[i];
+        _pager->queueRequest(e->tileFileName,
+                             e->getNode(),
+                             e->get_priority(),
+                             framestamp,
+                             e->getDatabaseRequest(),
+                             _options.get());
+    }
+    _pendingTiles->setIntValue(loading);
+    _requestedTiles->setIntValue(requests.size());
+
+    if (measure)
+        tile_cache.measure_tile(measure);
+
+    // Drop tiles when there are too many, or right away when they use
+    // more memory than allowed
     int drop_count = sz - tile_cache.get_max_cache_size();
-    if (( drop_count > 0 )&&
-         ((loading==0)||(drop_count > 10)))
+    if ((( drop_count > 0 )&&
+         ((loading==0)||(drop_count > 10)))||
+        tile_cache.is_over_budget())
     {
         long drop_index = tile_cache.get_drop_tile();
         while ( drop_index > -1 )
@@ -306,21 +457,35 @@ void FGTileMgr::update_queues()
             // the pager and will be deleted in the pager thread.
             _pager->queueDeleteRequest(subgraph);
             
-            if (--drop_count > 0)
+            if ((--drop_count > 0)||tile_cache.is_over_budget())
                 drop_index = tile_cache.get_drop_tile();
             else
                 drop_index = -1;
         }
     }
+    _cacheSize->setIntValue(tile_cache.get_size());
+    _memoryMB->setDoubleValue(tile_cache.get_memory_bytes() / (1024.0*1024.0));
+
+    // average time per file in the stages of loading the terrain, which
+    // the pager threads run in parallel
+    SGBinObjectStats stats = SGBinObject::get_load_stats();
+    double files = std::max(1u, stats.files);
+    _btgStats->setIntValue("files", stats.files);
+    _btgStats->setDoubleValue("read-usec", stats.readUSec / files);
+    _btgStats->setDoubleValue("inflate-usec", stats.inflateUSec / files);
+    _btgStats->setDoubleValue("decode-usec", stats.decodeUSec / files);
+    _btgStats->setDoubleValue("build-usec", stats.buildUSec / files);
 }
 
 // given the current lon/lat (in degrees), fill in the array of local
 // chunks.  If the chunk isn't already in the cache, then read it from
 // disk.
-void FGTileMgr::update(double)
+void FGTileMgr::update(double dt)
 {
     double vis = _visibilityMeters->getDoubleValue();
     schedule_tiles_at(globals->get_view_position(), vis);
+    if (state == Running)
+        schedule_ahead(dt);
 
     update_queues();
 
@@ -62,6 +62,9 @@ private:
     // schedule a needed buckets for loading
     void schedule_needed(const SGBucket& curr_bucket, double rangeM);
 
+    // schedule the buckets along the projected track of the aircraft
+    void schedule_ahead(double dt);
+
     SGBucket previous_bucket;
     SGBucket current_bucket;
     SGBucket pending;
@@ -71,6 +74,10 @@ private:
     double longitude;
     double latitude;
     double scheduled_visibility;
+    // time since the track ahead was last scheduled
+    double ahead_elapsed;
+    // cache size needed for the tiles of the current view
+    int view_cache_size;
 
     /**
      * tile cache
@@ -89,6 +96,12 @@ private:
     SGPropertyNode_ptr _visibilityMeters;
     SGPropertyNode_ptr _maxTileRangeM, _disableNasalHooks;
     SGPropertyNode_ptr _scenery_loaded, _scenery_override;
+    SGPropertyNode_ptr _speedNorthFps, _speedEastFps, _speedUp;
+    SGPropertyNode_ptr _lookaheadSec, _maxRequests, _maxPrefetchTiles;
+    SGPropertyNode_ptr _cacheHits, _cacheMisses, _cacheSize;
+    SGPropertyNode_ptr _maxMemoryMB, _memoryMB;
+    SGPropertyNode_ptr _btgStats;
+    SGPropertyNode_ptr _pendingTiles, _requestedTiles, _prefetchTiles;
 
     osg::ref_ptr<flightgear::SceneryPager> _pager;
 
@@ -311,7 +311,7 @@ static SGPropertyNode* findnode(naContext c, naRef* vec, int len)
         for(int i=0; i<len; i++) {
             naRef a = vec[i];
             if(!naIsString(a)) return 0;
-            p = p->getNode(naStr_data(a));
+            p = p->getNode(fgCompiledPath(naStr_data(a)));
             if(p == 0) return 0;
         }
     } catch (const string& err) {
@@ -385,7 +385,8 @@ static naRef f_setprop(naContext c, naRef me, int argc, naRef* args)
     naRef val = args[argc-1];
     bool result = false;
     try {
-        if(naIsString(val)) result = props->setStringValue(buf, naStr_data(val));
+        const SGPropertyPath& path = fgCompiledPath(buf);
+        if(naIsString(val)) result = props->setStringValue(path, naStr_data(val));
         else {
             naRef n = naNumValue(val);
             if(naIsNil(n))
@@ -395,7 +396,7 @@ static naRef f_setprop(naContext c, naRef me, int argc, naRef* args)
                 naRuntimeError(c, "setprop() passed a NaN");
             }
             
-            result = props->setDoubleValue(buf, n.num);
+            result = props->setDoubleValue(path, n.num);
         }
     } catch (const string& err) {
         naRuntimeError(c, (char *)err.c_str());
@@ -744,6 +745,7 @@ void FGNasalSys::init()
     int i;
 
     _context = naNewContext();
+    _gcNode = fgGetNode("/sim/nasal-gc", true);
 
     // Start with globals.  Add it to itself as a recursive
     // sub-reference under the name "globals".  This gives client-code
@@ -870,6 +872,11 @@ void FGNasalSys::update(double)
     // they're very fast, just trust me). -Andy
     naFreeContext(_context);
     _context = naNewContext();
+
+    // Give the incremental collector some time every frame, so it needs
+    // less while scripts allocate.
+    naGCSetIncremental(_gcNode->getBoolValue("incremental", true));
+    naGCStep(_gcNode->getDoubleValue("frame-budget-ms", 0.5) * 1000);
 }
 
 bool pathSortPredicate(const SGPath& p1, const SGPath& p2)
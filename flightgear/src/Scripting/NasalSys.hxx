@@ -176,6 +176,8 @@ private:
     naRef _gcHash;
     int _callCount;
 
+    SGPropertyNode_ptr _gcNode;
+
     simgear::BufferedLogCallback* _log;
 public:
     void handleTimer(NasalTimer* t);
@@ -154,9 +154,14 @@ FGVoiceMgr::FGVoice::~FGVoice()
 
 void FGVoiceMgr::FGVoice::pushMessage(string m)
 {
-	_msg.push(m + "\015\012");
 #if defined(ENABLE_THREADS)
+	// never wait for a voice server which doesn't keep up
+	if (!_msg.try_push(m + "\015\012"))
+		SG_LOG(SG_SOUND, SG_WARN, "VOICE: too many messages queued, dropping `"
+				<< m << '\'');
 	_mgr->_thread->wake_up();
+#else
+	_msg.push(m + "\015\012");
 #endif
 }
 
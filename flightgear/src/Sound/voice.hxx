@@ -116,7 +116,8 @@ private:
 	FGVoiceMgr *_mgr;
 
 #if defined(ENABLE_THREADS)
-	SGLockedQueue<std::string> _msg;
+	// pushed by the main loop, spoken by the voice thread
+	SGSingleProducerQueue<std::string> _msg;
 #else
   std::queue<std::string> _msg;
 #endif
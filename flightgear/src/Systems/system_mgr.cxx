@@ -72,21 +72,27 @@ bool FGSystemMgr::build (SGPropertyNode* config_props)
         string name = node->getName();
         std::ostringstream temp;
         temp << i;
+        SGSubsystem* system = 0;
         if ( name == "electrical" ) {
-            set_subsystem( "electrical" + temp.str(),
-                           new FGElectricalSystem( node ) );
+            system = new FGElectricalSystem( node );
+            set_subsystem( "electrical" + temp.str(), system );
         } else if ( name == "pitot" ) {
-            set_subsystem( "system" + temp.str(), 
-                           new PitotSystem( node ) );
+            system = new PitotSystem( node );
+            set_subsystem( "system" + temp.str(), system );
         } else if ( name == "static" ) {
-            set_subsystem( "system" + temp.str(), 
-                           new StaticSystem( node ) );
+            system = new StaticSystem( node );
+            set_subsystem( "system" + temp.str(), system );
         } else if ( name == "vacuum" ) {
-            set_subsystem( "system" + temp.str(), 
-                           new VacuumSystem( node ) );
+            system = new VacuumSystem( node );
+            set_subsystem( "system" + temp.str(), system );
         } else {
             SG_LOG(SG_SYSTEMS, SG_ALERT, "Ignoring unknown system: " << name);
         }
+
+        // systems may declare the properties they use, so they can be
+        // updated concurrently (see SGSubsystem::declare_reads)
+        if ( system )
+            system->declare_access( node );
     }
     return true;
 }
@@ -47,6 +47,7 @@
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
 #include <osgViewer/GraphicsWindow>
+#include <OpenThreads/Thread>
 
 #include <Scenery/scenery.hxx>
 #include <Main/fg_os.hxx>
@@ -214,6 +215,12 @@ void fgOSOpenWindow(bool stencil)
     //osg::setNotifyLevel(osg::DEBUG_INFO);
   
     viewer = new osgViewer::Viewer;
+    // Load scenery tiles in as many threads as there are cores to spare,
+    // next to the one for http requests
+    int pagerThreads = fgGetInt("/sim/rendering/database-pager/threads", 0);
+    if (pagerThreads <= 0)
+        pagerThreads = std::max(1, OpenThreads::GetNumberOfProcessors() - 1);
+    FGScenery::getPagerSingleton()->setUpThreads(pagerThreads + 1, 1);
     viewer->setDatabasePager(FGScenery::getPagerSingleton());
     CameraGroup* cameraGroup = 0;
     std::string mode;
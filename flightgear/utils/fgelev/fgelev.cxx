@@ -20,9 +20,18 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <iomanip>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #include <osg/ArgumentParser>
 #include <osg/Image>
@@ -35,18 +44,24 @@
 #include <simgear/bvh/BVHLineSegmentVisitor.hxx>
 #include <simgear/bvh/BVHPager.hxx>
 #include <simgear/bvh/BVHPageNode.hxx>
+#include <simgear/bvh/BVHTransform.hxx>
+#include <simgear/bvh/BVHMotionTransform.hxx>
+#include <simgear/bvh/BVHStaticGeometry.hxx>
 #include <simgear/scene/material/matlib.hxx>
 #include <simgear/scene/model/BVHPageNodeOSG.hxx>
 #include <simgear/scene/model/ModelRegistry.hxx>
 #include <simgear/scene/util/SGReaderWriterOptions.hxx>
 #include <simgear/scene/util/OptionsReadFileCallback.hxx>
 #include <simgear/scene/tgdb/userdata.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGQueue.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 namespace sg = simgear;
 
 class Visitor : public sg::BVHLineSegmentVisitor {
 public:
-    Visitor(const SGLineSegmentd& lineSegment, sg::BVHPager& pager) :
+    Visitor(const SGLineSegmentd& lineSegment, sg::BVHPager* pager) :
         BVHLineSegmentVisitor(lineSegment, 0),
         _pager(pager)
     { }
@@ -55,11 +70,78 @@ public:
     virtual void apply(sg::BVHPageNode& node)
     {
         // we have a non threaded pager so load just right here.
-        _pager.use(node);
+        if (_pager)
+            _pager->use(node);
         BVHLineSegmentVisitor::apply(node);
     }
 private:
+    sg::BVHPager* _pager;
+};
+
+// Loads the pages a line segment, or one up to margin away from it, may
+// need, and computes the bounds of everything in there. The worker
+// threads then only read the tree when they intersect with it.
+class PageInVisitor : public sg::BVHVisitor {
+public:
+    PageInVisitor(const SGLineSegmentd& lineSegment, sg::BVHPager& pager,
+                  double margin) :
+        _lineSegment(lineSegment),
+        _pager(pager),
+        _margin(margin)
+    { }
+    virtual ~PageInVisitor()
+    { }
+    virtual void apply(sg::BVHGroup& group)
+    {
+        if (!test(group.getBoundingSphere()))
+            return;
+        group.traverse(*this);
+    }
+    virtual void apply(sg::BVHPageNode& node)
+    {
+        if (!test(node.getBoundingSphere()))
+            return;
+        _pager.use(node);
+        node.traverse(*this);
+    }
+    virtual void apply(sg::BVHTransform& transform)
+    {
+        if (!test(transform.getBoundingSphere()))
+            return;
+        SGLineSegmentd lineSegment = _lineSegment;
+        _lineSegment = transform.lineSegmentToLocal(lineSegment);
+        transform.traverse(*this);
+        _lineSegment = lineSegment;
+    }
+    virtual void apply(sg::BVHMotionTransform& transform)
+    {
+        if (!test(transform.getBoundingSphere()))
+            return;
+        SGLineSegmentd lineSegment = _lineSegment;
+        _lineSegment = lineSegment.transform(transform.getToLocalTransform(0));
+        transform.traverse(*this);
+        _lineSegment = lineSegment;
+    }
+    virtual void apply(sg::BVHLineGeometry&)
+    { }
+    virtual void apply(sg::BVHStaticGeometry& node)
+    { node.getBoundingSphere(); }
+    virtual void apply(const sg::BVHStaticBinary&, const sg::BVHStaticData&)
+    { }
+    virtual void apply(const sg::BVHStaticTriangle&, const sg::BVHStaticData&)
+    { }
+private:
+    bool test(const SGSphered& sphere) const
+    {
+        if (sphere.empty())
+            return false;
+        SGSphered grown(sphere.getCenter(), sphere.getRadius() + _margin);
+        return intersects(_lineSegment, grown);
+    }
+
+    SGLineSegmentd _lineSegment;
     sg::BVHPager& _pager;
+    double _margin;
 };
 
 // Short circuit reading image files.
@@ -73,7 +155,7 @@ public:
 };
 
 static bool
-intersect(sg::BVHNode& node, sg::BVHPager& pager,
+intersect(sg::BVHNode& node, sg::BVHPager* pager,
           const SGVec3d& start, SGVec3d& end, double offset)
 {
     SGVec3d perp = offset*perpendicular(start - end);
@@ -85,6 +167,117 @@ intersect(sg::BVHNode& node, sg::BVHPager& pager,
     return true;
 }
 
+// The largest offset intersect() is tried with when looking for holes
+static const double maxHoleScale = 1;
+
+struct Query {
+    std::string id;
+    double lon;
+    double lat;
+    double elevation;
+    double holeScale;
+};
+
+/// Computes the elevation of the query, pager may only be 0 if the
+/// pages it needs are already loaded.
+static void
+answer(sg::BVHNode& node, sg::BVHPager* pager, Query& query)
+{
+    SGVec3d start = SGVec3d::fromGeod(SGGeod::fromDegM(query.lon, query.lat, 10000));
+    SGVec3d end = SGVec3d::fromGeod(SGGeod::fromDegM(query.lon, query.lat, -1000));
+
+    // Try to find an intersection
+    bool found = intersect(node, pager, start, end, 0);
+    double scale = 1e-5;
+    while (!found && scale <= maxHoleScale) {
+        found = intersect(node, pager, start, end, scale);
+        scale *= 2;
+    }
+    query.holeScale = scale;
+    if (!found)
+        query.elevation = -1000;
+    else
+        query.elevation = SGGeod::fromCart(end).getElevationM();
+}
+
+// Answers ranges of queries until it gets an empty one
+class Worker : public SGThread {
+public:
+    struct Range {
+        Query* begin;
+        Query* end;
+    };
+
+    Worker(sg::BVHNode& node, SGBlockingQueue<Range>& ranges,
+           SGBlockingQueue<Range>& done) :
+        _node(node),
+        _ranges(ranges),
+        _done(done)
+    { }
+    virtual void run()
+    {
+        for (;;) {
+            Range range = _ranges.pop();
+            if (range.begin == range.end)
+                break;
+            for (Query* query = range.begin; query != range.end; ++query)
+                answer(_node, 0, *query);
+            _done.push(range);
+        }
+    }
+private:
+    sg::BVHNode& _node;
+    SGBlockingQueue<Range>& _ranges;
+    SGBlockingQueue<Range>& _done;
+};
+
+// Binary records are a 4 byte id followed by two doubles for lon and
+// lat, answered with the id followed by a double for the elevation, all
+// in the byte order of the machine.
+static bool
+readQuery(Query& query, bool binary)
+{
+    if (binary) {
+        char id[4];
+        std::cin.read(id, sizeof(id));
+        std::cin.read(reinterpret_cast<char*>(&query.lon), sizeof(double));
+        std::cin.read(reinterpret_cast<char*>(&query.lat), sizeof(double));
+        if (std::cin.fail())
+            return false;
+        query.id.assign(id, sizeof(id));
+        return true;
+    }
+
+    std::cin >> query.id;
+    std::cin >> query.lon >> query.lat;
+    if (std::cin.fail())
+        return false;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return true;
+}
+
+static void
+writeQuery(const Query& query, bool binary)
+{
+    if (1e-5 < query.holeScale)
+        std::cerr << "Found hole of minimum diameter "
+                  << query.holeScale << "m at lon = " << query.lon
+                  << "deg lat = " << query.lat << "deg" << std::endl;
+
+    if (binary) {
+        std::cout.write(query.id.data(), query.id.size());
+        std::cout.write(reinterpret_cast<const char*>(&query.elevation),
+                        sizeof(double));
+        return;
+    }
+
+    std::cout << query.id << ": ";
+    if (query.elevation == -1000)
+        std::cout << "-1000" << std::endl;
+    else
+        std::cout << std::fixed << std::setprecision(3) << query.elevation << std::endl;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -163,6 +356,20 @@ main(int argc, char** argv)
     props->getNode("sim/rendering/random-objects", true)->setBoolValue(false);
     props->getNode("sim/rendering/random-vegetation", true)->setBoolValue(false);
 
+    // Number of worker threads, 0 answers each query as it comes in
+    unsigned threads = 0;
+    arguments.read("--threads", threads);
+    // Queries read and answered together with worker threads
+    unsigned batchSize = 4096;
+    arguments.read("--batch-size", batchSize);
+    if (!threads || !batchSize)
+        batchSize = 1;
+    // Number of batches an unused page stays loaded for
+    unsigned expiry = 10;
+    arguments.read("--expiry", expiry);
+    bool binary = arguments.read("--binary");
+    bool stats = arguments.read("--stats");
+
     // Here, all arguments are processed
     arguments.reportRemainingOptionsAsUnrecognized();
     arguments.writeErrorMessages(std::cerr);
@@ -181,43 +388,102 @@ main(int argc, char** argv)
     // We assume that the above is a paged database.
     sg::BVHPager pager;
 
-    while (std::cin.good()) {
+#ifdef _WIN32
+    if (binary) {
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+
+    SGBlockingQueue<Worker::Range> ranges, done;
+    std::vector<Worker*> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.push_back(new Worker(*node, ranges, done));
+        workers.back()->start();
+    }
+
+    std::vector<Query> queries(batchSize);
+    SGTimeStamp startTime = SGTimeStamp::now();
+    SGTimeStamp lastReport = startTime;
+    unsigned long count = 0;
+    bool failed = false;
+    while (!failed) {
+        unsigned size = 0;
+        for (; size < batchSize; ++size) {
+            if (!readQuery(queries[size], binary)) {
+                failed = true;
+                break;
+            }
+        }
+        if (!size)
+            break;
+
         // Increment the paging relevant number
         pager.setUseStamp(1 + pager.getUseStamp());
-        // and expire everything not accessed for the past 30 requests
-        pager.update(10);
+        // and expire everything not accessed for the past batches
+        pager.update(expiry);
 
-        std::string id;
-        std::cin >> id;
-        double lon, lat;
-        std::cin >> lon >> lat;
-        if (std::cin.fail())
-            return EXIT_FAILURE;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        SGVec3d start = SGVec3d::fromGeod(SGGeod::fromDegM(lon, lat, 10000));
-        SGVec3d end = SGVec3d::fromGeod(SGGeod::fromDegM(lon, lat, -1000));
-
-        // Try to find an intersection
-        bool found = intersect(*node, pager, start, end, 0);
-        double scale = 1e-5;
-        while (!found && scale <= 1) {
-            found = intersect(*node, pager, start, end, scale);
-            scale *= 2;
-        }
-        if (1e-5 < scale)
-            std::cerr << "Found hole of minimum diameter "
-                      << scale << "m at lon = " << lon
-                      << "deg lat = " << lat << "deg" << std::endl;
-
-        std::cout << id << ": ";
-        if (!found) {
-            std::cout << "-1000" << std::endl;
+        if (workers.empty()) {
+            for (unsigned i = 0; i < size; ++i)
+                answer(*node, &pager, queries[i]);
         } else {
-            SGGeod geod = SGGeod::fromCart(end);
-            std::cout << std::fixed << std::setprecision(3) << geod.getElevationM() << std::endl;
+            // The pager is not thread safe, load everything the batch
+            // needs, including the hole searching, in this thread
+            for (unsigned i = 0; i < size; ++i) {
+                const Query& query = queries[i];
+                SGVec3d start = SGVec3d::fromGeod(SGGeod::fromDegM(query.lon, query.lat, 10000));
+                SGVec3d end = SGVec3d::fromGeod(SGGeod::fromDegM(query.lon, query.lat, -1000));
+                PageInVisitor visitor(SGLineSegmentd(start, end), pager,
+                                      2*maxHoleScale);
+                node->accept(visitor);
+            }
+
+            unsigned chunk = std::max(1u, size/(8*threads));
+            unsigned pending = 0;
+            for (unsigned i = 0; i < size; i += chunk) {
+                Worker::Range range;
+                range.begin = &queries[i];
+                range.end = &queries[0] + std::min(i + chunk, size);
+                ranges.push(range);
+                ++pending;
+            }
+            for (; pending; --pending)
+                done.pop();
         }
+
+        for (unsigned i = 0; i < size; ++i)
+            writeQuery(queries[i], binary);
+        if (binary)
+            std::cout.flush();
+        count += size;
+
+        if (stats && 10 <= (SGTimeStamp::now() - lastReport).toSecs()) {
+            lastReport = SGTimeStamp::now();
+            double secs = (lastReport - startTime).toSecs();
+            std::cerr << count << " points in " << secs << " s, "
+                      << count/secs << " points per second" << std::endl;
+        }
+    }
+
+    for (unsigned i = 0; i < workers.size(); ++i) {
+        Worker::Range range = { 0, 0 };
+        ranges.push(range);
     }
+    for (unsigned i = 0; i < workers.size(); ++i) {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    if (stats) {
+        double secs = (SGTimeStamp::now() - startTime).toSecs();
+        std::cerr << count << " points in " << secs << " s, "
+                  << count/secs << " points per second with "
+                  << threads << " worker threads" << std::endl;
+    }
+
+    // Input that is not a query is an error, the end of it is not
+    if (failed && !std::cin.eof())
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 }
@@ -32,6 +32,7 @@
 #include "BVHMotionTransform.hxx"
 #include "BVHLineGeometry.hxx"
 #include "BVHStaticGeometry.hxx"
+#include "BVHStaticFlatTree.hxx"
 
 #include "BVHStaticData.hxx"
 
@@ -128,7 +129,24 @@ BVHLineSegmentVisitor::apply(BVHStaticGeometry& node)
 {
     if (!intersects(_lineSegment, node.getBoundingSphere()))
         return;
-    node.traverse(*this);
+    const BVHStaticFlatTree* flatTree = node.getFlatTree();
+    if (!flatTree) {
+        node.traverse(*this);
+        return;
+    }
+
+    SGLineSegmentf lineSegment(_lineSegment);
+    unsigned index;
+    if (!flatTree->intersect(lineSegment, index))
+        return;
+    setLineSegmentEnd(SGVec3d(lineSegment.getEnd()));
+    _normal = SGVec3d(flatTree->getTriangle(index).getNormal());
+    _linearVelocity = SGVec3d::zeros();
+    _angularVelocity = SGVec3d::zeros();
+    const BVHStaticData* data = node.getStaticData();
+    _material = data->getMaterial(flatTree->getMaterialIndex(index));
+    _id = 0;
+    _haveHit = true;
 }
 
 void
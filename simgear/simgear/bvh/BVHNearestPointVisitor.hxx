@@ -28,6 +28,7 @@
 #include "BVHTransform.hxx"
 #include "BVHLineGeometry.hxx"
 #include "BVHStaticGeometry.hxx"
+#include "BVHStaticFlatTree.hxx"
 
 #include "BVHStaticData.hxx"
 
@@ -111,7 +112,20 @@ public:
     {
         if (!intersects(_sphere, node.getBoundingSphere()))
             return;
-        node.traverse(*this);
+        const BVHStaticFlatTree* flatTree = node.getFlatTree();
+        if (!flatTree) {
+            node.traverse(*this);
+            return;
+        }
+        unsigned index;
+        if (!flatTree->nearestPoint(_sphere, _point, index))
+            return;
+        _linearVelocity = SGVec3d::zeros();
+        _angularVelocity = SGVec3d::zeros();
+        const BVHStaticData* data = node.getStaticData();
+        _material = data->getMaterial(flatTree->getMaterialIndex(index));
+        _havePoint = true;
+        _id = 0;
     }
     
     virtual void apply(const BVHStaticBinary& node, const BVHStaticData& data)
@@ -34,6 +34,8 @@ public:
     { _vertices.push_back(vertex); return _vertices.size() - 1; }
     const SGVec3f& getVertex(unsigned i) const
     { return _vertices[i]; }
+    unsigned getNumVertices() const
+    { return _vertices.size(); }
     
     
     unsigned addMaterial(const BVHMaterial* material)
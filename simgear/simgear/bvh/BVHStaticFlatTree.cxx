@@ -0,0 +1,307 @@
+// BVHStaticFlatTree.cxx -- Array based BVH for fast terrain queries
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include "BVHStaticFlatTree.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BVHStaticBinary.hxx"
+
+namespace simgear {
+
+namespace {
+
+// The queries keep the children they still have to visit on a stack,
+// together with the distance at which they were found.
+struct StackEntry {
+    int child;
+    float dist;
+};
+
+// Pushes the children with hit set in order of decreasing dist, so the
+// closest one is visited first.
+template<unsigned width>
+inline void
+pushChildren(StackEntry* stack, unsigned& size, const int child[width],
+             const bool hit[width], const float dist[width])
+{
+    unsigned order[width];
+    unsigned n = 0;
+    for (unsigned k = 0; k < width; ++k) {
+        if (!hit[k])
+            continue;
+        unsigned i = n++;
+        for (; 0 < i && dist[order[i-1]] < dist[k]; --i)
+            order[i] = order[i-1];
+        order[i] = k;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        stack[size].child = child[order[i]];
+        stack[size].dist = dist[order[i]];
+        ++size;
+    }
+}
+
+}
+
+class BVHStaticFlatTree::Builder {
+public:
+    Builder(BVHStaticFlatTree* tree, const BVHStaticData& data) :
+        _tree(tree),
+        _data(data),
+        _valid(true)
+    { }
+
+    bool valid() const
+    { return _valid; }
+
+    // Collects up to WIDTH children from the binary tree below node,
+    // always opening the largest box next, and appends a node for them.
+    unsigned addNode(const BVHStaticNode* node, unsigned depth)
+    {
+        unsigned index = _tree->_nodes.size();
+        _tree->_nodes.push_back(Node());
+        if (MAX_DEPTH <= depth) {
+            _valid = false;
+            return index;
+        }
+
+        const BVHStaticNode* children[WIDTH];
+        unsigned n = 1;
+        children[0] = node;
+        while (n < WIDTH) {
+            int largest = -1;
+            float largestArea = -1;
+            for (unsigned i = 0; i < n; ++i) {
+                const BVHStaticBinary* binary;
+                binary = dynamic_cast<const BVHStaticBinary*>(children[i]);
+                if (!binary)
+                    continue;
+                SGVec3f size = binary->getBoundingBox().getSize();
+                float area = size[0]*size[1] + size[1]*size[2]
+                    + size[2]*size[0];
+                if (area <= largestArea)
+                    continue;
+                largest = i;
+                largestArea = area;
+            }
+            if (largest < 0)
+                break;
+            const BVHStaticBinary* binary;
+            binary = static_cast<const BVHStaticBinary*>(children[largest]);
+            children[largest] = binary->getLeftChild();
+            children[n++] = binary->getRightChild();
+        }
+
+        for (unsigned k = 0; k < WIDTH; ++k) {
+            SGBoxf box;
+            int child = 0;
+            if (k < n) {
+                const BVHStaticBinary* binary;
+                binary = dynamic_cast<const BVHStaticBinary*>(children[k]);
+                const BVHStaticTriangle* triangle;
+                triangle = dynamic_cast<const BVHStaticTriangle*>(children[k]);
+                if (binary) {
+                    box = binary->getBoundingBox();
+                    child = addNode(binary, depth + 1);
+                } else if (triangle) {
+                    box = triangle->computeBoundingBox(_data);
+                    child = ~addTriangle(*triangle);
+                } else {
+                    _valid = false;
+                }
+            }
+            // The node array may have moved while adding the children
+            Node& flatNode = _tree->_nodes[index];
+            flatNode.child[k] = child;
+            if (!child)
+                box = SGBoxf(SGVec3f::zeros());
+            // The queries compute the boxes in a different way than
+            // the triangle tests, do not let rounding drop a hit
+            SGVec3f size = box.getSize();
+            float pad = 1e-4f*std::max(size[0], std::max(size[1], size[2]));
+            for (unsigned i = 0; i < 3; ++i) {
+                float scale = std::max(fabs(box.getMin()[i]),
+                                       fabs(box.getMax()[i]));
+                float eps = pad + 16*SGLimitsf::epsilon()*scale;
+                flatNode.min[i][k] = box.getMin()[i] - eps;
+                flatNode.max[i][k] = box.getMax()[i] + eps;
+            }
+        }
+        return index;
+    }
+
+    int addTriangle(const BVHStaticTriangle& triangle)
+    {
+        _tree->_triangles.push_back(&triangle);
+        return _tree->_triangles.size() - 1;
+    }
+
+private:
+    BVHStaticFlatTree* _tree;
+    const BVHStaticData& _data;
+    bool _valid;
+};
+
+BVHStaticFlatTree::BVHStaticFlatTree()
+{
+}
+
+BVHStaticFlatTree::~BVHStaticFlatTree()
+{
+}
+
+BVHStaticFlatTree*
+BVHStaticFlatTree::build(const BVHStaticNode* node, const BVHStaticData& data)
+{
+    if (!node)
+        return 0;
+    SGSharedPtr<BVHStaticFlatTree> tree = new BVHStaticFlatTree;
+    tree->_root = node;
+    tree->_data = &data;
+    Builder builder(tree, data);
+    builder.addNode(node, 0);
+    if (!builder.valid())
+        return 0;
+    std::vector<Node>(tree->_nodes).swap(tree->_nodes);
+    std::vector<const BVHStaticTriangle*>(tree->_triangles).swap(tree->_triangles);
+    return tree.release();
+}
+
+bool
+BVHStaticFlatTree::intersect(SGLineSegmentf& lineSegment,
+                             unsigned& triangle) const
+{
+    SGVec3f start = lineSegment.getStart();
+    SGVec3f direction = lineSegment.getDirection();
+    float invDirection[3];
+    for (unsigned i = 0; i < 3; ++i) {
+        if (SGLimitsf::min() < fabs(direction[i]))
+            invDirection[i] = 1/direction[i];
+        else if (direction[i] < 0)
+            invDirection[i] = -SGLimitsf::max();
+        else
+            invDirection[i] = SGLimitsf::max();
+    }
+    float length2 = dot(direction, direction);
+
+    // The part of the line segment still to search, in fractions of
+    // its original length
+    float end = 1;
+    bool haveHit = false;
+
+    StackEntry stack[WIDTH*MAX_DEPTH];
+    unsigned size = 1;
+    stack[0].child = 0;
+    stack[0].dist = 0;
+    while (size) {
+        StackEntry entry = stack[--size];
+        if (end < entry.dist)
+            continue;
+
+        if (entry.child < 0) {
+            unsigned index = ~entry.child;
+            SGVec3f point;
+            if (!intersects(point, getTriangle(index), lineSegment, 1e-4f))
+                continue;
+            lineSegment.set(start, point);
+            end = 0 < length2 ? dot(point - start, direction)/length2 : 0;
+            triangle = index;
+            haveHit = true;
+            continue;
+        }
+
+        const Node& node = _nodes[entry.child];
+        float near[WIDTH], far[WIDTH];
+        for (unsigned k = 0; k < WIDTH; ++k) {
+            near[k] = 0;
+            far[k] = end;
+        }
+        for (unsigned i = 0; i < 3; ++i) {
+            for (unsigned k = 0; k < WIDTH; ++k) {
+                float t0 = (node.min[i][k] - start[i])*invDirection[i];
+                float t1 = (node.max[i][k] - start[i])*invDirection[i];
+                near[k] = std::max(near[k], std::min(t0, t1));
+                far[k] = std::min(far[k], std::max(t0, t1));
+            }
+        }
+        bool hit[WIDTH];
+        for (unsigned k = 0; k < WIDTH; ++k)
+            hit[k] = node.child[k] && near[k] <= far[k];
+        pushChildren<WIDTH>(stack, size, node.child, hit, near);
+    }
+    return haveHit;
+}
+
+bool
+BVHStaticFlatTree::nearestPoint(SGSphered& sphere, SGVec3d& point,
+                                unsigned& triangle) const
+{
+    if (sphere.empty())
+        return false;
+    SGVec3f center(sphere.getCenter());
+    bool havePoint = false;
+
+    StackEntry stack[WIDTH*MAX_DEPTH];
+    unsigned size = 1;
+    stack[0].child = 0;
+    stack[0].dist = 0;
+    while (size) {
+        StackEntry entry = stack[--size];
+        float radius2 = sphere.getRadius2();
+        if (radius2 < entry.dist)
+            continue;
+
+        if (entry.child < 0) {
+            unsigned index = ~entry.child;
+            SGVec3d closest(closestPoint(getTriangle(index), center));
+            if (!intersects(sphere, closest))
+                continue;
+            point = closest;
+            // As in the visitor, shrink the sphere to the point found
+            sphere.setRadius(length(closest - sphere.getCenter()));
+            triangle = index;
+            havePoint = true;
+            continue;
+        }
+
+        const Node& node = _nodes[entry.child];
+        float dist2[WIDTH];
+        for (unsigned k = 0; k < WIDTH; ++k)
+            dist2[k] = 0;
+        for (unsigned i = 0; i < 3; ++i) {
+            for (unsigned k = 0; k < WIDTH; ++k) {
+                float d = std::max(node.min[i][k] - center[i],
+                                   center[i] - node.max[i][k]);
+                d = std::max(d, 0.0f);
+                dist2[k] += d*d;
+            }
+        }
+        bool hit[WIDTH];
+        for (unsigned k = 0; k < WIDTH; ++k)
+            hit[k] = node.child[k] && dist2[k] <= radius2;
+        pushChildren<WIDTH>(stack, size, node.child, hit, dist2);
+    }
+    return havePoint;
+}
+
+}
@@ -0,0 +1,94 @@
+// BVHStaticFlatTree.hxx -- Array based BVH for fast terrain queries
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef BVHStaticFlatTree_hxx
+#define BVHStaticFlatTree_hxx
+
+#include <vector>
+#include <simgear/math/SGGeometry.hxx>
+#include <simgear/structure/SGReferenced.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+
+#include "BVHStaticData.hxx"
+#include "BVHStaticNode.hxx"
+#include "BVHStaticTriangle.hxx"
+
+namespace simgear {
+
+/**
+ * The bounds of a static geometry again, in a tree of four wide nodes
+ * stored in one array.  The bounds of the four children of a
+ * node are kept next to each other per coordinate, so a query tests
+ * all four boxes at once in straight line code the compiler can
+ * vectorize, and walks the tree without virtual calls or pointer
+ * chasing.  Used for the line segment and nearest point queries that
+ * dominate terrain lookups, the rest keeps using the node tree.
+ * The leafs refer to the triangle nodes of that tree, which in turn
+ * index the vertices of the static data, so no geometry is copied.
+ */
+class BVHStaticFlatTree : public SGReferenced {
+public:
+    virtual ~BVHStaticFlatTree();
+
+    /// Flattens the tree below node.  Returns 0 for trees with other
+    /// leafs than triangles, or too deep for the query stacks.
+    static BVHStaticFlatTree* build(const BVHStaticNode* node,
+                                    const BVHStaticData& data);
+
+    /// Looks for the first triangle hit by lineSegment.  On a hit the
+    /// line segment is cut at the intersection point and the index of
+    /// the triangle is returned in triangle.
+    bool intersect(SGLineSegmentf& lineSegment, unsigned& triangle) const;
+
+    /// Looks for the point closest to the center of sphere, if any is
+    /// within the sphere.  On success the radius of sphere is reduced
+    /// to the distance of that point.
+    bool nearestPoint(SGSphered& sphere, SGVec3d& point,
+                      unsigned& triangle) const;
+
+    unsigned getNumTriangles() const
+    { return _triangles.size(); }
+    SGTrianglef getTriangle(unsigned i) const
+    { return _triangles[i]->getTriangle(*_data); }
+    unsigned getMaterialIndex(unsigned i) const
+    { return _triangles[i]->getMaterialIndex(); }
+
+private:
+    BVHStaticFlatTree();
+
+    class Builder;
+
+    enum { WIDTH = 4, MAX_DEPTH = 64 };
+
+    // Children with references below zero are triangles, ~child being
+    // the index of the triangle.  Unused children have an empty box.
+    struct Node {
+        float min[3][WIDTH];
+        float max[3][WIDTH];
+        int child[WIDTH];
+    };
+
+    std::vector<Node> _nodes;
+    // Owned by the node tree below _root
+    std::vector<const BVHStaticTriangle*> _triangles;
+    SGSharedPtr<const BVHStaticNode> _root;
+    SGSharedPtr<const BVHStaticData> _data;
+};
+
+}
+
+#endif
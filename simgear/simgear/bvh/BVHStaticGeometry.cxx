@@ -22,9 +22,11 @@
 namespace simgear {
 
 BVHStaticGeometry::BVHStaticGeometry(const BVHStaticNode* staticNode,
-                                     const BVHStaticData* staticData) :
+                                     const BVHStaticData* staticData,
+                                     const BVHStaticFlatTree* flatTree) :
     _staticNode(staticNode),
-    _staticData(staticData)
+    _staticData(staticData),
+    _flatTree(flatTree)
 {
 }
 
@@ -25,13 +25,15 @@
 #include "BVHNode.hxx"
 #include "BVHStaticData.hxx"
 #include "BVHStaticNode.hxx"
+#include "BVHStaticFlatTree.hxx"
 
 namespace simgear {
 
 class BVHStaticGeometry : public BVHNode {
 public:
     BVHStaticGeometry(const BVHStaticNode* staticNode,
-                      const BVHStaticData* staticData);
+                      const BVHStaticData* staticData,
+                      const BVHStaticFlatTree* flatTree = 0);
     virtual ~BVHStaticGeometry();
     
     virtual void accept(BVHVisitor& visitor);
@@ -43,12 +45,17 @@ public:
     { return _staticData; }
     const BVHStaticNode* getStaticNode() const
     { return _staticNode; }
+    /// The same triangles for the fast line segment and nearest point
+    /// queries, if the builder made them.
+    const BVHStaticFlatTree* getFlatTree() const
+    { return _flatTree; }
     
     virtual SGSphered computeBoundingSphere() const;
     
 private:
     SGSharedPtr<const BVHStaticNode> _staticNode;
     SGSharedPtr<const BVHStaticData> _staticData;
+    SGSharedPtr<const BVHStaticFlatTree> _flatTree;
 };
 
 }
@@ -19,6 +19,7 @@
 #define BVHStaticGeometryBuilder_hxx
 
 #include <algorithm>
+#include <list>
 #include <map>
 #include <set>
 
@@ -37,6 +38,7 @@
 #include "BVHStaticTriangle.hxx"
 #include "BVHStaticBinary.hxx"
 #include "BVHStaticGeometry.hxx"
+#include "BVHStaticFlatTree.hxx"
 
 namespace simgear {
 
@@ -130,7 +132,9 @@ public:
         if (!tree)
             return 0;
         _staticData->trim();
-        return new BVHStaticGeometry(tree, _staticData);
+        const BVHStaticFlatTree* flatTree;
+        flatTree = BVHStaticFlatTree::build(tree, *_staticData);
+        return new BVHStaticGeometry(tree, _staticData, flatTree);
     }
 
 private:
@@ -145,9 +145,14 @@ BVHSubTreeCollector::apply(BVHStaticGeometry& node)
     if (!_staticNode)
         return;
     
-    BVHStaticGeometry* staticTree;
-    staticTree = new BVHStaticGeometry(_staticNode, node.getStaticData());
-    addNode(staticTree);
+    // Keep the flat tree of the geometry when all of it is inside
+    if (_staticNode == node.getStaticNode()) {
+        addNode(&node);
+    } else {
+        BVHStaticGeometry* staticTree;
+        staticTree = new BVHStaticGeometry(_staticNode, node.getStaticData());
+        addNode(staticTree);
+    }
     _staticNode = 0;
 }
 
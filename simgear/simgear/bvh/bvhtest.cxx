@@ -16,7 +16,9 @@
 //
 
 #include <iostream>
+#include <cstdlib>
 #include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "BVHNode.hxx"
 #include "BVHGroup.hxx"
@@ -29,6 +31,7 @@
 #include "BVHStaticTriangle.hxx"
 #include "BVHStaticBinary.hxx"
 #include "BVHStaticGeometry.hxx"
+#include "BVHStaticGeometryBuilder.hxx"
 
 #include "BVHBoundingBoxVisitor.hxx"
 #include "BVHSubTreeCollector.hxx"
@@ -131,6 +134,123 @@ testNearestPoint()
     return true;
 }
 
+// A hilly terrain patch of size by size quads, about 10km wide
+BVHStaticGeometry*
+buildTerrain(unsigned size)
+{
+    BVHStaticGeometryBuilder builder;
+    float spacing = 10000.0f/size;
+    for (unsigned i = 0; i < size; ++i) {
+        for (unsigned j = 0; j < size; ++j) {
+            SGVec3f v[4];
+            for (unsigned k = 0; k < 4; ++k) {
+                float x = (i + (k & 1))*spacing - 5000;
+                float y = (j + (k >> 1))*spacing - 5000;
+                float z = 100*sin(0.001f*x)*cos(0.0007f*y)
+                    + 2*sin(0.01f*x + 0.006f*y);
+                v[k] = SGVec3f(x, y, z);
+            }
+            builder.addTriangle(v[0], v[1], v[3]);
+            builder.addTriangle(v[0], v[3], v[2]);
+        }
+    }
+    return builder.buildTree();
+}
+
+static double
+uniform(double min, double max)
+{
+    return min + (max - min)*(rand()/(RAND_MAX + 1.0));
+}
+
+// Runs the same queries through the flat tree of the terrain and
+// through its node tree, which need to find the same points.
+bool
+testFlatTree()
+{
+    SGSharedPtr<BVHStaticGeometry> flat = buildTerrain(256);
+    if (!flat->getFlatTree())
+        return false;
+    SGSharedPtr<BVHStaticGeometry> nodes;
+    nodes = new BVHStaticGeometry(flat->getStaticNode(),
+                                  flat->getStaticData());
+
+    const unsigned count = 20000;
+    std::vector<SGLineSegmentd> lineSegments;
+    std::vector<SGSphered> spheres;
+    srand(1);
+    for (unsigned i = 0; i < count; ++i) {
+        SGVec3d start(uniform(-5500, 5500), uniform(-5500, 5500), 1000);
+        SGVec3d end(start[0] + uniform(-2000, 2000),
+                    start[1] + uniform(-2000, 2000), -1000);
+        if (i % 2)
+            end = SGVec3d(start[0], start[1], -1000);
+        lineSegments.push_back(SGLineSegmentd(start, end));
+        SGVec3d center(start[0], start[1], uniform(-150, 150));
+        spheres.push_back(SGSphered(center, uniform(1, 100)));
+    }
+
+    unsigned hits = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        BVHLineSegmentVisitor flatVisitor(lineSegments[i]);
+        flat->accept(flatVisitor);
+        BVHLineSegmentVisitor nodeVisitor(lineSegments[i]);
+        nodes->accept(nodeVisitor);
+        if (flatVisitor.empty() != nodeVisitor.empty())
+            return false;
+        if (flatVisitor.empty())
+            continue;
+        ++hits;
+        if (1e-3 < dist(flatVisitor.getPoint(), nodeVisitor.getPoint()))
+            return false;
+        // Hits on an edge may come from either triangle, which can
+        // face the other way as the builder does not keep the winding
+        double cosAngle = dot(flatVisitor.getNormal(), nodeVisitor.getNormal());
+        if (fabs(cosAngle) < 0.999)
+            return false;
+    }
+    // Vertical lines inside the patch always hit
+    if (hits < count/2)
+        return false;
+
+    for (unsigned i = 0; i < count; ++i) {
+        BVHNearestPointVisitor flatVisitor(spheres[i], 0);
+        flat->accept(flatVisitor);
+        BVHNearestPointVisitor nodeVisitor(spheres[i], 0);
+        nodes->accept(nodeVisitor);
+        if (flatVisitor.empty() != nodeVisitor.empty())
+            return false;
+        if (flatVisitor.empty())
+            continue;
+        if (1e-3 < dist(flatVisitor.getPoint(), nodeVisitor.getPoint()))
+            return false;
+    }
+
+    // Both query kinds through both layouts, to see what the flat
+    // tree gains
+    BVHStaticGeometry* geometries[2] = { nodes, flat };
+    const char* names[2] = { "node tree", "flat tree" };
+    for (unsigned k = 0; k < 2; ++k) {
+        SGTimeStamp start = SGTimeStamp::now();
+        for (unsigned i = 0; i < count; ++i) {
+            BVHLineSegmentVisitor visitor(lineSegments[i]);
+            geometries[k]->accept(visitor);
+        }
+        double lineUSec = (SGTimeStamp::now() - start).toUSecs();
+        start = SGTimeStamp::now();
+        for (unsigned i = 0; i < count; ++i) {
+            BVHNearestPointVisitor visitor(spheres[i], 0);
+            geometries[k]->accept(visitor);
+        }
+        double sphereUSec = (SGTimeStamp::now() - start).toUSecs();
+        std::cout << names[k] << ": " << 1000*lineUSec/count
+                  << " nsec per line segment, " << 1000*sphereUSec/count
+                  << " nsec per nearest point" << std::endl;
+    }
+
+    return true;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -138,5 +258,7 @@ main(int argc, char** argv)
         return EXIT_FAILURE;
     if (!testNearestPoint())
         return EXIT_FAILURE;
+    if (!testFlatTree())
+        return EXIT_FAILURE;
     return EXIT_SUCCESS;
 }
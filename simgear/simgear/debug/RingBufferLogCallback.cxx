@@ -0,0 +1,201 @@
+/** \file RingBufferLogCallback.cxx
+ * Keep the most recent log messages in a fixed-size binary buffer
+ */
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include <simgear/debug/RingBufferLogCallback.hxx>
+
+#include <cstring>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#  include <io.h>
+#  include <sys/stat.h>
+#  define SG_WRITE ::_write
+#  define SG_CLOSE ::_close
+#else
+#  include <unistd.h>
+#  define SG_WRITE ::write
+#  define SG_CLOSE ::close
+#endif
+
+const char* debugClassToString(sgDebugClass c);
+
+namespace simgear
+{
+
+struct RingBufferLogCallback::Record
+{
+    unsigned length;    ///< including this header
+    unsigned sequence;
+    unsigned debugClass;
+    int priority;
+    int line;
+    const char* file;   ///< __FILE__, so it stays valid
+};
+
+// Formatting helpers which neither allocate nor use stdio
+static void append(char* buf, size_t& pos, size_t cap, const char* s, size_t n)
+{
+    if (n > cap - pos)
+        n = cap - pos;
+    memcpy(buf + pos, s, n);
+    pos += n;
+}
+
+static void append(char* buf, size_t& pos, size_t cap, const char* s)
+{
+    append(buf, pos, cap, s, s ? strlen(s) : 0);
+}
+
+static void append(char* buf, size_t& pos, size_t cap, long value)
+{
+    char digits[24];
+    int n = 0;
+    unsigned long v = value < 0 ? -value : value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        digits[n++] = '-';
+    while (n > 0 && pos < cap)
+        buf[pos++] = digits[--n];
+}
+
+RingBufferLogCallback::RingBufferLogCallback(size_t bytes, sgDebugClass c,
+                                             sgDebugPriority p) :
+    LogCallback(c, p),
+    m_data(new char[bytes > sizeof(Record) ? bytes : sizeof(Record)]),
+    m_size(bytes > sizeof(Record) ? bytes : sizeof(Record)),
+    m_head(0),
+    m_used(0),
+    m_count(0),
+    m_sequence(0)
+{
+}
+
+RingBufferLogCallback::~RingBufferLogCallback()
+{
+    delete[] m_data;
+}
+
+void RingBufferLogCallback::write(size_t pos, const void* src, size_t n)
+{
+    pos %= m_size;
+    size_t first = n < m_size - pos ? n : m_size - pos;
+    memcpy(m_data + pos, src, first);
+    memcpy(m_data, static_cast<const char*>(src) + first, n - first);
+}
+
+void RingBufferLogCallback::read(size_t pos, void* dst, size_t n) const
+{
+    pos %= m_size;
+    size_t first = n < m_size - pos ? n : m_size - pos;
+    memcpy(dst, m_data + pos, first);
+    memcpy(static_cast<char*>(dst) + first, m_data, n - first);
+}
+
+void RingBufferLogCallback::operator()(sgDebugClass c, sgDebugPriority p,
+        const char* file, int line, const std::string& aMessage)
+{
+    if (!shouldLog(c, p)) return;
+
+    size_t length = aMessage.size();
+    if (length > MAX_MESSAGE)
+        length = MAX_MESSAGE;
+    if (length > m_size - sizeof(Record))
+        length = m_size - sizeof(Record);
+
+    Record record;
+    record.length = sizeof(Record) + length;
+    record.sequence = m_sequence++;
+    record.debugClass = c;
+    record.priority = p;
+    record.line = line;
+    record.file = file;
+
+    // drop the oldest records until the new one fits
+    while (m_used + record.length > m_size) {
+        Record oldest;
+        read(m_head, &oldest, sizeof(oldest));
+        m_head = (m_head + oldest.length) % m_size;
+        m_used -= oldest.length;
+        --m_count;
+    }
+
+    size_t tail = m_head + m_used;
+    write(tail, &record, sizeof(record));
+    write(tail + sizeof(record), aMessage.data(), length);
+    m_used += record.length;
+    ++m_count;
+}
+
+void RingBufferLogCallback::dump(int fd) const
+{
+    char line[MAX_MESSAGE + 256];
+    size_t pos = m_head;
+    size_t end = m_head + m_used;
+    while (pos < end) {
+        Record record;
+        read(pos, &record, sizeof(record));
+        if (record.length < sizeof(Record) || record.length > end - pos)
+            break; // overwritten while we were reading
+
+        size_t n = 0;
+        const size_t cap = sizeof(line) - 1;
+        append(line, n, cap, (long) record.sequence);
+        append(line, n, cap, " ");
+        append(line, n, cap, debugClassToString((sgDebugClass) record.debugClass));
+        append(line, n, cap, ":");
+        append(line, n, cap, (long) record.priority);
+        append(line, n, cap, ":");
+        append(line, n, cap, record.file);
+        append(line, n, cap, ":");
+        append(line, n, cap, (long) record.line);
+        append(line, n, cap, ":");
+
+        size_t length = record.length - sizeof(Record);
+        if (length > cap - n)
+            length = cap - n;
+        read(pos + sizeof(Record), line + n, length);
+        n += length;
+        line[n++] = '\n';
+
+        if (SG_WRITE(fd, line, n) < 0)
+            return;
+        pos += record.length;
+    }
+}
+
+bool RingBufferLogCallback::dump(const char* path) const
+{
+#ifdef _WIN32
+    int fd = ::_open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                     _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0)
+        return false;
+
+    dump(fd);
+    SG_CLOSE(fd);
+    return true;
+}
+
+} // of namespace simgear
@@ -0,0 +1,86 @@
+/** \file RingBufferLogCallback.hxx
+ * Keep the most recent log messages in a fixed-size binary buffer
+ */
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef SG_DEBUG_RINGBUFFERLOGCALLBACK_HXX
+#define SG_DEBUG_RINGBUFFERLOGCALLBACK_HXX
+
+#include <simgear/debug/logstream.hxx>
+
+namespace simgear
+{
+
+/**
+ * Log callback keeping the most recent messages in a buffer allocated
+ * once up front. Messages are stored as binary records (message text
+ * truncated to MAX_MESSAGE bytes) and the oldest ones are overwritten
+ * once the buffer is full.
+ *
+ * Intended to be dumped after a crash: dump() only uses write(), and
+ * neither allocates nor takes locks.
+ */
+class RingBufferLogCallback : public LogCallback
+{
+public:
+    enum { MAX_MESSAGE = 512 };
+
+    RingBufferLogCallback(size_t bytes, sgDebugClass c, sgDebugPriority p);
+    virtual ~RingBufferLogCallback();
+
+    virtual void operator()(sgDebugClass c, sgDebugPriority p,
+        const char* file, int line, const std::string& aMessage);
+
+    /**
+     * Write the buffered messages, oldest first, as text lines to a file
+     * descriptor.
+     */
+    void dump(int fd) const;
+
+    /**
+     * Write the buffered messages to a new file.
+     *
+     * @return false if the file can't be created
+     */
+    bool dump(const char* path) const;
+
+    /**
+     * Get the number of messages currently held.
+     */
+    size_t count() const { return m_count; }
+
+private:
+    struct Record;
+
+    void write(size_t pos, const void* src, size_t n);
+    void read(size_t pos, void* dst, size_t n) const;
+
+    char* m_data;
+    size_t m_size;
+    size_t m_head;      ///< offset of the oldest record
+    size_t m_used;      ///< bytes used by records
+    size_t m_count;
+    unsigned m_sequence;
+
+    // Not copyable
+    RingBufferLogCallback(const RingBufferLogCallback&);
+    RingBufferLogCallback& operator=(const RingBufferLogCallback&);
+};
+
+} // of namespace simgear
+
+#endif // of SG_DEBUG_RINGBUFFERLOGCALLBACK_HXX
@@ -25,6 +25,7 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <sstream>
 
 #include <boost/foreach.hpp>
 
@@ -34,6 +35,8 @@
 #include <simgear/threads/SGGuard.hxx>
 
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/structure/SGAtomic.hxx>
+#include <simgear/debug/RingBufferLogCallback.hxx>
 
 #ifdef _WIN32
 // for AllocConsole
@@ -73,35 +76,48 @@ const char* debugClassToString(sgDebugClass c)
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace simgear
+{
+
+LogCallback::LogCallback(sgDebugClass c, sgDebugPriority p) :
+    m_class(c),
+    m_priority(p)
+{
+}
+
+void LogCallback::setLogLevels(sgDebugClass c, sgDebugPriority p)
+{
+    m_class = c;
+    m_priority = p;
+}
+
+} // of namespace simgear
+
 class FileLogCallback : public simgear::LogCallback
 {
 public:
     FileLogCallback(const std::string& aPath, sgDebugClass c, sgDebugPriority p) :
-        m_file(aPath.c_str(), std::ios_base::out | std::ios_base::trunc),
-        m_class(c),
-        m_priority(p)
+        simgear::LogCallback(c, p),
+        m_file(aPath.c_str(), std::ios_base::out | std::ios_base::trunc)
     {
     }
     
     virtual void operator()(sgDebugClass c, sgDebugPriority p, 
         const char* file, int line, const std::string& message)
     {
-        if ((c & m_class) == 0 || p < m_priority) return;
+        if (!shouldLog(c, p)) return;
         m_file << debugClassToString(c) << ":" << (int) p
             << ":" << file << ":" << line << ":" << message << std::endl;
     }
 private:
     std::ofstream m_file;   
-    sgDebugClass m_class;
-    sgDebugPriority m_priority;
 };
    
 class StderrLogCallback : public simgear::LogCallback
 {
 public:
     StderrLogCallback(sgDebugClass c, sgDebugPriority p) :
-        m_class(c),
-            m_priority(p)
+        simgear::LogCallback(c, p)
     {
 #ifdef _WIN32
         AllocConsole(); // but only if we want a console
@@ -111,16 +127,10 @@ public:
 #endif
     }
     
-    void setLogLevels( sgDebugClass c, sgDebugPriority p )
-    {
-        m_priority = p;
-        m_class = c;
-    }
-    
     virtual void operator()(sgDebugClass c, sgDebugPriority p, 
         const char* file, int line, const std::string& aMessage)
     {
-        if ((c & m_class) == 0 || p < m_priority) return;
+        if (!shouldLog(c, p)) return;
         
         // if running under MSVC, we could use OutputDebugString here
         
@@ -129,9 +139,6 @@ public:
         //    file, line, aMessage.c_str());
         fflush(stderr);
     }
-private:
-    sgDebugClass m_class;
-    sgDebugPriority m_priority;
 };
 
 class LogStreamPrivate : public SGThread
@@ -179,24 +186,45 @@ private:
     };
 public:
     LogStreamPrivate() :
+        m_entries(4096),
         m_logClass(SG_ALL), 
         m_logPriority(SG_ALERT),
-        m_isRunning(false)
+        m_isRunning(false),
+        m_ringBuffer(NULL),
+        m_droppedReported(0)
     { 
         m_stderrCallback = new StderrLogCallback(m_logClass, m_logPriority);
         addCallback(m_stderrCallback);
     }
                     
     SGMutex m_lock;
-    SGBlockingQueue<LogEntry> m_entries;
+    
+    /// Messages are passed to the logging thread without taking locks.
+    /// While it sleeps on m_wake, m_sleeping is 1, and the first thread to
+    /// reset it wakes it up; the others need not take m_wakeLock.
+    SGMultiProducerQueue<LogEntry*> m_entries;
+    SGMutex m_wakeLock;
+    SGWaitCondition m_wake;
+    SGAtomic m_sleeping;
+    
+    /// Messages which didn't fit into the queue, and how many of them the
+    /// logging thread has reported so far
+    SGAtomic m_dropped;
+    unsigned m_droppedReported;
     
     typedef std::vector<simgear::LogCallback*> CallbackVec;
     CallbackVec m_callbacks;    
     
     sgDebugClass m_logClass;
     sgDebugPriority m_logPriority;
+    
+    /// Classes any callback wants at each priority, so would_log() can
+    /// reject messages without looking at the callbacks.
+    SGAtomic m_filter[SG_ALERT + 1];
+    
     bool m_isRunning;
     StderrLogCallback* m_stderrCallback;
+    simgear::RingBufferLogCallback* m_ringBuffer;
     
     void startLog()
     {
@@ -209,19 +237,54 @@ public:
     virtual void run()
     {
         while (1) {
-            LogEntry entry(m_entries.pop());
+            LogEntry* entry = NULL;
+            if (!m_entries.try_pop(entry)) {
+                SGGuard<SGMutex> g(m_wakeLock);
+                m_sleeping.compareAndExchange(0, 1);
+                if (m_entries.empty())
+                    m_wake.wait(m_wakeLock);
+                m_sleeping.compareAndExchange(1, 0);
+                continue;
+            }
+            
+            unsigned dropped = m_dropped;
+            if (dropped != m_droppedReported) {
+                std::ostringstream os;
+                os << (dropped - m_droppedReported)
+                    << " log messages dropped, logging fell behind";
+                m_droppedReported = dropped;
+                dispatch(LogEntry(SG_GENERAL, SG_WARN, __FILE__, __LINE__, os.str()));
+            }
+            
             // special marker entry detected, terminate the thread since we are
             // making a configuration change or quitting the app
-            if ((entry.debugClass == SG_NONE) && !strcmp(entry.file, "done")) {
+            if ((entry->debugClass == SG_NONE) && !strcmp(entry->file, "done")) {
+                delete entry;
                 return;
             }
             
-            // submit to each installed callback in turn
-            BOOST_FOREACH(simgear::LogCallback* cb, m_callbacks) {
+            dispatch(*entry);
+            delete entry;
+        } // of main thread loop
+    }
+    
+    // submit to each installed callback in turn
+    void dispatch(const LogEntry& entry)
+    {
+        BOOST_FOREACH(simgear::LogCallback* cb, m_callbacks) {
+            if (cb->shouldLog(entry.debugClass, entry.debugPriority)) {
                 (*cb)(entry.debugClass, entry.debugPriority,
                     entry.file, entry.line, entry.message);
-            }           
-        } // of main thread loop
+            }
+        }
+    }
+    
+    void wake()
+    {
+        if (m_sleeping.compareAndExchange(1, 0)) {
+            SGGuard<SGMutex> g(m_wakeLock);
+            m_wake.signal();
+        }
     }
     
     bool stop()
@@ -231,9 +294,10 @@ public:
             return false;
         }
         
-        // log a special marker value, which will cause the thread to wakeup,
-        // and then exit
-        log(SG_NONE, SG_ALERT, "done", -1, "");
+        // queue a special marker value, which will cause the thread to
+        // wakeup, and then exit. It must not be dropped, so wait for room.
+        m_entries.push(new LogEntry(SG_NONE, SG_ALERT, "done", -1, ""));
+        wake();
         join();
         
         m_isRunning = false;
@@ -244,6 +308,7 @@ public:
     {
         PauseThread pause(this);
         m_callbacks.push_back(cb);
+        updateFilter();
     }
     
     void removeCallback(simgear::LogCallback* cb)
@@ -253,6 +318,10 @@ public:
         if (it != m_callbacks.end()) {
             m_callbacks.erase(it);
         }
+        if (cb == m_ringBuffer) {
+            m_ringBuffer = NULL;
+        }
+        updateFilter();
     }
     
     void setLogLevels( sgDebugClass c, sgDebugPriority p )
@@ -261,10 +330,28 @@ public:
         m_logPriority = p;
         m_logClass = c;
         m_stderrCallback->setLogLevels(c, p);
+        updateFilter();
+    }
+    
+    // only called while the logging thread is paused
+    void updateFilter()
+    {
+        for (int p = 0; p <= SG_ALERT; ++p) {
+            unsigned classes = SG_NONE;
+            BOOST_FOREACH(simgear::LogCallback* cb, m_callbacks) {
+                if (p >= cb->getLogPriority())
+                    classes |= cb->getLogClasses();
+            }
+            unsigned old = m_filter[p];
+            while (!m_filter[p].compareAndExchange(old, classes))
+                old = m_filter[p];
+        }
     }
     
     bool would_log( sgDebugClass c, sgDebugPriority p ) const
     {
+        if (p < SG_BULK || p > SG_ALERT) return false;
+        if ((c & m_filter[p]) == 0) return false;
         if (p >= SG_INFO) return true;
         return ((c & m_logClass) != 0 && p >= m_logPriority);
     }
@@ -272,8 +359,13 @@ public:
     void log( sgDebugClass c, sgDebugPriority p,
             const char* fileName, int line, const std::string& msg)
     {
-        LogEntry entry(c, p, fileName, line, msg);
-        m_entries.push(entry);
+        LogEntry* entry = new LogEntry(c, p, fileName, line, msg);
+        if (!m_entries.try_push(entry)) {
+            // the logging thread has fallen behind, don't wait for it
+            ++m_dropped;
+            delete entry;
+        }
+        wake();
     }
 };
 
@@ -350,13 +442,19 @@ sglog()
     static std::ios_base::Init initializer;
     
     // http://www.aristeia.com/Papers/DDJ_Jul_Aug_2004_revised.pdf
-    // in the absence of portable memory barrier ops in Simgear,
-    // let's keep this correct & safe
+    // The flag is read with a full memory barrier, so only the first calls
+    // need to take the lock.
+    static SGAtomic initialized;
+    if (initialized)
+        return *global_logstream;
+    
     static SGMutex m;
     SGGuard<SGMutex> g(m);
     
-    if( !global_logstream )
+    if( !global_logstream ) {
         global_logstream = new logstream();
+        ++initialized;
+    }
     return *global_logstream;
 }
 
@@ -366,3 +464,19 @@ logstream::logToFile( const SGPath& aPath, sgDebugClass c, sgDebugPriority p )
     global_privateLogstream->addCallback(new FileLogCallback(aPath.str(), c, p));
 }
 
+void
+logstream::logToRingBuffer( size_t bytes, sgDebugClass c, sgDebugPriority p )
+{
+    simgear::RingBufferLogCallback* cb =
+        new simgear::RingBufferLogCallback(bytes, c, p);
+    global_privateLogstream->addCallback(cb);
+    global_privateLogstream->m_ringBuffer = cb;
+}
+
+bool
+logstream::dumpRingBuffer( const char* path ) const
+{
+    simgear::RingBufferLogCallback* cb = global_privateLogstream->m_ringBuffer;
+    return cb && cb->dump(path);
+}
+
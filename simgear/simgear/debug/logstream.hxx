@@ -42,6 +42,27 @@ public:
     virtual ~LogCallback() {}
     virtual void operator()(sgDebugClass c, sgDebugPriority p, 
         const char* file, int line, const std::string& aMessage) = 0;
+
+    /**
+     * Set the messages this callback wants to receive. The logstream
+     * doesn't even format messages no callback wants.
+     */
+    void setLogLevels(sgDebugClass c, sgDebugPriority p);
+
+    sgDebugClass getLogClasses() const { return m_class; }
+    sgDebugPriority getLogPriority() const { return m_priority; }
+
+    bool shouldLog(sgDebugClass c, sgDebugPriority p) const
+    {
+        return (c & m_class) != 0 && p >= m_priority;
+    }
+
+protected:
+    LogCallback(sgDebugClass c = SG_ALL, sgDebugPriority p = SG_BULK);
+
+private:
+    sgDebugClass m_class;
+    sgDebugPriority m_priority;
 };
      
 } // of namespace simgear
@@ -64,6 +85,23 @@ public:
 
     void logToFile( const SGPath& aPath, sgDebugClass c, sgDebugPriority p );
 
+    /**
+     * Keep the most recent messages in a fixed-size binary ring buffer,
+     * for dumpRingBuffer() to write out after a crash.
+     *
+     * @param bytes Size of the buffer
+     */
+    void logToRingBuffer( size_t bytes, sgDebugClass c, sgDebugPriority p );
+
+    /**
+     * Write the messages kept by logToRingBuffer() as text to a file. Only
+     * uses async-signal-safe system calls, so this can be called from a
+     * signal handler.
+     *
+     * @return false if there is no ring buffer or the file can't be created
+     */
+    bool dumpRingBuffer( const char* path ) const;
+
     void set_log_priority( sgDebugPriority p);
     
     void set_log_classes( sgDebugClass c);
@@ -90,7 +128,9 @@ public:
     /**
      * register a logging callback. Note callbacks are run in a
      * dedicated thread, so callbacks which pass data to other threads
-     * must use appropriate locking.
+     * must use appropriate locking. Messages are handed to that thread
+     * through a lock-free queue. If it falls behind and the queue fills
+     * up, further messages are dropped, and the number dropped is logged.
      */
     void addCallback(simgear::LogCallback* cb);
      
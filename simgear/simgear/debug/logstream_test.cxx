@@ -0,0 +1,164 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "logstream.hxx"
+#include "RingBufferLogCallback.hxx"
+
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Callback remembering every message it receives
+class CollectingLogCallback : public simgear::LogCallback
+{
+public:
+    CollectingLogCallback(sgDebugClass c, sgDebugPriority p) :
+        simgear::LogCallback(c, p)
+    { }
+
+    virtual void operator()(sgDebugClass c, sgDebugPriority p,
+        const char* file, int line, const std::string& aMessage)
+    {
+        SGGuard<SGMutex> g(_lock);
+        _messages.push_back(aMessage);
+    }
+
+    SGMutex _lock;
+    std::vector<string> _messages;
+};
+
+std::vector<string> readLines(const char* path)
+{
+    std::vector<string> lines;
+    std::ifstream file(path);
+    string line;
+    while (std::getline(file, line))
+        lines.push_back(line);
+    return lines;
+}
+
+void testRingBuffer()
+{
+    const char* path = "test_logstream_dump.txt";
+    simgear::RingBufferLogCallback ring(1024, SG_ALL, SG_INFO);
+
+    ring(SG_NAVAID, SG_DEBUG, "file.cxx", 1, "filtered");
+    ring(SG_NAVAID, SG_INFO, "file.cxx", 2, "first");
+    ring(SG_AI, SG_WARN, "other.cxx", 3, "second");
+    COMPARE(ring.count(), 2u);
+
+    VERIFY(ring.dump(path));
+    std::vector<string> lines = readLines(path);
+    COMPARE(lines.size(), 2u);
+    COMPARE(lines[0], string("0 navaid:3:file.cxx:2:first"));
+    COMPARE(lines[1], string("1 ai:4:other.cxx:3:second"));
+
+    // long messages are truncated
+    ring(SG_AI, SG_INFO, "file.cxx", 4, string(2000, 'x'));
+    VERIFY(ring.dump(path));
+    lines = readLines(path);
+    COMPARE(lines.back().size(), string("2 ai:3:file.cxx:4:").size()
+            + simgear::RingBufferLogCallback::MAX_MESSAGE);
+
+    // the oldest records make room for new ones
+    for (int i = 0; i < 100; ++i)
+        ring(SG_AI, SG_INFO, "file.cxx", 5, "message");
+    VERIFY(ring.count() < 100);
+    VERIFY(ring.dump(path));
+    lines = readLines(path);
+    COMPARE(lines.size(), ring.count());
+    COMPARE(lines.back(), string("102 ai:3:file.cxx:5:message"));
+
+    std::remove(path);
+}
+
+// Logs count messages from its own thread
+class LoggingThread : public SGThread
+{
+public:
+    LoggingThread(int count) : _count(count) { }
+
+    virtual void run()
+    {
+        for (int i = 0; i < _count; ++i)
+            SG_LOG(SG_AI, SG_WARN, "thread message " << i);
+    }
+
+    int _count;
+};
+
+void testLogstream()
+{
+    const char* path = "test_logstream_crash.txt";
+    VERIFY(!sglog().dumpRingBuffer(path));
+
+    CollectingLogCallback* collector =
+        new CollectingLogCallback(sgDebugClass(SG_AI | SG_GENERAL), SG_WARN);
+    sglog().addCallback(collector);
+
+    // nothing below the collector or stderr levels gets formatted
+    VERIFY(sglog().would_log(SG_AI, SG_WARN));
+    VERIFY(!sglog().would_log(SG_AI, SG_INFO));
+    VERIFY(!sglog().would_log(SG_NAVAID, SG_WARN));
+
+    SG_LOG(SG_AI, SG_WARN, "wanted");
+    SG_LOG(SG_AI, SG_INFO, "unwanted");
+
+    std::vector<LoggingThread*> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(new LoggingThread(2000));
+        threads.back()->start();
+    }
+    for (int i = 0; i < 4; ++i) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    sglog().logToRingBuffer(64 * 1024, SG_ALL, SG_INFO);
+    VERIFY(sglog().would_log(SG_NAVAID, SG_INFO));
+    SG_LOG(SG_NAVAID, SG_INFO, "ring buffer only");
+
+    // removing a callback drains the queue first. Messages which didn't
+    // fit into the queue are dropped, but counted.
+    sglog().removeCallback(collector);
+    COMPARE(collector->_messages[0], string("wanted"));
+    unsigned received = 0, dropped = 0;
+    for (size_t i = 1; i < collector->_messages.size(); ++i) {
+        const string& msg = collector->_messages[i];
+        if (msg.find("thread message ") == 0)
+            ++received;
+        else if (msg.find(" log messages dropped") != string::npos)
+            dropped += atoi(msg.c_str());
+    }
+    COMPARE(received + dropped, 4u * 2000);
+    delete collector;
+
+    VERIFY(sglog().dumpRingBuffer(path));
+    std::vector<string> lines = readLines(path);
+    COMPARE(lines.size(), 1u);
+    VERIFY(lines[0].find(":ring buffer only") != string::npos);
+    std::remove(path);
+}
+
+int main(int argc, char* argv[])
+{
+    testRingBuffer();
+    testLogstream();
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
@@ -39,11 +39,15 @@
 #include <string>
 #include <iostream>
 #include <bitset>
+#include <algorithm>
 
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/math/SGGeometry.hxx>
 #include <simgear/structure/exception.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "lowlevel.hxx"
 #include "sg_binobj.hxx"
@@ -82,121 +86,187 @@ enum sgPropertyTypes {
 };
 
 
+// Holds a whole binary object in memory and reads it from front to back.
+// Reading past the end sets the error flag and returns zeros, so the
+// reader checks once per object instead of for each value.
 class sgSimpleBuffer {
 
 private:
 
-    char *ptr;
-    unsigned int size;
+    std::vector<char> data;
     size_t offset;
-public:
+    bool error;
 
-    sgSimpleBuffer( unsigned int s = 0) :
-        ptr(NULL),
-        size(0),
-        offset(0)
+    // Returns a pointer to the next n bytes, or 0 if there are not
+    // enough of them left
+    char* take( size_t n )
     {
-        resize(s);
+        if ( error || data.size() - offset < n ) {
+            error = true;
+            offset = data.size();
+            return NULL;
+        }
+        char* p = &data[0] + offset;
+        offset += n;
+        return p;
     }
 
-    ~sgSimpleBuffer()
+    template <class T>
+    T readValue()
     {
-        delete [] ptr;
+        T value = 0;
+        char* p = take( sizeof(T) );
+        if ( p ) {
+            memcpy( &value, p, sizeof(T) );
+            if ( sgIsBigEndian() )
+                sgEndianSwap( &value );
+        }
+        return value;
     }
 
-    unsigned int get_size() const { return size; }
-    char *get_ptr() const { return ptr; }
-    
-    void reset()
+public:
+
+    sgSimpleBuffer() :
+        offset(0),
+        error(false)
     {
-        offset = 0;
     }
-    
-    void resize( unsigned int s )
+
+    std::vector<char>& get_data() { return data; }
+    bool get_error() const { return error; }
+    bool at_end() const { return offset >= data.size(); }
+
+    void reset()
     {
-        if ( s > size ) {
-            if ( ptr != NULL ) {
-                delete [] ptr;
-            }
-          
-            if ( size == 0) {
-                size = 16;
-            }
-          
-            while ( size < s ) {
-              size = size << 1;
-            }
-            ptr = new char[size];
-        }
+        offset = 0;
+        error = false;
     }
-    
-    SGVec3d readVec3d()
+
+    char readChar()
     {
-        double* p = reinterpret_cast<double*>(ptr + offset);
-        
-        if ( sgIsBigEndian() ) {            
-            sgEndianSwap((uint64_t *) p + 0);
-            sgEndianSwap((uint64_t *) p + 1);
-            sgEndianSwap((uint64_t *) p + 2);
-        }
-        
-        offset += 3 * sizeof(double);
-        return SGVec3d(p);
+        char* p = take( 1 );
+        return p ? *p : 0;
     }
-    
-    float readFloat()
-    {
-        float* p = reinterpret_cast<float*>(ptr + offset);
-        if ( sgIsBigEndian() ) {            
-            sgEndianSwap((uint32_t *) p);
-        }
-        
-        offset += sizeof(float);
-        return *p;
+
+    uint16_t readUShort() { return readValue<uint16_t>(); }
+    int16_t readShort() { return (int16_t)readValue<uint16_t>(); }
+    uint32_t readUInt() { return readValue<uint32_t>(); }
+    int32_t readInt() { return (int32_t)readValue<uint32_t>(); }
+
+    // The next n bytes, to be decoded in place. Returns 0 if the
+    // buffer ends before.
+    char* readBytes( size_t n ) { return take( n ); }
+
+    void skip( size_t n ) { take( n ); }
+};
+
+// Decode arrays of little endian floats. Written as plain loops over
+// whole elements, which compilers turn into vector code.
+static void swap_floats(char* p, size_t count)
+{
+    if ( sgIsBigEndian() ) {
+        uint32_t* q = reinterpret_cast<uint32_t*>(p);
+        for ( size_t i = 0; i < count; ++i )
+            sgEndianSwap( q + i );
     }
-    
-    SGVec2f readVec2f()
-    {
-        float* p = reinterpret_cast<float*>(ptr + offset);
-        
-        if ( sgIsBigEndian() ) {            
-            sgEndianSwap((uint32_t *) p + 0);
-            sgEndianSwap((uint32_t *) p + 1);
+}
+
+template <class T, unsigned N>
+static void decode_floats(char* p, size_t nbytes, std::vector<T>& list)
+{
+    size_t count = nbytes / (N * sizeof(float));
+    swap_floats( p, count * N );
+    size_t base = list.size();
+    list.resize( base + count );
+    const float* src = reinterpret_cast<const float*>(p);
+    if ( reinterpret_cast<size_t>(p) % sizeof(float) ) {
+        // not aligned, copy the values out one by one
+        for ( size_t i = 0; i < count; ++i ) {
+            float v[N];
+            memcpy( v, p + i * N * sizeof(float), sizeof(v) );
+            for ( unsigned k = 0; k < N; ++k )
+                list[base + i][k] = v[k];
         }
-        
-        offset += 2 * sizeof(float);
-        return SGVec2f(p);
+        return;
     }
-    
-    SGVec3f readVec3f()
-    {
-        float* p = reinterpret_cast<float*>(ptr + offset);
-        
-        if ( sgIsBigEndian() ) {            
-            sgEndianSwap((uint32_t *) p + 0);
-            sgEndianSwap((uint32_t *) p + 1);
-            sgEndianSwap((uint32_t *) p + 2);
-        }
-        
-        offset += 3 * sizeof(float);
-        return SGVec3f(p);
+    for ( size_t i = 0; i < count; ++i )
+        for ( unsigned k = 0; k < N; ++k )
+            list[base + i][k] = src[i * N + k];
+}
+
+// Reads the whole file into memory, inflating it when it is compressed.
+// Returns false if the file cannot be opened, throws if it is broken.
+static bool read_file(const string& file, std::vector<char>& data,
+                      SGBinObjectStats& stats)
+{
+    SGTimeStamp start = SGTimeStamp::now();
+    FILE* fp = fopen( file.c_str(), "rb" );
+    if ( !fp )
+        return false;
+    std::vector<char> raw;
+    char chunk[65536];
+    size_t n;
+    while ( (n = fread( chunk, 1, sizeof(chunk), fp )) > 0 )
+        raw.insert( raw.end(), chunk, chunk + n );
+    bool ok = !ferror( fp );
+    fclose( fp );
+    stats.fileBytes += raw.size();
+    stats.readUSec += (SGTimeStamp::now() - start).toUSecs();
+    if ( !ok )
+        throw sg_io_exception("Error reading", sg_location(file));
+
+    start = SGTimeStamp::now();
+    if ( raw.size() < 18 || (unsigned char)raw[0] != 0x1f ||
+         (unsigned char)raw[1] != 0x8b ) {
+        // not compressed, gzread passes such files through as well
+        data.swap( raw );
+        stats.dataBytes += data.size();
+        stats.inflateUSec += (SGTimeStamp::now() - start).toUSecs();
+        return true;
     }
-    
-    SGVec4f readVec4f()
-    {
-        float* p = reinterpret_cast<float*>(ptr + offset);
-        
-        if ( sgIsBigEndian() ) {            
-            sgEndianSwap((uint32_t *) p + 0);
-            sgEndianSwap((uint32_t *) p + 1);
-            sgEndianSwap((uint32_t *) p + 2);
-            sgEndianSwap((uint32_t *) p + 3);
+
+    // The gzip trailer holds the size of the (last) member, good as a
+    // first guess for the output. Inflate in one go, not per value.
+    // A damaged file could claim anything there, so the guess is capped
+    // at a generous ratio and the buffer grows on demand beyond that.
+    size_t guess = (unsigned char)raw[raw.size() - 4]
+        | ((unsigned char)raw[raw.size() - 3] << 8)
+        | ((unsigned char)raw[raw.size() - 2] << 16)
+        | ((size_t)(unsigned char)raw[raw.size() - 1] << 24);
+    guess = std::min( guess, 16 * raw.size() );
+    data.resize( std::max(guess, raw.size()) + 1 );
+
+    z_stream zs;
+    memset( &zs, 0, sizeof(zs) );
+    if ( inflateInit2( &zs, 15 + 16 ) != Z_OK )
+        throw sg_io_exception("Error inflating", sg_location(file));
+    zs.next_in = reinterpret_cast<Bytef*>(&raw[0]);
+    zs.avail_in = raw.size();
+    size_t size = 0;
+    int ret = Z_OK;
+    while ( ret == Z_OK ) {
+        if ( size == data.size() )
+            data.resize( 2 * data.size() );
+        zs.next_out = reinterpret_cast<Bytef*>(&data[0] + size);
+        zs.avail_out = data.size() - size;
+        ret = inflate( &zs, Z_NO_FLUSH );
+        size = data.size() - zs.avail_out;
+        // concatenated gzip members follow each other, anything else
+        // after the end is ignored like gzread does
+        if ( ret == Z_STREAM_END && zs.avail_in >= 2 &&
+             zs.next_in[0] == 0x1f && zs.next_in[1] == 0x8b ) {
+            inflateReset( &zs );
+            ret = Z_OK;
         }
-        
-        offset += 4 * sizeof(float);
-        return SGVec4f(p);
     }
-};
+    inflateEnd( &zs );
+    data.resize( size );
+    stats.dataBytes += size;
+    stats.inflateUSec += (SGTimeStamp::now() - start).toUSecs();
+    if ( ret != Z_STREAM_END )
+        throw sg_io_exception("Error inflating", sg_location(file));
+    return true;
+}
 
 template <class T>
 static void read_indices(char* buffer, 
@@ -219,6 +289,11 @@ static void read_indices(char* buffer,
         }
     }
     
+    if (indexMask & SG_IDX_VERTICES) vertices.reserve(count);
+    if (indexMask & SG_IDX_NORMALS) normals.reserve(count);
+    if (indexMask & SG_IDX_COLORS) colors.reserve(count);
+    if (indexMask & SG_IDX_TEXCOORDS) texCoords.reserve(count);
+
     T* src = reinterpret_cast<T*>(buffer);
     for (int i=0; i<count; ++i) {
         if (indexMask & SG_IDX_VERTICES) vertices.push_back(*src++);
@@ -276,7 +351,7 @@ void write_indices(gzFile fp, unsigned char indexMask,
 
 
 // read object properties
-void SGBinObject::read_object( gzFile fp,
+void SGBinObject::read_object( sgSimpleBuffer& buf,
                          int obj_type,
                          int nproperties,
                          int nelements,
@@ -289,8 +364,8 @@ void SGBinObject::read_object( gzFile fp,
     unsigned int nbytes;
     unsigned char idx_mask;
     int j;
-    sgSimpleBuffer buf( 32768 );  // 32 Kb
     char material[256];
+    material[0] = '\0';
 
     // default values
     if ( obj_type == SG_POINTS ) {
@@ -300,12 +375,12 @@ void SGBinObject::read_object( gzFile fp,
     }
 
     for ( j = 0; j < nproperties; ++j ) {
-        char prop_type;
-        sgReadChar( fp, &prop_type );
-        sgReadUInt( fp, &nbytes );
-        buf.resize(nbytes);
-        char *ptr = buf.get_ptr();
-        sgReadBytes( fp, nbytes, ptr );
+        char prop_type = buf.readChar();
+        nbytes = buf.readUInt();
+        char *ptr = buf.readBytes( nbytes );
+        if ( !ptr ) {
+            break;
+        }
         if ( prop_type == SG_MATERIAL ) {
             if (nbytes > 255) {
                 nbytes = 255;
@@ -313,13 +388,13 @@ void SGBinObject::read_object( gzFile fp,
             strncpy( material, ptr, nbytes );
             material[nbytes] = '\0';
             // cout << "material type = " << material << endl;
-        } else if ( prop_type == SG_INDEX_TYPES ) {
+        } else if ( prop_type == SG_INDEX_TYPES && nbytes > 0 ) {
             idx_mask = ptr[0];
             //cout << std::hex << "index mask:" << idx_mask << std::dec << endl;
         }
     }
 
-    if ( sgReadError() ) {
+    if ( buf.get_error() ) {
         throw sg_exception("Error reading object properties");
     }
     
@@ -328,34 +403,35 @@ void SGBinObject::read_object( gzFile fp,
         throw sg_exception("object index mask has no bits set");
     }
     
+    vertices.reserve( vertices.size() + nelements );
+    normals.reserve( normals.size() + nelements );
+    colors.reserve( colors.size() + nelements );
+    texCoords.reserve( texCoords.size() + nelements );
+    materials.reserve( materials.size() + nelements );
     for ( j = 0; j < nelements; ++j ) {
-        sgReadUInt( fp, &nbytes );
-        if ( sgReadError() ) {
+        nbytes = buf.readUInt();
+        if ( buf.get_error() ) {
             throw sg_exception("Error reading element size");
         }
         
-        buf.resize( nbytes );
-        char *ptr = buf.get_ptr();
-        sgReadBytes( fp, nbytes, ptr );
-        
-        if ( sgReadError() ) {
+        char *ptr = buf.readBytes( nbytes );
+        if ( !ptr ) {
             throw sg_exception("Error reading element bytes");
         }
                 
-        int_list vs;
-        int_list ns;
-        int_list cs;
-        int_list tcs;
+        vertices.push_back( int_list() );
+        normals.push_back( int_list() );
+        colors.push_back( int_list() );
+        texCoords.push_back( int_list() );
         if (version >= 10) {
-            read_indices<uint32_t>(ptr, nbytes, idx_mask, vs, ns, cs, tcs);
+            read_indices<uint32_t>(ptr, nbytes, idx_mask, vertices.back(),
+                                   normals.back(), colors.back(),
+                                   texCoords.back());
         } else {
-            read_indices<uint16_t>(ptr, nbytes, idx_mask, vs, ns, cs, tcs);
+            read_indices<uint16_t>(ptr, nbytes, idx_mask, vertices.back(),
+                                   normals.back(), colors.back(),
+                                   texCoords.back());
         }
-
-        vertices.push_back( vs );
-        normals.push_back( ns );
-        colors.push_back( cs );
-        texCoords.push_back( tcs );
         materials.push_back( material );
     } // of element iteration
 }
@@ -363,11 +439,11 @@ void SGBinObject::read_object( gzFile fp,
 
 // read a binary file and populate the provided structures.
 bool SGBinObject::read_bin( const string& file ) {
-    SGVec3d p;
-    int i, k;
+    int i;
     size_t j;
     unsigned int nbytes;
-    sgSimpleBuffer buf( 32768 );  // 32 Kb
+    sgSimpleBuffer buf;
+    SGBinObjectStats stats;
 
     // zero out structures
     gbs_center = SGVec3d(0, 0, 0);
@@ -401,22 +477,24 @@ bool SGBinObject::read_bin( const string& file ) {
     fans_tc.clear();
     fan_materials.clear();
 
-    gzFile fp;
-    if ( (fp = gzopen( file.c_str(), "rb" )) == NULL ) {
+    // Read and inflate the whole file first, then decode it from memory.
+    // That keeps the pager threads out of zlib's per value overhead, and
+    // away from the global error flag of the low level read functions.
+    std::vector<char>& data = buf.get_data();
+    if ( !read_file( file, data, stats ) ) {
         string filegz = file + ".gz";
-        if ( (fp = gzopen( filegz.c_str(), "rb" )) == NULL ) {
+        data.clear();
+        if ( !read_file( filegz, data, stats ) ) {
             SG_LOG( SG_EVENT, SG_ALERT,
                "ERROR: opening " << file << " or " << filegz << " for reading!");
 
             throw sg_io_exception("Error opening for reading (and .gz)", sg_location(file));
         }
     }
-
-    sgClearReadError();
+    SGTimeStamp start = SGTimeStamp::now();
 
     // read headers
-    unsigned int header;
-    sgReadUInt( fp, &header );
+    unsigned int header = buf.readUInt();
     if ( ((header & 0xFF000000) >> 24) == 'S' &&
          ((header & 0x00FF0000) >> 16) == 'G' ) {
         // cout << "Good header" << endl;
@@ -424,14 +502,11 @@ bool SGBinObject::read_bin( const string& file ) {
         version = (header & 0x0000FFFF);
         // cout << "File version = " << version << endl;
     } else {
-        // close the file before we return
-        gzclose(fp);
         throw sg_io_exception("Bad BTG magic/version", sg_location(file));
     }
     
     // read creation time
-    unsigned int foo_calendar_time;
-    sgReadUInt( fp, &foo_calendar_time );
+    unsigned int foo_calendar_time = buf.readUInt();
 
 #if 0
     time_t calendar_time = foo_calendar_time;
@@ -444,49 +519,40 @@ bool SGBinObject::read_bin( const string& file ) {
     char time_str[256];
     strftime( time_str, 256, "%a %b %d %H:%M:%S %Z %Y", local_tm);
     SG_LOG( SG_EVENT, SG_DEBUG, "File created on " << time_str);
+#else
+    (void)foo_calendar_time;
 #endif
 
     // read number of top level objects
     int nobjects;
     if ( version >= 10) { // version 10 extends everything to be 32-bit
-        sgReadInt( fp, &nobjects );
+        nobjects = buf.readInt();
     } else if ( version >= 7 ) {
-        uint16_t v;
-        sgReadUShort( fp, &v );
-        nobjects = v;
+        nobjects = buf.readUShort();
     } else {
-        int16_t v;
-        sgReadShort( fp, &v );
-        nobjects = v;
+        nobjects = buf.readShort();
     }
      
      //cout << "Total objects to read = " << nobjects << endl;
 
-    if ( sgReadError() ) {
+    if ( buf.get_error() ) {
         throw sg_io_exception("Error reading BTG file header", sg_location(file));
     }
     
     // read in objects
     for ( i = 0; i < nobjects; ++i ) {
         // read object header
-        char obj_type;
+        char obj_type = buf.readChar();
         uint32_t nproperties, nelements;
-        sgReadChar( fp, &obj_type );
         if ( version >= 10 ) {
-            sgReadUInt( fp, &nproperties );
-            sgReadUInt( fp, &nelements );
+            nproperties = buf.readUInt();
+            nelements = buf.readUInt();
         } else if ( version >= 7 ) {
-            uint16_t v;
-            sgReadUShort( fp, &v );
-            nproperties = v;
-            sgReadUShort( fp, &v );
-            nelements = v;
+            nproperties = buf.readUShort();
+            nelements = buf.readUShort();
         } else {
-            int16_t v;
-            sgReadShort( fp, &v );
-            nproperties = v;
-            sgReadShort( fp, &v );
-            nelements = v;
+            nproperties = buf.readShort();
+            nelements = buf.readShort();
         }
 
          //cout << "object " << i << " = " << (int)obj_type << " props = "
@@ -494,131 +560,118 @@ bool SGBinObject::read_bin( const string& file ) {
             
         if ( obj_type == SG_BOUNDING_SPHERE ) {
             // read bounding sphere properties
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
             
             // read bounding sphere elements
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
-                buf.resize( nbytes );
-                buf.reset();
-                char *ptr = buf.get_ptr();
-                sgReadBytes( fp, nbytes, ptr );
-                gbs_center = buf.readVec3d();
-                gbs_radius = buf.readFloat();
+                nbytes = buf.readUInt();
+                char *ptr = buf.readBytes( nbytes );
+                if ( !ptr || nbytes < 3 * sizeof(double) + sizeof(float) )
+                    continue;
+                double center[3];
+                float radius;
+                memcpy( center, ptr, sizeof(center) );
+                memcpy( &radius, ptr + sizeof(center), sizeof(radius) );
+                if ( sgIsBigEndian() ) {
+                    for ( int k = 0; k < 3; ++k )
+                        sgEndianSwap( reinterpret_cast<uint64_t*>(center + k) );
+                    sgEndianSwap( reinterpret_cast<uint32_t*>(&radius) );
+                }
+                gbs_center = SGVec3d(center);
+                gbs_radius = radius;
             }
         } else if ( obj_type == SG_VERTEX_LIST ) {
             // read vertex list properties
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
 
-            // read vertex list elements
+            // read vertex list elements, extend from float to double
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
-                buf.resize( nbytes );
-                buf.reset();
-                char *ptr = buf.get_ptr();
-                sgReadBytes( fp, nbytes, ptr );
-                int count = nbytes / (sizeof(float) * 3);
-                wgs84_nodes.reserve( count );
-                for ( k = 0; k < count; ++k ) {
-                    SGVec3f v = buf.readVec3f();
-                // extend from float to double, hmmm
-                    wgs84_nodes.push_back( SGVec3d(v[0], v[1], v[2]) );
-                }
+                nbytes = buf.readUInt();
+                char *ptr = buf.readBytes( nbytes );
+                if ( ptr )
+                    decode_floats<SGVec3d, 3>( ptr, nbytes, wgs84_nodes );
             }
         } else if ( obj_type == SG_COLOR_LIST ) {
             // read color list properties
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
 
             // read color list elements
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
-                buf.resize( nbytes );
-                buf.reset();
-                char *ptr = buf.get_ptr();
-                sgReadBytes( fp, nbytes, ptr );
-                int count = nbytes / (sizeof(float) * 4);
-                colors.reserve(count);
-                for ( k = 0; k < count; ++k ) {
-                    colors.push_back( buf.readVec4f() );
-                }
+                nbytes = buf.readUInt();
+                char *ptr = buf.readBytes( nbytes );
+                if ( ptr )
+                    decode_floats<SGVec4f, 4>( ptr, nbytes, colors );
             }
         } else if ( obj_type == SG_NORMAL_LIST ) {
             // read normal list properties
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
 
             // read normal list elements
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
-                buf.resize( nbytes );
-                buf.reset();
-                unsigned char *ptr = (unsigned char *)(buf.get_ptr());
-                sgReadBytes( fp, nbytes, ptr );
+                nbytes = buf.readUInt();
+                unsigned char *ptr = (unsigned char *)buf.readBytes( nbytes );
+                if ( !ptr )
+                    continue;
                 int count = nbytes / 3;
-                normals.reserve( count );
+                size_t base = normals.size();
+                normals.resize( base + count );
  
-                for ( k = 0; k < count; ++k ) {
+                for ( int k = 0; k < count; ++k ) {
                     SGVec3f normal( (ptr[0]) / 127.5 - 1.0,
                                     (ptr[1]) / 127.5 - 1.0, 
                                     (ptr[2]) / 127.5 - 1.0);
-                    normals.push_back(normalize(normal));
+                    normals[base + k] = normalize(normal);
                     ptr += 3;
                 }
             }
         } else if ( obj_type == SG_TEXCOORD_LIST ) {
             // read texcoord list properties
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
 
             // read texcoord list elements
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
-                buf.resize( nbytes );
-                buf.reset();
-                char *ptr = buf.get_ptr();
-                sgReadBytes( fp, nbytes, ptr );
-                int count = nbytes / (sizeof(float) * 2);
-                texcoords.reserve(count);
-                for ( k = 0; k < count; ++k ) {
-                    texcoords.push_back( buf.readVec2f() );
-                }
+                nbytes = buf.readUInt();
+                char *ptr = buf.readBytes( nbytes );
+                if ( ptr )
+                    decode_floats<SGVec2f, 2>( ptr, nbytes, texcoords );
             }
         } else if ( obj_type == SG_POINTS ) {
             // read point elements
-            read_object( fp, SG_POINTS, nproperties, nelements,
+            read_object( buf, SG_POINTS, nproperties, nelements,
                          pts_v, pts_n, pts_c, pts_tc, pt_materials );
         } else if ( obj_type == SG_TRIANGLE_FACES ) {
             // read triangle face properties
-            read_object( fp, SG_TRIANGLE_FACES, nproperties, nelements,
+            read_object( buf, SG_TRIANGLE_FACES, nproperties, nelements,
                          tris_v, tris_n, tris_c, tris_tc, tri_materials );
         } else if ( obj_type == SG_TRIANGLE_STRIPS ) {
             // read triangle strip properties
-            read_object( fp, SG_TRIANGLE_STRIPS, nproperties, nelements,
+            read_object( buf, SG_TRIANGLE_STRIPS, nproperties, nelements,
                          strips_v, strips_n, strips_c, strips_tc,
                          strip_materials );
         } else if ( obj_type == SG_TRIANGLE_FANS ) {
             // read triangle fan properties
-            read_object( fp, SG_TRIANGLE_FANS, nproperties, nelements,
+            read_object( buf, SG_TRIANGLE_FANS, nproperties, nelements,
                          fans_v, fans_n, fans_c, fans_tc, fan_materials );
         } else {
             // unknown object type, just skip
-            read_properties( fp, nproperties );
+            read_properties( buf, nproperties );
 
             // read elements
             for ( j = 0; j < nelements; ++j ) {
-                sgReadUInt( fp, &nbytes );
+                nbytes = buf.readUInt();
                 // cout << "element size = " << nbytes << endl;
-                if ( nbytes > buf.get_size() ) { buf.resize( nbytes ); }
-                char *ptr = buf.get_ptr();
-                sgReadBytes( fp, nbytes, ptr );
+                buf.skip( nbytes );
             }
         }
         
-        if ( sgReadError() ) {
+        if ( buf.get_error() ) {
             throw sg_io_exception("Error while reading object", sg_location(file, i));
         }
     }
 
-    // close the file
-    gzclose(fp);
+    stats.files = 1;
+    stats.decodeUSec = (SGTimeStamp::now() - start).toUSecs();
+    add_load_stats( stats );
 
     return true;
 }
@@ -1044,20 +1097,47 @@ bool SGBinObject::write_ascii( const string& base, const string& name,
     return (err == 0);
 }
 
-void SGBinObject::read_properties(gzFile fp, int nproperties)
+void SGBinObject::read_properties(sgSimpleBuffer& buf, int nproperties)
 {
-    sgSimpleBuffer buf;
-    uint32_t nbytes;
-    
     // read properties
     for ( int j = 0; j < nproperties; ++j ) {
-        char prop_type;
-        sgReadChar( fp, &prop_type );
-        sgReadUInt( fp, &nbytes );
+        buf.readChar();
+        uint32_t nbytes = buf.readUInt();
         // cout << "property size = " << nbytes << endl;
-        if ( nbytes > buf.get_size() ) { buf.resize( nbytes ); }
-        char *ptr = buf.get_ptr();
-        sgReadBytes( fp, nbytes, ptr );
+        buf.skip( nbytes );
     }
 }
 
+namespace {
+SGMutex statsMutex;
+SGBinObjectStats loadStats;
+}
+
+SGBinObjectStats::SGBinObjectStats() :
+    files(0),
+    fileBytes(0),
+    dataBytes(0),
+    readUSec(0),
+    inflateUSec(0),
+    decodeUSec(0),
+    buildUSec(0)
+{
+}
+
+SGBinObjectStats SGBinObject::get_load_stats()
+{
+    SGGuard<SGMutex> lock(statsMutex);
+    return loadStats;
+}
+
+void SGBinObject::add_load_stats(const SGBinObjectStats& stats)
+{
+    SGGuard<SGMutex> lock(statsMutex);
+    loadStats.files += stats.files;
+    loadStats.fileBytes += stats.fileBytes;
+    loadStats.dataBytes += stats.dataBytes;
+    loadStats.readUSec += stats.readUSec;
+    loadStats.inflateUSec += stats.inflateUSec;
+    loadStats.decodeUSec += stats.decodeUSec;
+    loadStats.buildUSec += stats.buildUSec;
+}
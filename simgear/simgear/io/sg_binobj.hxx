@@ -45,6 +45,24 @@ typedef group_list::const_iterator const_group_list_iterator;
 // forward decls
 class SGBucket;
 class SGPath;
+class sgSimpleBuffer;
+
+/**
+ * Time spent in the stages of loading binary objects, summed up over all
+ * files and threads.  The build stage is filled in by the scenery code
+ * turning the objects into scene graph.
+ */
+struct SGBinObjectStats {
+    SGBinObjectStats();
+
+    unsigned files;
+    double fileBytes;           // bytes read from disk
+    double dataBytes;           // bytes after inflating
+    double readUSec;
+    double inflateUSec;
+    double decodeUSec;
+    double buildUSec;
+};
 
 /**
  * A class to manipulate the simgear 3d object format.
@@ -115,9 +133,9 @@ private:
     group_list fans_tc;		// fans texture coordinate index
     string_list fan_materials;	// fans materials
 
-    void read_properties(gzFile fp, int nproperties);
+    void read_properties(sgSimpleBuffer& buf, int nproperties);
     
-    void read_object( gzFile fp,
+    void read_object( sgSimpleBuffer& buf,
                              int obj_type,
                              int nproperties,
                              int nelements,
@@ -210,6 +228,12 @@ public:
      */
     bool read_bin( const std::string& file );
 
+    /**
+     * The stages of all files read so far. Safe to call from any thread.
+     */
+    static SGBinObjectStats get_load_stats();
+    static void add_load_stats( const SGBinObjectStats& stats );
+
     /** 
      * Write out the structures to a binary file.  We assume that the
      * groups come to us sorted by material property.  If not, things
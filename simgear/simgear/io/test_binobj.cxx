@@ -14,6 +14,8 @@
 #endif
 
 #include <simgear/misc/sg_dir.hxx>
+#include <simgear/structure/exception.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include "sg_binobj.hxx"
 
@@ -324,6 +326,88 @@ void test_many_objects()
     compareTris(basic, rd);
 }
 
+// Reads the same file as the main thread, for loading tiles in several
+// pager threads at once
+class ReadThread : public SGThread
+{
+public:
+    ReadThread(const SGPath& path) : _path(path) { }
+
+    virtual void run()
+    {
+        _rd.read_bin(_path.str());
+    }
+
+    SGPath _path;
+    SGBinObject _rd;
+};
+
+void test_threads()
+{
+    SGBinObject basic;
+    SGPath path(simgear::Dir::current().file("threads.btg.gz"));
+
+    std::vector<SGVec3d> points;
+    generate_points(2000, points);
+    std::vector<SGVec3f> normals;
+    generate_normals(1024, normals);
+    std::vector<SGVec2f> texCoords;
+    generate_tcs(2000, texCoords);
+
+    basic.set_wgs84_nodes(points);
+    basic.set_normals(normals);
+    basic.set_texcoords(texCoords);
+    generate_tris(basic, 2000);
+
+    bool ok = basic.write_bin_file(path);
+    VERIFY( ok );
+
+    SGBinObjectStats before = SGBinObject::get_load_stats();
+    std::vector<ReadThread*> threads;
+    for (int i=0; i<4; ++i) {
+        threads.push_back(new ReadThread(path));
+        threads.back()->start();
+    }
+    for (int i=0; i<4; ++i) {
+        threads[i]->join();
+        const SGBinObject& rd = threads[i]->_rd;
+        COMPARE(rd.get_wgs84_nodes().size(), points.size());
+        COMPARE(rd.get_normals().size(), normals.size());
+        comparePoints(rd, points);
+        compareTexCoords(rd, texCoords);
+        compareTris(basic, rd);
+        delete threads[i];
+    }
+
+    SGBinObjectStats stats = SGBinObject::get_load_stats();
+    COMPARE(stats.files, before.files + 4);
+    VERIFY(stats.dataBytes > stats.fileBytes);
+}
+
+// A file cut short fails with an exception, not with garbage
+void test_truncated()
+{
+    SGPath path(simgear::Dir::current().file("threads.btg.gz"));
+    SGPath cut(simgear::Dir::current().file("truncated.btg.gz"));
+    FILE* in = fopen(path.c_str(), "rb");
+    FILE* out = fopen(cut.c_str(), "wb");
+    VERIFY(in && out);
+    char buffer[4096];
+    size_t n = fread(buffer, 1, sizeof(buffer), in);
+    fwrite(buffer, 1, n, out);
+    fclose(in);
+    fclose(out);
+
+    SGBinObject rd;
+    bool thrown = false;
+    try {
+        rd.read_bin(cut.str());
+    } catch (sg_exception&) {
+        thrown = true;
+    }
+    VERIFY(thrown);
+}
+
 int main(int argc, char* argv[])
 {
     test_empty();
@@ -332,6 +416,8 @@ int main(int argc, char* argv[])
     test_big();
     test_some_objects();
     test_many_objects();
+    test_threads();
+    test_truncated();
     
     return 0;
 }
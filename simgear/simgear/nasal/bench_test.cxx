@@ -0,0 +1,167 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "nasal.h"
+
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Micro-benchmarks of the interpreter, each returning a value which
+// is checked so the results stay the same whatever the VM does.
+static const char* script =
+    "var Point = {\n"
+    "    new: func(x, y) { return { parents: [Point], x: x, y: y }; },\n"
+    "    norm2: func { return me.x * me.x + me.y * me.y; }\n"
+    "};\n"
+    "var add = func(a, b) { return a + b; };\n"
+    "\n"
+    "var arithmetic = func(n) {\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        sum += i * 2 - 1 + i / 4;\n"
+    "    return sum;\n"
+    "}\n"
+    "var constants = func(n) {\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        sum += 60 * 60 * 24 / 1024 + (2 - 3) * -1.5;\n"
+    "    return sum;\n"
+    "}\n"
+    "var fields = func(n) {\n"
+    "    var p = Point.new(3, 4);\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        sum += p.x + p.y;\n"
+    "    return sum;\n"
+    "}\n"
+    "var methods = func(n) {\n"
+    "    var p = Point.new(3, 4);\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        sum += p.norm2();\n"
+    "    return sum;\n"
+    "}\n"
+    "var calls = func(n) {\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        sum = add(sum, 1);\n"
+    "    return sum;\n"
+    "}\n"
+    "var containers = func(n) {\n"
+    "    var v = [];\n"
+    "    var h = {};\n"
+    "    for (var i = 0; i < n; i += 1) {\n"
+    "        append(v, i);\n"
+    "        h[i] = v[i];\n"
+    "    }\n"
+    "    var sum = 0;\n"
+    "    foreach (var x; v) sum += h[x];\n"
+    "    return sum;\n"
+    "}\n"
+    "var strings = func(n) {\n"
+    "    var count = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        count += size(\"id\" ~ i ~ \"/\" ~ (i + 1));\n"
+    "    return count;\n"
+    "}\n"
+    "var branches = func(n) {\n"
+    "    var count = 0;\n"
+    "    for (var i = 0; i < n; i += 1) {\n"
+    "        if (i > 10 and i <= 20 or i == 5) count += 1;\n"
+    "        elsif (i >= n - 1) count += 2;\n"
+    "        count += i < 3 ? 1 : 0;\n"
+    "    }\n"
+    "    return count;\n"
+    "}\n"
+    "\n"
+    "# Things the compiler must not change\n"
+    "var semantics = func {\n"
+    "    var s = \"3\";\n"
+    "    if (s + 1 != 4 or 1 - s != -2 or s * 2 != 6) return 0;\n"
+    "    if (1 / 0 != 2 / 0 or -(1 / 0) != -1 / 0) return 0;\n"
+    "    if (2 * 3 + 4 != 10 or (1 < 2) != 1 or 3 / 2 != 1.5) return 0;\n"
+    "    if (call(func { \"x\" + 1 }, [], nil, nil, var err = []) != nil)\n"
+    "        return 0;\n"
+    "    if (size(err) != 3 or err[2] != 72) return 0;\n"
+    "    var h = { a: { b: 2 } };\n"
+    "    return h.a.b == 2 and Point.new(1, 2).norm2() == 5;\n"
+    "}\n";
+
+struct Benchmark {
+    const char* name;
+    int iterations;
+    double result;
+};
+
+static naRef call(naContext ctx, naRef ns, const char* name,
+                  int argc = 0, naRef* args = 0)
+{
+    naRef func = naHash_cget(ns, const_cast<char*>(name));
+    naRef result = naCall(ctx, func, argc, args, naNil(), naNil());
+    if (naGetError(ctx)) {
+        cerr << "** FAILED: " << name << ": " << naGetError(ctx) << endl;
+        exit(1);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    naContext ctx = naNewContext();
+    naRef ns = naInit_std(ctx);
+    naSave(ctx, ns);
+
+    int errLine = 0;
+    naRef file = naStr_fromdata(naNewString(ctx), const_cast<char*>("bench_test"), 10);
+    naRef code = naParseCode(ctx, file, 1, const_cast<char*>(script),
+                             strlen(script), &errLine);
+    if (naIsNil(code)) {
+        cerr << "** FAILED: line " << errLine << ": " << naGetError(ctx) << endl;
+        return EXIT_FAILURE;
+    }
+    naCall(ctx, naBindFunction(ctx, code, ns), 0, 0, naNil(), ns);
+    VERIFY(!naGetError(ctx));
+
+    COMPARE(naNumValue(call(ctx, ns, "semantics")).num, 1.0);
+
+    const int n = 100000;
+    Benchmark benchmarks[] = {
+        { "arithmetic", n, 11249787500.0 },
+        { "constants", n, 85.875 * n },
+        { "fields", n, 7.0 * n },
+        { "methods", n, 25.0 * n },
+        { "calls", n, n },
+        { "containers", n, (n - 1) * (n / 2.0) },
+        { "strings", n / 10, 107784.0 },
+        { "branches", n, 16.0 }
+    };
+
+    double total = 0;
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+        const Benchmark& b = benchmarks[i];
+        naRef args[1] = { naNum(b.iterations) };
+        SGTimeStamp start = SGTimeStamp::now();
+        COMPARE(naNumValue(call(ctx, ns, b.name, 1, args)).num, b.result);
+        double usec = (SGTimeStamp::now() - start).toUSecs();
+        total += usec;
+        cout << b.name << ": " << 1000 * usec / b.iterations
+             << " nsec per iteration" << endl;
+    }
+    cout << "total: " << total / 1000 << " msec" << endl;
+
+    naFreeContext(ctx);
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
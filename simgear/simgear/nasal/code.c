@@ -137,12 +137,10 @@ static void initTemps(naContext c)
     c->ntemps = 0;
 }
 
+// Free contexts keep their cached objects, see OBJ_CACHE_SZ
 static void initContext(naContext c)
 {
-    int i;
     c->fTop = c->opTop = c->markTop = 0;
-    for(i=0; i<NUM_NASAL_TYPES; i++)
-        c->nfree[i] = 0;
 
     if(c->tempsz > 32) {
         naFree(c->temps);
@@ -167,6 +165,8 @@ static void initGlobals()
     globals->lock = naNewLock();
 
     globals->allocCount = 256; // reasonable starting value
+    globals->gcIncremental = 1;
+    globals->memberEpoch = 1;
     for(i=0; i<NUM_NASAL_TYPES; i++)
         naGC_init(&(globals->pools[i]), i);
     globals->deadsz = 256;
@@ -191,6 +191,7 @@ static void initGlobals()
 
 naContext naNewContext()
 {
+    int i;
     naContext c;
     if(globals == 0)
         initGlobals();
@@ -205,6 +206,10 @@ naContext naNewContext()
     } else {
         UNLOCK();
         c = (naContext)naAlloc(sizeof(struct Context));
+        for(i=0; i<NUM_NASAL_TYPES; i++) {
+            c->nfree[i] = 0;
+            c->cachesz[i] = 1;
+        }
         initTemps(c);
         initContext(c);
         LOCK();
@@ -438,7 +443,11 @@ static const char* ghostGetMember(naContext ctx, naRef obj, naRef field, naRef*
 // indicate success, or a non-empty error message.  Works this way so
 // we can generate smart error messages without throwing them with a
 // longjmp -- this gets called under naMember_get() from C code.
-static const char* getMember_r(naContext ctx, naRef obj, naRef field, naRef* out, int count)
+// Vectors and hashes walked through "parents" get flagged, so that
+// changing them invalidates the member caches.  The result can only
+// be cached if all of them were hashes.
+static const char* getMember_r(naContext ctx, naRef obj, naRef field,
+                               naRef* out, int count, int* cacheable)
 {
     int i;
     naRef p;
@@ -446,32 +455,95 @@ static const char* getMember_r(naContext ctx, naRef obj, naRef field, naRef* out
     if(--count < 0) return "too many parents";
 
     if (IS_GHOST(obj)) {
+        *cacheable = 0;
         if (ghostGetMember(ctx, obj, field, out)) return "";
         if(!ghostGetMember(ctx, obj, globals->parentsRef, &p)) return 0;
     } else if (IS_HASH(obj)) {
         if(naHash_get(obj, field, out)) return "";
         if(!naHash_get(obj, globals->parentsRef, &p)) return 0;
     } else if (IS_STR(obj) ) {
-        return getMember_r(ctx, getStringMethods(ctx), field, out, count);
+        *cacheable = 0;
+        return getMember_r(ctx, getStringMethods(ctx), field, out, count,
+                           cacheable);
     } else {
         return "non-objects have no members";
     }
     
     if(!IS_VEC(p)) return "object \"parents\" field not vector";
+    PTR(p).vec->proto = 1;
     pv = PTR(p).vec->rec;
     for(i=0; pv && i<pv->size; i++) {
-        const char* err = getMember_r(ctx, pv->array[i], field, out, count);
+        const char* err;
+        if(IS_HASH(pv->array[i])) PTR(pv->array[i]).hash->proto = 1;
+        err = getMember_r(ctx, pv->array[i], field, out, count, cacheable);
         if(err) return err; /* either an error or success */
     }
     return 0;
 }
 
-static void getMember(naContext ctx, naRef obj, naRef fld,
-                      naRef* result, int count)
+void naiProtoChanged()
+{
+    // Epoch 0 marks empty caches, so skip it when wrapping around
+    if(++globals->memberEpoch == 0)
+        globals->memberEpoch = 1;
+}
+
+// True if two parents vectors hold the same objects
+static int sameParents(naRef a, naRef b)
+{
+    int i;
+    struct VecRec *ra, *rb;
+    if(IDENTICAL(a, b)) return 1;
+    if(!IS_VEC(a) || !IS_VEC(b)) return 0;
+    ra = PTR(a).vec->rec;
+    rb = PTR(b).vec->rec;
+    if(!ra || !rb || ra->size != rb->size) return 0;
+    for(i=0; i<ra->size; i++)
+        if(!IDENTICAL(ra->array[i], rb->array[i])) return 0;
+    return 1;
+}
+
+// Member lookup for OP_MEMBER.  The receiver's own fields are always
+// looked up, but what was found through its parents is remembered in
+// the instruction's cache (if any), and reused for any receiver with
+// the same parents until one of the vectors or hashes walked changes.
+// Caches are shared by everything running the code, and aren't
+// updated atomically, so they are only used while a single thread
+// runs Nasal.  The thread count is read without the lock: it only
+// changes when a thread starts or stops running Nasal, and a thread
+// always sees its own count, so two running threads can never both
+// find themselves alone.
+static void getMember(naContext ctx, struct naCode* cd, int cache,
+                      naRef obj, naRef fld, naRef* result)
 {
-    const char* err = getMember_r(ctx, obj, fld, result, count);
+    struct MemberCache* mc = cache < cd->nCaches && globals->nThreads <= 1
+                           ? &cd->caches[cache] : 0;
+    int cacheable = mc && IS_HASH(obj);
+    const char* err;
+    naRef p;
+
+    if(cacheable) {
+        if(naHash_get(obj, fld, result)) return;
+        if(mc->epoch == globals->memberEpoch
+           && naHash_get(obj, globals->parentsRef, &p)
+           && sameParents(p, mc->parents)) {
+            *result = mc->value;
+            return;
+        }
+    }
+
+    err = getMember_r(ctx, obj, fld, result, 64, &cacheable);
     if(!err)   naRuntimeError(ctx, "No such member: %s", naStr_data(fld));
     if(err[0]) naRuntimeError(ctx, err);
+
+    if(cacheable && naHash_get(obj, globals->parentsRef, &p)) {
+        // Invalidate first, another thread might be using the entry
+        mc->epoch = 0;
+        mc->parents = p;
+        mc->value = *result;
+        mc->epoch = globals->memberEpoch;
+        GC_BARRIER(cd);
+    }
 }
 
 static void setMember(naContext ctx, naRef obj, naRef fld, naRef value)
@@ -491,7 +563,8 @@ static void setMember(naContext ctx, naRef obj, naRef fld, naRef value)
 
 int naMember_get(naContext ctx, naRef obj, naRef field, naRef* out)
 {
-    const char* err = getMember_r(ctx, obj, field, out, 64);
+    int cacheable;
+    const char* err = getMember_r(ctx, obj, field, out, 64, &cacheable);
     return err && !err[0];
 }
 
@@ -553,12 +626,72 @@ static void evalSlice2(naContext ctx, naRef src, naRef dst,
 #define STK(n) (ctx->opStack[ctx->opTop-(n)])
 #define SETFRAME(F) f = (F); cd = PTR(PTR(f->func).func->code).code;
 #define FIXFRAME() SETFRAME(&(ctx->fStack[ctx->fTop-1]))
+
+// With GCC, every instruction jumps straight to the next one through
+// a table of label addresses ("threaded" dispatch), which the branch
+// predictor copes with much better than a single switch.
+#if defined(__GNUC__)
+# define THREADED_DISPATCH
+#endif
+
+#ifdef THREADED_DISPATCH
+# define SWITCH(op) goto *labels[op];
+# define CASE(op) L_##op
+# define NEXT() do { \
+    ctx->ntemps = 0; /* reset GC temp vector */  \
+    DBG(printStackDEBUG(ctx));                   \
+    op = BYTECODE(cd)[f->ip++];                  \
+    DBG(printf("Stack Depth: %d\n", ctx->opTop)); \
+    DBG(printOpDEBUG(f->ip-1, op));              \
+    goto *labels[op]; } while(0)
+#else
+# define SWITCH(op) switch(op)
+# define CASE(op) case op
+# define NEXT() break
+#endif
+
 static naRef run(naContext ctx)
 {
     struct Frame* f;
     struct naCode* cd;
     int op, arg;
     naRef a, b;
+#ifdef THREADED_DISPATCH
+    static void* labels[] = {
+        [OP_NOT] = &&L_OP_NOT, [OP_MUL] = &&L_OP_MUL,
+        [OP_PLUS] = &&L_OP_PLUS, [OP_MINUS] = &&L_OP_MINUS,
+        [OP_DIV] = &&L_OP_DIV, [OP_NEG] = &&L_OP_NEG,
+        [OP_CAT] = &&L_OP_CAT, [OP_LT] = &&L_OP_LT, [OP_LTE] = &&L_OP_LTE,
+        [OP_GT] = &&L_OP_GT, [OP_GTE] = &&L_OP_GTE, [OP_EQ] = &&L_OP_EQ,
+        [OP_NEQ] = &&L_OP_NEQ, [OP_EACH] = &&L_OP_EACH,
+        [OP_JMP] = &&L_OP_JMP, [OP_JMPLOOP] = &&L_OP_JMPLOOP,
+        [OP_JIFNOTPOP] = &&L_OP_JIFNOTPOP, [OP_JIFEND] = &&L_OP_JIFEND,
+        [OP_FCALL] = &&L_OP_FCALL, [OP_MCALL] = &&L_OP_MCALL,
+        [OP_RETURN] = &&L_OP_RETURN, [OP_PUSHCONST] = &&L_OP_PUSHCONST,
+        [OP_PUSHONE] = &&L_OP_PUSHONE, [OP_PUSHZERO] = &&L_OP_PUSHZERO,
+        [OP_PUSHNIL] = &&L_OP_PUSHNIL, [OP_POP] = &&L_OP_POP,
+        [OP_DUP] = &&L_OP_DUP, [OP_XCHG] = &&L_OP_XCHG,
+        [OP_INSERT] = &&L_OP_INSERT, [OP_EXTRACT] = &&L_OP_EXTRACT,
+        [OP_MEMBER] = &&L_OP_MEMBER, [OP_SETMEMBER] = &&L_OP_SETMEMBER,
+        [OP_LOCAL] = &&L_OP_LOCAL, [OP_SETLOCAL] = &&L_OP_SETLOCAL,
+        [OP_NEWVEC] = &&L_OP_NEWVEC, [OP_VAPPEND] = &&L_OP_VAPPEND,
+        [OP_NEWHASH] = &&L_OP_NEWHASH, [OP_HAPPEND] = &&L_OP_HAPPEND,
+        [OP_MARK] = &&L_OP_MARK, [OP_UNMARK] = &&L_OP_UNMARK,
+        [OP_BREAK] = &&L_OP_BREAK, [OP_SETSYM] = &&L_OP_SETSYM,
+        [OP_DUP2] = &&L_OP_DUP2, [OP_INDEX] = &&L_OP_INDEX,
+        [OP_BREAK2] = &&L_OP_BREAK2, [OP_PUSHEND] = &&L_OP_PUSHEND,
+        [OP_JIFTRUE] = &&L_OP_JIFTRUE, [OP_JIFNOT] = &&L_OP_JIFNOT,
+        [OP_FCALLH] = &&L_OP_FCALLH, [OP_MCALLH] = &&L_OP_MCALLH,
+        [OP_XCHG2] = &&L_OP_XCHG2, [OP_UNPACK] = &&L_OP_UNPACK,
+        [OP_SLICE] = &&L_OP_SLICE, [OP_SLICE2] = &&L_OP_SLICE2,
+        [OP_LMEMBER] = &&L_OP_LMEMBER, [OP_DMEMBER] = &&L_OP_DMEMBER,
+        [OP_LMETHOD] = &&L_OP_LMETHOD, [OP_PLUSK] = &&L_OP_PLUSK,
+        [OP_MINUSK] = &&L_OP_MINUSK, [OP_MULK] = &&L_OP_MULK,
+        [OP_DIVK] = &&L_OP_DIVK, [OP_LTK] = &&L_OP_LTK,
+        [OP_LTEK] = &&L_OP_LTEK, [OP_GTK] = &&L_OP_GTK,
+        [OP_GTEK] = &&L_OP_GTEK
+    };
+#endif
 
     ctx->dieArg = naNil();
     ctx->error[0] = 0;
@@ -569,12 +702,12 @@ static naRef run(naContext ctx)
         op = BYTECODE(cd)[f->ip++];
         DBG(printf("Stack Depth: %d\n", ctx->opTop));
         DBG(printOpDEBUG(f->ip-1, op));
-        switch(op) {
-        case OP_POP:  ctx->opTop--; break;
-        case OP_DUP:  PUSH(STK(1)); break;
-        case OP_DUP2: PUSH(STK(2)); PUSH(STK(2)); break;
-        case OP_XCHG:  a=STK(1); STK(1)=STK(2); STK(2)=a; break;
-        case OP_XCHG2: a=STK(1); STK(1)=STK(2); STK(2)=STK(3); STK(3)=a; break;
+        SWITCH(op) {
+        CASE(OP_POP):  ctx->opTop--; NEXT();
+        CASE(OP_DUP):  PUSH(STK(1)); NEXT();
+        CASE(OP_DUP2): PUSH(STK(2)); PUSH(STK(2)); NEXT();
+        CASE(OP_XCHG):  a=STK(1); STK(1)=STK(2); STK(2)=a; NEXT();
+        CASE(OP_XCHG2): a=STK(1); STK(1)=STK(2); STK(2)=STK(3); STK(3)=a; NEXT();
 
 #define BINOP(expr) do { \
     double l = IS_NUM(STK(2)) ? STK(2).num : numify(ctx, STK(2)); \
@@ -582,140 +715,181 @@ static naRef run(naContext ctx)
     SETNUM(STK(2), expr);                                         \
     ctx->opTop--; } while(0)
 
-        case OP_PLUS:  BINOP(l + r);         break;
-        case OP_MINUS: BINOP(l - r);         break;
-        case OP_MUL:   BINOP(l * r);         break;
-        case OP_DIV:   BINOP(l / r);         break;
-        case OP_LT:    BINOP(l <  r ? 1 : 0); break;
-        case OP_LTE:   BINOP(l <= r ? 1 : 0); break;
-        case OP_GT:    BINOP(l >  r ? 1 : 0); break;
-        case OP_GTE:   BINOP(l >= r ? 1 : 0); break;
+        CASE(OP_PLUS):  BINOP(l + r);         NEXT();
+        CASE(OP_MINUS): BINOP(l - r);         NEXT();
+        CASE(OP_MUL):   BINOP(l * r);         NEXT();
+        CASE(OP_DIV):   BINOP(l / r);         NEXT();
+        CASE(OP_LT):    BINOP(l <  r ? 1 : 0); NEXT();
+        CASE(OP_LTE):   BINOP(l <= r ? 1 : 0); NEXT();
+        CASE(OP_GT):    BINOP(l >  r ? 1 : 0); NEXT();
+        CASE(OP_GTE):   BINOP(l >= r ? 1 : 0); NEXT();
 #undef BINOP
 
-        case OP_EQ: case OP_NEQ:
-            STK(2) = evalEquality(op, STK(2), STK(1));
+// Same, with a numeric constant as the right operand
+#define BINOPK(expr) do { \
+    double l = IS_NUM(STK(1)) ? STK(1).num : numify(ctx, STK(1)); \
+    double r = CONSTARG().num;                                    \
+    SETNUM(STK(1), expr); } while(0)
+
+        CASE(OP_PLUSK):  BINOPK(l + r);         NEXT();
+        CASE(OP_MINUSK): BINOPK(l - r);         NEXT();
+        CASE(OP_MULK):   BINOPK(l * r);         NEXT();
+        CASE(OP_DIVK):   BINOPK(l / r);         NEXT();
+        CASE(OP_LTK):    BINOPK(l <  r ? 1 : 0); NEXT();
+        CASE(OP_LTEK):   BINOPK(l <= r ? 1 : 0); NEXT();
+        CASE(OP_GTK):    BINOPK(l >  r ? 1 : 0); NEXT();
+        CASE(OP_GTEK):   BINOPK(l >= r ? 1 : 0); NEXT();
+#undef BINOPK
+
+        CASE(OP_EQ):
+            STK(2) = evalEquality(OP_EQ, STK(2), STK(1));
+            ctx->opTop--;
+            NEXT();
+        CASE(OP_NEQ):
+            STK(2) = evalEquality(OP_NEQ, STK(2), STK(1));
             ctx->opTop--;
-            break;
-        case OP_CAT:
+            NEXT();
+        CASE(OP_CAT):
             STK(2) = evalCat(ctx, STK(2), STK(1));
             ctx->opTop--;
-            break;
-        case OP_NEG:
+            NEXT();
+        CASE(OP_NEG):
             STK(1) = naNum(-numify(ctx, STK(1)));
-            break;
-        case OP_NOT:
+            NEXT();
+        CASE(OP_NOT):
             STK(1) = naNum(boolify(ctx, STK(1)) ? 0 : 1);
-            break;
-        case OP_PUSHCONST:
+            NEXT();
+        CASE(OP_PUSHCONST):
             a = CONSTARG();
             if(IS_CODE(a)) a = bindFunction(ctx, f, a);
             PUSH(a);
-            break;
-        case OP_PUSHONE:
+            NEXT();
+        CASE(OP_PUSHONE):
             PUSH(naNum(1));
-            break;
-        case OP_PUSHZERO:
+            NEXT();
+        CASE(OP_PUSHZERO):
             PUSH(naNum(0));
-            break;
-        case OP_PUSHNIL:
+            NEXT();
+        CASE(OP_PUSHNIL):
             PUSH(naNil());
-            break;
-        case OP_PUSHEND:
+            NEXT();
+        CASE(OP_PUSHEND):
             PUSH(endToken());
-            break;
-        case OP_NEWVEC:
+            NEXT();
+        CASE(OP_NEWVEC):
             PUSH(naNewVector(ctx));
-            break;
-        case OP_VAPPEND:
+            NEXT();
+        CASE(OP_VAPPEND):
             naVec_append(STK(2), STK(1));
             ctx->opTop--;
-            break;
-        case OP_NEWHASH:
+            NEXT();
+        CASE(OP_NEWHASH):
             PUSH(naNewHash(ctx));
-            break;
-        case OP_HAPPEND:
+            NEXT();
+        CASE(OP_HAPPEND):
             naHash_set(STK(3), STK(2), STK(1));
             ctx->opTop -= 2;
-            break;
-        case OP_LOCAL:
+            NEXT();
+        CASE(OP_LOCAL):
             a = CONSTARG();
             getLocal(ctx, f, &a, &b);
             PUSH(b);
-            break;
-        case OP_SETSYM:
+            NEXT();
+        CASE(OP_SETSYM):
             setSymbol(f, STK(1), STK(2));
             ctx->opTop--;
-            break;
-        case OP_SETLOCAL:
+            NEXT();
+        CASE(OP_SETLOCAL):
             naHash_set(f->locals, STK(1), STK(2));
             ctx->opTop--;
-            break;
-        case OP_MEMBER:
-            getMember(ctx, STK(1), CONSTARG(), &STK(1), 64);
-            break;
-        case OP_SETMEMBER:
+            NEXT();
+        CASE(OP_MEMBER):
+            a = CONSTARG();
+            getMember(ctx, cd, ARG(), STK(1), a, &STK(1));
+            NEXT();
+        CASE(OP_LMEMBER): // OP_LOCAL, OP_MEMBER
+            a = CONSTARG();
+            getLocal(ctx, f, &a, &b);
+            PUSH(b);
+            a = CONSTARG();
+            getMember(ctx, cd, ARG(), b, a, &STK(1));
+            NEXT();
+        CASE(OP_DMEMBER): // OP_DUP, OP_MEMBER
+            PUSH(STK(1));
+            a = CONSTARG();
+            getMember(ctx, cd, ARG(), STK(1), a, &STK(1));
+            NEXT();
+        CASE(OP_LMETHOD): // OP_LOCAL, OP_DUP, OP_MEMBER
+            a = CONSTARG();
+            getLocal(ctx, f, &a, &b);
+            PUSH(b);
+            PUSH(b);
+            a = CONSTARG();
+            getMember(ctx, cd, ARG(), b, a, &STK(1));
+            NEXT();
+        CASE(OP_SETMEMBER):
             setMember(ctx, STK(2), STK(1), STK(3));
-            break;
-        case OP_INSERT:
+            NEXT();
+        CASE(OP_INSERT):
             containerSet(ctx, STK(2), STK(1), STK(3));
             ctx->opTop -= 2;
-            break;
-        case OP_EXTRACT:
+            NEXT();
+        CASE(OP_EXTRACT):
             STK(2) = containerGet(ctx, STK(2), STK(1));
             ctx->opTop--;
-            break;
-        case OP_SLICE:
+            NEXT();
+        CASE(OP_SLICE):
             evalSlice(ctx, STK(3), STK(2), STK(1));
             ctx->opTop--;
-            break;
-        case OP_SLICE2:
+            NEXT();
+        CASE(OP_SLICE2):
             evalSlice2(ctx, STK(4), STK(3), STK(2), STK(1));
             ctx->opTop -= 2;
-            break;
-        case OP_JMPLOOP:
+            NEXT();
+        CASE(OP_JMPLOOP):
             // Identical to JMP, except for locking
             naCheckBottleneck();
             f->ip = BYTECODE(cd)[f->ip];
             DBG(printf("   [Jump to: %d]\n", f->ip));
-            break;
-        case OP_JMP:
+            NEXT();
+        CASE(OP_JMP):
             f->ip = BYTECODE(cd)[f->ip];
             DBG(printf("   [Jump to: %d]\n", f->ip));
-            break;
-        case OP_JIFEND:
+            NEXT();
+        CASE(OP_JIFEND):
             arg = ARG();
             if(IS_END(STK(1))) {
                 ctx->opTop--; // Pops **ONLY** if it's nil!
                 f->ip = arg;
                 DBG(printf("   [Jump to: %d]\n", f->ip));
             }
-            break;
-        case OP_JIFTRUE:
+            NEXT();
+        CASE(OP_JIFTRUE):
             arg = ARG();
             if(boolify(ctx, STK(1))) {
                 f->ip = arg;
                 DBG(printf("   [Jump to: %d]\n", f->ip));
             }
-            break;
-        case OP_JIFNOT:
+            NEXT();
+        CASE(OP_JIFNOT):
             arg = ARG();
             if(!boolify(ctx, STK(1))) {
                 f->ip = arg;
                 DBG(printf("   [Jump to: %d]\n", f->ip));
             }
-            break;
-        case OP_JIFNOTPOP:
+            NEXT();
+        CASE(OP_JIFNOTPOP):
             arg = ARG();
             if(!boolify(ctx, POP())) {
                 f->ip = arg;
                 DBG(printf("   [Jump to: %d]\n", f->ip));
             }
-            break;
-        case OP_FCALL:  SETFRAME(setupFuncall(ctx, ARG(), 0, 0)); break;
-        case OP_MCALL:  SETFRAME(setupFuncall(ctx, ARG(), 1, 0)); break;
-        case OP_FCALLH: SETFRAME(setupFuncall(ctx,     1, 0, 1)); break;
-        case OP_MCALLH: SETFRAME(setupFuncall(ctx,     1, 1, 1)); break;
-        case OP_RETURN:
+            NEXT();
+        CASE(OP_FCALL):  SETFRAME(setupFuncall(ctx, ARG(), 0, 0)); NEXT();
+        CASE(OP_MCALL):  SETFRAME(setupFuncall(ctx, ARG(), 1, 0)); NEXT();
+        CASE(OP_FCALLH): SETFRAME(setupFuncall(ctx,     1, 0, 1)); NEXT();
+        CASE(OP_MCALLH): SETFRAME(setupFuncall(ctx,     1, 1, 1)); NEXT();
+        CASE(OP_RETURN):
             a = STK(1);
             ctx->dieArg = naNil();
             if(ctx->callChild) naFreeContext(ctx->callChild);
@@ -723,32 +897,34 @@ static naRef run(naContext ctx)
             ctx->opTop = f->bp + 1; // restore the correct opstack frame!
             STK(1) = a;
             FIXFRAME();
-            break;
-        case OP_EACH:
+            NEXT();
+        CASE(OP_EACH):
             evalEach(ctx, 0);
-            break;
-        case OP_INDEX:
+            NEXT();
+        CASE(OP_INDEX):
             evalEach(ctx, 1);
-            break;
-        case OP_MARK: // save stack state (e.g. "setjmp")
+            NEXT();
+        CASE(OP_MARK): // save stack state (e.g. "setjmp")
             if(ctx->markTop >= MAX_MARK_DEPTH)
                 ERR(ctx, "mark stack overflow");
             ctx->markStack[ctx->markTop++] = ctx->opTop;
-            break;
-        case OP_UNMARK: // pop stack state set by mark
+            NEXT();
+        CASE(OP_UNMARK): // pop stack state set by mark
             ctx->markTop--;
-            break;
-        case OP_BREAK: // restore stack state (FOLLOW WITH JMP!)
+            NEXT();
+        CASE(OP_BREAK): // restore stack state (FOLLOW WITH JMP!)
             ctx->opTop = ctx->markStack[ctx->markTop-1];
-            break;
-        case OP_BREAK2: // same, but also pop the mark stack
+            NEXT();
+        CASE(OP_BREAK2): // same, but also pop the mark stack
             ctx->opTop = ctx->markStack[--ctx->markTop];
-            break;
-        case OP_UNPACK:
+            NEXT();
+        CASE(OP_UNPACK):
             evalUnpack(ctx, ARG());
-            break;
+            NEXT();
+#ifndef THREADED_DISPATCH
         default:
             ERR(ctx, "BUG: bad opcode");
+#endif
         }
         ctx->ntemps = 0; // reset GC temp vector
         DBG(printStackDEBUG(ctx));
@@ -759,6 +935,9 @@ static naRef run(naContext ctx)
 #undef CONSTARG
 #undef STK
 #undef FIXFRAME
+#undef SWITCH
+#undef CASE
+#undef NEXT
 
 void naSave(naContext ctx, naRef obj)
 {
@@ -9,14 +9,14 @@
 #define MAX_RECURSION 128
 #define MAX_MARK_DEPTH 128
 
-// Number of objects (per pool per thread) asked for using naGC_get().
-// The idea is that contexts can "cache" allocations to prevent thread
-// contention on the global pools.  But in practice this interacts
-// very badly with small subcontext calls, which grab huge numbers of
-// cached objects and don't use them, causing far more collections
-// than necessary.  Just leave it at 1 pending a rework of the
-// collector synchronization.
-#define OBJ_CACHE_SZ 1
+// Maximum number of objects (per pool per context) asked for at once
+// using naGC_get().  Contexts "cache" allocations so that they don't
+// contend for the global lock on every one.  Small subcontext calls
+// would grab huge numbers of cached objects and not use them, causing
+// far more collections than necessary, so each context starts asking
+// for a single object and doubles the amount with every refill.  The
+// collector drops the caches, and resets the amounts, when it sweeps.
+#define OBJ_CACHE_SZ 128
 
 enum {    
     OP_NOT, OP_MUL, OP_PLUS, OP_MINUS, OP_DIV, OP_NEG, OP_CAT, OP_LT, OP_LTE,
@@ -26,7 +26,13 @@ enum {
     OP_MEMBER, OP_SETMEMBER, OP_LOCAL, OP_SETLOCAL, OP_NEWVEC, OP_VAPPEND,
     OP_NEWHASH, OP_HAPPEND, OP_MARK, OP_UNMARK, OP_BREAK, OP_SETSYM, OP_DUP2,
     OP_INDEX, OP_BREAK2, OP_PUSHEND, OP_JIFTRUE, OP_JIFNOT, OP_FCALLH,
-    OP_MCALLH, OP_XCHG2, OP_UNPACK, OP_SLICE, OP_SLICE2
+    OP_MCALLH, OP_XCHG2, OP_UNPACK, OP_SLICE, OP_SLICE2,
+
+    // Superinstructions generated for common sequences: OP_LOCAL and
+    // OP_MEMBER, OP_DUP and OP_MEMBER (method lookup), all three, and
+    // arithmetic with a numeric constant as the right operand.
+    OP_LMEMBER, OP_DMEMBER, OP_LMETHOD, OP_PLUSK, OP_MINUSK, OP_MULK,
+    OP_DIVK, OP_LTK, OP_LTEK, OP_GTK, OP_GTEK
 };
 
 struct Frame {
@@ -41,13 +47,30 @@ struct Globals {
     struct naPool pools[NUM_NASAL_TYPES];
     int allocCount;
 
+    // Incremental collection, see gc.c
+    int gcPhase;
+    int gcDebt;          // allocations since the last incremental step
+    int gcStep;          // nonzero if the next bottleneck should do a step
+    double gcStepUSec;   // time budget of a step requested by naGCStep()
+    int gcIncremental;
+    int sweepPool;       // pool being swept...
+    struct Block* sweepBlock; // ...and the position within it
+    int sweepElem;
+    struct naObj** gray; // objects marked, but whose children aren't yet
+    int ngray;
+    int graysz;
+    struct naObj** grayAgain; // black containers modified while marking
+    int ngrayAgain;
+    int grayAgainsz;
+    struct naGCStats gcStats;
+
     // Dead blocks waiting to be freed when it is safe
     void** deadBlocks;
     int deadsz;
     int ndead;
     
     // Threading stuff
-    int nThreads;
+    volatile int nThreads; // read without the lock by getMember()
     int waitCount;
     int needGC;
     int bottleneck;
@@ -59,6 +82,9 @@ struct Globals {
     naRef argRef;
     naRef parentsRef;
 
+    // Current generation of the OP_MEMBER caches
+    unsigned int memberEpoch;
+
     // A hash of symbol names
     naRef symbols;
 
@@ -79,8 +105,9 @@ struct Context {
     int markTop;
 
     // Free object lists, cached from the global GC
-    struct naObj** free[NUM_NASAL_TYPES];
+    struct naObj* free[NUM_NASAL_TYPES][OBJ_CACHE_SZ];
     int nfree[NUM_NASAL_TYPES];
+    int cachesz[NUM_NASAL_TYPES]; // objects asked for by the next refill
 
     // GC-findable reference point for objects that may live on the
     // processor ("real") stack during execution.  naNew() places them
@@ -117,6 +144,7 @@ void* naNewSem();
 void naFreeSem(void* sem);
 void naSemDown(void* sem);
 void naSemUp(void* sem, int count);
+double naTimeUSec();
 
 void naCheckBottleneck();
 
@@ -13,6 +13,7 @@
 static void genExpr(struct Parser* p, struct Token* t);
 static void genExprList(struct Parser* p, struct Token* t);
 static naRef newLambda(struct Parser* p, struct Token* t);
+static void newLineEntry(struct Parser* p, int line);
 
 static void emit(struct Parser* p, int val)
 {
@@ -32,15 +33,6 @@ static void emitImmediate(struct Parser* p, int val, int arg)
     emit(p, arg);
 }
 
-static void genBinOp(int op, struct Parser* p, struct Token* t)
-{
-    if(!LEFT(t) || !RIGHT(t))
-        naParseError(p, "empty subexpression", t->line);
-    genExpr(p, LEFT(t));
-    genExpr(p, RIGHT(t));
-    emit(p, op);
-}
-
 static int newConstant(struct Parser* p, naRef c)
 {
     int i;
@@ -100,6 +92,137 @@ static int genScalarConstant(struct Parser* p, struct Token* t)
     return idx;
 }
 
+// Member lookups take the index of their own inline cache after the
+// field constant, or 0xffff if the code object has run out of them.
+static void emitCache(struct Parser* p)
+{
+    emit(p, p->cg->nCaches < 0xffff ? p->cg->nCaches++ : 0xffff);
+}
+
+static void emitMember(struct Parser* p, int op, int cidx)
+{
+    emitImmediate(p, op, cidx);
+    emitCache(p);
+}
+
+static void setLine(struct Parser* p, int line)
+{
+    if(line != p->cg->lastLine)
+        newLineEntry(p, line);
+    p->cg->lastLine = line;
+}
+
+// Emits an instruction which reads the local variable sym first, the
+// way genExpr() would have for the symbol on its own.
+static void emitLocalOp(struct Parser* p, struct Token* sym, int op)
+{
+    p->errLine = sym->line;
+    setLine(p, sym->line);
+    emitImmediate(p, op, findConstantIndex(p, sym));
+}
+
+// Evaluates an expression made only of numeric literals and
+// arithmetic, the way the interpreter would.  Returns zero if it
+// isn't one.
+static int foldConstant(struct Token* t, double* out)
+{
+    double l, r;
+    if(!t) return 0;
+    switch(t->type) {
+    case TOK_LITERAL:
+        if(t->str) return 0;
+        *out = t->num;
+        return 1;
+    case TOK_LPAR:
+        if(BINARY(t) || !RIGHT(t)) return 0; // function call
+        return foldConstant(LEFT(t), out);
+    case TOK_MINUS: case TOK_NEG:
+        if(BINARY(t)) break;
+        if(!foldConstant(RIGHT(t), &r)) return 0;
+        *out = -r;
+        // genExpr() pre-negates literals, and pushes -0 as a zero
+        if(t->type == TOK_MINUS && RIGHT(t)->type == TOK_LITERAL && r == 0)
+            *out = 0;
+        return 1;
+    case TOK_PLUS: case TOK_MUL: case TOK_DIV: case TOK_LT: case TOK_LTE:
+    case TOK_GT: case TOK_GTE: case TOK_EQ: case TOK_NEQ:
+        if(!BINARY(t)) return 0;
+        break;
+    default:
+        return 0;
+    }
+    if(!foldConstant(LEFT(t), &l) || !foldConstant(RIGHT(t), &r))
+        return 0;
+    switch(t->type) {
+    case TOK_PLUS:  *out = l + r; break;
+    case TOK_MINUS: *out = l - r; break;
+    case TOK_MUL:   *out = l * r; break;
+    case TOK_DIV:   *out = l / r; break;
+    case TOK_LT:    *out = l <  r ? 1 : 0; break;
+    case TOK_LTE:   *out = l <= r ? 1 : 0; break;
+    case TOK_GT:    *out = l >  r ? 1 : 0; break;
+    case TOK_GTE:   *out = l >= r ? 1 : 0; break;
+    case TOK_EQ:    *out = l == r ? 1 : 0; break;
+    case TOK_NEQ:   *out = l != r ? 1 : 0; break;
+    default:        return 0;
+    }
+    return 1;
+}
+
+// Like internConstant(), which can't tell 0 from -0, for numbers
+static int numConstant(struct Parser* p, double num)
+{
+    if(num == 0) return newConstant(p, naNum(num));
+    return internConstant(p, naNum(num));
+}
+
+static void genNumConstant(struct Parser* p, double num)
+{
+    if(num == 1) emit(p, OP_PUSHONE);
+    else if(num == 0 && 1/num > 0) emit(p, OP_PUSHZERO);
+    else emitImmediate(p, OP_PUSHCONST, numConstant(p, num));
+}
+
+// Generates the right operand of a binary operator and the operator
+// itself, as a single instruction if the operand is constant.
+static void genRightOp(struct Parser* p, int op, struct Token* t)
+{
+    int kop;
+    double num;
+    switch(op) {
+    case OP_PLUS:  kop = OP_PLUSK;  break;
+    case OP_MINUS: kop = OP_MINUSK; break;
+    case OP_MUL:   kop = OP_MULK;   break;
+    case OP_DIV:   kop = OP_DIVK;   break;
+    case OP_LT:    kop = OP_LTK;    break;
+    case OP_LTE:   kop = OP_LTEK;   break;
+    case OP_GT:    kop = OP_GTK;    break;
+    case OP_GTE:   kop = OP_GTEK;   break;
+    default:       kop = -1;
+    }
+    if(kop >= 0 && foldConstant(t, &num)) {
+        p->errLine = t->line;
+        setLine(p, t->line);
+        emitImmediate(p, kop, numConstant(p, num));
+    } else {
+        genExpr(p, t);
+        emit(p, op);
+    }
+}
+
+static void genBinOp(int op, struct Parser* p, struct Token* t)
+{
+    double num;
+    if(!LEFT(t) || !RIGHT(t))
+        naParseError(p, "empty subexpression", t->line);
+    if(foldConstant(t, &num)) {
+        genNumConstant(p, num);
+        return;
+    }
+    genExpr(p, LEFT(t));
+    genRightOp(p, op, RIGHT(t));
+}
+
 static int genLValue(struct Parser* p, struct Token* t, int* cidx)
 {
     if(!t) naParseError(p, "bad lvalue", -1);
@@ -131,7 +254,7 @@ static void genEqOp(int op, struct Parser* p, struct Token* t)
     if(setop == OP_SETMEMBER) {
         emit(p, OP_DUP2);
         emit(p, OP_POP);
-        emitImmediate(p, OP_MEMBER, cidx);
+        emitMember(p, OP_MEMBER, cidx);
     } else if(setop == OP_INSERT) {
         emit(p, OP_DUP2);
         emit(p, OP_EXTRACT);
@@ -139,8 +262,7 @@ static void genEqOp(int op, struct Parser* p, struct Token* t)
         emitImmediate(p, OP_LOCAL, cidx);
         n = 1;
     }
-    genExpr(p, RIGHT(t));
-    emit(p, op);
+    genRightOp(p, op, RIGHT(t));
     emit(p, n == 1 ? OP_XCHG : OP_XCHG2);
     emit(p, setop);
 }
@@ -274,9 +396,14 @@ static void genFuncall(struct Parser* p, struct Token* t)
     int method = 0;
     if(LEFT(t)->type == TOK_DOT) {
         method = 1;
-        genExpr(p, LEFT(LEFT(t)));
-        emit(p, OP_DUP);
-        emitImmediate(p, OP_MEMBER, findConstantIndex(p, RIGHT(LEFT(t))));
+        if(LEFT(LEFT(t)) && LEFT(LEFT(t))->type == TOK_SYMBOL) {
+            emitLocalOp(p, LEFT(LEFT(t)), OP_LMETHOD);
+            emit(p, findConstantIndex(p, RIGHT(LEFT(t))));
+            emitCache(p);
+        } else {
+            genExpr(p, LEFT(LEFT(t)));
+            emitMember(p, OP_DMEMBER, findConstantIndex(p, RIGHT(LEFT(t))));
+        }
     } else {
         genExpr(p, LEFT(t));
     }
@@ -608,9 +735,7 @@ static void genExpr(struct Parser* p, struct Token* t)
     int i;
     if(!t) naParseError(p, "parse error", -1); // throw line -1...
     p->errLine = t->line;                      // ...to use this one instead
-    if(t->line != p->cg->lastLine)
-        newLineEntry(p, t->line);
-    p->cg->lastLine = t->line;
+    setLine(p, t->line);
     switch(t->type) {
     case TOK_TOP:      genExprList(p, LEFT(t)); break;
     case TOK_IF:       genIfElse(p, t);   break;
@@ -671,10 +796,18 @@ static void genExpr(struct Parser* p, struct Token* t)
         emit(p, OP_NEG);
         break;
     case TOK_DOT:
-        genExpr(p, LEFT(t));
+        if(LEFT(t) && LEFT(t)->type == TOK_SYMBOL)
+            emitLocalOp(p, LEFT(t), OP_LMEMBER);
+        else
+            genExpr(p, LEFT(t));
         if(!RIGHT(t) || RIGHT(t)->type != TOK_SYMBOL)
             naParseError(p, "object field not symbol", RIGHT(t)->line);
-        emitImmediate(p, OP_MEMBER, findConstantIndex(p, RIGHT(t)));
+        if(LEFT(t) && LEFT(t)->type == TOK_SYMBOL) {
+            emit(p, findConstantIndex(p, RIGHT(t)));
+            emitCache(p);
+        } else {
+            emitMember(p, OP_MEMBER, findConstantIndex(p, RIGHT(t)));
+        }
         break;
     case TOK_EMPTY: case TOK_NIL:
         emit(p, OP_PUSHNIL);
@@ -731,6 +864,7 @@ naRef naCodeGen(struct Parser* p, struct Token* block, struct Token* arglist)
     cg.lineIps = 0;
     cg.nLineIps = 0;
     cg.nextLineIp = 0;
+    cg.nCaches = 0;
     p->cg = &cg;
 
     genExprList(p, block);
@@ -772,5 +906,12 @@ naRef naCodeGen(struct Parser* p, struct Token* block, struct Token* arglist)
     for(i=0; i<code->codesz; i++) BYTECODE(code)[i] = cg.byteCode[i];
     for(i=0; i<code->nLines; i++) LINEIPS(code)[i] = cg.lineIps[i];
 
+    code->caches = naAlloc(cg.nCaches * sizeof(struct MemberCache));
+    for(i=0; i<cg.nCaches; i++) {
+        code->caches[i].parents = code->caches[i].value = naNil();
+        code->caches[i].epoch = 0;
+    }
+    code->nCaches = cg.nCaches;
+
     return codeObj;
 }
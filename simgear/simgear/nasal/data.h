@@ -93,6 +93,22 @@ struct naObj {
     GC_HEADER;
 };
 
+// Values of the mark byte during an incremental collection, see gc.c
+#define GC_WHITE 0
+#define GC_BLACK 1
+#define GC_GRAY  2
+
+// Write barrier, which must follow every store of a reference into an
+// existing vector or hash.
+#define GC_BARRIER(o) \
+    do { if((o)->mark == GC_BLACK) naiGCBarrier((struct naObj*)(o)); } while(0)
+
+// Must accompany every change to a vector or hash that has been walked
+// as part of a "parents" chain, as member lookups through it may have
+// been cached (see getMember() in code.c).
+#define PROTO_CHANGED(o) \
+    do { if((o)->proto) naiProtoChanged(); } while(0)
+
 #define MAX_STR_EMBLEN 15
 struct naStr {
     GC_HEADER;
@@ -115,6 +131,7 @@ struct VecRec {
 
 struct naVec {
     GC_HEADER;
+    unsigned char proto; // seen in a "parents" chain
     struct VecRec* rec;
 };
 
@@ -126,6 +143,7 @@ struct HashNode {
 
 struct naHash {
     GC_HEADER;
+    unsigned char proto; // seen in a "parents" chain
     struct HashRec* rec;
 };
 
@@ -138,8 +156,20 @@ struct naCode {
     unsigned short codesz;
     unsigned short restArgSym; // The "..." vector name, defaults to "arg"
     unsigned short nLines;
+    unsigned short nCaches;
     naRef srcFile;
     naRef* constants;
+    struct MemberCache* caches;
+};
+
+/* Inline cache of an OP_MEMBER instruction: the last member found
+ * through the parents of a hash, valid as long as no vector or hash
+ * in the chain has changed since (i.e. epoch is still current) and
+ * the receiver has the same parents and no such field of its own. */
+struct MemberCache {
+    naRef parents;
+    naRef value;
+    unsigned int epoch;
 };
 
 /* naCode objects store their variable length arrays in a single block
@@ -208,13 +238,15 @@ naRef naStr_buf(naRef str, int len);
 int naiHash_tryset(naRef hash, naRef key, naRef val); // sets if exists
 int naiHash_sym(struct naHash* h, struct naStr* sym, naRef* out);
 void naiHash_newsym(struct naHash* h, naRef* sym, naRef* val);
+void naiProtoChanged();
 
 void naGC_init(struct naPool* p, int type);
-struct naObj** naGC_get(struct naPool* p, int n, int* nout);
+int naGC_get(struct naPool* p, struct naObj** out, int n);
 void naGC_swapfree(void** target, void* val);
 void naGC_freedead();
 void naiGCMark(naRef r);
 void naiGCMarkHash(naRef h);
+void naiGCBarrier(struct naObj* o);
 
 void naStr_gcclean(struct naStr* s);
 void naVec_gcclean(struct naVec* s);
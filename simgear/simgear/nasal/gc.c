@@ -4,6 +4,28 @@
 
 #define MIN_BLOCK_SIZE 32
 
+// While a collection is in progress, every GC_STEP_ALLOCS allocations
+// trigger an incremental step, which scans GC_WORK_PER_ALLOC references
+// or sweeps as many objects per object allocated.
+#define GC_STEP_ALLOCS 64
+#define GC_WORK_PER_ALLOC 32
+
+// Collection phases.  Marking is incremental, using the gray stack
+// instead of recursion, and a write barrier (naiGCBarrier()) turns
+// black containers gray again when they are modified.  The context
+// stacks aren't barriered, so they are scanned once more at the end
+// of marking.  Pools are then swept one after the other, also in
+// steps, and objects allocated from a pool whose sweep hasn't started
+// yet are born black.
+//
+// Note that new objects are only reachable through the temps (which
+// aren't scanned before the end of marking) until they get stored
+// somewhere, so they can be initialized without barriers.
+enum { GC_IDLE, GC_MARK, GC_SWEEP };
+
+static void beginSweep(struct naPool* p);
+static int sweep(struct naPool* p, int work);
+static void endSweep(struct naPool* p);
 static void reap(struct naPool* p);
 static void mark(naRef r);
 
@@ -22,6 +44,15 @@ static void freeDead()
     globals->ndead = 0;
 }
 
+static void push(struct naObj*** stack, int* n, int* sz, struct naObj* o)
+{
+    if(*n >= *sz) {
+        *sz = *sz < 256 ? 256 : 2 * *sz;
+        *stack = naRealloc(*stack, sizeof(struct naObj*) * *sz);
+    }
+    (*stack)[(*n)++] = o;
+}
+
 static void marktemps(struct Context* c)
 {
     int i;
@@ -32,16 +63,11 @@ static void marktemps(struct Context* c)
     }
 }
 
-// Must be called with the big lock!
-static void garbageCollect()
+static void markroots(int withTemps)
 {
     int i;
-    struct Context* c;
-    globals->allocCount = 0;
-    c = globals->allContexts;
+    struct Context* c = globals->allContexts;
     while(c) {
-        for(i=0; i<NUM_NASAL_TYPES; i++)
-            c->nfree[i] = 0;
         for(i=0; i < c->fTop; i++) {
             mark(c->fStack[i].func);
             mark(c->fStack[i].locals);
@@ -49,7 +75,8 @@ static void garbageCollect()
         for(i=0; i < c->opTop; i++)
             mark(c->opStack[i]);
         mark(c->dieArg);
-        marktemps(c);
+        if(withTemps)
+            marktemps(c);
         c = c->nextAll;
     }
 
@@ -58,22 +85,167 @@ static void garbageCollect()
     mark(globals->meRef);
     mark(globals->argRef);
     mark(globals->parentsRef);
+}
 
-    // Finally collect all the freed objects
-    for(i=0; i<NUM_NASAL_TYPES; i++)
-        reap(&(globals->pools[i]));
+static void markvec(struct naVec* v)
+{
+    int i;
+    struct VecRec* vr = v->rec;
+    if(!vr) return;
+    for(i=0; i<vr->size; i++)
+        mark(vr->array[i]);
+}
+
+// Marks the children of a gray object, and returns a measure of the
+// work done.
+static int scan(struct naObj* o)
+{
+    int i;
+    naRef r;
+    SETPTR(r, o);
+    o->mark = GC_BLACK;
+    switch(o->type) {
+    case T_VEC:
+        markvec(PTR(r).vec);
+        return 1 + naVec_size(r);
+    case T_HASH:
+        naiGCMarkHash(r);
+        return 1 + 2*naHash_size(r);
+    case T_CODE:
+        mark(PTR(r).code->srcFile);
+        for(i=0; i<PTR(r).code->nConstants; i++)
+            mark(PTR(r).code->constants[i]);
+        for(i=0; i<PTR(r).code->nCaches; i++) {
+            mark(PTR(r).code->caches[i].parents);
+            mark(PTR(r).code->caches[i].value);
+        }
+        return 1 + PTR(r).code->nConstants + 2*PTR(r).code->nCaches;
+    case T_FUNC:
+        mark(PTR(r).func->code);
+        mark(PTR(r).func->namespace);
+        mark(PTR(r).func->next);
+        return 4;
+    }
+    return 1;
+}
+
+// Scans gray objects until there are none left (returns 1), or the
+// work is done.
+static int propagate(int work)
+{
+    struct Globals* g = globals;
+    while(g->ngray > 0) {
+        if(work <= 0) return 0;
+        work -= scan(g->gray[--g->ngray]);
+    }
+    return 1;
+}
+
+static void startCycle()
+{
+    globals->gcPhase = GC_MARK;
+    markroots(0);
+}
+
+// Finishes marking in one go: the stacks have changed since the
+// cycle started, and so have the containers hit by the write barrier.
+static void finishMark()
+{
+    int i;
+    struct Context* c;
+    struct Globals* g = globals;
+    markroots(1);
+    while(g->ngrayAgain > 0)
+        push(&g->gray, &g->ngray, &g->graysz, g->grayAgain[--g->ngrayAgain]);
+    while(!propagate(1 << 30)) {}
+
+    // Objects cached by the contexts before now would miss being born
+    // black, see naGC_get()
+    for(c = g->allContexts; c; c = c->nextAll)
+        for(i=0; i<NUM_NASAL_TYPES; i++)
+            c->nfree[i] = 0;
+
+    g->gcPhase = GC_SWEEP;
+    g->sweepPool = 0;
+    g->allocCount = 0;
+    beginSweep(&g->pools[0]);
+}
+
+static void finishSweep()
+{
+    struct Globals* g = globals;
 
     // Make enough space for the dead blocks we need to free during
     // execution.  This works out to 1 spot for every 2 live objects,
     // which should be limit the number of bottleneck operations
     // without imposing an undue burden of extra "freeable" memory.
-    if(globals->deadsz < globals->allocCount) {
-        globals->deadsz = globals->allocCount;
-        if(globals->deadsz < 256) globals->deadsz = 256;
-        naFree(globals->deadBlocks);
-        globals->deadBlocks = naAlloc(sizeof(void*) * globals->deadsz);
+    if(g->deadsz < g->allocCount) {
+        g->deadsz = g->allocCount;
+        if(g->deadsz < 256) g->deadsz = 256;
+        naFree(g->deadBlocks);
+        g->deadBlocks = naAlloc(sizeof(void*) * g->deadsz);
+    }
+    g->gcPhase = GC_IDLE;
+    g->gcStats.cycles++;
+}
+
+// Sweeps the pools in turn, returning 1 once the last one is done
+static int sweepPools(int work)
+{
+    struct Globals* g = globals;
+    while(g->gcPhase == GC_SWEEP) {
+        struct naPool* p = &g->pools[g->sweepPool];
+        if(!sweep(p, work))
+            return 0;
+        endSweep(p);
+        if(++g->sweepPool < NUM_NASAL_TYPES) {
+            beginSweep(&g->pools[g->sweepPool]);
+            return 0;
+        }
+        finishSweep();
     }
-    globals->needGC = 0;
+    return 1;
+}
+
+// Does whatever collection work has been requested.  Must be called
+// with the big lock, in the bottleneck!
+static void garbageCollect()
+{
+    struct Globals* g = globals;
+    double start = naTimeUSec(), pause;
+
+    if(g->needGC) {
+        // Finish the cycle in progress, or do a complete one
+        if(g->gcPhase == GC_IDLE) startCycle();
+        if(g->gcPhase == GC_MARK) finishMark();
+        while(!sweepPools(1 << 30)) {}
+        g->gcStats.forced++;
+    } else if(g->gcStep) {
+        int done = 0, work;
+        work = (g->gcDebt > GC_STEP_ALLOCS ? g->gcDebt : GC_STEP_ALLOCS)
+             * GC_WORK_PER_ALLOC;
+        if(g->gcPhase == GC_IDLE) startCycle();
+        while(!done) {
+            if(g->gcPhase == GC_MARK) {
+                if(propagate(g->gcStepUSec > 0 ? 1024 : work))
+                    finishMark();
+            } else if(g->gcPhase == GC_SWEEP) {
+                sweepPools(g->gcStepUSec > 0 ? 1024 : work);
+            }
+            done = g->gcPhase == GC_IDLE
+                || g->gcStepUSec <= 0
+                || naTimeUSec() - start >= g->gcStepUSec;
+        }
+        g->gcStats.steps++;
+    }
+    g->needGC = g->gcStep = 0;
+    g->gcStepUSec = 0;
+    g->gcDebt = 0;
+
+    pause = naTimeUSec() - start;
+    g->gcStats.totalPauseUSec += pause;
+    if(pause > g->gcStats.maxPauseUSec)
+        g->gcStats.maxPauseUSec = pause;
 }
 
 void naModLock()
@@ -112,7 +284,7 @@ static void bottleneck()
     }
     if(g->waitCount >= g->nThreads - 1) {
         freeDead();
-        if(g->needGC) garbageCollect();
+        if(g->needGC || g->gcStep) garbageCollect();
         if(g->waitCount) naSemUp(g->sem, g->waitCount);
         g->bottleneck = 0;
     }
@@ -126,6 +298,8 @@ void naCheckBottleneck()
 static void naCode_gcclean(struct naCode* o)
 {
     naFree(o->constants);  o->constants = 0;
+    naFree(o->caches);  o->caches = 0;
+    o->nCaches = 0;
 }
 
 static void naCCode_gcclean(struct naCCode* c)
@@ -198,62 +372,61 @@ static int poolsize(struct naPool* p)
     return total;
 }
 
-struct naObj** naGC_get(struct naPool* p, int n, int* nout)
+// Takes up to n objects from the pool's free list, copying them to out
+// (the free list gets rebuilt by the sweep), and returns how many.
+int naGC_get(struct naPool* p, struct naObj** out, int n)
 {
+    int i;
     struct naObj** result;
+    struct Globals* g = globals;
     naCheckBottleneck();
     LOCK();
-    while(globals->allocCount < 0 || (p->nfree == 0 && p->freetop >= p->freesz)) {
-        globals->needGC = 1;
+    if(g->gcPhase == GC_IDLE ? g->allocCount < 0
+                             : g->gcDebt >= GC_STEP_ALLOCS) {
+        if(g->gcIncremental) g->gcStep = 1;
+        else g->needGC = 1;
+        bottleneck();
+    }
+    // The pool being swept can't grow until it is done
+    while(p->nfree == 0 && g->gcPhase == GC_SWEEP && p->type == g->sweepPool) {
+        g->gcStep = 1;
+        bottleneck();
+    }
+    while(p->nfree == 0 && p->freetop >= p->freesz) {
+        g->needGC = 1;
         bottleneck();
     }
     if(p->nfree == 0)
         newBlock(p, poolsize(p)/8);
     n = p->nfree < n ? p->nfree : n;
-    *nout = n;
     p->nfree -= n;
-    globals->allocCount -= n;
+    g->allocCount -= n;
     result = (struct naObj**)(p->free + p->nfree);
+    for(i=0; i<n; i++)
+        out[i] = result[i];
+    if(g->gcPhase != GC_IDLE) {
+        g->gcDebt += n;
+        if(g->gcPhase == GC_SWEEP && p->type > g->sweepPool)
+            for(i=0; i<n; i++)
+                out[i]->mark = GC_BLACK;
+    }
     UNLOCK();
-    return result;
+    return n;
 }
 
-static void markvec(naRef r)
-{
-    int i;
-    struct VecRec* vr = PTR(r).vec->rec;
-    if(!vr) return;
-    for(i=0; i<vr->size; i++)
-        mark(vr->array[i]);
-}
-
-// Sets the reference bit on the object, and recursively on all
-// objects reachable from it.  Uses the processor stack for recursion...
+// Turns an object gray, to be scanned later
 static void mark(naRef r)
 {
-    int i;
-
+    struct naObj* o;
     if(IS_NUM(r) || IS_NIL(r))
         return;
 
-    if(PTR(r).obj->mark == 1)
+    o = PTR(r).obj;
+    if(o->mark != GC_WHITE)
         return;
 
-    PTR(r).obj->mark = 1;
-    switch(PTR(r).obj->type) {
-    case T_VEC: markvec(r); break;
-    case T_HASH: naiGCMarkHash(r); break;
-    case T_CODE:
-        mark(PTR(r).code->srcFile);
-        for(i=0; i<PTR(r).code->nConstants; i++)
-            mark(PTR(r).code->constants[i]);
-        break;
-    case T_FUNC:
-        mark(PTR(r).func->code);
-        mark(PTR(r).func->namespace);
-        mark(PTR(r).func->next);
-        break;
-    }
+    o->mark = GC_GRAY;
+    push(&globals->gray, &globals->ngray, &globals->graysz, o);
 }
 
 void naiGCMark(naRef r)
@@ -261,12 +434,73 @@ void naiGCMark(naRef r)
     mark(r);
 }
 
-// Collects all the unreachable objects into a free list, and
-// allocates more space if needed.
-static void reap(struct naPool* p)
+void naiGCBarrier(struct naObj* o)
+{
+    struct Globals* g = globals;
+    // Objects also stay black while sweeping.  The phase only changes
+    // in the bottleneck, so it can be checked without the lock.
+    if(g->gcPhase != GC_MARK)
+        return;
+    LOCK();
+    if(g->gcPhase == GC_MARK && o->mark == GC_BLACK) {
+        o->mark = GC_GRAY;
+        push(&g->grayAgain, &g->ngrayAgain, &g->grayAgainsz, o);
+    }
+    UNLOCK();
+}
+
+void naGCSetIncremental(int enable)
+{
+    globals->gcIncremental = enable;
+}
+
+// Runs the bottleneck for the collection work set up by the caller
+static void requestGC()
+{
+    naModLock();
+    LOCK();
+    bottleneck();
+    UNLOCK();
+    naModUnlock();
+}
+
+void naGCStep(double usec)
+{
+    int running;
+    LOCK();
+    running = globals->gcPhase != GC_IDLE;
+    if(running && usec > 0) {
+        globals->gcStep = 1;
+        globals->gcStepUSec = usec;
+    }
+    UNLOCK();
+    if(running && usec > 0)
+        requestGC();
+}
+
+void naGC()
+{
+    LOCK();
+    globals->needGC = 1;
+    UNLOCK();
+    requestGC();
+}
+
+void naGCGetStats(struct naGCStats* out)
+{
+    LOCK();
+    *out = globals->gcStats;
+    naBZero(&globals->gcStats, sizeof(struct naGCStats));
+    UNLOCK();
+}
+
+// Starts collecting the unreachable objects of a pool into a new free
+// list, allocating more space if needed.  The old free list is
+// dropped: its objects are unmarked and will be found again.
+static void beginSweep(struct naPool* p)
 {
-    struct Block* b;
-    int elem, freesz, total = poolsize(p);
+    struct Context* c;
+    int freesz, total = poolsize(p);
     freesz = total < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : total;
     freesz = (3 * freesz / 2) + (globals->nThreads * OBJ_CACHE_SZ);
     if(p->freesz < freesz) {
@@ -277,15 +511,41 @@ static void reap(struct naPool* p)
 
     p->nfree = 0;
     p->free = p->free0;
+    for(c = globals->allContexts; c; c = c->nextAll) {
+        c->nfree[p->type] = 0;
+        c->cachesz[p->type] = 1;
+    }
 
-    for(b = p->blocks; b; b = b->next)
-        for(elem=0; elem < b->size; elem++) {
-            struct naObj* o = (struct naObj*)(b->block + elem * p->elemsz);
-            if(o->mark == 0)
+    globals->sweepBlock = p->blocks;
+    globals->sweepElem = 0;
+}
+
+// Sweeps up to work objects, returning 1 once the pool is done.  The
+// free list only grows from the swept blocks, so objects allocated in
+// between are never seen by the sweep.
+static int sweep(struct naPool* p, int work)
+{
+    struct Globals* g = globals;
+    while(g->sweepBlock) {
+        struct Block* b = g->sweepBlock;
+        for(; g->sweepElem < b->size; g->sweepElem++) {
+            struct naObj* o =
+                (struct naObj*)(b->block + g->sweepElem * p->elemsz);
+            if(work-- <= 0)
+                return 0;
+            if(o->mark == GC_WHITE)
                 freeelem(p, o);
-            o->mark = 0;
+            o->mark = GC_WHITE;
         }
+        g->sweepBlock = b->next;
+        g->sweepElem = 0;
+    }
+    return 1;
+}
 
+static void endSweep(struct naPool* p)
+{
+    int total = poolsize(p);
     p->freetop = p->nfree;
 
     // allocs of this type until the next collection
@@ -302,6 +562,15 @@ static void reap(struct naPool* p)
     }
 }
 
+// Collects all the unreachable objects into a free list, and
+// allocates more space if needed.
+static void reap(struct naPool* p)
+{
+    beginSweep(p);
+    sweep(p, 1 << 30);
+    endSweep(p);
+}
+
 // Does the swap, returning the old value
 static void* doswap(void** target, void* val)
 {
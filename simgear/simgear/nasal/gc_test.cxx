@@ -0,0 +1,209 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "nasal.h"
+
+#include <simgear/structure/SGTimingHistogram.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Allocates the way a navigation display does every frame: a hash and
+// a few strings per symbol, closures, and some of it kept in long lived
+// containers.
+static const char* script =
+    "var cache = {};\n"
+    "var history = [];\n"
+    "var frame = 0;\n"
+    "var update = func {\n"
+    "    frame += 1;\n"
+    "    var symbols = [];\n"
+    "    for (var i = 0; i < 200; i += 1) {\n"
+    "        var s = { id: \"WPT\" ~ i, lat: i * 0.01, lon: frame * 0.01,\n"
+    "                  pos: [i, frame, i * frame],\n"
+    "                  label: func { return me.id ~ \"/\" ~ frame; } };\n"
+    "        s.text = s.label();\n"
+    "        append(symbols, s);\n"
+    "    }\n"
+    "    cache[\"k\" ~ (frame - int(frame / 50) * 50)] =\n"
+    "        { frame: frame, name: \"frame\" ~ frame,\n"
+    "          symbols: subvec(symbols, 0, 10) };\n"
+    "    append(history, \"h\" ~ frame);\n"
+    "    if (size(history) > 100) history = subvec(history, 1);\n"
+    "    return size(symbols);\n"
+    "}\n"
+    "var check = func {\n"
+    "    foreach (var k; keys(cache)) {\n"
+    "        var c = cache[k];\n"
+    "        if (c.name != \"frame\" ~ c.frame) return 0;\n"
+    "        foreach (var s; c.symbols)\n"
+    "            if (s.text != s.id ~ \"/\" ~ c.frame) return 0;\n"
+    "    }\n"
+    "    for (var i = 0; i < size(history); i += 1)\n"
+    "        if (history[i] != \"h\" ~ (frame - size(history) + 1 + i))\n"
+    "            return 0;\n"
+    "    return 1;\n"
+    "}\n"
+    "# Allocates only objects of its own, for running in several threads\n"
+    "var work = func(n) {\n"
+    "    var v = [];\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        append(v, { id: \"obj\" ~ i, pos: [i, i + 1] });\n"
+    "    var sum = 0;\n"
+    "    foreach (var o; v)\n"
+    "        sum += o.id == \"obj\" ~ o.pos[0] ? o.pos[1] - o.pos[0] : -1;\n"
+    "    return sum;\n"
+    "}\n";
+
+static naRef call(naContext ctx, naRef ns, const char* name)
+{
+    naRef func = naHash_cget(ns, const_cast<char*>(name));
+    naRef result = naCall(ctx, func, 0, 0, naNil(), naNil());
+    if (naGetError(ctx)) {
+        cerr << "** FAILED: " << naGetError(ctx) << endl;
+        exit(1);
+    }
+    return result;
+}
+
+/**
+ * Run frames of the script, and report the distribution of frame times.
+ * Checks the data kept across frames is intact every now and then.
+ *
+ * @param stepUSec time given to the collector after each frame
+ */
+static naGCStats runFrames(naContext ctx, naRef ns, const char* title,
+                           int frames, double stepUSec)
+{
+    SGTimingHistogram histogram;
+    naGCStats stats;
+    naGCGetStats(&stats);
+
+    for (int i = 0; i < frames; ++i) {
+        SGTimeStamp start = SGTimeStamp::now();
+        naRef n = call(ctx, ns, "update");
+        histogram.add((SGTimeStamp::now() - start).toUSecs());
+        COMPARE(naNumValue(n).num, 200.0);
+
+        if (stepUSec > 0)
+            naGCStep(stepUSec);
+        if (i % 100 == 0)
+            COMPARE(naNumValue(call(ctx, ns, "check")).num, 1.0);
+    }
+    COMPARE(naNumValue(call(ctx, ns, "check")).num, 1.0);
+
+    naGCGetStats(&stats);
+    VERIFY(stats.cycles > 0);
+    cout << title << ": frame p50 " << histogram.percentile(0.5)
+         << " p99 " << histogram.percentile(0.99)
+         << " max " << histogram.max() << " usec, "
+         << stats.cycles << " collections (" << stats.forced << " forced), "
+         << stats.steps << " steps, longest pause "
+         << stats.maxPauseUSec << " usec" << endl;
+    return stats;
+}
+
+// Runs the work function with a context of its own
+class WorkThread : public SGThread
+{
+public:
+    WorkThread(naRef work, int runs) : _work(work), _runs(runs), _ok(true) { }
+
+    virtual void run()
+    {
+        naContext ctx = naNewContext();
+        naRef args[1] = { naNum(WORK_SIZE) };
+        for (int i = 0; i < _runs; ++i) {
+            naRef n = naCall(ctx, _work, 1, args, naNil(), naNil());
+            if (naGetError(ctx) || naNumValue(n).num != WORK_SIZE)
+                _ok = false;
+        }
+        naFreeContext(ctx);
+    }
+
+    enum { WORK_SIZE = 1000 };
+    naRef _work;
+    int _runs;
+    bool _ok;
+};
+
+/**
+ * Runs the same amount of work in one and in several threads, which
+ * allocate (and collect) concurrently.
+ */
+static void runThreads(naRef ns, int nthreads, int runs)
+{
+    naRef work = naHash_cget(ns, const_cast<char*>("work"));
+    std::vector<WorkThread*> threads;
+    naGCStats stats;
+    naGCGetStats(&stats);
+
+    SGTimeStamp start = SGTimeStamp::now();
+    for (int i = 0; i < nthreads; ++i) {
+        threads.push_back(new WorkThread(work, runs / nthreads));
+        threads.back()->start();
+    }
+    for (int i = 0; i < nthreads; ++i) {
+        threads[i]->join();
+        VERIFY(threads[i]->_ok);
+        delete threads[i];
+    }
+    double usec = (SGTimeStamp::now() - start).toUSecs();
+
+    naGCGetStats(&stats);
+    VERIFY(stats.cycles > 0);
+    cout << nthreads << " thread(s): " << usec / 1000 << " msec for "
+         << runs << " runs, " << stats.cycles << " collections" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    naContext ctx = naNewContext();
+    naRef ns = naInit_std(ctx);
+    naSave(ctx, ns);
+
+    int errLine = 0;
+    naRef file = naStr_fromdata(naNewString(ctx), const_cast<char*>("gc_test"), 7);
+    naRef code = naParseCode(ctx, file, 1, const_cast<char*>(script),
+                             strlen(script), &errLine);
+    if (naIsNil(code)) {
+        cerr << "** FAILED: line " << errLine << ": " << naGetError(ctx) << endl;
+        return EXIT_FAILURE;
+    }
+    naCall(ctx, naBindFunction(ctx, code, ns), 0, 0, naNil(), ns);
+    VERIFY(!naGetError(ctx));
+
+    // warm up, so both runs start with a grown heap
+    runFrames(ctx, ns, "warm-up", 200, 0);
+
+    naGCSetIncremental(0);
+    naGC();
+    runFrames(ctx, ns, "stop-the-world", 1000, 0);
+
+    naGCSetIncremental(1);
+    naGC();
+    naGCStats stats = runFrames(ctx, ns, "incremental", 1000, 0);
+    COMPARE(stats.forced, 0);
+    VERIFY(stats.steps > stats.cycles);
+    runFrames(ctx, ns, "incremental, 200 usec per frame", 1000, 200);
+
+    runThreads(ns, 1, 200);
+    runThreads(ns, 4, 200);
+
+    naFreeContext(ctx);
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
@@ -141,6 +141,8 @@ void naHash_set(naRef hash, naRef key, naRef val)
     if(!hr || hr->next >= POW2(hr->lgsz))
         hr = resize(PTR(hash).hash);
     hashset(hr, key, val);
+    GC_BARRIER(PTR(hash).hash);
+    PROTO_CHANGED(PTR(hash).hash);
 }
 
 void naHash_delete(naRef hash, naRef key)
@@ -149,6 +151,7 @@ void naHash_delete(naRef hash, naRef key)
     if(hr) {
         int cell = findcell(hr, key, refhash(key));
         if(TAB(hr)[cell] >= 0) {
+            PROTO_CHANGED(PTR(hash).hash);
             TAB(hr)[cell] = ENT_DELETED;
             if(--hr->size < POW2(hr->lgsz-1))
                 resize(PTR(hash).hash);
@@ -213,7 +216,12 @@ int naiHash_tryset(naRef hash, naRef key, naRef val)
     HashRec* hr = REC(hash);
     if(hr) {
         int ent, cell = findcell(hr, key, refhash(key));
-        if((ent = TAB(hr)[cell]) >= 0) { ENTS(hr)[ent].val = val; return 1; }
+        if((ent = TAB(hr)[cell]) >= 0) {
+            ENTS(hr)[ent].val = val;
+            GC_BARRIER(PTR(hash).hash);
+            PROTO_CHANGED(PTR(hash).hash);
+            return 1;
+        }
     }
     return 0;
 }
@@ -268,5 +276,7 @@ void naiHash_newsym(struct naHash* hash, naRef* sym, naRef* val)
     hr->size++;
     ENTS(hr)[TAB(hr)[cell]].key = *sym;
     ENTS(hr)[TAB(hr)[cell]].val = *val;
+    GC_BARRIER(hash);
+    PROTO_CHANGED(hash);
 }
 
@@ -0,0 +1,178 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "nasal.h"
+
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Every test returns 1 if the lookups see the right values, each one
+// changing the objects a cached lookup went through in some way.
+static const char* script =
+    "var Base = { name: func { \"base\" }, value: 1 };\n"
+    "var Derived = { parents: [Base] };\n"
+    "var get = func(o) { return o.value; };\n"
+    "\n"
+    "var shadowing = func {\n"
+    "    var a = { parents: [Derived] };\n"
+    "    var b = { parents: [Derived], value: 2 };\n"
+    "    return get(a) == 1 and get(b) == 2 and get(a) == 1;\n"
+    "}\n"
+    "var changeBase = func {\n"
+    "    var a = { parents: [Derived] };\n"
+    "    if (get(a) != 1) return 0;\n"
+    "    Base.value = 3;\n"
+    "    if (get(a) != 3) return 0;\n"
+    "    Derived.value = 4;\n"
+    "    if (get(a) != 4) return 0;\n"
+    "    delete(Derived, \"value\");\n"
+    "    Base.value = 1;\n"
+    "    return get(a) == 1;\n"
+    "}\n"
+    "var changeParents = func {\n"
+    "    var Other = { value: 5 };\n"
+    "    var a = { parents: [Derived] };\n"
+    "    var b = { parents: [Other] };\n"
+    "    if (get(a) != 1 or get(b) != 5) return 0;\n"
+    "    a.parents = [Other];\n"
+    "    if (get(a) != 5) return 0;\n"
+    "    Derived.parents[0] = Other;\n"
+    "    var c = { parents: [Derived] };\n"
+    "    if (get(c) != 5) return 0;\n"
+    "    Derived.parents = [Base];\n"
+    "    if (get(c) != 1) return 0;\n"
+    "    var d = { parents: [{}] };\n"
+    "    append(d.parents, Other);\n"
+    "    return get(d) == 5;\n"
+    "}\n"
+    "var methods = func {\n"
+    "    var a = { parents: [Derived] };\n"
+    "    if (a.name() != \"base\") return 0;\n"
+    "    Base.name = func { \"changed\" };\n"
+    "    var result = a.name() == \"changed\";\n"
+    "    Base.name = func { \"base\" };\n"
+    "    return result and a.name() == \"base\";\n"
+    "}\n"
+    "var missing = func {\n"
+    "    var a = { parents: [Derived] };\n"
+    "    var found = func(o) { return call(func { o.extra }, [], nil, nil, []); };\n"
+    "    if (found(a) != nil) return 0;\n"
+    "    Base.extra = 6;\n"
+    "    return found(a) == 6;\n"
+    "}\n"
+    "\n"
+    "# A class hierarchy depth levels deep, with the method at the top\n"
+    "var hierarchy = func(depth) {\n"
+    "    var cls = { value: 1, method: func { return me.value; } };\n"
+    "    for (var i = 0; i < depth; i += 1)\n"
+    "        cls = { parents: [cls] };\n"
+    "    return cls;\n"
+    "}\n"
+    "var objects = func(cls, n) {\n"
+    "    var v = [];\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        append(v, { parents: [cls], x: i });\n"
+    "    return v;\n"
+    "}\n"
+    "var lookups = func(v, n) {\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1)\n"
+    "        foreach (var o; v) sum += o.method() + o.x;\n"
+    "    return sum;\n"
+    "}\n"
+    "# As above, but changing the hierarchy before each round of lookups\n"
+    "var uncached = func(v, n) {\n"
+    "    var sum = 0;\n"
+    "    for (var i = 0; i < n; i += 1) {\n"
+    "        foreach (var o; v) {\n"
+    "            o.parents[0].touched = i;\n"
+    "            sum += o.method() + o.x;\n"
+    "        }\n"
+    "    }\n"
+    "    return sum;\n"
+    "}\n";
+
+static naRef call(naContext ctx, naRef ns, const char* name,
+                  int argc = 0, naRef* args = 0)
+{
+    naRef func = naHash_cget(ns, const_cast<char*>(name));
+    naRef result = naCall(ctx, func, argc, args, naNil(), naNil());
+    if (naGetError(ctx)) {
+        cerr << "** FAILED: " << name << ": " << naGetError(ctx) << endl;
+        exit(1);
+    }
+    return result;
+}
+
+static void benchmark(naContext ctx, naRef ns, int depth)
+{
+    const int objects = 100, rounds = 200;
+    naRef args[2];
+    args[0] = naNum(depth);
+    naRef cls = call(ctx, ns, "hierarchy", 1, args);
+    naSave(ctx, cls);
+    args[0] = cls;
+    args[1] = naNum(objects);
+    args[0] = call(ctx, ns, "objects", 2, args);
+    naSave(ctx, args[0]);
+    args[1] = naNum(rounds);
+
+    // sum of (1 + x) over all lookups
+    double expected = rounds * (objects + objects * (objects - 1) / 2.0);
+    double usec[2];
+    const char* funcs[2] = { "lookups", "uncached" };
+    for (int i = 0; i < 2; ++i) {
+        SGTimeStamp start = SGTimeStamp::now();
+        COMPARE(naNumValue(call(ctx, ns, funcs[i], 2, args)).num, expected);
+        usec[i] = (SGTimeStamp::now() - start).toUSecs();
+    }
+
+    double n = objects * rounds;
+    cout << "parents depth " << depth << ": "
+         << 1000 * usec[0] / n << " nsec per call cached, "
+         << 1000 * usec[1] / n << " nsec invalidated" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    naContext ctx = naNewContext();
+    naRef ns = naInit_std(ctx);
+    naSave(ctx, ns);
+
+    int errLine = 0;
+    naRef file = naStr_fromdata(naNewString(ctx), const_cast<char*>("member_test"), 11);
+    naRef code = naParseCode(ctx, file, 1, const_cast<char*>(script),
+                             strlen(script), &errLine);
+    if (naIsNil(code)) {
+        cerr << "** FAILED: line " << errLine << ": " << naGetError(ctx) << endl;
+        return EXIT_FAILURE;
+    }
+    naCall(ctx, naBindFunction(ctx, code, ns), 0, 0, naNil(), ns);
+    VERIFY(!naGetError(ctx));
+
+    COMPARE(naNumValue(call(ctx, ns, "shadowing")).num, 1.0);
+    COMPARE(naNumValue(call(ctx, ns, "changeBase")).num, 1.0);
+    COMPARE(naNumValue(call(ctx, ns, "changeParents")).num, 1.0);
+    COMPARE(naNumValue(call(ctx, ns, "methods")).num, 1.0);
+    COMPARE(naNumValue(call(ctx, ns, "missing")).num, 1.0);
+
+    benchmark(ctx, ns, 1);
+    benchmark(ctx, ns, 8);
+    benchmark(ctx, ns, 32);
+
+    naFreeContext(ctx);
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
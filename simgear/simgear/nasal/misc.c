@@ -66,9 +66,12 @@ naRef naStringValue(naContext c, naRef r)
 naRef naNew(struct Context* c, int type)
 {
     naRef result;
-    if(c->nfree[type] == 0)
-        c->free[type] = naGC_get(&globals->pools[type],
-                                 OBJ_CACHE_SZ, &c->nfree[type]);
+    if(c->nfree[type] == 0) {
+        c->nfree[type] = naGC_get(&globals->pools[type], c->free[type],
+                                  c->cachesz[type]);
+        if(c->cachesz[type] < OBJ_CACHE_SZ)
+            c->cachesz[type] *= 2;
+    }
     result = naObj(type, c->free[type][--c->nfree[type]]);
     naTempSave(c, result);
     return result;
@@ -87,6 +90,7 @@ naRef naNewString(struct Context* c)
 naRef naNewVector(struct Context* c)
 {
     naRef r = naNew(c, T_VEC);
+    PTR(r).vec->proto = 0;
     PTR(r).vec->rec = 0;
     return r;
 }
@@ -94,13 +98,17 @@ naRef naNewVector(struct Context* c)
 naRef naNewHash(struct Context* c)
 {
     naRef r = naNew(c, T_HASH);
+    PTR(r).hash->proto = 0;
     PTR(r).hash->rec = 0;
     return r;
 }
 
 naRef naNewCode(struct Context* c)
 {
-    return naNew(c, T_CODE);
+    naRef r = naNew(c, T_CODE);
+    PTR(r).code->nCaches = 0;
+    PTR(r).code->caches = 0;
+    return r;
 }
 
 naRef naNewCCode(struct Context* c, naCFunction fptr)
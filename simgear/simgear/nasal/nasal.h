@@ -265,6 +265,28 @@ int          naIsGhost(naRef r);
 void naModLock();
 void naModUnlock();
 
+// Garbage collection.  Once enough objects have been allocated, the
+// collector starts marking the live ones in small steps interleaved
+// with further allocations.  The world is only stopped for the final
+// root scan and the sweep, or for a complete collection when marking
+// can't keep up with allocation.  naGCSetIncremental(0) restores the
+// old behaviour of doing the whole collection at once.  naGCStep()
+// does up to usec microseconds of work on a collection in progress
+// (e.g. in time left over at the end of a frame), and naGC() a
+// complete collection.  Neither may be called with the mod lock held.
+// naGCGetStats() returns the statistics gathered since its last call.
+struct naGCStats {
+    int cycles;           // completed collections
+    int forced;           // ...of which had to be done all at once
+    int steps;            // incremental marking steps
+    double maxPauseUSec;  // longest time spent in a single GC pause
+    double totalPauseUSec;
+};
+void naGCSetIncremental(int enable);
+void naGCStep(double usec);
+void naGC();
+void naGCGetStats(struct naGCStats* out);
+
 // Library utilities.  Generate namespaces and add symbols.
 typedef struct { char* name; naCFunction func; } naCFuncItem;
 naRef naGenLib(naContext c, naCFuncItem *funcs);
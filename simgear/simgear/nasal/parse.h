@@ -85,6 +85,8 @@ struct CodeGenerator {
     int* optArgVals;
     naRef restArgSym;
 
+    int nCaches; // OP_MEMBER inline caches
+
     // Stack of "loop" frames for break/continue statements
     struct {
         int breakIP;
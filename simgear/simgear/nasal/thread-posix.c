@@ -1,6 +1,7 @@
 #ifndef _WIN32
 
 #include <pthread.h>
+#include <sys/time.h>
 #include "code.h"
 
 void* naNewLock()
@@ -68,6 +69,13 @@ void naSemUp(void* sh, int count)
     pthread_mutex_unlock(&sem->lock);
 }
 
+double naTimeUSec()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
 #endif
 
 extern int GccWarningWorkaround_IsoCForbidsAnEmptySourceFile;
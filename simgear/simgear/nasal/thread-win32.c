@@ -19,6 +19,14 @@ void  naSemDown(void* sem) { WaitForSingleObject((HANDLE)sem, INFINITE); }
 void  naSemUp(void* sem, int count) { ReleaseSemaphore(sem, count, 0); }
 void naFreeSem(void* sem) { ReleaseSemaphore(sem, 1, 0); }
 
+double naTimeUSec()
+{
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return count.QuadPart * 1e6 / freq.QuadPart;
+}
+
 #endif
 
 extern int GccWarningWorkaround_IsoCForbidsAnEmptySourceFile;
@@ -43,6 +43,8 @@ void naVec_set(naRef vec, int i, naRef o)
         struct VecRec* r = PTR(vec).vec->rec;
         if(r && i >= r->size) return;
         r->array[i] = o;
+        GC_BARRIER(PTR(vec).vec);
+        PROTO_CHANGED(PTR(vec).vec);
     }
 }
 
@@ -64,6 +66,8 @@ int naVec_append(naRef vec, naRef o)
             r = PTR(vec).vec->rec;
         }
         r->array[r->size] = o;
+        GC_BARRIER(PTR(vec).vec);
+        PROTO_CHANGED(PTR(vec).vec);
         return r->size++;
     }
     return 0;
@@ -84,6 +88,7 @@ void naVec_setsize(naContext c, naRef vec, int sz)
         for(i=0; i<sz; i++)
             nv->array[i] = (v && i < v->size) ? v->array[i] : naNil();
         naGC_swapfree((void*)&(PTR(vec).vec->rec), nv);
+        PROTO_CHANGED(PTR(vec).vec);
     }
 }
 
@@ -95,6 +100,7 @@ naRef naVec_removefirst(naRef vec)
     if(IS_VEC(vec)) {
         struct VecRec* v = PTR(vec).vec->rec;
         if(!v || v->size == 0) return naNil();
+        PROTO_CHANGED(PTR(vec).vec);
         o = v->array[0];
         for (i=1; i<v->size; i++)
             v->array[i-1] = v->array[i];
@@ -113,6 +119,7 @@ naRef naVec_removelast(naRef vec)
     if(IS_VEC(vec)) {
         struct VecRec* v = PTR(vec).vec->rec;
         if(!v || v->size == 0) return naNil();
+        PROTO_CHANGED(PTR(vec).vec);
         o = v->array[v->size - 1];
         v->size--;
         if(v->size < (v->alloced >> 1))
@@ -0,0 +1,192 @@
+// Read-only copies of property subtrees for use by other threads
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU Library General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "PropertySnapshot.hxx"
+#include "props_io.hxx"
+
+#include <string.h>
+
+namespace simgear
+{
+
+  /**
+   * Whether copy still matches src. Only typed getters are used on copy, as
+   * it may be read by other threads at the same time.
+   */
+  static bool sameProperties( const SGPropertyNode* src,
+                              const SGPropertyNode* copy )
+  {
+    if(    src->nChildren() != copy->nChildren()
+        || src->getAttributes() != copy->getAttributes() )
+      return false;
+
+    if( src->isAlias() )
+    {
+      // copyProperties() does not follow aliases
+      if( copy->hasValue() )
+        return false;
+    }
+    else if( src->hasValue() != copy->hasValue() )
+      return false;
+    else if( src->hasValue() )
+    {
+      if( src->getType() != copy->getType() )
+        return false;
+
+      switch( src->getType() )
+      {
+        case props::BOOL:
+          if( src->getBoolValue() != copy->getBoolValue() )
+            return false;
+          break;
+        case props::INT:
+          if( src->getIntValue() != copy->getIntValue() )
+            return false;
+          break;
+        case props::LONG:
+          if( src->getLongValue() != copy->getLongValue() )
+            return false;
+          break;
+        case props::FLOAT:
+          if( src->getFloatValue() != copy->getFloatValue() )
+            return false;
+          break;
+        case props::DOUBLE:
+          if( src->getDoubleValue() != copy->getDoubleValue() )
+            return false;
+          break;
+        case props::STRING:
+        case props::UNSPECIFIED:
+          if( strcmp(src->getStringValue(), copy->getStringValue()) != 0 )
+            return false;
+          break;
+        default:
+          // Rare types are simply copied again
+          return false;
+      }
+    }
+
+    for( int i = 0; i < src->nChildren(); ++i )
+    {
+      const SGPropertyNode* src_child = src->getChild(i);
+      const SGPropertyNode* copy_child = copy->getChild(i);
+      if(    src_child->getIndex() != copy_child->getIndex()
+          || strcmp(src_child->getName(), copy_child->getName()) != 0
+          || !sameProperties(src_child, copy_child) )
+        return false;
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  const SGPropertyNode*
+  PropertySnapshot::Frame::getSubtree(const std::string& path) const
+  {
+    for( size_t i = 0; i < _paths.size(); ++i )
+      if( _paths[i] == path )
+        return _copies[i];
+
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  PropertySnapshot::PropertySnapshot(SGPropertyNode* root):
+    _root(root),
+    _publish_count(0),
+    _copy_count(0)
+  {
+
+  }
+
+  //----------------------------------------------------------------------------
+  void PropertySnapshot::addSubtree(const std::string& path)
+  {
+    _subtrees.push_back(path);
+  }
+
+  //----------------------------------------------------------------------------
+  bool PropertySnapshot::publish()
+  {
+    unsigned current = _current_slot;
+    const Frame* prev = _frames[current];
+    if( prev && prev->_paths.size() != _subtrees.size() )
+      prev = 0;
+
+    SGSharedPtr<Frame> frame = new Frame;
+    frame->_paths = _subtrees;
+    frame->_copies.resize(_subtrees.size());
+
+    bool changed = !prev;
+    for( size_t i = 0; i < _subtrees.size(); ++i )
+    {
+      const SGPropertyNode* src = _root->getNode(_subtrees[i]);
+      const SGPropertyNode* old = prev ? prev->_copies[i].get() : 0;
+      if( !src )
+      {
+        changed |= (old != 0);
+        continue;
+      }
+
+      if( old && sameProperties(src, old) )
+      {
+        frame->_copies[i] = old;
+        continue;
+      }
+
+      SGPropertyNode_ptr copy = new SGPropertyNode;
+      copyProperties(src, copy);
+      frame->_copies[i] = copy;
+      ++_copy_count;
+      changed = true;
+    }
+
+    if( !changed )
+      return false;
+
+    // Readers which picked the other slot before the last publish() may
+    // still be copying its pointer, which does not take long.
+    unsigned next = 1 - current;
+    while( _readers[next] != 0 )
+      ;
+
+    _frames[next] = frame;
+    _current_slot.compareAndExchange(current, next);
+    ++_publish_count;
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  PropertySnapshot::FramePtr PropertySnapshot::get() const
+  {
+    for(;;)
+    {
+      // Once registered as a reader of the current slot, publish() leaves it
+      // alone. If it switched slots in between, try again with the new one.
+      unsigned slot = _current_slot;
+      ++_readers[slot];
+      if( _current_slot == slot )
+      {
+        FramePtr frame = _frames[slot];
+        --_readers[slot];
+        return frame;
+      }
+      --_readers[slot];
+    }
+  }
+
+} // namespace simgear
@@ -0,0 +1,143 @@
+// Read-only copies of property subtrees for use by other threads
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU Library General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA
+
+#ifndef SG_PROPERTY_SNAPSHOT_HXX_
+#define SG_PROPERTY_SNAPSHOT_HXX_
+
+#include <simgear/props/props.hxx>
+#include <simgear/structure/SGAtomic.hxx>
+
+#include <string>
+#include <vector>
+
+namespace simgear
+{
+
+  /**
+   * Publishes consistent, read-only copies of one or more property subtrees
+   * for threads other than the main loop.
+   *
+   * The owner (usually a subsystem running in the main loop) calls
+   * publish() once per frame. Subtrees which changed since the last call
+   * are copied, the others are shared with the previous frame. Any thread
+   * can call get() to obtain the most recent frame. A frame is never
+   * modified after it has been published and stays valid for as long as the
+   * returned pointer is held, so all values read from one frame belong to
+   * the same main loop iteration.
+   *
+   * @code
+   * // main thread
+   * PropertySnapshot snapshot(globals->get_props());
+   * snapshot.addSubtree("position");
+   * snapshot.addSubtree("orientation");
+   * ...
+   * snapshot.publish();
+   *
+   * // worker thread
+   * PropertySnapshot::FramePtr state = snapshot.get();
+   * const SGPropertyNode* pos = state ? state->getSubtree("position") : 0;
+   * if( pos )
+   *   lat = pos->getDoubleValue("latitude-deg");
+   * @endcode
+   *
+   * Reading a frame is safe from any number of threads, with one exception:
+   * getStringValue() on nodes not of type STRING formats into a buffer of
+   * the node, so use the typed getters instead.
+   */
+  class PropertySnapshot
+  {
+    public:
+
+      /**
+       * The copies of all subtrees made by one publish()
+       */
+      class Frame : public SGReferenced
+      {
+        public:
+          /**
+           * Get the copy of a subtree registered with addSubtree(), or 0 if
+           * the subtree did not exist.
+           */
+          const SGPropertyNode* getSubtree(const std::string& path) const;
+
+        private:
+          friend class PropertySnapshot;
+
+          std::vector<std::string>              _paths;
+          std::vector<SGConstPropertyNode_ptr>  _copies;
+      };
+
+      typedef SGSharedPtr<const Frame> FramePtr;
+
+      /**
+       * @param root  Node the subtree paths are relative to
+       */
+      explicit PropertySnapshot(SGPropertyNode* root);
+
+      /**
+       * Add a subtree to be copied by publish().
+       */
+      void addSubtree(const std::string& path);
+
+      /**
+       * Copy all changed subtrees and make them available to readers. Only to
+       * be called by the thread owning the source property tree. At most
+       * waits for a reader still taking a reference to the frame published
+       * two calls ago, whose slot is reused.
+       *
+       * @return false if nothing changed, so the previous frame has been kept.
+       */
+      bool publish();
+
+      /**
+       * Get the most recently published frame, or 0 if nothing has been
+       * published yet. Can be called from any thread, and never locks.
+       */
+      FramePtr get() const;
+
+      /**
+       * Get the number of frames published.
+       */
+      unsigned getPublishCount() const { return _publish_count; }
+
+      /**
+       * Get the number of subtrees copied, as opposed to shared with the
+       * previous frame, by all calls to publish().
+       */
+      unsigned getCopyCount() const { return _copy_count; }
+
+    private:
+
+      SGPropertyNode_ptr          _root;
+      std::vector<std::string>    _subtrees;
+
+      /// The current frame and the one before it. Readers announce which
+      /// slot they copy from in _readers, so publish() only overwrites the
+      /// other slot once nobody reads it any more.
+      FramePtr                    _frames[2];
+      SGAtomic                    _current_slot; ///< only changed by publish()
+      mutable SGAtomic            _readers[2];
+      SGAtomic                    _publish_count;
+      SGAtomic                    _copy_count;
+
+      // Non-copyable
+      PropertySnapshot(const PropertySnapshot&);
+      PropertySnapshot& operator=(const PropertySnapshot&);
+  };
+
+} // namespace simgear
+
+#endif /* SG_PROPERTY_SNAPSHOT_HXX_ */
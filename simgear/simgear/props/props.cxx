@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
 
 #include <set>
 #include <sstream>
@@ -30,6 +31,10 @@
 #include <boost/bind.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/range.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #if PROPS_STANDALONE
 #include <iostream>
@@ -215,19 +220,213 @@ find_last_child (const char * name, const PropertyList& nodes)
   return index;
 }
 
+////////////////////////////////////////////////////////////////////////
+// Hashed child lookup.
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * Hash a (name, index) pair. Equal for any iterator type over the same
+ * characters, so lookups never need to copy the name.
+ */
+template<typename Itr>
+inline size_t
+hash_child_key (Itr begin, Itr end, int index)
+{
+  size_t seed = boost::hash_range(begin, end);
+  boost::hash_combine(seed, index);
+  return seed;
+}
+
+/**
+ * Lookup table for the children of nodes with many children (eg.
+ * /ai/models or /sim/multiplay). Keys refer to the name stored in the child
+ * itself, so every name is held only once and no strings are copied.
+ */
+class SGPropertyNode::ChildIndex
+{
+public:
+
+  template<typename Itr>
+  SGPropertyNode* find (Itr begin, Itr end, int index) const
+  {
+    NodeMap::const_iterator it =
+      _nodes.find(RangeKey<Itr>(begin, end, index), KeyHash(), KeyEqual());
+    return it != _nodes.end() ? it->second : 0;
+  }
+
+  int findLast (const char * name) const
+  {
+    LastIndexMap::const_iterator it =
+      _last.find(name, NameHash(), NameEqual());
+    return it != _last.end() ? it->second : -1;
+  }
+
+  void insert (SGPropertyNode * node)
+  {
+    const string& name = node->getNameString();
+    int index = node->getIndex();
+    _nodes[NodeKey(&name, index)] = node;
+
+    if (index < 0)
+      return;
+    LastIndexMap::iterator it = _last.find(name);
+    if (it == _last.end())
+      _last.insert(std::make_pair(name, index));
+    else if (index > it->second)
+      it->second = index;
+  }
+
+  void erase (SGPropertyNode * node)
+  {
+    const string& name = node->getNameString();
+    int index = node->getIndex();
+    NodeMap::iterator it = _nodes.find(NodeKey(&name, index));
+    if (it == _nodes.end() || it->second != node)
+      return;
+    _nodes.erase(it);
+
+    LastIndexMap::iterator last = _last.find(name);
+    if (last == _last.end() || last->second != index)
+      return;
+
+    // Indices are usually dense, so walking down finds the new maximum fast
+    for (int i = index - 1; i >= 0; --i) {
+      if (find(name.begin(), name.end(), i)) {
+        last->second = i;
+        return;
+      }
+    }
+    _last.erase(last);
+  }
+
+private:
+
+  struct NodeKey
+  {
+    NodeKey (const string* n, int i) : name(n), index(i) {}
+    const string* name;
+    int index;
+  };
+
+  template<typename Itr>
+  struct RangeKey
+  {
+    RangeKey (Itr b, Itr e, int i) : begin(b), end(e), index(i) {}
+    Itr begin;
+    Itr end;
+    int index;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const NodeKey& key) const
+    {
+      return hash_child_key(key.name->begin(), key.name->end(), key.index);
+    }
+
+    template<typename Itr>
+    size_t operator()(const RangeKey<Itr>& key) const
+    {
+      return hash_child_key(key.begin, key.end, key.index);
+    }
+  };
+
+  struct KeyEqual
+  {
+    bool operator()(const NodeKey& lhs, const NodeKey& rhs) const
+    {
+      return lhs.index == rhs.index && *lhs.name == *rhs.name;
+    }
+
+    template<typename Itr>
+    bool operator()(const RangeKey<Itr>& lhs, const NodeKey& rhs) const
+    {
+      return lhs.index == rhs.index
+          && boost::equals(*rhs.name, boost::make_iterator_range(lhs.begin,
+                                                                 lhs.end));
+    }
+  };
+
+  struct NameHash
+  {
+    size_t operator()(const string& name) const
+    {
+      return boost::hash_range(name.begin(), name.end());
+    }
+
+    size_t operator()(const char* name) const
+    {
+      return boost::hash_range(name, name + strlen(name));
+    }
+  };
+
+  struct NameEqual
+  {
+    bool operator()(const string& lhs, const string& rhs) const
+    {
+      return lhs == rhs;
+    }
+
+    bool operator()(const char* lhs, const string& rhs) const
+    {
+      return rhs == lhs;
+    }
+  };
+
+  typedef boost::unordered_map<NodeKey, SGPropertyNode*, KeyHash, KeyEqual>
+    NodeMap;
+  typedef boost::unordered_map<string, int, NameHash, NameEqual>
+    LastIndexMap;
+
+  NodeMap _nodes;
+  LastIndexMap _last;
+};
+
+int SGPropertyNode::_child_index_threshold = 16;
+SGAtomic SGPropertyNode::_listener_calls;
+
+void
+SGPropertyNode::setChildIndexThreshold (int threshold)
+{
+  _child_index_threshold = threshold;
+}
+
+int
+SGPropertyNode::getChildIndexThreshold ()
+{
+  return _child_index_threshold;
+}
+
+template<typename Itr>
+inline SGPropertyNode*
+SGPropertyNode::lookupChild (Itr begin, Itr end, int index) const
+{
+  if (_child_index)
+    return _child_index->find(begin, end, index);
+
+  int pos = find_child(begin, end, index, _children);
+  return pos >= 0 ? _children[pos].ptr() : 0;
+}
+
+int
+SGPropertyNode::lastChildIndex (const char * name) const
+{
+  if (_child_index)
+    return _child_index->findLast(name);
+  return find_last_child(name, _children);
+}
+
 /**
  * Get first unused index for child nodes with the given name
  */
-static int
-first_unused_index( const char * name,
-                    const PropertyList& nodes,
-                    int min_index )
+int
+SGPropertyNode::firstUnusedChildIndex (const char * name, int min_index) const
 {
   const char* nameEnd = name + strlen(name);
 
   for( int index = min_index; index < std::numeric_limits<int>::max(); ++index )
   {
-    if( find_child(name, nameEnd, index, nodes) < 0 )
+    if( !lookupChild(name, nameEnd, index) )
       return index;
   }
 
@@ -235,23 +434,39 @@ first_unused_index( const char * name,
   return -1;
 }
 
+void
+SGPropertyNode::appendChild (SGPropertyNode * node)
+{
+  _children.push_back(node);
+  newStructureGeneration();
+
+  if (_child_index) {
+    _child_index->insert(node);
+  } else if (_child_index_threshold >= 0
+             && _children.size() > (size_t)_child_index_threshold) {
+    _child_index = new ChildIndex;
+    for (size_t i = 0; i < _children.size(); ++i)
+      _child_index->insert(_children[i]);
+  }
+}
+
 template<typename Itr>
 inline SGPropertyNode*
 SGPropertyNode::getExistingChild (Itr begin, Itr end, int index, bool create)
 {
-  int pos = find_child(begin, end, index, _children);
-  if (pos >= 0) {
-    return _children[pos];
+  SGPropertyNode* existing = lookupChild(begin, end, index);
+  if (existing) {
+    return existing;
   } else if (create) {
     SGPropertyNode_ptr node;
-    pos = find_child(begin, end, index, _removedChildren);
+    int pos = find_child(begin, end, index, _removedChildren);
     if (pos >= 0) {
       PropertyList::iterator it = _removedChildren.begin();
       it += pos;
       node = _removedChildren[pos];
       _removedChildren.erase(it);
       node->setAttribute(REMOVED, false);
-      _children.push_back(node);
+      appendChild(node);
       fireChildAdded(node);
       return node;      
     }
@@ -269,7 +484,7 @@ SGPropertyNode::getChildImpl (Itr begin, Itr end, int index, bool create)
       return node;
     } else if (create) {
       node = new SGPropertyNode(begin, end, index, this);
-      _children.push_back(node);
+      appendChild(node);
       fireChildAdded(node);
       return node;
     } else {
@@ -660,6 +875,22 @@ SGPropertyNode::trace_read () const
  */
 const int SGPropertyNode::LAST_USED_ATTRIBUTE = PRESERVE;
 
+SGAtomic SGPropertyNode::_last_structure_generation;
+
+/**
+ * Give the node a structure generation no node had before, so a cached
+ * path can also tell another node allocated at the same address apart.
+ */
+void
+SGPropertyNode::newStructureGeneration ()
+{
+  unsigned int generation = ++_last_structure_generation;
+  unsigned int old;
+  do {
+    old = _structure_generation;
+  } while (!_structure_generation.compareAndExchange(old, generation));
+}
+
 /**
  * Default constructor: always creates a root node.
  */
@@ -668,8 +899,11 @@ SGPropertyNode::SGPropertyNode ()
     _parent(0),
     _type(props::NONE),
     _tied(false),
+    _change_pending(0),
+    _structure_generation(++_last_structure_generation),
     _attr(READ|WRITE),
-    _listeners(0)
+    _listeners(0),
+    _child_index(0)
 {
   _local_val.string_val = 0;
   _value.val = 0;
@@ -686,8 +920,11 @@ SGPropertyNode::SGPropertyNode (const SGPropertyNode &node)
     _parent(0),			// don't copy the parent
     _type(node._type),
     _tied(node._tied),
+    _change_pending(0),
+    _structure_generation(++_last_structure_generation),
     _attr(node._attr),
-    _listeners(0)		// CHECK!!
+    _listeners(0),		// CHECK!!
+    _child_index(0)
 {
   _local_val.string_val = 0;
   _value.val = 0;
@@ -741,8 +978,11 @@ SGPropertyNode::SGPropertyNode (Itr begin, Itr end,
     _parent(parent),
     _type(props::NONE),
     _tied(false),
+    _change_pending(0),
+    _structure_generation(++_last_structure_generation),
     _attr(READ|WRITE),
-    _listeners(0)
+    _listeners(0),
+    _child_index(0)
 {
   _local_val.string_val = 0;
   _value.val = 0;
@@ -758,8 +998,11 @@ SGPropertyNode::SGPropertyNode (const string& name,
     _parent(parent),
     _type(props::NONE),
     _tied(false),
+    _change_pending(0),
+    _structure_generation(++_last_structure_generation),
     _attr(READ|WRITE),
-    _listeners(0)
+    _listeners(0),
+    _child_index(0)
 {
   _local_val.string_val = 0;
   _value.val = 0;
@@ -777,6 +1020,9 @@ SGPropertyNode::~SGPropertyNode ()
     _children[i]->_parent = 0;
   for (unsigned i = 0; i < _removedChildren.size(); ++i)
     _removedChildren[i]->_parent = 0;
+  delete _child_index;
+  if (_change_pending)
+    SGPropertyTransaction::dequeue(this);
   clearValue();
 
   if (_listeners) {
@@ -878,12 +1124,12 @@ SGPropertyNode *
 SGPropertyNode::addChild(const char * name, int min_index, bool append)
 {
   int pos = append
-          ? std::max(find_last_child(name, _children) + 1, min_index)
-          : first_unused_index(name, _children, min_index);
+          ? std::max(lastChildIndex(name) + 1, min_index)
+          : firstUnusedChildIndex(name, min_index);
 
   SGPropertyNode_ptr node;
   node = new SGPropertyNode(name, name + strlen(name), pos, this);
-  _children.push_back(node);
+  appendChild(node);
   fireChildAdded(node);
   return node;
 }
@@ -915,7 +1161,7 @@ SGPropertyNode::addChildren( const std::string& name,
   else
   {
     // If we don't want to fill the holes just find last node
-    min_index = std::max(find_last_child(name.c_str(), _children) + 1, min_index);
+    min_index = std::max(lastChildIndex(name.c_str()) + 1, min_index);
   }
 
   for( int index = min_index;
@@ -926,7 +1172,7 @@ SGPropertyNode::addChildren( const std::string& name,
     {
       SGPropertyNode_ptr node;
       node = new SGPropertyNode(name, index, this);
-      _children.push_back(node);
+      appendChild(node);
       fireChildAdded(node);
       nodes.push_back(node);
     }
@@ -980,7 +1226,7 @@ SGPropertyNode::getChild (const string& name, int index, bool create)
       return node;
     } else if (create) {
       node = new SGPropertyNode(name, index, this);
-      _children.push_back(node);
+      appendChild(node);
       fireChildAdded(node);
       return node;
     } else {
@@ -994,11 +1240,7 @@ SGPropertyNode::getChild (const string& name, int index, bool create)
 const SGPropertyNode *
 SGPropertyNode::getChild (const char * name, int index) const
 {
-  int pos = find_child(name, name + strlen(name), index, _children);
-  if (pos >= 0)
-    return _children[pos];
-  else
-    return 0;
+  return lookupChild(name, name + strlen(name), index);
 }
 
 
@@ -1034,6 +1276,9 @@ SGPropertyNode::removeChild (int pos, bool keep)
   it += pos;
   node = _children[pos];
   _children.erase(it);
+  newStructureGeneration();
+  if (_child_index)
+    _child_index->erase(node);
   if (keep) {
     _removedChildren.push_back(node);
   }
@@ -1052,9 +1297,16 @@ SGPropertyNode_ptr
 SGPropertyNode::removeChild (const char * name, int index, bool keep)
 {
   SGPropertyNode_ptr ret;
-  int pos = find_child(name, name + strlen(name), index, _children);
-  if (pos >= 0)
-    ret = removeChild(pos, keep);
+  SGPropertyNode* node = lookupChild(name, name + strlen(name), index);
+  if (!node)
+    return ret;
+
+  for (size_t pos = 0; pos < _children.size(); ++pos) {
+    if (_children[pos].ptr() == node) {
+      ret = removeChild(static_cast<int>(pos), keep);
+      break;
+    }
+  }
   return ret;
 }
 
@@ -2143,6 +2395,115 @@ SGPropertyNode::untie (const char * relative_path)
   return (node == 0 ? false : node->untie());
 }
 
+
+
+////////////////////////////////////////////////////////////////////////
+// Convenience methods using pre-compiled paths.
+////////////////////////////////////////////////////////////////////////
+
+SGPropertyNode *
+SGPropertyNode::getNode (const SGPropertyPath& path, bool create)
+{
+  return path.resolve(this, create);
+}
+
+const SGPropertyNode *
+SGPropertyNode::getNode (const SGPropertyPath& path) const
+{
+  return path.resolve(this);
+}
+
+bool
+SGPropertyNode::hasValue (const SGPropertyPath& path) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? false : node->hasValue());
+}
+
+bool
+SGPropertyNode::getBoolValue (const SGPropertyPath& path,
+                              bool defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getBoolValue());
+}
+
+int
+SGPropertyNode::getIntValue (const SGPropertyPath& path,
+                             int defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getIntValue());
+}
+
+long
+SGPropertyNode::getLongValue (const SGPropertyPath& path,
+                              long defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getLongValue());
+}
+
+float
+SGPropertyNode::getFloatValue (const SGPropertyPath& path,
+                               float defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getFloatValue());
+}
+
+double
+SGPropertyNode::getDoubleValue (const SGPropertyPath& path,
+                                double defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getDoubleValue());
+}
+
+const char *
+SGPropertyNode::getStringValue (const SGPropertyPath& path,
+                                const char * defaultValue) const
+{
+  const SGPropertyNode * node = getNode(path);
+  return (node == 0 ? defaultValue : node->getStringValue());
+}
+
+bool
+SGPropertyNode::setBoolValue (const SGPropertyPath& path, bool value)
+{
+  return getNode(path, true)->setBoolValue(value);
+}
+
+bool
+SGPropertyNode::setIntValue (const SGPropertyPath& path, int value)
+{
+  return getNode(path, true)->setIntValue(value);
+}
+
+bool
+SGPropertyNode::setLongValue (const SGPropertyPath& path, long value)
+{
+  return getNode(path, true)->setLongValue(value);
+}
+
+bool
+SGPropertyNode::setFloatValue (const SGPropertyPath& path, float value)
+{
+  return getNode(path, true)->setFloatValue(value);
+}
+
+bool
+SGPropertyNode::setDoubleValue (const SGPropertyPath& path, double value)
+{
+  return getNode(path, true)->setDoubleValue(value);
+}
+
+bool
+SGPropertyNode::setStringValue (const SGPropertyPath& path, const char * value)
+{
+  return getNode(path, true)->setStringValue(value);
+}
+
 void
 SGPropertyNode::addChangeListener (SGPropertyChangeListener * listener,
                                    bool initial)
@@ -2176,13 +2537,27 @@ SGPropertyNode::removeChangeListener (SGPropertyChangeListener * listener)
 void
 SGPropertyNode::fireValueChanged ()
 {
-  fireValueChanged(this);
+  if (SGPropertyTransaction::isActive())
+    SGPropertyTransaction::queue(this);
+  else
+    fireValueChanged(this);
+}
+
+void
+SGPropertyNode::resetListenerCallCount ()
+{
+  unsigned int calls = _listener_calls;
+  while (!_listener_calls.compareAndExchange(calls, 0))
+    calls = _listener_calls;
 }
 
 void
 SGPropertyNode::fireChildAdded (SGPropertyNode * child)
 {
-  fireChildAdded(this, child);
+  if (SGPropertyTransaction::isDeferring())
+    SGPropertyTransaction::queueChild(true, this, child);
+  else
+    fireChildAdded(this, child);
 }
 
 void
@@ -2203,7 +2578,10 @@ SGPropertyNode::fireCreatedRecursive(bool fire_self)
 void
 SGPropertyNode::fireChildRemoved (SGPropertyNode * child)
 {
-  fireChildRemoved(this, child);
+  if (SGPropertyTransaction::isDeferring())
+    SGPropertyTransaction::queueChild(false, this, child);
+  else
+    fireChildRemoved(this, child);
 }
 
 void
@@ -2212,7 +2590,7 @@ SGPropertyNode::fireChildrenRemovedRecursive()
   for(size_t i = 0; i < _children.size(); ++i)
   {
     SGPropertyNode* child = _children[i];
-    fireChildRemoved(this, child);
+    fireChildRemoved(child);
     child->fireChildrenRemovedRecursive();
   }
 }
@@ -2222,6 +2600,7 @@ SGPropertyNode::fireValueChanged (SGPropertyNode * node)
 {
   if (_listeners != 0) {
     for (unsigned int i = 0; i < _listeners->size(); i++) {
+      ++_listener_calls;
       (*_listeners)[i]->valueChanged(node);
     }
   }
@@ -2235,6 +2614,7 @@ SGPropertyNode::fireChildAdded (SGPropertyNode * parent,
 {
   if (_listeners != 0) {
     for (unsigned int i = 0; i < _listeners->size(); i++) {
+      ++_listener_calls;
       (*_listeners)[i]->childAdded(parent, child);
     }
   }
@@ -2248,6 +2628,7 @@ SGPropertyNode::fireChildRemoved (SGPropertyNode * parent,
 {
   if (_listeners != 0) {
     for (unsigned int i = 0; i < _listeners->size(); i++) {
+      ++_listener_calls;
       (*_listeners)[i]->childRemoved(parent, child);
     }
   }
@@ -2255,6 +2636,384 @@ SGPropertyNode::fireChildRemoved (SGPropertyNode * parent,
     _parent->fireChildRemoved(parent, child);
 }
 
+////////////////////////////////////////////////////////////////////////
+// Implementation of SGPropertyPath.
+////////////////////////////////////////////////////////////////////////
+
+SGPropertyPath::SGPropertyPath ()
+  : _absolute(false),
+    _start(0),
+    _found(false)
+{
+}
+
+SGPropertyPath::SGPropertyPath (const char * path)
+  : _path(path),
+    _absolute(false),
+    _start(0),
+    _found(false)
+{
+  compile();
+}
+
+SGPropertyPath::SGPropertyPath (const string& path)
+  : _path(path),
+    _absolute(false),
+    _start(0),
+    _found(false)
+{
+  compile();
+}
+
+SGPropertyPath::~SGPropertyPath ()
+{
+}
+
+/**
+ * Split the path into (name, index) components, following the same rules
+ * as find_node() and parse_name().
+ */
+void
+SGPropertyPath::compile ()
+{
+  _absolute = !_path.empty() && _path[0] == '/';
+
+  size_t pos = 0;
+  while (pos <= _path.size()) {
+    size_t next = _path.find('/', pos);
+    if (next == string::npos)
+      next = _path.size();
+    string token = _path.substr(pos, next - pos);
+    pos = next + 1;
+
+    // Empty tokens (eg. from '//' or a leading '/') and '.' are no-ops
+    if (token.empty() || token == ".")
+      continue;
+    if (token == "..") {
+      _components.push_back(Component(string(), 0));
+      continue;
+    }
+    if (token[0] == '.')
+      throw string("illegal character after . or ..");
+    if (!isalpha(token[0]) && token[0] != '_')
+      throw string("'") + token[0] + "' found in property path '" + _path
+          + "'\nname must begin with alpha or '_'";
+
+    size_t i = 1;
+    while (i < token.size() && token[i] != '[') {
+      char c = token[i];
+      if (!isalpha(c) && !isdigit(c) && c != '_' && c != '-' && c != '.')
+        throw string("'") + c + "' found in property path '" + _path
+            + "'\nname may contain only ._- and alphanumeric characters";
+      ++i;
+    }
+
+    int index = 0;
+    if (i < token.size()) {
+      size_t j = i + 1;
+      for (; j < token.size() && isdigit(token[j]); ++j)
+        index = (index * 10) + (token[j] - '0');
+      if (j == token.size() || token[j] != ']')
+        throw string("unterminated index (looking for ']')");
+    }
+    _components.push_back(Component(token.substr(0, i), index));
+  }
+}
+
+/**
+ * Whether the last result for start is still valid: no child has been added
+ * to or removed from any node on the way since.
+ */
+bool
+SGPropertyPath::isCached (const SGPropertyNode * start, bool create) const
+{
+  if (start != _start || _chain.empty() || (create && !_found))
+    return false;
+  if (_absolute && start->getRootNode() != _chain.front())
+    return false;
+  // A node is only looked at after the one before it was found unchanged,
+  // so it is still that node's child, or parent, and alive
+  for (size_t i = 0; i < _chain.size(); ++i) {
+    if (_chain[i]->getStructureGeneration() != _generations[i])
+      return false;
+    if (i + 1 < _chain.size() && _components[i].name.empty()
+        && _chain[i]->getParent() != _chain[i + 1])
+      return false;
+  }
+  return true;
+}
+
+SGPropertyNode *
+SGPropertyPath::resolve (SGPropertyNode * start, bool create) const
+{
+  if (isCached(start, create))
+    return _found ? _chain.back() : 0;
+
+  _chain.clear();
+  SGPropertyNode * node = _absolute ? start->getRootNode() : start;
+  _chain.push_back(node);
+  for (size_t i = 0; i < _components.size() && node; ++i) {
+    const Component& comp = _components[i];
+    if (comp.name.empty()) {
+      node = node->getParent();
+      if (!node)
+        throw string("attempt to move past root with '..'");
+    } else {
+      node = node->getChild(comp.name, comp.index, create);
+    }
+    if (node)
+      _chain.push_back(node);
+  }
+
+  // Read the generations only now, as creating nodes increments them
+  _generations.resize(_chain.size());
+  for (size_t i = 0; i < _chain.size(); ++i)
+    _generations[i] = _chain[i]->getStructureGeneration();
+  _start = start;
+  _found = (node != 0);
+  return node;
+}
+
+const SGPropertyNode *
+SGPropertyPath::resolve (const SGPropertyNode * start) const
+{
+  return resolve(const_cast<SGPropertyNode*>(start), false);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Implementation of SGPropertyTransaction.
+////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  enum EventType { VALUE_CHANGED, CHILD_ADDED, CHILD_REMOVED };
+
+  /**
+   * A queued listener notification. node is the changed node, or the
+   * parent of a child event.
+   */
+  struct Event
+  {
+    Event (EventType t, SGPropertyNode * n, SGPropertyNode * c = 0)
+      : type(t), node(n), child(c) {}
+
+    EventType type;
+    SGPropertyNode * node;      ///< 0 if destroyed while queued
+    SGPropertyNode_ptr child;
+  };
+
+  typedef std::vector<Event> EventQueue;
+
+  /**
+   * Transaction state of one thread. Kept from its outermost transaction
+   * until the queued changes have been dispatched.
+   */
+  struct TransactionState
+  {
+    TransactionState () : depth(0), deferDepth(0), deferAll(false), next(0) {}
+
+    int depth;
+    int deferDepth; ///< Number of open DEFER transactions
+    bool deferAll;  ///< The outermost transaction is DEFER
+    EventQueue pending;
+    std::set<SGPropertyNode*> queued; ///< Nodes with value changes in pending
+    size_t next; ///< Next event to dispatch from pending
+  };
+
+  typedef std::map<long, TransactionState> TransactionStates;
+
+#ifdef _MSC_VER
+# define SG_THREAD_LOCAL __declspec(thread)
+#else
+# define SG_THREAD_LOCAL __thread
+#endif
+
+  // The calling thread's entry in transactionStates, or 0. Only the owning
+  // thread changes its depths, so it can test them without the lock.
+  SG_THREAD_LOCAL TransactionState* currentState = 0;
+
+  // Guards all of the following and the pending events of every state
+  SGMutex transactionMutex;
+  TransactionStates transactionStates;
+  EventQueue deferredEvents;
+  size_t nextDeferred = 0;
+
+  /**
+   * Null out the events of a node about to be destroyed.
+   */
+  void dequeueEvents (EventQueue& events, size_t first, SGPropertyNode* node)
+  {
+    for (size_t i = first; i < events.size(); ++i)
+      if (events[i].node == node)
+        events[i].node = 0;
+  }
+}
+
+SGPropertyTransaction::SGPropertyTransaction (Mode mode)
+  : _mode(mode)
+{
+  SGGuard<SGMutex> lock(transactionMutex);
+  if (!currentState)
+    currentState = &transactionStates[SGThread::current()];
+  if (currentState->depth++ == 0)
+    currentState->deferAll = (mode == DEFER);
+  if (mode == DEFER)
+    ++currentState->deferDepth;
+}
+
+SGPropertyTransaction::~SGPropertyTransaction ()
+{
+  {
+    SGGuard<SGMutex> lock(transactionMutex);
+    TransactionState& state = *currentState;
+    if (_mode == DEFER)
+      --state.deferDepth;
+    if (--state.depth > 0)
+      return;
+
+    if (state.deferAll) {
+      // Hand everything over to dispatchDeferred(). The nodes stay
+      // counted in _change_pending until dispatched.
+      deferredEvents.insert(deferredEvents.end(),
+                            state.pending.begin() + state.next,
+                            state.pending.end());
+      transactionStates.erase(SGThread::current());
+      currentState = 0;
+      return;
+    }
+  }
+
+  // Listeners changing values while we dispatch are notified immediately.
+  // If a listener itself commits a transaction, that commit continues with
+  // the remaining queue, so look the state up again for every event.
+  // Events keep child nodes alive, which must not be destroyed while
+  // holding the lock, as their destructor may take it.
+  for (;;) {
+    Event event(VALUE_CHANGED, 0);
+    EventQueue done;
+    {
+      SGGuard<SGMutex> lock(transactionMutex);
+      if (!currentState)
+        break;
+      TransactionState& state = *currentState;
+      if (state.next == state.pending.size()) {
+        done.swap(state.pending);
+        transactionStates.erase(SGThread::current());
+        currentState = 0;
+        break;
+      }
+      event = state.pending[state.next++];
+      if (!event.node) // destroyed while queued
+        continue;
+      if (event.type == VALUE_CHANGED)
+        state.queued.erase(event.node);
+      --event.node->_change_pending;
+    }
+    dispatch(event.type, event.node, event.child);
+  }
+}
+
+bool
+SGPropertyTransaction::isActive ()
+{
+  return currentState && currentState->depth > 0;
+}
+
+bool
+SGPropertyTransaction::isDeferring ()
+{
+  return currentState && currentState->deferDepth > 0;
+}
+
+void
+SGPropertyTransaction::dispatchDeferred ()
+{
+  for (;;) {
+    Event event(VALUE_CHANGED, 0);
+    EventQueue done; // see ~SGPropertyTransaction
+    {
+      SGGuard<SGMutex> lock(transactionMutex);
+      if (nextDeferred == deferredEvents.size()) {
+        done.swap(deferredEvents);
+        nextDeferred = 0;
+        return;
+      }
+      event = deferredEvents[nextDeferred++];
+      if (!event.node)
+        continue;
+      --event.node->_change_pending;
+    }
+    dispatch(event.type, event.node, event.child);
+  }
+}
+
+void
+SGPropertyTransaction::queue (SGPropertyNode * node)
+{
+  SGGuard<SGMutex> lock(transactionMutex);
+  TransactionState& state = *currentState;
+  if (state.queued.insert(node).second) {
+    state.pending.push_back(Event(VALUE_CHANGED, node));
+    ++node->_change_pending;
+  }
+}
+
+void
+SGPropertyTransaction::queueChild (bool added, SGPropertyNode * parent,
+                                   SGPropertyNode * child)
+{
+  SGGuard<SGMutex> lock(transactionMutex);
+  TransactionState& state = *currentState;
+  state.pending.push_back(Event(added ? CHILD_ADDED : CHILD_REMOVED,
+                                parent, child));
+  ++parent->_change_pending;
+}
+
+void
+SGPropertyTransaction::dequeue (SGPropertyNode * node)
+{
+  SGGuard<SGMutex> lock(transactionMutex);
+  TransactionStates::iterator it;
+  for (it = transactionStates.begin(); it != transactionStates.end(); ++it) {
+    TransactionState& state = it->second;
+    state.queued.erase(node);
+    dequeueEvents(state.pending, state.next, node);
+  }
+  dequeueEvents(deferredEvents, nextDeferred, node);
+}
+
+/**
+ * Notify the listeners of the event's node and its ancestors. For value
+ * changes, each listener is called only once even if it is registered on
+ * several of them.
+ */
+void
+SGPropertyTransaction::dispatch (int type, SGPropertyNode * node,
+                                 SGPropertyNode * child)
+{
+  if (type == CHILD_ADDED) {
+    node->fireChildAdded(node, child);
+    return;
+  } else if (type == CHILD_REMOVED) {
+    node->fireChildRemoved(node, child);
+    return;
+  }
+
+  vector<SGPropertyChangeListener*> called;
+  for (SGPropertyNode* n = node; n; n = n->_parent) {
+    if (!n->_listeners)
+      continue;
+    for (unsigned int i = 0; i < n->_listeners->size(); i++) {
+      SGPropertyChangeListener* listener = (*n->_listeners)[i];
+      if (find(called.begin(), called.end(), listener) != called.end())
+        continue;
+      called.push_back(listener);
+      ++SGPropertyNode::_listener_calls;
+      listener->valueChanged(node);
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Implementation of SGPropertyChangeListener.
 ////////////////////////////////////////////////////////////////////////
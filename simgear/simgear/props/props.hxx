@@ -32,6 +32,7 @@
 
 #include <simgear/math/SGMathFwd.hxx>
 #include <simgear/math/sg_types.hxx>
+#include <simgear/structure/SGAtomic.hxx>
 #include <simgear/structure/SGReferenced.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
 
@@ -679,6 +680,8 @@ class SGPropertyNode;
 typedef SGSharedPtr<SGPropertyNode> SGPropertyNode_ptr;
 typedef SGSharedPtr<const SGPropertyNode> SGConstPropertyNode_ptr;
 
+class SGPropertyPath;
+
 namespace simgear
 {
 typedef std::vector<SGPropertyNode_ptr> PropertyList;
@@ -939,6 +942,26 @@ public:
                                         bool keep = true)
   { return removeChildren(name.c_str(), keep); }
 
+  /**
+   * Set the number of children above which a node maintains a hashed
+   * (name, index) lookup table for its children. Nodes with fewer children
+   * are searched linearly. A negative value disables the lookup table for
+   * nodes gaining children from now on.
+   */
+  static void setChildIndexThreshold (int threshold);
+
+  /**
+   * Get the number of children above which a node hashes its children.
+   */
+  static int getChildIndexThreshold ();
+
+  /**
+   * Get a number which changes every time a child is added to or removed
+   * from this node. No two nodes ever had the same number, so it also
+   * tells nodes apart. Used to invalidate cached path lookups.
+   */
+  unsigned int getStructureGeneration () const { return _structure_generation; }
+
   //
   // Alias support.
   //
@@ -1078,6 +1101,19 @@ public:
 				  int index) const
   { return getNode(relative_path.c_str(), index); }
 
+  /**
+   * Get a pointer to another node by pre-compiled path.
+   *
+   * The path is only parsed once and the node it resolves to is cached
+   * until the structure of the property tree changes.
+   */
+  SGPropertyNode * getNode (const SGPropertyPath& path, bool create = false);
+
+  /**
+   * Get a const pointer to another node by pre-compiled path.
+   */
+  const SGPropertyNode * getNode (const SGPropertyPath& path) const;
+
   //
   // Access Mode.
   //
@@ -1492,6 +1528,84 @@ public:
   bool setUnspecifiedValue (const char * relative_path, const char * value);
 
 
+  //
+  // Convenience methods using pre-compiled paths.
+  //
+
+  /**
+   * Test whether another node has a leaf value.
+   */
+  bool hasValue (const SGPropertyPath& path) const;
+
+  /**
+   * Get another node's value as a bool.
+   */
+  bool getBoolValue (const SGPropertyPath& path,
+                     bool defaultValue = false) const;
+
+  /**
+   * Get another node's value as an int.
+   */
+  int getIntValue (const SGPropertyPath& path, int defaultValue = 0) const;
+
+  /**
+   * Get another node's value as a long int.
+   */
+  long getLongValue (const SGPropertyPath& path,
+                     long defaultValue = 0L) const;
+
+  /**
+   * Get another node's value as a float.
+   */
+  float getFloatValue (const SGPropertyPath& path,
+                       float defaultValue = 0.0f) const;
+
+  /**
+   * Get another node's value as a double.
+   */
+  double getDoubleValue (const SGPropertyPath& path,
+                         double defaultValue = 0.0) const;
+
+  /**
+   * Get another node's value as a string.
+   */
+  const char * getStringValue (const SGPropertyPath& path,
+                               const char * defaultValue = "") const;
+
+  /**
+   * Set another node's value as a bool.
+   */
+  bool setBoolValue (const SGPropertyPath& path, bool value);
+
+  /**
+   * Set another node's value as an int.
+   */
+  bool setIntValue (const SGPropertyPath& path, int value);
+
+  /**
+   * Set another node's value as a long int.
+   */
+  bool setLongValue (const SGPropertyPath& path, long value);
+
+  /**
+   * Set another node's value as a float.
+   */
+  bool setFloatValue (const SGPropertyPath& path, float value);
+
+  /**
+   * Set another node's value as a double.
+   */
+  bool setDoubleValue (const SGPropertyPath& path, double value);
+
+  /**
+   * Set another node's value as a string.
+   */
+  bool setStringValue (const SGPropertyPath& path, const char * value);
+
+  bool setStringValue (const SGPropertyPath& path, const std::string& value)
+  { return setStringValue(path, value.c_str()); }
+
+
   /**
    * Test whether another node is bound to an external data source.
    */
@@ -1621,9 +1735,23 @@ public:
 
   /**
    * Fire a value change event to all listeners.
+   *
+   * Inside an SGPropertyTransaction the event is queued instead, and
+   * dispatched once when the outermost transaction ends.
    */
   void fireValueChanged ();
 
+  /**
+   * Get the number of change listener calls (value changes, child added and
+   * child removed events) since the last call to resetListenerCallCount().
+   */
+  static unsigned int getListenerCallCount () { return _listener_calls; }
+
+  /**
+   * Reset the listener call counter, eg. once per frame.
+   */
+  static void resetListenerCallCount ();
+
 
   /**
    * Fire a child-added event to all listeners.
@@ -1686,9 +1814,13 @@ protected:
   SGPropertyNode (Itr begin, Itr end, int index, SGPropertyNode * parent);
 
   static simgear::PropertyInterpolationMgr* _interpolation_mgr;
+  static int _child_index_threshold;
+  static SGAtomic _listener_calls;
 
 private:
 
+  class ChildIndex;
+
   // Get the raw value
   bool get_bool () const;
   int get_int () const;
@@ -1732,6 +1864,9 @@ private:
   mutable std::string _buffer;
   simgear::props::Type _type;
   bool _tied;
+  SGAtomic _change_pending; ///< Number of transactions it is queued in
+  SGAtomic _structure_generation;
+  static SGAtomic _last_structure_generation;
   int _attr;
 
   // The right kind of pointer...
@@ -1751,6 +1886,21 @@ private:
 
   std::vector<SGPropertyChangeListener *> * _listeners;
 
+  // (name, index) lookup table for nodes with many children, or 0
+  ChildIndex * _child_index;
+
+  // Find an existing child without reviving removed ones
+  template<typename Itr>
+  SGPropertyNode * lookupChild (Itr begin, Itr end, int index) const;
+  // Highest index in use by children with the given name, or -1
+  int lastChildIndex (const char * name) const;
+  // Lowest index >= min_index not used by a child with the given name
+  int firstUnusedChildIndex (const char * name, int min_index) const;
+  // Append to _children and keep the lookup table up to date
+  void appendChild (SGPropertyNode * node);
+  // Move _structure_generation on to a number no node had before
+  void newStructureGeneration ();
+
   // Pass name as a pair of iterators
   template<typename Itr>
   SGPropertyNode * getChildImpl (Itr begin, Itr end, int index = 0, bool create = false);
@@ -1763,6 +1913,165 @@ private:
                                        bool create, int last_index);
   // For boost
   friend size_t hash_value(const SGPropertyNode& node);
+  friend class SGPropertyTransaction;
+};
+
+
+/**
+ * Defer value change notifications for as long as an instance exists.
+ *
+ * Listeners are notified when the outermost transaction is destroyed. Each
+ * changed node is reported only once, no matter how often its value has been
+ * set in between, so eg. an FDM writing the same subtree several times per
+ * update triggers each listener (including those on ancestor nodes) at most
+ * once per changed node, even if it is registered on several of its
+ * ancestors. Transactions can be nested.
+ *
+ * Transactions apply to the thread which created them: changes made by other
+ * threads meanwhile are neither deferred nor dispatched with them.
+ *
+ * Child added and child removed events are still dispatched immediately,
+ * unless the transaction has been created with DEFER. Then all events are
+ * handed to the thread owning the tree instead, which calls listeners when
+ * it calls dispatchDeferred(). This lets other threads change properties
+ * without running listeners (which may run Nasal, or touch anything else)
+ * concurrently with the main loop. The parent node of a deferred child
+ * event must not be destroyed before dispatch unless it has a parent
+ * itself, as roots are not referenced.
+ *
+ * @code
+ * {
+ *   SGPropertyTransaction transaction;
+ *   pos->setDoubleValue("latitude-deg", lat);
+ *   pos->setDoubleValue("longitude-deg", lon);
+ * } // listeners are called here
+ * @endcode
+ */
+class SGPropertyTransaction
+{
+public:
+  enum Mode
+  {
+    DISPATCH, ///< Call listeners when the outermost transaction ends
+    DEFER     ///< Leave all events to dispatchDeferred()
+  };
+
+  SGPropertyTransaction (Mode mode = DISPATCH);
+  ~SGPropertyTransaction ();
+
+  /**
+   * Whether value change notifications are currently being deferred on the
+   * calling thread.
+   */
+  static bool isActive ();
+
+  /**
+   * Call the listeners for all events left by DEFER transactions which
+   * have ended. Only to be called by the thread owning the property tree.
+   */
+  static void dispatchDeferred ();
+
+private:
+  friend class SGPropertyNode;
+
+  // Non-copyable
+  SGPropertyTransaction (const SGPropertyTransaction&);
+  SGPropertyTransaction& operator= (const SGPropertyTransaction&);
+
+  static bool isDeferring ();
+  static void queue (SGPropertyNode * node);
+  static void queueChild (bool added, SGPropertyNode * parent,
+                          SGPropertyNode * child);
+  static void dequeue (SGPropertyNode * node);
+  // type is one of the event types in props.cxx
+  static void dispatch (int type, SGPropertyNode * node,
+                        SGPropertyNode * child);
+
+  Mode _mode;
+};
+
+
+/**
+ * A property path which is parsed only once.
+ *
+ * Hot code accessing the same nodes by path over and over (eg. every frame)
+ * can keep an SGPropertyPath instead of a string. Besides skipping the
+ * parsing, the nodes a path resolves through are cached per start node and
+ * only looked up again after children have been added to or removed from
+ * one of them (see SGPropertyNode::getStructureGeneration), so changes
+ * elsewhere in the tree do not invalidate the path.
+ *
+ * Paths are not thread safe, as resolving them updates the cache.
+ */
+class SGPropertyPath
+{
+public:
+
+  /**
+   * Create an empty path, resolving to the start node itself.
+   */
+  SGPropertyPath ();
+
+  /**
+   * Compile a path.
+   *
+   * @throw std::string on syntax errors, just like SGPropertyNode::getNode.
+   */
+  explicit SGPropertyPath (const char * path);
+  explicit SGPropertyPath (const std::string& path);
+
+  ~SGPropertyPath ();
+
+  /**
+   * Get the path as given on construction.
+   */
+  const std::string& str () const { return _path; }
+
+  /**
+   * Whether the path starts at the root node.
+   */
+  bool isAbsolute () const { return _absolute; }
+
+  /**
+   * Resolve the path relative to the given node.
+   *
+   * @param start   Node to start at. Ignored except for its root if the
+   *                path is absolute.
+   * @param create  Whether to create missing nodes.
+   */
+  SGPropertyNode * resolve (SGPropertyNode * start, bool create = false) const;
+
+  /**
+   * Resolve the path relative to the given node, without creating nodes.
+   */
+  const SGPropertyNode * resolve (const SGPropertyNode * start) const;
+
+private:
+
+  struct Component
+  {
+    Component (const std::string& n, int i) : name(n), index(i) {}
+
+    std::string name; ///< Empty for the parent node ("..")
+    int index;
+  };
+
+  void compile ();
+
+  std::string _path;
+  bool _absolute;
+  std::vector<Component> _components;
+
+  bool isCached (const SGPropertyNode * start, bool create) const;
+
+  // Nodes the path was last resolved through from _start, ending with the
+  // node found (if any), and their structure generations at that time.
+  // They are not referenced, so the path does not keep removed nodes
+  // alive; isCached() only follows them as long as nothing changed.
+  mutable const SGPropertyNode * _start;
+  mutable std::vector<SGPropertyNode *> _chain;
+  mutable std::vector<unsigned int> _generations;
+  mutable bool _found;
 };
 
 // Convenience functions for use in templates
@@ -21,6 +21,7 @@
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/xml/easyxml.hxx>
 #include <simgear/misc/ResourceManager.hxx>
+#include <simgear/misc/stdint.hxx>
 
 #include "props.hxx"
 #include "props_io.hxx"
@@ -29,10 +30,19 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <sstream>
 #include <cstring>      // strcmp()
 #include <vector>
 #include <map>
 
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 using std::istream;
 using std::ifstream;
 using std::ostream;
@@ -624,6 +634,509 @@ writeProperties (const char* file, const SGPropertyNode * start_node)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Binary property list reader and writer.
+//
+// All numbers are stored little-endian, independent of the host:
+//
+//   header:  "SGPB", uint32 version, uint32 name count
+//   names:   per name: uint32 length, characters (no terminator)
+//   nodes:   uint32 top-level node count, then the node records in
+//            depth-first order
+//   record:  uint32 name id, int32 index, uint32 attributes, uint8 type,
+//            uint8 flags, uint32 child count, value (if NODE_HAS_VALUE),
+//            child records
+//
+// Values are stored as uint8 (bool), int32 (int), int64 (long), IEEE
+// float/double bits, 3 or 4 doubles (vec3d/vec4d), and length-prefixed
+// strings (string, unspecified, and the target path of an alias).
+////////////////////////////////////////////////////////////////////////
+
+static const char BINARY_MAGIC[4] = { 'S', 'G', 'P', 'B' };
+static const uint32_t BINARY_VERSION = 1;
+
+enum { NODE_HAS_VALUE = 1 };
+
+// Deepest nesting accepted from a binary property list. Far more than
+// any real tree needs, but keeps damaged or hostile input from
+// exhausting the stack.
+enum { MAX_BINARY_DEPTH = 256 };
+
+/**
+ * Sequential reader for a binary property list in memory.
+ */
+class BinaryPropsReader
+{
+public:
+  BinaryPropsReader (const char * buf, size_t size, const string& location)
+    : _pos(reinterpret_cast<const unsigned char*>(buf)),
+      _end(_pos + size),
+      _location(location)
+  {}
+
+  void read (SGPropertyNode * start_node);
+
+private:
+  void need (size_t n)
+  {
+    if (static_cast<size_t>(_end - _pos) < n)
+      throw sg_io_exception("Truncated binary property list",
+                            sg_location(_location));
+  }
+
+  uint8_t readU8 ()
+  {
+    need(1);
+    return *_pos++;
+  }
+
+  uint32_t readU32 ()
+  {
+    need(4);
+    uint32_t v = uint32_t(_pos[0])
+               | uint32_t(_pos[1]) << 8
+               | uint32_t(_pos[2]) << 16
+               | uint32_t(_pos[3]) << 24;
+    _pos += 4;
+    return v;
+  }
+
+  uint64_t readU64 ()
+  {
+    uint64_t lo = readU32();
+    uint64_t hi = readU32();
+    return lo | hi << 32;
+  }
+
+  float readFloat ()
+  {
+    uint32_t bits = readU32();
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  double readDouble ()
+  {
+    uint64_t bits = readU64();
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  string readString ()
+  {
+    uint32_t len = readU32();
+    need(len);
+    string s(reinterpret_cast<const char*>(_pos), len);
+    _pos += len;
+    return s;
+  }
+
+  void readNode (SGPropertyNode * parent, unsigned depth);
+
+  typedef std::pair<SGPropertyNode*, string> Alias;
+
+  const unsigned char * _pos;
+  const unsigned char * _end;
+  string _location;
+  vector<string> _names;
+  vector<Alias> _aliases;
+};
+
+void
+BinaryPropsReader::read (SGPropertyNode * start_node)
+{
+  if (!isBinaryProperties(reinterpret_cast<const char*>(_pos), _end - _pos))
+    throw sg_io_exception("Not a binary property list",
+                          sg_location(_location));
+  _pos += sizeof(BINARY_MAGIC);
+
+  uint32_t version = readU32();
+  if (version != BINARY_VERSION) {
+    std::ostringstream message;
+    message << "Unsupported binary property list version " << version;
+    throw sg_io_exception(message.str(), sg_location(_location));
+  }
+
+  uint32_t nNames = readU32();
+  // Every name takes at least its length field
+  _names.reserve(SG_MIN2(size_t(nNames), size_t(_end - _pos) / 4));
+  for (uint32_t i = 0; i < nNames; i++)
+    _names.push_back(readString());
+
+  uint32_t nChildren = readU32();
+  for (uint32_t i = 0; i < nChildren; i++)
+    readNode(start_node, 1);
+
+				// Aliases are resolved last, as their
+				// targets may appear later in the file.
+  for (size_t i = 0; i < _aliases.size(); i++) {
+    SGPropertyNode * node = _aliases[i].first;
+    int mode = node->getAttributes();
+    if (!node->alias(_aliases[i].second.c_str()))
+      SG_LOG(SG_INPUT, SG_ALERT, "Failed to set alias to "
+             << _aliases[i].second);
+    node->setAttributes(mode);
+  }
+}
+
+void
+BinaryPropsReader::readNode (SGPropertyNode * parent, unsigned depth)
+{
+  using namespace simgear;
+
+  if (depth > MAX_BINARY_DEPTH)
+    throw sg_io_exception("Binary property list nested too deeply",
+                          sg_location(_location));
+
+  uint32_t name_id = readU32();
+  int index = static_cast<int32_t>(readU32());
+  int mode = static_cast<int>(readU32());
+  props::Type type = static_cast<props::Type>(readU8());
+  uint8_t flags = readU8();
+  uint32_t nChildren = readU32();
+
+  if (name_id >= _names.size())
+    throw sg_io_exception("Invalid name in binary property list",
+                          sg_location(_location));
+  SGPropertyNode * node = parent->getChild(_names[name_id], index, true);
+
+  if (flags & NODE_HAS_VALUE) {
+    bool ret = true;
+    switch (type) {
+    case props::BOOL:
+      ret = node->setBoolValue(readU8() != 0);
+      break;
+    case props::INT:
+      ret = node->setIntValue(static_cast<int32_t>(readU32()));
+      break;
+    case props::LONG:
+      ret = node->setLongValue(static_cast<long>(static_cast<int64_t>(readU64())));
+      break;
+    case props::FLOAT:
+      ret = node->setFloatValue(readFloat());
+      break;
+    case props::DOUBLE:
+      ret = node->setDoubleValue(readDouble());
+      break;
+    case props::STRING:
+      ret = node->setStringValue(readString());
+      break;
+    case props::UNSPECIFIED:
+      ret = node->setUnspecifiedValue(readString().c_str());
+      break;
+    case props::VEC3D: {
+      SGVec3d v;
+      for (int i = 0; i < 3; i++)
+        v[i] = readDouble();
+      ret = node->setValue(v);
+      break;
+    }
+    case props::VEC4D: {
+      SGVec4d v;
+      for (int i = 0; i < 4; i++)
+        v[i] = readDouble();
+      ret = node->setValue(v);
+      break;
+    }
+    case props::ALIAS:
+      _aliases.push_back(Alias(node, readString()));
+      break;
+    default: {
+      std::ostringstream message;
+      message << "Unrecognized data type " << int(type)
+              << " in binary property list";
+      throw sg_io_exception(message.str(), sg_location(_location));
+    }
+    }
+    if (!ret)
+      SG_LOG(SG_INPUT, SG_ALERT, "readBinaryProperties: Failed to set "
+             << node->getPath() << " with type " << int(type));
+  }
+
+  node->setAttributes(mode);
+
+  for (uint32_t i = 0; i < nChildren; i++)
+    readNode(node, depth + 1);
+}
+
+
+/**
+ * Buffered writer for a binary property list. Node records are collected
+ * first, so the name table can be written in front of them.
+ */
+class BinaryPropsWriter
+{
+public:
+  BinaryPropsWriter (bool write_all, SGPropertyNode::Attribute archive_flag)
+    : _write_all(write_all),
+      _archive_flag(archive_flag)
+  {}
+
+  void write (ostream& output, const SGPropertyNode * start_node);
+
+private:
+  bool selected (const SGPropertyNode * node) const
+  {
+    return _write_all || isArchivable(node, _archive_flag);
+  }
+
+  static void writeU8 (string& out, uint8_t v)
+  {
+    out += static_cast<char>(v);
+  }
+
+  static void writeU32 (string& out, uint32_t v)
+  {
+    char buf[4] = { char(v), char(v >> 8), char(v >> 16), char(v >> 24) };
+    out.append(buf, 4);
+  }
+
+  static void writeU64 (string& out, uint64_t v)
+  {
+    writeU32(out, uint32_t(v));
+    writeU32(out, uint32_t(v >> 32));
+  }
+
+  static void writeFloat (string& out, float v)
+  {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    writeU32(out, bits);
+  }
+
+  static void writeDouble (string& out, double v)
+  {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    writeU64(out, bits);
+  }
+
+  static void writeString (string& out, const string& s)
+  {
+    writeU32(out, s.size());
+    out.append(s);
+  }
+
+  uint32_t nameId (const char * name);
+  void writeNode (const SGPropertyNode * node);
+
+  bool _write_all;
+  SGPropertyNode::Attribute _archive_flag;
+  map<string, uint32_t> _name_ids;
+  vector<const char*> _names;
+  string _nodes;
+};
+
+void
+BinaryPropsWriter::write (ostream& output, const SGPropertyNode * start_node)
+{
+  uint32_t nChildren = 0;
+  for (int i = 0; i < start_node->nChildren(); i++)
+    if (selected(start_node->getChild(i)))
+      nChildren++;
+
+  writeU32(_nodes, nChildren);
+  for (int i = 0; i < start_node->nChildren(); i++)
+    writeNode(start_node->getChild(i));
+
+  string header(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  writeU32(header, BINARY_VERSION);
+  writeU32(header, _names.size());
+  for (size_t i = 0; i < _names.size(); i++)
+    writeString(header, _names[i]);
+
+  output.write(header.data(), header.size());
+  output.write(_nodes.data(), _nodes.size());
+}
+
+uint32_t
+BinaryPropsWriter::nameId (const char * name)
+{
+  map<string, uint32_t>::iterator it = _name_ids.find(name);
+  if (it != _name_ids.end())
+    return it->second;
+
+  uint32_t id = _names.size();
+  _name_ids.insert(std::make_pair(string(name), id));
+  _names.push_back(name);
+  return id;
+}
+
+void
+BinaryPropsWriter::writeNode (const SGPropertyNode * node)
+{
+  using namespace simgear;
+
+  if (!selected(node))
+    return;
+
+  int nChildren = node->nChildren();
+  uint32_t nSelected = 0;
+  for (int i = 0; i < nChildren; i++)
+    if (selected(node->getChild(i)))
+      nSelected++;
+
+  bool has_value = node->hasValue()
+                && (_write_all || node->getAttribute(_archive_flag));
+  props::Type type = node->getType();
+  if (node->isAlias()) {
+    type = props::ALIAS;
+    has_value = has_value && node->getAliasTarget() != 0;
+  } else if (type == props::NONE || type > props::VEC4D) {
+    // Unknown extended types are stored as their string value
+    type = props::UNSPECIFIED;
+  }
+
+  writeU32(_nodes, nameId(node->getName()));
+  writeU32(_nodes, node->getIndex());
+  writeU32(_nodes, node->getAttributes());
+  writeU8(_nodes, type);
+  writeU8(_nodes, has_value ? NODE_HAS_VALUE : 0);
+  writeU32(_nodes, nSelected);
+
+  if (has_value) {
+    switch (type) {
+    case props::ALIAS:
+      writeString(_nodes, node->getAliasTarget()->getPath());
+      break;
+    case props::BOOL:
+      writeU8(_nodes, node->getBoolValue() ? 1 : 0);
+      break;
+    case props::INT:
+      writeU32(_nodes, node->getIntValue());
+      break;
+    case props::LONG:
+      writeU64(_nodes, static_cast<int64_t>(node->getLongValue()));
+      break;
+    case props::FLOAT:
+      writeFloat(_nodes, node->getFloatValue());
+      break;
+    case props::DOUBLE:
+      writeDouble(_nodes, node->getDoubleValue());
+      break;
+    case props::VEC3D: {
+      SGVec3d v = node->getValue<SGVec3d>();
+      for (int i = 0; i < 3; i++)
+        writeDouble(_nodes, v[i]);
+      break;
+    }
+    case props::VEC4D: {
+      SGVec4d v = node->getValue<SGVec4d>();
+      for (int i = 0; i < 4; i++)
+        writeDouble(_nodes, v[i]);
+      break;
+    }
+    default:
+      writeString(_nodes, node->getStringValue());
+      break;
+    }
+  }
+
+  for (int i = 0; i < nChildren; i++)
+    writeNode(node->getChild(i));
+}
+
+
+bool
+isBinaryProperties (const char *buf, size_t size)
+{
+  return size >= sizeof(BINARY_MAGIC)
+      && memcmp(buf, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+
+/**
+ * Read properties from a binary property list in memory.
+ *
+ * @param buf The buffer containing the binary property list.
+ * @param size The size of the buffer in bytes.
+ * @param start_node The root node for reading properties.
+ */
+void
+readBinaryProperties (const char *buf, size_t size,
+                      SGPropertyNode * start_node)
+{
+  BinaryPropsReader(buf, size, "").read(start_node);
+}
+
+
+/**
+ * Read properties from a binary property list file.
+ *
+ * @param file A string containing the file path.
+ * @param start_node The root node for reading properties.
+ */
+void
+readBinaryProperties (const string &file, SGPropertyNode * start_node)
+{
+#ifndef _WIN32
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw sg_io_exception("Cannot open file", sg_location(file));
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    throw sg_io_exception("Not a binary property list", sg_location(file));
+  }
+
+  size_t size = st.st_size;
+  void * data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    throw sg_io_exception("Cannot map file", sg_location(file));
+
+  try {
+    BinaryPropsReader(static_cast<const char*>(data), size, file)
+      .read(start_node);
+  } catch (...) {
+    munmap(data, size);
+    throw;
+  }
+  munmap(data, size);
+#else
+  ifstream input(file.c_str(), std::ios::in | std::ios::binary);
+  if (!input.good())
+    throw sg_io_exception("Cannot open file", sg_location(file));
+
+  vector<char> data;
+  char buf[8192];
+  while (input.read(buf, sizeof(buf)) || input.gcount() > 0)
+    data.insert(data.end(), buf, buf + input.gcount());
+
+  BinaryPropsReader(data.empty() ? 0 : &data[0], data.size(), file)
+    .read(start_node);
+#endif
+}
+
+
+void
+writeBinaryProperties (ostream &output, const SGPropertyNode * start_node,
+                       bool write_all, SGPropertyNode::Attribute archive_flag)
+{
+  BinaryPropsWriter(write_all, archive_flag).write(output, start_node);
+}
+
+
+void
+writeBinaryProperties (const string &file, const SGPropertyNode * start_node,
+                       bool write_all, SGPropertyNode::Attribute archive_flag)
+{
+  SGPath path(file.c_str());
+  path.create_dir(0777);
+
+  ofstream output(file.c_str(), std::ios::out | std::ios::binary);
+  if (output.good()) {
+    writeBinaryProperties(output, start_node, write_all, archive_flag);
+  } else {
+    throw sg_io_exception("Cannot open file", sg_location(file));
+  }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Copy properties from one tree to another.
 ////////////////////////////////////////////////////////////////////////
@@ -58,6 +58,50 @@ void writeProperties (const std::string &file,
 		      SGPropertyNode::Attribute archive_flag = SGPropertyNode::ARCHIVE);
 
 
+/**
+ * Read properties from a binary property list in memory, as written by
+ * writeBinaryProperties(). The buffer is only read, so it can be a
+ * memory-mapped file.
+ */
+void readBinaryProperties (const char *buf, size_t size,
+                           SGPropertyNode * start_node);
+
+
+/**
+ * Read properties from a binary property list file. The file is
+ * memory-mapped where the platform supports it.
+ */
+void readBinaryProperties (const std::string &file,
+                           SGPropertyNode * start_node);
+
+
+/**
+ * Write properties to an output stream as a binary property list.
+ *
+ * Unlike the XML format, node attributes are preserved. Node selection
+ * follows the same rules as for writeProperties().
+ */
+void writeBinaryProperties (std::ostream &output,
+                            const SGPropertyNode * start_node,
+                            bool write_all = false,
+                            SGPropertyNode::Attribute archive_flag = SGPropertyNode::ARCHIVE);
+
+
+/**
+ * Write properties to a binary property list file.
+ */
+void writeBinaryProperties (const std::string &file,
+                            const SGPropertyNode * start_node,
+                            bool write_all = false,
+                            SGPropertyNode::Attribute archive_flag = SGPropertyNode::ARCHIVE);
+
+
+/**
+ * Test whether a buffer starts with the binary property list signature.
+ */
+bool isBinaryProperties (const char *buf, size_t size);
+
+
 /**
  * Copy properties from one node to another.
  */
@@ -10,9 +10,17 @@
 #include <simgear/compiler.h>
 
 #include <iostream>
+#include <sstream>
 
 #include "props.hxx"
 #include "props_io.hxx"
+#include "PropertySnapshot.hxx"
+#include "vectorPropTemplates.hxx"
+
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/structure/exception.hxx>
 
 using std::cout;
 using std::cerr;
@@ -385,6 +393,530 @@ void test_addChild()
 }
 
 
+////////////////////////////////////////////////////////////////////////
+// Check hashed child lookup and compare it with linear search.
+////////////////////////////////////////////////////////////////////////
+
+static void
+test_child_index ()
+{
+  cout << endl << "Testing hashed child lookup" << endl;
+
+  SGPropertyNode root;
+  SGPropertyNode* models = root.getNode("ai/models", true);
+  for (int i = 0; i < 100; ++i)
+    models->getChild("aircraft", i, true)->setIntValue(i);
+  models->getChild("carrier", 0, true);
+
+  if (models->getNode("aircraft[57]")->getIntValue() != 57)
+    cerr << "** FAILED to find aircraft[57]" << endl;
+  if (models->getChild("carrier", 0) == 0)
+    cerr << "** FAILED to find carrier[0]" << endl;
+  if (models->getChild("aircraft", 100) != 0)
+    cerr << "** FAILED: found non-existing aircraft[100]" << endl;
+
+  models->removeChild("aircraft", 99, false);
+  if (models->getChild("aircraft", 99) != 0)
+    cerr << "** FAILED to remove aircraft[99]" << endl;
+  if (models->addChild("aircraft")->getIndex() != 99)
+    cerr << "** FAILED to append aircraft at index #99" << endl;
+
+  models->removeChild("aircraft", 10);
+  if (models->addChild("aircraft", 0, false)->getIndex() != 10)
+    cerr << "** FAILED to fill hole at index #10" << endl;
+}
+
+static double
+time_child_lookup (int fan_out, int lookups)
+{
+  SGPropertyNode root;
+  SGPropertyNode* models = root.getNode("ai/models", true);
+  for (int i = 0; i < fan_out; ++i)
+    models->getChild("aircraft", i, true)->setDoubleValue(i);
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < fan_out; ++i) {
+    std::ostringstream path;
+    path << "/ai/models/aircraft[" << (i * 7919) % fan_out << "]";
+    paths.push_back(path.str());
+  }
+
+  double sum = 0;
+  SGTimeStamp start = SGTimeStamp::now();
+  for (int i = 0; i < lookups; ++i)
+    sum += root.getNode(paths[i % fan_out])->getDoubleValue();
+  double usecs = (SGTimeStamp::now() - start).toUSecs();
+
+  // keep the lookups from being optimised away
+  if (sum < 0)
+    cerr << "** FAILED: negative sum" << endl;
+  return usecs / lookups;
+}
+
+static void
+benchmark_child_lookup ()
+{
+  cout << endl << "Benchmarking child lookup (usec per getNode)" << endl;
+  cout << "children\tlinear\thashed" << endl;
+
+  int threshold = SGPropertyNode::getChildIndexThreshold();
+  for (int fan_out = 8; fan_out <= 2048; fan_out *= 4) {
+    SGPropertyNode::setChildIndexThreshold(-1);
+    double linear = time_child_lookup(fan_out, 20000);
+    SGPropertyNode::setChildIndexThreshold(threshold);
+    double hashed = time_child_lookup(fan_out, 20000);
+    cout << fan_out << "\t" << linear << "\t" << hashed << endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// Check pre-compiled paths.
+////////////////////////////////////////////////////////////////////////
+
+static void
+test_property_path ()
+{
+  cout << endl << "Testing pre-compiled paths" << endl;
+
+  SGPropertyNode root;
+  SGPropertyNode* foo = root.getNode("foo", true);
+  SGPropertyPath abs_path("/hack/../foo/./bar[2]/baz");
+  SGPropertyPath rel_path("bar[2]/baz");
+
+  if (root.getNode(abs_path) != 0)
+    cerr << "** FAILED: resolved non-existing path" << endl;
+
+  root.setDoubleValue(abs_path, 2.5);
+  if (root.getDoubleValue("foo/bar[2]/baz") != 2.5)
+    cerr << "** FAILED to create node through path" << endl;
+  if (foo->getNode(rel_path) != root.getNode(abs_path))
+    cerr << "** FAILED: relative and absolute paths differ" << endl;
+  if (foo->getNode(abs_path) != root.getNode(abs_path))
+    cerr << "** FAILED: absolute path not resolved from root" << endl;
+
+  foo->removeChild("bar", 2, false);
+  if (foo->getNode(rel_path) != 0)
+    cerr << "** FAILED: cached node survived removal" << endl;
+  if (foo->getDoubleValue(rel_path, -1) != -1)
+    cerr << "** FAILED to return default value" << endl;
+
+  foo->setIntValue(rel_path, 3);
+  if (root.getIntValue("foo/bar[2]/baz") != 3)
+    cerr << "** FAILED to recreate node through path" << endl;
+
+  SGPropertyNode_ptr removed = foo->getNode("bar", 2);
+  foo->removeChild("bar", 2, false);
+  if (SGReferenced::count(removed) != 1)
+    cerr << "** FAILED: path keeps removed node alive" << endl;
+  foo->setIntValue(rel_path, 3);
+
+  unsigned int generation = foo->getStructureGeneration();
+  root.setIntValue("other", 1);
+  if (foo->getStructureGeneration() != generation)
+    cerr << "** FAILED: unrelated node changed structure generation" << endl;
+  foo->getNode("new", true);
+  if (foo->getStructureGeneration() == generation)
+    cerr << "** FAILED to change structure generation" << endl;
+
+  try {
+    SGPropertyPath bad("foo/b@r");
+    cerr << "** FAILED to reject illegal path" << endl;
+  } catch (const std::string&) {
+  }
+}
+
+static void
+benchmark_property_path ()
+{
+  cout << endl << "Benchmarking path access (usec per lookup)" << endl;
+
+  SGPropertyNode root;
+  const char* str_path = "/instrumentation/airspeed-indicator/indicated-speed-kt";
+  root.setDoubleValue(str_path, 1);
+  SGPropertyPath path(str_path);
+
+  const int lookups = 100000;
+  double sum = 0;
+  SGTimeStamp start = SGTimeStamp::now();
+  for (int i = 0; i < lookups; ++i)
+    sum += root.getDoubleValue(str_path);
+  double str_usecs = (SGTimeStamp::now() - start).toUSecs() / lookups;
+
+  start = SGTimeStamp::now();
+  for (int i = 0; i < lookups; ++i)
+    sum += root.getDoubleValue(path);
+  double path_usecs = (SGTimeStamp::now() - start).toUSecs() / lookups;
+
+  if (sum != 2 * lookups)
+    cerr << "** FAILED: unexpected sum " << sum << endl;
+  cout << "string: " << str_usecs << " compiled: " << path_usecs << endl;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Check deferred change notification.
+////////////////////////////////////////////////////////////////////////
+
+class CountingListener : public SGPropertyChangeListener
+{
+public:
+  CountingListener () : count(0) {}
+  virtual void valueChanged (SGPropertyNode * node) { ++count; }
+  int count;
+};
+
+class TransactionWriter : public SGThread
+{
+public:
+  TransactionWriter (SGPropertyNode* node, bool defer = false)
+    : _node(node), _defer(defer), active(true) {}
+
+  virtual void run ()
+  {
+    if (_defer) {
+      SGPropertyTransaction transaction(SGPropertyTransaction::DEFER);
+      _node->setDoubleValue(-2);
+      _node->getParent()->getNode("tmp", true);
+      _node->getParent()->getNode("gone", true)->setIntValue(1);
+      _node->getParent()->removeChild("gone", 0, false);
+    } else {
+      active = SGPropertyTransaction::isActive();
+      _node->setDoubleValue(-1);
+    }
+  }
+
+private:
+  SGPropertyNode* _node;
+  bool _defer;
+public:
+  bool active;
+};
+
+class ChildListener : public SGPropertyChangeListener
+{
+public:
+  ChildListener () : added(0), removed(0) {}
+  virtual void childAdded (SGPropertyNode*, SGPropertyNode*) { ++added; }
+  virtual void childRemoved (SGPropertyNode*, SGPropertyNode*) { ++removed; }
+  int added;
+  int removed;
+};
+
+static void
+test_transaction ()
+{
+  cout << endl << "Testing property transactions" << endl;
+
+  SGPropertyNode root;
+  SGPropertyNode* pos = root.getNode("position", true);
+  SGPropertyNode* lat = pos->getNode("latitude-deg", true);
+  SGPropertyNode* lon = pos->getNode("longitude-deg", true);
+
+  CountingListener pos_listener, lat_listener, both_listener;
+  pos->addChangeListener(&pos_listener);
+  lat->addChangeListener(&lat_listener);
+  pos->addChangeListener(&both_listener);
+  lat->addChangeListener(&both_listener);
+
+  SGPropertyNode::resetListenerCallCount();
+  {
+    SGPropertyTransaction transaction;
+    for (int i = 0; i < 10; ++i) {
+      SGPropertyTransaction nested;
+      lat->setDoubleValue(i);
+      lon->setDoubleValue(i);
+    }
+    if (pos_listener.count || lat_listener.count)
+      cerr << "** FAILED: listener called inside transaction" << endl;
+
+    SGPropertyNode* tmp = pos->getNode("tmp", true);
+    tmp->setIntValue(1);
+    pos->removeChild("tmp", 0, false);
+  }
+
+  // lat and lon reach the listener on /position once each
+  if (pos_listener.count != 2 || lat_listener.count != 1)
+    cerr << "** FAILED: expected 2 and 1 notifications, got "
+         << pos_listener.count << " and " << lat_listener.count << endl;
+  // also once per changed node if registered on lat and its parent
+  if (both_listener.count != 2)
+    cerr << "** FAILED: expected 2 notifications, got "
+         << both_listener.count << endl;
+  // plus child added/removed for tmp, which are not deferred
+  if (SGPropertyNode::getListenerCallCount() != 9)
+    cerr << "** FAILED: expected 9 listener calls, got "
+         << SGPropertyNode::getListenerCallCount() << endl;
+
+  lat->setDoubleValue(42);
+  if (lat_listener.count != 2)
+    cerr << "** FAILED: listener not called outside transaction" << endl;
+
+  // changes made by other threads are not deferred
+  {
+    SGPropertyTransaction transaction;
+    TransactionWriter writer(lon);
+    writer.start();
+    writer.join();
+    if (pos_listener.count != 4)
+      cerr << "** FAILED: change from other thread deferred" << endl;
+    if (!SGPropertyTransaction::isActive() || writer.active)
+      cerr << "** FAILED: transaction not limited to its thread" << endl;
+  }
+
+  // deferred events are only dispatched by dispatchDeferred()
+  ChildListener child_listener;
+  pos->addChangeListener(&child_listener);
+  {
+    TransactionWriter writer(lon, true);
+    writer.start();
+    writer.join();
+  }
+  if (pos_listener.count != 4 || child_listener.added)
+    cerr << "** FAILED: deferred events dispatched by the writer" << endl;
+  SGPropertyTransaction::dispatchDeferred();
+  // lon and "gone", which the child removed event keeps alive
+  if (pos_listener.count != 6 || child_listener.added != 2
+      || child_listener.removed != 1)
+    cerr << "** FAILED: deferred events not dispatched, got "
+         << pos_listener.count << ", " << child_listener.added << " and "
+         << child_listener.removed << endl;
+  pos->removeChangeListener(&child_listener);
+
+  pos->removeChangeListener(&pos_listener);
+  lat->removeChangeListener(&lat_listener);
+  pos->removeChangeListener(&both_listener);
+  lat->removeChangeListener(&both_listener);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Check snapshots read from another thread.
+////////////////////////////////////////////////////////////////////////
+
+class SnapshotReader : public SGThread
+{
+public:
+  SnapshotReader (const simgear::PropertySnapshot& snapshot)
+    : _snapshot(snapshot), reads(0), torn(0), done(0)
+  {}
+
+  virtual void run ()
+  {
+    while (!done) {
+      simgear::PropertySnapshot::FramePtr state = _snapshot.get();
+      if (!state)
+        continue;
+      ++reads;
+      const SGPropertyNode* pos = state->getSubtree("position");
+      const SGPropertyNode* orient = state->getSubtree("orientation");
+      int lat = pos->getIntValue("latitude-deg");
+      int lon = pos->getIntValue("longitude-deg");
+      int roll = orient->getIntValue("roll-deg");
+      if (lat != lon || lat != roll)
+        ++torn;
+    }
+  }
+
+  const simgear::PropertySnapshot& _snapshot;
+  int reads;
+  int torn;
+  SGAtomic done;
+};
+
+static void
+test_snapshot ()
+{
+  cout << endl << "Testing property snapshots" << endl;
+
+  SGPropertyNode_ptr root = new SGPropertyNode;
+  simgear::PropertySnapshot snapshot(root);
+  snapshot.addSubtree("position");
+  snapshot.addSubtree("orientation");
+
+  if (snapshot.get() != 0)
+    cerr << "** FAILED: snapshot available before publishing" << endl;
+
+  SnapshotReader reader(snapshot);
+  reader.start();
+
+  for (int i = 0; i < 20000; ++i) {
+    root->setIntValue("position/latitude-deg", i);
+    root->setIntValue("position/longitude-deg", i);
+    root->setIntValue("orientation/roll-deg", i);
+    root->setIntValue("velocities/speed-kt", i);
+    if (!snapshot.publish())
+      cerr << "** FAILED: changes not published" << endl;
+  }
+  ++reader.done;
+  reader.join();
+
+  simgear::PropertySnapshot::FramePtr state = snapshot.get();
+  if (state->getSubtree("position")->getIntValue("latitude-deg") != 19999)
+    cerr << "** FAILED: latest values not published" << endl;
+  if (state->getSubtree("velocities"))
+    cerr << "** FAILED: unregistered subtree copied" << endl;
+
+  // Unchanged subtrees are shared with the previous frame
+  unsigned copies = snapshot.getCopyCount();
+  if (snapshot.publish())
+    cerr << "** FAILED: published without changes" << endl;
+  root->setIntValue("orientation/roll-deg", -1);
+  if (!snapshot.publish() || snapshot.getCopyCount() != copies + 1)
+    cerr << "** FAILED: expected only the changed subtree to be copied" << endl;
+  if (snapshot.get()->getSubtree("position")
+      != state->getSubtree("position"))
+    cerr << "** FAILED: unchanged subtree not shared" << endl;
+  if (reader.torn)
+    cerr << "** FAILED: " << reader.torn << " of " << reader.reads
+         << " snapshots inconsistent" << endl;
+  cout << snapshot.getPublishCount() << " published, "
+       << reader.reads << " read" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Check the binary property list format.
+////////////////////////////////////////////////////////////////////////
+
+static const char binary_test_xml[] =
+  "<?xml version=\"1.0\"?>"
+  "<PropertyList>"
+  " <sim>"
+  "  <description type=\"string\">Test &amp; &lt;aircraft&gt;</description>"
+  "  <count type=\"int\">-3</count>"
+  "  <ticks type=\"long\">1234567890</ticks>"
+  "  <flag type=\"bool\">true</flag>"
+  "  <ratio type=\"float\">0.25</ratio>"
+  "  <weight type=\"double\">1234.5678</weight>"
+  "  <note>untyped</note>"
+  "  <offset type=\"vec3d\">1 2.5 -3</offset>"
+  "  <view n=\"2\"><name userarchive=\"y\">Cockpit</name></view>"
+  "  <weight-alias alias=\"/sim/weight\"/>"
+  "  <locked write=\"n\" type=\"int\">7</locked>"
+  " </sim>"
+  "</PropertyList>";
+
+static void
+test_binary_properties ()
+{
+  cout << endl << "Testing binary property lists" << endl;
+
+  SGPropertyNode xml_root;
+  readProperties(binary_test_xml, sizeof(binary_test_xml) - 1, &xml_root,
+                 0, true);
+
+  std::ostringstream out;
+  writeBinaryProperties(out, &xml_root, true);
+  std::string data = out.str();
+
+  if (!isBinaryProperties(data.data(), data.size()))
+    cerr << "** FAILED: binary signature not written" << endl;
+
+  SGPropertyNode bin_root;
+  readBinaryProperties(data.data(), data.size(), &bin_root);
+  if (!SGPropertyNode::compare(xml_root, bin_root))
+    cerr << "** FAILED: binary round trip differs from XML" << endl;
+
+  if (bin_root.getStringValue("sim/description") !=
+      std::string("Test & <aircraft>"))
+    cerr << "** FAILED: string value not preserved" << endl;
+  if (bin_root.getType("sim/ticks") != simgear::props::LONG
+      || bin_root.getType("sim/note") != simgear::props::UNSPECIFIED)
+    cerr << "** FAILED: value types not preserved" << endl;
+  if (bin_root.getNode("sim/offset")->getValue<SGVec3d>() !=
+      SGVec3d(1, 2.5, -3))
+    cerr << "** FAILED: vec3d value not preserved" << endl;
+  if (!bin_root.getNode("sim/view[2]/name")
+      ->getAttribute(SGPropertyNode::USERARCHIVE))
+    cerr << "** FAILED: attributes not preserved" << endl;
+  if (bin_root.getNode("sim/locked")->getAttribute(SGPropertyNode::WRITE))
+    cerr << "** FAILED: write protection not preserved" << endl;
+
+  SGPropertyNode* alias = bin_root.getNode("sim/weight-alias");
+  if (!alias->isAlias()
+      || alias->getAliasTarget() != bin_root.getNode("sim/weight"))
+    cerr << "** FAILED: alias not preserved" << endl;
+
+  // Through a file, which is memory-mapped where supported
+  SGPath path("props_test.bin");
+  writeBinaryProperties(path.str(), &xml_root, true);
+  SGPropertyNode file_root;
+  readBinaryProperties(path.str(), &file_root);
+  path.remove();
+  if (!SGPropertyNode::compare(xml_root, file_root))
+    cerr << "** FAILED: binary file round trip differs from XML" << endl;
+
+  bool thrown = false;
+  try {
+    SGPropertyNode truncated;
+    readBinaryProperties(data.data(), data.size() / 2, &truncated);
+  } catch (sg_io_exception&) {
+    thrown = true;
+  }
+  if (!thrown)
+    cerr << "** FAILED: truncated binary property list accepted" << endl;
+
+  SGPropertyNode deep_root;
+  SGPropertyNode* deep = &deep_root;
+  for (int i = 0; i < 1000; ++i)
+    deep = deep->getChild("level", 0, true);
+  std::ostringstream deep_out;
+  writeBinaryProperties(deep_out, &deep_root, true);
+  std::string deep_data = deep_out.str();
+  thrown = false;
+  try {
+    SGPropertyNode nested;
+    readBinaryProperties(deep_data.data(), deep_data.size(), &nested);
+  } catch (sg_io_exception&) {
+    thrown = true;
+  }
+  if (!thrown)
+    cerr << "** FAILED: deeply nested binary property list accepted" << endl;
+}
+
+static void
+benchmark_binary_properties ()
+{
+  cout << endl << "Benchmarking XML vs. binary reading (msec per read)"
+       << endl;
+
+  // Roughly the size of a complex aircraft tree after loading
+  SGPropertyNode src;
+  for (int i = 0; i < 200; ++i) {
+    std::ostringstream system;
+    system << "systems/system[" << i << "]/";
+    for (int j = 0; j < 10; ++j) {
+      std::ostringstream prop;
+      prop << system.str() << "item[" << j << "]/";
+      src.setDoubleValue(prop.str() + "value-norm", i * 0.01 + j);
+      src.setIntValue(prop.str() + "mode", j);
+      src.setBoolValue(prop.str() + "serviceable", true);
+      src.setStringValue(prop.str() + "name", "a component name");
+    }
+  }
+
+  std::ostringstream xml_out, bin_out;
+  writeProperties(xml_out, &src, true);
+  writeBinaryProperties(bin_out, &src, true);
+  std::string xml = xml_out.str(), bin = bin_out.str();
+
+  const int reads = 5;
+  SGTimeStamp start = SGTimeStamp::now();
+  for (int i = 0; i < reads; ++i) {
+    SGPropertyNode root;
+    readProperties(xml.data(), xml.size(), &root);
+  }
+  double xml_msecs = (SGTimeStamp::now() - start).toMSecs() / reads;
+
+  start = SGTimeStamp::now();
+  for (int i = 0; i < reads; ++i) {
+    SGPropertyNode root;
+    readBinaryProperties(bin.data(), bin.size(), &root);
+  }
+  double bin_msecs = (SGTimeStamp::now() - start).toMSecs() / reads;
+
+  cout << "xml: " << xml_msecs << " (" << xml.size() << " bytes)"
+       << " binary: " << bin_msecs << " (" << bin.size() << " bytes)"
+       << endl;
+}
+
 int main (int ac, char ** av)
 {
   test_value();
@@ -403,6 +935,14 @@ int main (int ac, char ** av)
   }
 
   test_addChild();
+  test_child_index();
+  benchmark_child_lookup();
+  test_property_path();
+  benchmark_property_path();
+  test_transaction();
+  test_snapshot();
+  test_binary_properties();
+  benchmark_binary_properties();
 
   return 0;
 }
@@ -46,6 +46,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/Registry>
 #include <osgDB/FileUtils>
+#include <OpenThreads/ScopedLock>
 
 #include <simgear/debug/logstream.hxx>
 #include <simgear/misc/sg_path.hxx>
@@ -444,6 +445,7 @@ SGMaterial::init ()
 
 Effect* SGMaterial::get_effect(int i)
 {    
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_effectMutex);
     if(!_status[i].effect_realized) {
         if (!_status[i].effect.valid())
             return 0;
@@ -36,6 +36,7 @@
 
 #include <osg/ref_ptr>
 #include <osg/Texture2D>
+#include <OpenThreads/Mutex>
 
 namespace osg
 {
@@ -361,6 +362,10 @@ private:
   // texture status
   std::vector<_internal_state> _status;
 
+  // Tiles are loaded by several pager threads, which may realize the
+  // effects at the same time
+  OpenThreads::Mutex _effectMutex;
+
   // texture size
   double xsize, ysize;
 
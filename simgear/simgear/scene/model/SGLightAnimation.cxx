@@ -26,6 +26,8 @@
 
 #include <osg/Geometry>
 #include <osg/MatrixTransform>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 #include <simgear/props/vectorPropTemplates.hxx>
 #include <simgear/scene/material/EffectGeode.hxx>
 #include <simgear/scene/material/Technique.hxx>
@@ -38,6 +40,8 @@
 
 typedef std::map<std::string, osg::observer_ptr<simgear::Effect> > EffectMap;
 static EffectMap lightEffectMap;
+// models are loaded in several pager threads
+static OpenThreads::Mutex lightEffectMapMutex;
 
 #define GET_COLOR_VALUE(n) \
     SGVec4d( getConfig()->getDoubleValue(n "/r"), \
@@ -138,6 +142,7 @@ SGLightAnimation::install(osg::Node& node)
 
     bool cacheEffect = false;
     osg::ref_ptr<simgear::Effect> effect;
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(lightEffectMapMutex);
     EffectMap::iterator iter = lightEffectMap.end();
     if (!_animationValue.valid()) { // Effects with animated properties should be singletons
         iter = lightEffectMap.find(_key);
@@ -37,6 +37,8 @@
 #include <osg/MatrixTransform>
 #include <osg/Matrix>
 #include <osg/ShadeModel>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 #include <osg/Material>
 #include <osg/CullFace>
 
@@ -67,6 +69,8 @@ static BuildingStateSetMap statesetmap;
 
 typedef std::map<std::string, osg::observer_ptr<Effect> > EffectMap;
 static EffectMap buildingEffectMap;
+// tiles are loaded in several pager threads
+static OpenThreads::Mutex buildingEffectMapMutex;
     
 // Building instance scheme:
 // vertex - local position of vertices, with 0,0,0 being the center front.
@@ -721,27 +725,30 @@ BuildingBoundingBoxCallback::computeBound(const Drawable& drawable) const
   ref_ptr<Group> SGBuildingBin::createBuildingsGroup(Matrix transInv, const SGReaderWriterOptions* options)
   {
     ref_ptr<Effect> effect;
-    EffectMap::iterator iter = buildingEffectMap.find(texture);
-
-    if ((iter == buildingEffectMap.end())||
-        (!iter->second.lock(effect)))
     {
-      SGPropertyNode_ptr effectProp = new SGPropertyNode;
-      makeChild(effectProp, "inherits-from")->setStringValue("Effects/building");
-      SGPropertyNode* params = makeChild(effectProp, "parameters");
-      // Main texture - n=0
-      params->getChild("texture", 0, true)->getChild("image", 0, true)
-          ->setStringValue(texture);
-
-      // Light map - n=3
-      params->getChild("texture", 3, true)->getChild("image", 0, true)
-          ->setStringValue(lightMap);
-          
-      effect = makeEffect(effectProp, true, options);
-      if (iter == buildingEffectMap.end())
-          buildingEffectMap.insert(EffectMap::value_type(texture, effect));
-      else
-          iter->second = effect; // update existing, but empty observer
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(buildingEffectMapMutex);
+      EffectMap::iterator iter = buildingEffectMap.find(texture);
+
+      if ((iter == buildingEffectMap.end())||
+          (!iter->second.lock(effect)))
+      {
+        SGPropertyNode_ptr effectProp = new SGPropertyNode;
+        makeChild(effectProp, "inherits-from")->setStringValue("Effects/building");
+        SGPropertyNode* params = makeChild(effectProp, "parameters");
+        // Main texture - n=0
+        params->getChild("texture", 0, true)->getChild("image", 0, true)
+            ->setStringValue(texture);
+
+        // Light map - n=3
+        params->getChild("texture", 3, true)->getChild("image", 0, true)
+            ->setStringValue(lightMap);
+
+        effect = makeEffect(effectProp, true, options);
+        if (iter == buildingEffectMap.end())
+            buildingEffectMap.insert(EffectMap::value_type(texture, effect));
+        else
+            iter->second = effect; // update existing, but empty observer
+      }
     }
     
     ref_ptr<Group> group = new osg::Group();
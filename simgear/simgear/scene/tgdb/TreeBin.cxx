@@ -36,6 +36,8 @@
 #include <osg/MatrixTransform>
 #include <osg/Matrix>
 #include <osg/NodeVisitor>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
@@ -212,6 +214,8 @@ void addTreeToLeafGeode(Geode* geode, const SGVec3f& p)
 typedef std::map<std::string, osg::observer_ptr<Effect> > EffectMap;
 
 static EffectMap treeEffectMap;
+// tiles are loaded in several pager threads
+static OpenThreads::Mutex treeEffectMapMutex;
 
 // Helper classes for creating the quad tree
 namespace
@@ -337,22 +341,25 @@ osg::Group* createForest(SGTreeBinList& forestList, const osg::Matrix& transform
         TreeBin* forest = *i;
       
         ref_ptr<Effect> effect;
-        EffectMap::iterator iter = treeEffectMap.find(forest->texture);
-
-        if ((iter == treeEffectMap.end())||
-            (!iter->second.lock(effect)))
         {
-            SGPropertyNode_ptr effectProp = new SGPropertyNode;
-            makeChild(effectProp, "inherits-from")->setStringValue("Effects/tree");
-            SGPropertyNode* params = makeChild(effectProp, "parameters");
-            // emphasize n = 0
-            params->getChild("texture", 0, true)->getChild("image", 0, true)
-                ->setStringValue(forest->texture);
-            effect = makeEffect(effectProp, true, options);
-            if (iter == treeEffectMap.end())
-                treeEffectMap.insert(EffectMap::value_type(forest->texture, effect));
-            else
-                iter->second = effect; // update existing, but empty observer
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(treeEffectMapMutex);
+            EffectMap::iterator iter = treeEffectMap.find(forest->texture);
+
+            if ((iter == treeEffectMap.end())||
+                (!iter->second.lock(effect)))
+            {
+                SGPropertyNode_ptr effectProp = new SGPropertyNode;
+                makeChild(effectProp, "inherits-from")->setStringValue("Effects/tree");
+                SGPropertyNode* params = makeChild(effectProp, "parameters");
+                // emphasize n = 0
+                params->getChild("texture", 0, true)->getChild("image", 0, true)
+                    ->setStringValue(forest->texture);
+                effect = makeEffect(effectProp, true, options);
+                if (iter == treeEffectMap.end())
+                    treeEffectMap.insert(EffectMap::value_type(forest->texture, effect));
+                else
+                    iter->second = effect; // update existing, but empty observer
+            }
         }
 
         // Now, create a quadtree for the forest.
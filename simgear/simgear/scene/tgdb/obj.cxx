@@ -59,6 +59,7 @@
 #include <simgear/scene/util/SGNodeMasks.hxx>
 #include <simgear/scene/util/QuadTreeBuilder.hxx>
 #include <simgear/scene/util/SGReaderWriterOptions.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "SGTexturedTriangleBin.hxx"
 #include "SGLightBin.hxx"
@@ -898,6 +899,7 @@ SGLoadBTG(const std::string& path, const simgear::SGReaderWriterOptions* options
   SGBinObject tile;
   if (!tile.read_bin(path))
     return NULL;
+  SGTimeStamp buildStart = SGTimeStamp::now();
 
   SGMaterialLib* matlib = 0;
   bool use_random_objects = false;
@@ -1179,6 +1181,10 @@ SGLoadBTG(const std::string& path, const simgear::SGReaderWriterOptions* options
     transform->addChild(objectLOD);
   }
   transform->setNodeMask( ~simgear::MODELLIGHT_BIT );
+
+  SGBinObjectStats stats;
+  stats.buildUSec = (SGTimeStamp::now() - buildStart).toUSecs();
+  SGBinObject::add_load_stats(stats);
   
   return transform;
 }
@@ -38,11 +38,13 @@
 
 using std::string;
 
-SGPerformanceMonitor::SGPerformanceMonitor(SGSubsystemMgr* subSysMgr, SGPropertyNode_ptr root) :
+SGPerformanceMonitor::SGPerformanceMonitor(SGSubsystemMgr* subSysMgr, SGPropertyNode_ptr root,
+                                           SGPropertyNode_ptr timingRoot) :
     _isEnabled(false),
     _count(0)
 {
     _root = root;
+    _timingRoot = timingRoot;
     _subSysMgr = subSysMgr;
 }
 
@@ -65,7 +67,7 @@ SGPerformanceMonitor::unbind(void)
 void
 SGPerformanceMonitor::init(void)
 {
-
+    _lastExport.stamp();
 }
 
 void
@@ -84,6 +86,12 @@ SGPerformanceMonitor::update(double dt)
             _subSysMgr->setReportTimingCb(this,0);
     }
 
+    if (_timingRoot && _lastExport.elapsedMSec() > 1000)
+    {
+        _subSysMgr->exportTiming(_timingRoot);
+        _lastExport.stamp();
+    }
+
     if (!_isEnabled)
         return;
 
@@ -36,7 +36,14 @@ class SGPerformanceMonitor : public SGSubsystem
 {
 
 public:
-    SGPerformanceMonitor(SGSubsystemMgr* subSysMgr, SGPropertyNode_ptr root);
+    /**
+     * @param root          Node for the statistics enabled on demand
+     * @param timingRoot    If set, the always collected timing histograms
+     *                      are exported below this node once per second
+     *                      (see SGSubsystemMgr::exportTiming)
+     */
+    SGPerformanceMonitor(SGSubsystemMgr* subSysMgr, SGPropertyNode_ptr root,
+                         SGPropertyNode_ptr timingRoot = 0);
 
     virtual void bind   (void);
     virtual void unbind (void);
@@ -49,8 +56,10 @@ private:
     void reportTiming(const std::string& name, SampleStatistic* timeStat);
 
     SGTimeStamp _lastUpdate;
+    SGTimeStamp _lastExport;
     SGSubsystemMgr* _subSysMgr;
     SGPropertyNode_ptr _root;
+    SGPropertyNode_ptr _timingRoot;
     SGPropertyNode_ptr _statiticsSubsystems;
     SGPropertyNode_ptr _statisticsFlag;
     SGPropertyNode_ptr _statisticsInterval;
@@ -0,0 +1,105 @@
+// SGTimingHistogram.cxx -- Fixed-size histogram of execution times
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include "SGTimingHistogram.hxx"
+
+#include <cmath>
+
+SGTimingHistogram::SGTimingHistogram()
+{
+    reset();
+}
+
+void
+SGTimingHistogram::reset()
+{
+    for (int i = 0; i < NUM_BUCKETS; i++)
+        _counts[i] = 0;
+    _samples = 0;
+    _sum = 0;
+    _max = 0;
+    _last = 0;
+    _jitterSum = 0;
+}
+
+void
+SGTimingHistogram::add(double usec)
+{
+    ++_counts[bucketIndex(usec)];
+    if (_samples > 0)
+        _jitterSum += std::fabs(usec - _last);
+    ++_samples;
+    _sum += usec;
+    _last = usec;
+    if (usec > _max)
+        _max = usec;
+}
+
+double
+SGTimingHistogram::percentile(double fraction) const
+{
+    if (_samples == 0)
+        return 0;
+
+    unsigned target = static_cast<unsigned>(std::ceil(fraction * _samples));
+    if (target < 1)
+        target = 1;
+
+    unsigned count = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        count += _counts[i];
+        if (count < target)
+            continue;
+        // the last bucket also collects everything beyond its limit
+        if (i == NUM_BUCKETS - 1 || bucketLimit(i) > _max)
+            return _max;
+        return bucketLimit(i);
+    }
+    return _max;
+}
+
+double
+SGTimingHistogram::jitter() const
+{
+    return _samples > 1 ? _jitterSum / (_samples - 1) : 0;
+}
+
+// usec = m * 2^e with m in [0.5, 1), so e selects the octave and m the
+// bucket within it.
+int
+SGTimingHistogram::bucketIndex(double usec)
+{
+    if (usec < 1)
+        return 0;
+
+    int e;
+    double m = std::frexp(usec, &e);
+    int index = (e - 1) * BUCKETS_PER_OCTAVE
+              + static_cast<int>((m - 0.5) * 2 * BUCKETS_PER_OCTAVE);
+    return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+}
+
+double
+SGTimingHistogram::bucketLimit(int index)
+{
+    int octave = index / BUCKETS_PER_OCTAVE;
+    int step = index % BUCKETS_PER_OCTAVE + 1;
+    return std::ldexp(1.0 + double(step) / BUCKETS_PER_OCTAVE, octave);
+}
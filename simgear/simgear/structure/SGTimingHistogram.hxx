@@ -0,0 +1,76 @@
+// SGTimingHistogram.hxx -- Fixed-size histogram of execution times
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef __SGTIMINGHISTOGRAM_HXX
+#define __SGTIMINGHISTOGRAM_HXX
+
+/**
+ * Histogram of execution times, cheap enough to be fed on every frame.
+ *
+ * Samples are sorted into buckets of logarithmic width (four per power of
+ * two, from 1 usec up to about half a minute), so percentiles are accurate
+ * to within 25% without storing the samples themselves. Adding a sample
+ * neither allocates nor touches more than one bucket.
+ */
+class SGTimingHistogram
+{
+public:
+    SGTimingHistogram();
+
+    /**
+     * Add a sample, in microseconds.
+     */
+    void add(double usec);
+
+    /**
+     * Discard all samples.
+     */
+    void reset();
+
+    unsigned samples() const { return _samples; }
+    double mean() const { return _samples ? _sum / _samples : 0; }
+    double max() const { return _max; }
+
+    /**
+     * Get the time not exceeded by the given fraction of samples, eg. 0.95
+     * for the 95th percentile. Returns the upper limit of the bucket the
+     * percentile falls into, but never more than max().
+     */
+    double percentile(double fraction) const;
+
+    /**
+     * Get the mean difference between consecutive samples.
+     */
+    double jitter() const;
+
+private:
+    enum {
+        BUCKETS_PER_OCTAVE = 4,
+        NUM_BUCKETS = 25 * BUCKETS_PER_OCTAVE
+    };
+
+    static int bucketIndex(double usec);
+    static double bucketLimit(int index);
+
+    unsigned _counts[NUM_BUCKETS];
+    unsigned _samples;
+    double _sum;
+    double _max;
+    double _last;
+    double _jitterSum;
+};
+
+#endif // __SGTIMINGHISTOGRAM_HXX
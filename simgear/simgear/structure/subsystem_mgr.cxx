@@ -28,6 +28,12 @@
 #include "exception.hxx"
 #include "subsystem_mgr.hxx"
 
+#include <simgear/props/props.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include <cstring>
+
 #include <simgear/math/SGMath.hxx>
 #include "SGSmplstat.hxx"
 
@@ -117,6 +123,76 @@ void SGSubsystem::stamp(const string& name)
     timingInfo.push_back(TimingInfo(name, SGTimeStamp::now()));
 }
 
+// Normalize to "a/b/" ("" for the whole tree), so a prefix match is a
+// subtree match.
+static string
+subtreeKey (const string& path)
+{
+    string::size_type begin = path.find_first_not_of('/');
+    if (begin == string::npos)
+        return "";
+    string::size_type end = path.find_last_not_of('/');
+    return path.substr(begin, end - begin + 1) + '/';
+}
+
+static bool
+subtreesOverlap (const string_list& a, const string_list& b)
+{
+    for( size_t i = 0; i < a.size(); i++ )
+        for( size_t j = 0; j < b.size(); j++ )
+        {
+            const string& shorter = a[i].size() < b[j].size() ? a[i] : b[j];
+            const string& longer = a[i].size() < b[j].size() ? b[j] : a[i];
+            if (longer.compare(0, shorter.size(), shorter) == 0)
+                return true;
+        }
+    return false;
+}
+
+void
+SGSubsystem::declare_reads (const string& path)
+{
+    _reads.push_back(subtreeKey(path));
+}
+
+void
+SGSubsystem::declare_writes (const string& path)
+{
+    _writes.push_back(subtreeKey(path));
+}
+
+void
+SGSubsystem::declare_access (const SGPropertyNode* config)
+{
+    if (!config)
+        return;
+    for( int i = 0; i < config->nChildren(); i++ )
+    {
+        const SGPropertyNode* child = config->getChild(i);
+        if (!strcmp(child->getName(), "reads"))
+            declare_reads(child->getStringValue());
+        else if (!strcmp(child->getName(), "writes"))
+            declare_writes(child->getStringValue());
+    }
+}
+
+bool
+SGSubsystem::has_declared_access () const
+{
+    return !_reads.empty() || !_writes.empty();
+}
+
+bool
+SGSubsystem::conflicts_with (const SGSubsystem& other) const
+{
+    if (!has_declared_access() || !other.has_declared_access())
+        return true;
+
+    return subtreesOverlap(_writes, other._writes)
+        || subtreesOverlap(_writes, other._reads)
+        || subtreesOverlap(_reads, other._writes);
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Implementation of SGSubsystemGroup.
 ////////////////////////////////////////////////////////////////////////
@@ -129,12 +205,15 @@ public:
     Member ();
     virtual ~Member ();
     
-    virtual void update (double delta_time_sec);
+    bool update (double delta_time_sec);
+    void timedUpdate (double delta_time_sec);
 
     void reportTiming(void) { if (reportTimingCb) reportTimingCb(reportTimingUserData, name, &timeStat); }
     void updateExecutionTime(double time) { timeStat += time;}
 
     SampleStatistic timeStat;
+    SGTimingHistogram timeHistogram;
+    double lastTime; ///< usec taken by the last update, < 0 if skipped
     std::string name;
     SGSubsystem * subsystem;
     double min_step_sec;
@@ -145,10 +224,61 @@ public:
 };
 
 
+/**
+ * Threads updating the members of one batch concurrently. The calling
+ * thread takes part as well, so it never waits idly.
+ */
+class SGSubsystemGroup::Workers
+{
+public:
+    Workers (int threads);
+    ~Workers ();
+
+    /**
+     * Update all members and return once they are done. Returns false
+     * without updating anything if the workers are busy already, ie. if
+     * called from a member updated by the workers.
+     */
+    bool run (const std::vector<Member*>& members, double delta_time_sec);
+
+    int size () const { return _threads.size(); }
+
+private:
+    class Thread : public SGThread
+    {
+    public:
+        Thread (Workers& workers) : _workers(workers) {}
+        virtual ~Thread () {}
+        virtual void run () { _workers.work(); }
+    private:
+        Workers& _workers;
+    };
+
+    void work ();
+    void finish (Member* member);
+
+    SGMutex _mutex;
+    SGWaitCondition _start;
+    SGWaitCondition _done;
+    std::vector<Thread*> _threads;
+
+    std::vector<Member*> _members;
+    size_t _next;
+    size_t _pending;
+    double _dt;
+    bool _busy;
+    bool _stop;
+};
+
+SGSubsystemGroup::Workers* SGSubsystemGroup::_workers = 0;
+
 
 SGSubsystemGroup::SGSubsystemGroup () :
+  _batchesDirty(true),
   _fixedUpdateTime(-1.0),
   _updateTimeRemainder(0.0),
+  _frameBudgetMs(0.0),
+  _overruns(0),
   _initPosition(0)
 {
 }
@@ -165,6 +295,7 @@ SGSubsystemGroup::~SGSubsystemGroup ()
 void
 SGSubsystemGroup::init ()
 {
+    _batchesDirty = true;
     for( size_t i = 0; i < _members.size(); i++ )
         _members[i]->subsystem->init();
 }
@@ -183,12 +314,14 @@ SGSubsystemGroup::incrementalInit()
   if (memberStatus == INIT_DONE)
     ++_initPosition;
   
+  _batchesDirty = true;
   return INIT_CONTINUE;
 }
 
 void
 SGSubsystemGroup::postinit ()
 {
+    _batchesDirty = true;
     for( size_t i = 0; i < _members.size(); i++ )
         _members[i]->subsystem->postinit();
 }
@@ -196,6 +329,7 @@ SGSubsystemGroup::postinit ()
 void
 SGSubsystemGroup::reinit ()
 {
+    _batchesDirty = true;
     for( size_t i = 0; i < _members.size(); i++ )
         _members[i]->subsystem->reinit();
 }
@@ -238,23 +372,60 @@ SGSubsystemGroup::update (double delta_time_sec)
       delta_time_sec = _fixedUpdateTime;
     }
 
-    bool recordTime = (reportTimingCb != NULL);
-    SGTimeStamp timeStamp;
+    // Timing histograms are always collected, the more expensive
+    // SampleStatistic only if someone is listening.
+    bool updated = false;
+    double slowestTime = 0;
+    Member* slowest = 0;
+    SGTimeStamp groupStamp = SGTimeStamp::now();
     while (loopCount-- > 0) {
+      if (_workers) {
+          if (_batchesDirty)
+              build_batches();
+
+          for( size_t i = 0; i < _batches.size(); i++ )
+          {
+              const std::vector<Member*>& batch = _batches[i];
+              if ((batch.size() > 1) && _workers->run(batch, delta_time_sec))
+                  continue;
+
+              for( size_t j = 0; j < batch.size(); j++ )
+                  batch[j]->timedUpdate(delta_time_sec); // indirect call
+          }
+      } else {
+          for( size_t i = 0; i < _members.size(); i++ )
+              _members[i]->timedUpdate(delta_time_sec); // indirect call
+      }
+
       for( size_t i = 0; i < _members.size(); i++ )
       {
-          if (recordTime)
-              timeStamp = SGTimeStamp::now();
+          double time = _members[i]->lastTime;
+          if (time < 0)
+              continue;
 
-          _members[i]->update(delta_time_sec); // indirect call
-
-          if ((recordTime)&&(reportTimingCb))
-          {
-              timeStamp = SGTimeStamp::now() - timeStamp;
-              _members[i]->updateExecutionTime(timeStamp.toUSecs());
+          if (time > slowestTime) {
+              slowestTime = time;
+              slowest = _members[i];
           }
+          updated = true;
       }
     } // of multiple update loop
+
+    if (!updated)
+        return;
+
+    double groupTime = (SGTimeStamp::now() - groupStamp).toUSecs();
+    _timeHistogram.add(groupTime);
+    if ((_frameBudgetMs > 0.0) && (groupTime > _frameBudgetMs * 1000)) {
+        ++_overruns;
+        // No member may have measured any time, eg. all too fast for the
+        // timer resolution
+        if (slowest)
+            _lastOverrun = slowest->name;
+        SG_LOG(SG_GENERAL, SG_DEBUG, "frame budget of " << _frameBudgetMs
+               << "ms exceeded: " << groupTime / 1000 << "ms, slowest "
+               << _lastOverrun << " (" << slowestTime / 1000 << "ms)");
+    }
 }
 
 void
@@ -266,6 +437,79 @@ SGSubsystemGroup::reportTiming(void)
     }
 }
 
+static void
+exportHistogram (SGPropertyNode* node, SGTimingHistogram& histogram)
+{
+    node->setIntValue("samples", histogram.samples());
+    node->setDoubleValue("mean-ms", histogram.mean() / 1000);
+    node->setDoubleValue("p50-ms", histogram.percentile(0.50) / 1000);
+    node->setDoubleValue("p95-ms", histogram.percentile(0.95) / 1000);
+    node->setDoubleValue("p99-ms", histogram.percentile(0.99) / 1000);
+    node->setDoubleValue("max-ms", histogram.max() / 1000);
+    node->setDoubleValue("jitter-ms", histogram.jitter() / 1000);
+    histogram.reset();
+}
+
+void
+SGSubsystemGroup::exportTiming(SGPropertyNode* node)
+{
+    exportHistogram(node, _timeHistogram);
+    node->setDoubleValue("budget-ms", _frameBudgetMs);
+    node->setIntValue("overruns", _overruns);
+    node->setStringValue("last-overrun", _lastOverrun);
+
+    for( size_t i = 0; i < _members.size(); i++ )
+    {
+        SGPropertyNode* child = node->getChild("subsystem", int(i), true);
+        child->setStringValue("name", _members[i]->name);
+        exportHistogram(child, _members[i]->timeHistogram);
+    }
+
+    // drop nodes of removed members
+    int count = _members.size();
+    while (node->getChild("subsystem", count))
+        node->removeChild("subsystem", count, false);
+}
+
+void
+SGSubsystemGroup::build_batches ()
+{
+    _batches.clear();
+    for( size_t i = 0; i < _members.size(); i++ )
+    {
+        Member* member = _members[i];
+        bool join = !_batches.empty();
+        for( size_t j = 0; join && j < _batches.back().size(); j++ )
+            if (member->subsystem->conflicts_with(*_batches.back()[j]->subsystem))
+                join = false;
+
+        if (join)
+            _batches.back().push_back(member);
+        else
+            _batches.push_back(std::vector<Member*>(1, member));
+    }
+    _batchesDirty = false;
+}
+
+void
+SGSubsystemGroup::set_worker_threads(int threads)
+{
+    delete _workers;
+    _workers = threads > 0 ? new Workers(threads) : 0;
+}
+
+int
+SGSubsystemGroup::get_worker_threads()
+{
+    return _workers ? _workers->size() : 0;
+}
+
+void
+SGSubsystemGroup::set_frame_budget(double budget_ms)
+{
+    _frameBudgetMs = budget_ms;
+}
+
 void
 SGSubsystemGroup::suspend ()
 {
@@ -306,6 +550,7 @@ SGSubsystemGroup::set_subsystem (const string &name, SGSubsystem * subsystem,
     member->name = name;
     member->subsystem = subsystem;
     member->min_step_sec = min_step_sec;
+    _batchesDirty = true;
 }
 
 SGSubsystem *
@@ -324,6 +569,7 @@ SGSubsystemGroup::remove_subsystem (const string &name)
     for( size_t i = 0; i < _members.size(); i++ ) {
         if (name == _members[i]->name) {
             _members.erase(_members.begin() + i);
+            _batchesDirty = true;
             return;
         }
     }
@@ -364,7 +610,8 @@ SGSubsystemGroup::get_member (const string &name, bool create)
 
 
 SGSubsystemGroup::Member::Member ()
-    : name(""),
+    : lastTime(-1),
+      name(""),
       subsystem(0),
       min_step_sec(0),
       elapsed_sec(0),
@@ -383,16 +630,16 @@ SGSubsystemGroup::Member::~Member ()
     delete subsystem;
 }
 
-void
+bool
 SGSubsystemGroup::Member::update (double delta_time_sec)
 {
     elapsed_sec += delta_time_sec;
     if (elapsed_sec < min_step_sec) {
-        return;
+        return false;
     }
     
     if (subsystem->is_suspended()) {
-        return;
+        return false;
     }
     
     try {
@@ -408,6 +655,133 @@ SGSubsystemGroup::Member::update (double delta_time_sec)
         subsystem->suspend();
       }
     }
+    return true;
+}
+
+void
+SGSubsystemGroup::Member::timedUpdate (double delta_time_sec)
+{
+    SGTimeStamp timeStamp = SGTimeStamp::now();
+    if (!update(delta_time_sec)) {
+        lastTime = -1;
+        return;
+    }
+
+    // Timing histograms are always collected, the more expensive
+    // SampleStatistic only if someone is listening.
+    lastTime = (SGTimeStamp::now() - timeStamp).toUSecs();
+    timeHistogram.add(lastTime);
+    if (reportTimingCb)
+        updateExecutionTime(lastTime);
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// Implementation of SGSubsystemGroup::Workers
+////////////////////////////////////////////////////////////////////////
+
+
+SGSubsystemGroup::Workers::Workers (int threads)
+    : _next(0),
+      _pending(0),
+      _dt(0),
+      _busy(false),
+      _stop(false)
+{
+    for( int i = 0; i < threads; i++ )
+    {
+        _threads.push_back(new Thread(*this));
+        _threads.back()->start();
+    }
+}
+
+SGSubsystemGroup::Workers::~Workers ()
+{
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _stop = true;
+        _start.broadcast();
+    }
+    for( size_t i = 0; i < _threads.size(); i++ )
+    {
+        _threads[i]->join();
+        delete _threads[i];
+    }
+}
+
+bool
+SGSubsystemGroup::Workers::run (const std::vector<Member*>& members,
+                                double delta_time_sec)
+{
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        if (_busy)
+            return false;
+        _busy = true;
+        _members = members;
+        _next = 0;
+        _pending = members.size();
+        _dt = delta_time_sec;
+        _start.broadcast();
+    }
+
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        while (_next < _members.size()) {
+            Member* member = _members[_next++];
+            _mutex.unlock();
+            finish(member);
+            _mutex.lock();
+            --_pending;
+        }
+        while (_pending > 0)
+            _done.wait(_mutex);
+        _busy = false;
+    }
+
+    // Now that the batch is done, listeners can safely run here
+    SGPropertyTransaction::dispatchDeferred();
+    return true;
+}
+
+void
+SGSubsystemGroup::Workers::work ()
+{
+    SGGuard<SGMutex> lock(_mutex);
+    for (;;) {
+        while (!_stop && _next >= _members.size())
+            _start.wait(_mutex);
+        if (_stop)
+            return;
+
+        Member* member = _members[_next++];
+        _mutex.unlock();
+        finish(member);
+        _mutex.lock();
+        if (--_pending == 0)
+            _done.signal();
+    }
+}
+
+void
+SGSubsystemGroup::Workers::finish (Member* member)
+{
+    // Member::update() only catches sg_exception, and anything escaping
+    // here would take down the worker thread.
+    try {
+        // Listeners may do anything, so they must not be called while
+        // other members are being updated. run() calls them afterwards.
+        SGPropertyTransaction transaction(SGPropertyTransaction::DEFER);
+        member->timedUpdate(_dt);
+    } catch (std::exception& e) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "caught exception processing subsystem:"
+               << member->name << "\nmessage:" << e.what());
+        member->lastTime = -1;
+    } catch (...) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "caught unknown exception processing "
+               "subsystem:" << member->name);
+        member->lastTime = -1;
+    }
 }
 
 
@@ -586,4 +960,24 @@ SGSubsystemMgr::reportTiming()
     } // of groups iteration
 }
 
+void
+SGSubsystemMgr::exportTiming(SGPropertyNode* root)
+{
+    for (int i = 0; i < MAX_GROUPS; i++) {
+        SGPropertyNode* node = root->getChild("group", i, true);
+        node->setStringValue("name", get_group_name(GroupType(i)));
+        _groups[i]->set_frame_budget(node->getDoubleValue("budget-ms"));
+        _groups[i]->exportTiming(node);
+    }
+}
+
+const char*
+SGSubsystemMgr::get_group_name(GroupType group)
+{
+    static const char* names[MAX_GROUPS] = {
+        "init", "general", "fdm", "post-fdm", "display", "sound"
+    };
+    return (group >= 0 && group < MAX_GROUPS) ? names[group] : "";
+}
+
 // end of subsystem_mgr.cxx
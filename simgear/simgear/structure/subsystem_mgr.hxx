@@ -32,6 +32,7 @@
 
 #include <simgear/timing/timestamp.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/structure/SGTimingHistogram.hxx>
 #include <simgear/misc/strutils.hxx>
 
 class TimingInfo
@@ -49,6 +50,7 @@ public:
 };
 
 class SampleStatistic;
+class SGPropertyNode;
 
 typedef std::vector<TimingInfo> eventTimeVec;
 typedef std::vector<TimingInfo>::iterator eventTimeVecIterator;
@@ -274,6 +276,47 @@ public:
    */
   void stamp(const std::string& name);
 
+  /**
+   * Declare a property subtree read by update().
+   *
+   * <p>If worker threads are enabled (see
+   * SGSubsystemGroup::set_worker_threads), a group updates consecutive
+   * members concurrently as long as their declared accesses don't
+   * conflict, ie. none of them writes a subtree another one reads or
+   * writes. Subsystems not declaring any access are always updated
+   * alone. A subsystem declaring its accesses promises not to touch any
+   * other properties, nor any other state shared with other subsystems,
+   * in update(). It also must not create or remove nodes outside the
+   * subtrees it writes. Listeners on properties changed by concurrently
+   * updated members are called on the updating thread once the batch is
+   * done (see SGPropertyTransaction::DEFER).</p>
+   *
+   * @param path Absolute path of the subtree, "/" for the whole tree
+   */
+  void declare_reads(const std::string& path);
+
+  /**
+   * Declare a property subtree written by update(). See declare_reads().
+   */
+  void declare_writes(const std::string& path);
+
+  /**
+   * Declare the accesses listed by the "reads" and "writes" children of a
+   * configuration node, eg. an instrument definition.
+   */
+  void declare_access(const SGPropertyNode* config);
+
+  /**
+   * Test whether the subsystem has declared any accesses and thus may be
+   * updated concurrently with other subsystems.
+   */
+  bool has_declared_access() const;
+
+  /**
+   * Test whether two subsystems may not be updated concurrently.
+   */
+  bool conflicts_with(const SGSubsystem& other) const;
+
 protected:
 
   bool _suspended;
@@ -282,6 +325,10 @@ protected:
 
   static SGSubsystemTimingCb reportTimingCb;
   static void* reportTimingUserData;
+
+private:
+  string_list _reads;
+  string_list _writes;
 };
 
 
@@ -317,6 +364,41 @@ public:
 
     void reportTiming(void);
 
+    /**
+     * Write the timing histograms of the group and each of its members
+     * below the given node and start collecting new ones.
+     */
+    void exportTiming(SGPropertyNode* node);
+
+    /**
+     * Set the time all members together may take per frame. Frames
+     * exceeding it are counted as overruns.
+     *
+     * @param budget_ms Budget in milliseconds, or 0 (default) for none
+     */
+    void set_frame_budget(double budget_ms);
+    double get_frame_budget() const { return _frameBudgetMs; }
+
+    /**
+     * Get the number of frames which exceeded the frame budget.
+     */
+    unsigned get_overrun_count() const { return _overruns; }
+
+    /**
+     * Get the name of the slowest member in the most recent overrun.
+     */
+    const std::string& get_last_overrun() const { return _lastOverrun; }
+
+    /**
+     * Set the number of worker threads which, together with the calling
+     * thread, update non-conflicting members of all groups concurrently
+     * (see SGSubsystem::declare_reads). The default of 0 updates all
+     * members in order on the calling thread, which is deterministic and
+     * should be used for debugging.
+     */
+    static void set_worker_threads(int threads);
+    static int get_worker_threads();
+
     /**
      *
      */
@@ -330,12 +412,25 @@ public:
 private:
 
     class Member;
+    class Workers;
     Member* get_member (const std::string &name, bool create = false);
+    void build_batches ();
 
     std::vector<Member *> _members;
+
+    /// consecutive members which can be updated concurrently
+    std::vector<std::vector<Member*> > _batches;
+    bool _batchesDirty;
+
+    static Workers* _workers;
     
     double _fixedUpdateTime;
     double _updateTimeRemainder;
+
+    SGTimingHistogram _timeHistogram;
+    double _frameBudgetMs;
+    unsigned _overruns;
+    std::string _lastOverrun;
     
   /// index of the member we are currently init-ing
     unsigned int _initPosition;
@@ -408,6 +503,20 @@ public:
     virtual SGSubsystem * get_subsystem(const std::string &name) const;
 
     void reportTiming();
+
+    /**
+     * Export the timing histograms of all groups and their members, one
+     * "group" child of root per group, and start collecting new ones.
+     * A "budget-ms" value found in a group node is applied as the frame
+     * budget of that group (see SGSubsystemGroup::set_frame_budget).
+     */
+    void exportTiming(SGPropertyNode* root);
+
+    /**
+     * Get the name of a group, as used by exportTiming().
+     */
+    static const char* get_group_name(GroupType group);
+
     void setReportTimingCb(void* userData,SGSubsystemTimingCb cb) {reportTimingCb = cb;reportTimingUserData = userData;}
 
 private:
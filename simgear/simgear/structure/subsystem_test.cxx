@@ -0,0 +1,256 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#include "subsystem_mgr.hxx"
+#include "SGTimingHistogram.hxx"
+
+#include <simgear/props/props.hxx>
+#include <simgear/structure/SGAtomic.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Subsystem taking a given time per update
+class SleepingSubsystem : public SGSubsystem
+{
+public:
+    SleepingSubsystem(unsigned msec) : _msec(msec), _updates(0) { }
+
+    virtual void update(double dt)
+    {
+        ++_updates;
+        if (_msec)
+            SGTimeStamp::sleepForMSec(_msec);
+    }
+
+    unsigned _msec;
+    int _updates;
+};
+
+void testHistogram()
+{
+    SGTimingHistogram histogram;
+    COMPARE(histogram.samples(), 0u);
+    COMPARE(histogram.percentile(0.5), 0.0);
+
+    for (int i = 1; i <= 100; ++i)
+        histogram.add(i * 10);
+
+    COMPARE(histogram.samples(), 100u);
+    COMPARE(histogram.max(), 1000.0);
+    COMPARE(histogram.mean(), 505.0);
+    COMPARE(histogram.jitter(), 10.0);
+
+    // percentiles are accurate to the bucket width (25%)
+    double p50 = histogram.percentile(0.5);
+    VERIFY(p50 >= 500 && p50 <= 500 * 1.25);
+    double p95 = histogram.percentile(0.95);
+    VERIFY(p95 >= 950 && p95 <= 1000);
+    COMPARE(histogram.percentile(1.0), 1000.0);
+
+    // sub-microsecond and very long samples
+    histogram.reset();
+    histogram.add(0.1);
+    histogram.add(1e9);
+    VERIFY(histogram.percentile(0.5) <= 1.25);
+    COMPARE(histogram.percentile(1.0), 1e9);
+}
+
+void testFrameBudget()
+{
+    SGSubsystemMgr mgr;
+    SleepingSubsystem* fast = new SleepingSubsystem(0);
+    SleepingSubsystem* slow = new SleepingSubsystem(5);
+    SleepingSubsystem* skipped = new SleepingSubsystem(0);
+    mgr.add("fast", fast, SGSubsystemMgr::FDM);
+    mgr.add("slow", slow, SGSubsystemMgr::FDM);
+    mgr.add("skipped", skipped, SGSubsystemMgr::FDM, 1000);
+
+    SGPropertyNode_ptr root(new SGPropertyNode);
+    root->setDoubleValue("group[2]/budget-ms", 2);
+    mgr.exportTiming(root);
+
+    SGSubsystemGroup* fdm = mgr.get_group(SGSubsystemMgr::FDM);
+    COMPARE(fdm->get_frame_budget(), 2.0);
+
+    for (int i = 0; i < 4; ++i)
+        mgr.update(0.01);
+
+    COMPARE(slow->_updates, 4);
+    COMPARE(skipped->_updates, 0);
+    COMPARE(fdm->get_overrun_count(), 4u);
+    COMPARE(fdm->get_last_overrun(), string("slow"));
+    COMPARE(mgr.get_group(SGSubsystemMgr::GENERAL)->get_overrun_count(), 0u);
+
+    mgr.exportTiming(root);
+    SGPropertyNode* group = root->getChild("group", SGSubsystemMgr::FDM);
+    COMPARE(group->getStringValue("name"), string("fdm"));
+    COMPARE(group->getIntValue("samples"), 4);
+    COMPARE(group->getIntValue("overruns"), 4);
+    COMPARE(group->getStringValue("last-overrun"), string("slow"));
+    VERIFY(group->getDoubleValue("p50-ms") >= 5);
+
+    SGPropertyNode* member = group->getChild("subsystem", 1);
+    COMPARE(member->getStringValue("name"), string("slow"));
+    COMPARE(member->getIntValue("samples"), 4);
+    VERIFY(member->getDoubleValue("max-ms") >= 5);
+    COMPARE(group->getChild("subsystem", 2)->getIntValue("samples"), 0);
+
+    // histograms restart after each export
+    mgr.exportTiming(root);
+    COMPARE(group->getIntValue("samples"), 0);
+    COMPARE(group->getIntValue("overruns"), 4);
+
+    // removed members disappear from the export
+    delete mgr.remove("skipped");
+    mgr.exportTiming(root);
+    VERIFY(group->getChild("subsystem", 2) == NULL);
+}
+
+// Subsystem recording how many subsystems were running concurrently
+class ConcurrentSubsystem : public SGSubsystem
+{
+public:
+    ConcurrentSubsystem(const string& writes, const string& reads) :
+        _maxRunning(0)
+    {
+        declare_writes(writes);
+        if (!reads.empty())
+            declare_reads(reads);
+    }
+
+    virtual void update(double dt)
+    {
+        unsigned running = ++_running;
+        if (running > _maxRunning)
+            _maxRunning = running;
+        SGTimeStamp::sleepForMSec(20);
+        if (_output)
+            _output->setIntValue(_output->getIntValue() + 1);
+        --_running;
+    }
+
+    unsigned _maxRunning;
+    SGPropertyNode_ptr _output;
+    static SGAtomic _running;
+};
+
+class ThreadCheckingListener : public SGPropertyChangeListener
+{
+public:
+    ThreadCheckingListener() : _thread(SGThread::current()) {}
+
+    virtual void valueChanged(SGPropertyNode*)
+    {
+        ++_calls;
+        if (SGThread::current() != _thread)
+            ++_foreignCalls;
+    }
+
+    long _thread;
+    SGAtomic _calls;
+    SGAtomic _foreignCalls;
+};
+
+SGAtomic ConcurrentSubsystem::_running;
+
+void testConflicts()
+{
+    ConcurrentSubsystem a("/instrumentation/altimeter", "/position"),
+                        b("instrumentation/airspeed-indicator/", "/velocities"),
+                        c("/position/altitude-ft", ""),
+                        d("/instrumentation", "");
+    SleepingSubsystem undeclared(0);
+
+    VERIFY(!a.conflicts_with(b));
+    VERIFY(a.conflicts_with(c)); // reads what c writes
+    VERIFY(c.conflicts_with(a));
+    VERIFY(a.conflicts_with(d)); // same subtree written
+    VERIFY(!b.conflicts_with(c));
+    VERIFY(a.conflicts_with(undeclared));
+    VERIFY(!undeclared.has_declared_access());
+
+    // "altimeter" is no subtree of "alt"
+    ConcurrentSubsystem e("/instrumentation/alt", "");
+    VERIFY(!a.conflicts_with(e));
+
+    ConcurrentSubsystem f("/", "");
+    VERIFY(f.conflicts_with(b));
+
+    SGPropertyNode_ptr config(new SGPropertyNode);
+    config->setStringValue("reads[0]", "/position");
+    config->setStringValue("writes[0]", "/instrumentation/encoder");
+    undeclared.declare_access(config);
+    VERIFY(undeclared.has_declared_access());
+    VERIFY(undeclared.conflicts_with(c));
+    VERIFY(!undeclared.conflicts_with(b));
+}
+
+void testParallelUpdate()
+{
+    SGSubsystemGroup group;
+    ConcurrentSubsystem* a = new ConcurrentSubsystem("/a", "/input");
+    ConcurrentSubsystem* b = new ConcurrentSubsystem("/b", "/input");
+    ConcurrentSubsystem* c = new ConcurrentSubsystem("/c", "/input");
+    ConcurrentSubsystem* writer = new ConcurrentSubsystem("/input", "");
+    group.set_subsystem("a", a);
+    group.set_subsystem("b", b);
+    group.set_subsystem("c", c);
+    group.set_subsystem("writer", writer);
+
+    // serial by default
+    COMPARE(SGSubsystemGroup::get_worker_threads(), 0);
+    group.update(0.01);
+    COMPARE(a->_maxRunning, 1u);
+    COMPARE(c->_maxRunning, 1u);
+
+    SGSubsystemGroup::set_worker_threads(2);
+    COMPARE(SGSubsystemGroup::get_worker_threads(), 2);
+
+    // listeners are only called by the updating thread
+    SGPropertyNode_ptr outputs(new SGPropertyNode);
+    ThreadCheckingListener listener;
+    outputs->addChangeListener(&listener);
+    a->_output = outputs->getNode("a", true);
+    b->_output = outputs->getNode("b", true);
+    c->_output = outputs->getNode("c", true);
+
+    SGTimeStamp start = SGTimeStamp::now();
+    group.update(0.01);
+    double elapsedMs = (SGTimeStamp::now() - start).toMSecs();
+
+    // a, b and c run together, the writer of their input afterwards
+    unsigned maxRunning = std::max(a->_maxRunning,
+                                   std::max(b->_maxRunning, c->_maxRunning));
+    COMPARE(maxRunning, 3u);
+    COMPARE(writer->_maxRunning, 1u);
+    VERIFY(elapsedMs < 3 * 20);
+    COMPARE(unsigned(listener._calls), 3u);
+    COMPARE(unsigned(listener._foreignCalls), 0u);
+    outputs->removeChangeListener(&listener);
+
+    SGSubsystemGroup::set_worker_threads(0);
+    COMPARE(SGSubsystemGroup::get_worker_threads(), 0);
+}
+
+int main(int argc, char* argv[])
+{
+    testHistogram();
+    testFrameBudget();
+    testConflicts();
+    testParallelUpdate();
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
@@ -5,9 +5,12 @@
 
 #include <cassert>
 #include <queue>
+#include <vector>
 #include "SGGuard.hxx"
 #include "SGThread.hxx"
 
+#include <simgear/structure/SGAtomic.hxx>
+
 /**
  * SGQueue defines an interface for a FIFO.
  * It can be implemented using different types of synchronization
@@ -264,6 +267,342 @@ private:
 };
 
 
+/**
+ * Rounds a requested queue capacity up to a power of two.
+ */
+inline unsigned SGQueueCapacity( unsigned capacity )
+{
+    unsigned result = 2;
+    while (result < capacity && result < (1u << 30))
+        result <<= 1;
+    return result;
+}
+
+/**
+ * A bounded lock-free queue for exactly one producer thread and one
+ * consumer thread, eg. a worker thread handing results to the main loop.
+ *
+ * Unlike the guarded queues no call ever blocks on a mutex. The price is
+ * a fixed capacity: try_push() fails while the queue is full, and push()
+ * yields until the consumer made room. pop() returns a default
+ * constructed item if the queue is empty, like SGLockedQueue. Popped slots
+ * are reset to T(), so shared pointers are released by the consumer.
+ */
+template<class T>
+class SGSingleProducerQueue : public SGQueue<T>
+{
+public:
+    /**
+     * Create a new queue.
+     *
+     * @param capacity Maximum number of items, rounded up to a power of two.
+     */
+    explicit SGSingleProducerQueue( unsigned capacity = 1024 ) :
+        buffer(SGQueueCapacity(capacity)),
+        mask(buffer.size() - 1),
+        consumer_head(0),
+        consumer_tail(0),
+        producer_tail(0),
+        producer_head(0)
+    {}
+
+    ~SGSingleProducerQueue() {}
+
+    virtual bool empty() {
+        return size() == 0;
+    }
+
+    /**
+     * Add an item to the end of the queue, waiting for room if necessary.
+     * Only to be called by the producer thread.
+     */
+    virtual void push( const T& item ) {
+        while (!try_push(item))
+            SGThread::yield();
+    }
+
+    /**
+     * Add an item to the end of the queue if there is room for it. Only to
+     * be called by the producer thread.
+     *
+     * @return false if the queue is full.
+     */
+    bool try_push( const T& item ) {
+        if (producer_tail - producer_head > mask) {
+            producer_head = head;
+            if (producer_tail - producer_head > mask)
+                return false;
+        }
+        buffer[producer_tail & mask] = item;
+        ++producer_tail;
+        ++tail;                 // publishes the item (full barrier)
+        return true;
+    }
+
+    /**
+     * View the item from the head of the queue. Only to be called by the
+     * consumer thread.
+     */
+    virtual T front() {
+        assert( !empty() );
+        return buffer[consumer_head & mask];
+    }
+
+    /**
+     * Get an item from the head of the queue, or T() if it is empty. Only
+     * to be called by the consumer thread.
+     */
+    virtual T pop() {
+        T item = T();
+        try_pop(item);
+        return item;
+    }
+
+    /**
+     * Get an item from the head of the queue if there is one. Only to be
+     * called by the consumer thread.
+     *
+     * @return false if the queue is empty.
+     */
+    bool try_pop( T& item ) {
+        if (consumer_head == consumer_tail) {
+            consumer_tail = tail;
+            if (consumer_head == consumer_tail)
+                return false;
+        }
+        item = buffer[consumer_head & mask];
+        buffer[consumer_head & mask] = T();
+        ++consumer_head;
+        ++head;                 // hands the slot back (full barrier)
+        return true;
+    }
+
+    /**
+     * Append up to max_items items to a vector. Only to be called by the
+     * consumer thread.
+     *
+     * @return Number of items appended.
+     */
+    size_t pop_batch( std::vector<T>& items, size_t max_items = size_t(-1) ) {
+        consumer_tail = tail;
+        unsigned h = consumer_head;
+        unsigned n = consumer_tail - h;
+        if (n > max_items)
+            n = max_items;
+        for (unsigned i = 0; i < n; ++i) {
+            items.push_back(buffer[(h + i) & mask]);
+            buffer[(h + i) & mask] = T();
+        }
+        // Single consumer: nobody else moves head, so one CAS suffices
+        if (n) {
+            consumer_head += n;
+            head.compareAndExchange(h, h + n);
+        }
+        return n;
+    }
+
+    /**
+     * Query the number of items. Only a snapshot if called while other
+     * threads use the queue.
+     */
+    virtual size_t size() {
+        return unsigned(tail) - unsigned(head);
+    }
+
+    /**
+     * Query the maximum number of items.
+     */
+    size_t capacity() const {
+        return buffer.size();
+    }
+
+private:
+    std::vector<T> buffer;
+    const unsigned mask;
+
+    // Shared positions, and each side's private copies of them, which
+    // save reading the shared ones (a full barrier) on every call. All on
+    // separate cache lines, so neither side slows down the other.
+    char pad0[64];
+    SGAtomic head;
+    unsigned consumer_head;
+    unsigned consumer_tail;
+    char pad1[64];
+    SGAtomic tail;
+    unsigned producer_tail;
+    unsigned producer_head;
+    char pad2[64];
+
+private:
+    // Prevent copying.
+    SGSingleProducerQueue( const SGSingleProducerQueue& );
+    SGSingleProducerQueue& operator=( const SGSingleProducerQueue& );
+};
+
+
+/**
+ * A bounded lock-free queue for any number of producer and consumer
+ * threads (D. Vyukov's bounded MPMC queue).
+ *
+ * Each slot carries a sequence number telling whether it is ready to be
+ * written or read in the current round, so producers and consumers only
+ * ever compete for their own position counter. Otherwise this behaves
+ * like SGSingleProducerQueue. front() is only reliable with a single
+ * consumer.
+ */
+template<class T>
+class SGMultiProducerQueue : public SGQueue<T>
+{
+public:
+    /**
+     * Create a new queue.
+     *
+     * @param capacity Maximum number of items, rounded up to a power of two.
+     */
+    explicit SGMultiProducerQueue( unsigned capacity = 1024 ) :
+        mask(SGQueueCapacity(capacity) - 1),
+        cells(new Cell[mask + 1])
+    {
+        for (unsigned i = 0; i <= mask; ++i)
+            cells[i].sequence.compareAndExchange(0, i);
+    }
+
+    ~SGMultiProducerQueue() {
+        delete[] cells;
+    }
+
+    virtual bool empty() {
+        return size() == 0;
+    }
+
+    /**
+     * Add an item to the end of the queue, waiting for room if necessary.
+     */
+    virtual void push( const T& item ) {
+        while (!try_push(item))
+            SGThread::yield();
+    }
+
+    /**
+     * Add an item to the end of the queue if there is room for it.
+     *
+     * @return false if the queue is full.
+     */
+    bool try_push( const T& item ) {
+        Cell* cell;
+        unsigned pos = enqueue_pos;
+        for (;;) {
+            cell = &cells[pos & mask];
+            int diff = int(unsigned(cell->sequence) - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compareAndExchange(pos, pos + 1))
+                    break;
+            } else if (diff < 0) {
+                return false;   // slot still holds an item from last round
+            }
+            pos = enqueue_pos;
+        }
+        cell->data = item;
+        ++cell->sequence;       // pos + 1: ready to be read
+        return true;
+    }
+
+    /**
+     * View the item from the head of the queue.
+     */
+    virtual T front() {
+        assert( !empty() );
+        return cells[unsigned(dequeue_pos) & mask].data;
+    }
+
+    /**
+     * Get an item from the head of the queue, or T() if it is empty.
+     */
+    virtual T pop() {
+        T item = T();
+        try_pop(item);
+        return item;
+    }
+
+    /**
+     * Get an item from the head of the queue if there is one.
+     *
+     * @return false if the queue is empty.
+     */
+    bool try_pop( T& item ) {
+        Cell* cell;
+        unsigned pos = dequeue_pos;
+        for (;;) {
+            cell = &cells[pos & mask];
+            int diff = int(unsigned(cell->sequence) - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos.compareAndExchange(pos, pos + 1))
+                    break;
+            } else if (diff < 0) {
+                return false;   // slot not yet written in this round
+            }
+            pos = dequeue_pos;
+        }
+        item = cell->data;
+        cell->data = T();
+        // We own the slot, so this can't fail: ready for the next round
+        cell->sequence.compareAndExchange(pos + 1, pos + mask + 1);
+        return true;
+    }
+
+    /**
+     * Append up to max_items items to a vector.
+     *
+     * @return Number of items appended.
+     */
+    size_t pop_batch( std::vector<T>& items, size_t max_items = size_t(-1) ) {
+        size_t n = 0;
+        T item;
+        while (n < max_items && try_pop(item)) {
+            items.push_back(item);
+            ++n;
+        }
+        return n;
+    }
+
+    /**
+     * Query the number of items. Only a snapshot if called while other
+     * threads use the queue.
+     */
+    virtual size_t size() {
+        int n = int(unsigned(enqueue_pos) - unsigned(dequeue_pos));
+        return n > 0 ? n : 0;
+    }
+
+    /**
+     * Query the maximum number of items.
+     */
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    struct Cell {
+        SGAtomic sequence;
+        T data;
+    };
+
+    const unsigned mask;
+    Cell* const cells;
+
+    char pad0[64];
+    SGAtomic enqueue_pos;
+    char pad1[64];
+    SGAtomic dequeue_pos;
+    char pad2[64];
+
+private:
+    // Prevent copying.
+    SGMultiProducerQueue( const SGMultiProducerQueue& );
+    SGMultiProducerQueue& operator=( const SGMultiProducerQueue& );
+};
+
+
 /**
  * A guarded deque blocks threads trying to retrieve items
  * when none are available.
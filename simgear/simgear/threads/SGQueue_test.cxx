@@ -0,0 +1,175 @@
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <simgear/compiler.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "SGQueue.hxx"
+#include "SGThread.hxx"
+
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+template<class Queue>
+void testBasic(Queue& queue)
+{
+    COMPARE(queue.capacity(), 8u);
+    VERIFY(queue.empty());
+    COMPARE(queue.pop(), 0);
+
+    for (int i = 1; i <= 8; ++i)
+        VERIFY(queue.try_push(i));
+    VERIFY(!queue.try_push(9));
+    COMPARE(queue.size(), 8u);
+    COMPARE(queue.front(), 1);
+
+    COMPARE(queue.pop(), 1);
+    COMPARE(queue.pop(), 2);
+    VERIFY(queue.try_push(9));
+
+    std::vector<int> items;
+    COMPARE(queue.pop_batch(items, 3), 3u);
+    COMPARE(items.size(), 3u);
+    COMPARE(items[0], 3);
+    COMPARE(items[2], 5);
+
+    // wraps around the ring several times
+    for (int i = 10; i < 100; ++i) {
+        queue.push(i);
+        int expected = i - 4;
+        COMPARE(queue.pop(), expected);
+    }
+
+    items.clear();
+    COMPARE(queue.pop_batch(items), 4u);
+    COMPARE(items.back(), 99);
+    VERIFY(queue.empty());
+    int item = 0;
+    VERIFY(!queue.try_pop(item));
+}
+
+// Pushes count items with values first, first + 1, ...
+template<class Queue>
+class Producer : public SGThread
+{
+public:
+    Producer(Queue& queue, int first, int count) :
+        _queue(queue), _first(first), _count(count)
+    { }
+
+    virtual void run()
+    {
+        for (int i = 0; i < _count; ++i)
+            _queue.push(_first + i);
+    }
+
+    Queue& _queue;
+    int _first;
+    int _count;
+};
+
+// Consumes items until it has seen count of them. Zero means "empty" for
+// the mutex based queues, which don't have try_pop().
+template<class Queue>
+void consume(Queue& queue, int count, std::vector<int>& last,
+             long long& sum, int producerCount, int perProducer)
+{
+    for (int n = 0; n < count;) {
+        int item = queue.pop();
+        if (item == 0) {
+            SGThread::yield();
+            continue;
+        }
+        ++n;
+        sum += item;
+
+        // items of one producer must arrive in order
+        int producer = (item - 1) / perProducer;
+        VERIFY(producer < producerCount);
+        VERIFY(item > last[producer]);
+        last[producer] = item;
+    }
+}
+
+/**
+ * Run producers pushing into one consumer and return the throughput in
+ * items per msec.
+ */
+template<class Queue>
+double run(Queue& queue, int producerCount, int perProducer)
+{
+    std::vector<Producer<Queue>*> producers;
+    for (int i = 0; i < producerCount; ++i)
+        producers.push_back(new Producer<Queue>(queue, i * perProducer + 1,
+                                                perProducer));
+
+    SGTimeStamp start = SGTimeStamp::now();
+    for (int i = 0; i < producerCount; ++i)
+        producers[i]->start();
+
+    std::vector<int> last(producerCount, 0);
+    long long sum = 0;
+    int total = producerCount * perProducer;
+    consume(queue, total, last, sum, producerCount, perProducer);
+    double msecs = (SGTimeStamp::now() - start).toMSecs();
+
+    for (int i = 0; i < producerCount; ++i) {
+        producers[i]->join();
+        delete producers[i];
+    }
+
+    COMPARE(sum, (long long)total * (total + 1) / 2);
+    VERIFY(queue.empty());
+    return total / (msecs > 0 ? msecs : 1e-3);
+}
+
+void testThreaded()
+{
+    SGSingleProducerQueue<int> spsc(64);
+    run(spsc, 1, 100000);
+
+    SGMultiProducerQueue<int> mpmc(64);
+    run(mpmc, 4, 25000);
+}
+
+void benchmark()
+{
+    const int items = 400000;
+
+    cout << "Queue throughput (items per msec)" << endl;
+    cout << "producers\tlocked\tmulti-producer\tsingle-producer" << endl;
+    for (int producers = 1; producers <= 4; producers *= 2) {
+        SGLockedQueue<int> locked;
+        SGMultiProducerQueue<int> mpmc(4096);
+        cout << producers
+             << '\t' << run(locked, producers, items / producers)
+             << '\t' << run(mpmc, producers, items / producers);
+        if (producers == 1) {
+            SGSingleProducerQueue<int> spsc(4096);
+            cout << '\t' << run(spsc, 1, items);
+        }
+        cout << endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    SGSingleProducerQueue<int> spsc(5);
+    testBasic(spsc);
+    SGMultiProducerQueue<int> mpmc(8);
+    testBasic(mpmc);
+
+    testThreaded();
+    benchmark();
+
+    cout << __FILE__ << ": All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
@@ -85,6 +85,10 @@ long SGThread::current( void ) {
     return (long)GetCurrentThreadId();
 }
 
+void SGThread::yield( void ) {
+    SwitchToThread();
+}
+
 struct SGMutex::PrivateData {
     PrivateData()
     {
@@ -180,6 +184,7 @@ struct SGWaitCondition::PrivateData {
 /////////////////////////////////////////////////////////////////////////////
 
 #include <pthread.h>
+#include <sched.h>
 #include <cassert>
 #include <cerrno>
 #include <sys/time.h>
@@ -235,6 +240,10 @@ long SGThread::current( void ) {
     return (long)pthread_self();
 }
 
+void SGThread::yield( void ) {
+    sched_yield();
+}
+
 struct SGMutex::PrivateData {
     PrivateData()
     {
@@ -55,6 +55,11 @@ public:
      */
     static long current( void );
 
+    /**
+     * Give up the rest of the calling thread's time slice.
+     */
+    static void yield( void );
+
 protected:
     /**
      * Destroy a thread object.